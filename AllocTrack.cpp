@@ -0,0 +1,163 @@
+/*
+*  AllocTrack.cpp
+*
+*  Allocation counting for the steady state check. See AllocTrack.h.
+*
+*/
+
+#include <stddef.h>
+#include <atomic>
+#ifdef _WIN32
+#  include <windows.h>
+#  include <crtdbg.h>
+#elif defined(__GLIBC__)
+#  include <execinfo.h>
+#endif
+#include <AR/ar.h>
+#include "AllocTrack.h"
+
+#ifdef _MSC_VER
+#  define ALLOC_TLS __declspec(thread)
+#else
+#  define ALLOC_TLS __thread
+#endif
+
+#if defined(ALLOC_TRACKING) && defined(__GLIBC__)
+#  define ALLOC_TRACK_GLIBC
+#elif defined(ALLOC_TRACKING) && defined(_WIN32) && defined(_DEBUG)
+#  define ALLOC_TRACK_CRTDBG
+#endif
+
+static ALLOC_TLS int    gAllocTracking = 0;
+static ALLOC_TLS long   gAllocCount = 0;
+static ALLOC_TLS void   *gAllocStack[ALLOC_STACK_MAX];
+static ALLOC_TLS int    gAllocDepth = 0;
+static std::atomic<long> gAllocTotal(0);
+
+// Called for every allocation. Only the first tracked one on a thread
+// captures its stack; tracking is off meanwhile in case that allocates.
+static inline void allocNote(void)
+{
+	gAllocTotal.fetch_add(1, std::memory_order_relaxed);
+	if (!gAllocTracking) return;
+	if (gAllocCount++) return;
+	gAllocTracking = 0;
+#if defined(_WIN32)
+	gAllocDepth = CaptureStackBackTrace(1, ALLOC_STACK_MAX, gAllocStack, NULL);
+#elif defined(__GLIBC__)
+	gAllocDepth = backtrace(gAllocStack, ALLOC_STACK_MAX);
+#endif
+	gAllocTracking = 1;
+}
+
+#if defined(ALLOC_TRACK_GLIBC)
+
+extern "C" {
+	void *__libc_malloc(size_t size);
+	void *__libc_calloc(size_t n, size_t size);
+	void *__libc_realloc(void *p, size_t size);
+	void *__libc_memalign(size_t alignment, size_t size);
+	void __libc_free(void *p);
+
+	void *malloc(size_t size)
+	{
+		allocNote();
+		return __libc_malloc(size);
+	}
+
+	void *calloc(size_t n, size_t size)
+	{
+		allocNote();
+		return __libc_calloc(n, size);
+	}
+
+	void *realloc(void *p, size_t size)
+	{
+		allocNote();
+		return __libc_realloc(p, size);
+	}
+
+	void *memalign(size_t alignment, size_t size)
+	{
+		allocNote();
+		return __libc_memalign(alignment, size);
+	}
+
+	void *aligned_alloc(size_t alignment, size_t size)
+	{
+		allocNote();
+		return __libc_memalign(alignment, size);
+	}
+
+	int posix_memalign(void **p, size_t alignment, size_t size)
+	{
+		allocNote();
+		*p = __libc_memalign(alignment, size);
+		return *p ? 0 : 12; // ENOMEM
+	}
+
+	void free(void *p)
+	{
+		__libc_free(p);
+	}
+}
+
+int allocTrackAvailable(void)
+{
+	return (TRUE);
+}
+
+#elif defined(ALLOC_TRACK_CRTDBG)
+
+static int allocHook(int allocType, void *userData, size_t size, int blockType, long requestNumber, const unsigned char *filename, int lineNumber)
+{
+	(void)userData; (void)size; (void)requestNumber; (void)filename; (void)lineNumber;
+	if (blockType != _CRT_BLOCK && (allocType == _HOOK_ALLOC || allocType == _HOOK_REALLOC)) allocNote();
+	return (TRUE);
+}
+
+int allocTrackAvailable(void)
+{
+	static int installed = FALSE;
+
+	if (!installed) {
+		_CrtSetAllocHook(allocHook);
+		installed = TRUE;
+	}
+	return (TRUE);
+}
+
+#else
+
+int allocTrackAvailable(void)
+{
+	return (FALSE);
+}
+
+#endif
+
+void allocTrackBegin(void)
+{
+	gAllocCount = 0;
+	gAllocDepth = 0;
+	gAllocTracking = 1;
+}
+
+long allocTrackEnd(void)
+{
+	gAllocTracking = 0;
+	return gAllocCount;
+}
+
+int allocTrackFirstStack(void **pcs, int max)
+{
+	int i;
+
+	for (i = 0; i < gAllocDepth && i < max; i++) pcs[i] = gAllocStack[i];
+	return i;
+}
+
+long allocTrackTotal(void)
+{
+	return gAllocTotal.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,35 @@
+/*
+*  AllocTrack.h
+*
+*  Allocation counting for the steady state check.
+*
+*  Build with ALLOC_TRACKING defined to count heap allocations. With glibc
+*  malloc(), calloc(), realloc() and the aligned variants are interposed
+*  and forwarded to the __libc_ implementations; with the Windows debug
+*  CRT an _CrtSetAllocHook() hook does the counting. Operator new goes
+*  through malloc() and is counted too. Without ALLOC_TRACKING (or on
+*  other platforms) nothing is interposed and allocTrackAvailable()
+*  returns FALSE.
+*
+*  Counting is per thread: only allocations made by a thread between its
+*  allocTrackBegin() and allocTrackEnd() are counted for it.
+*
+*/
+
+#ifndef ALLOC_TRACK_H
+#define ALLOC_TRACK_H
+
+#define ALLOC_STACK_MAX     8
+
+int   allocTrackAvailable(void);
+
+void  allocTrackBegin(void);
+long  allocTrackEnd(void);          // Allocations on this thread since allocTrackBegin().
+// Stack of the first of them (innermost first, starting inside the
+// allocator), where the platform can capture one. Returns the depth.
+int   allocTrackFirstStack(void **pcs, int max);
+
+// Allocations on all threads since start up.
+long  allocTrackTotal(void);
+
+#endif // !ALLOC_TRACK_H
@@ -0,0 +1,722 @@
+/*
+*  BitLabel.cpp
+*
+*  Bit-packed binarization and run-length labeling of marker candidates.
+*  See BitLabel.h.
+*
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "BitLabel.h"
+#include "Kernels.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#  define BIT_LABEL_SSE2
+#  include <emmintrin.h>
+#endif
+#if defined(_MSC_VER)
+#  include <intrin.h>
+#endif
+
+// Foreground test used by the contour tracer, so that the bit and byte
+// paths share it.
+typedef int (*BitPixelFunc)(const void *data, int xsize, int x, int y);
+
+static int bitCtz64(uint64_t v)
+{
+#if defined(_MSC_VER) && defined(_M_X64)
+	unsigned long i;
+	_BitScanForward64(&i, v);
+	return (int)i;
+#elif defined(_MSC_VER)
+	unsigned long i;
+	if ((uint32_t)v) { _BitScanForward(&i, (uint32_t)v); return (int)i; }
+	_BitScanForward(&i, (uint32_t)(v >> 32));
+	return (int)i + 32;
+#else
+	return __builtin_ctzll(v);
+#endif
+}
+
+static int bitGrow(void **array, int *max, int need, size_t size)
+{
+	void *p;
+	int n;
+
+	if (need <= *max) return (TRUE);
+	n = *max ? *max : need;
+	while (n < need) n *= 2;
+	if ((p = realloc(*array, n * size)) == NULL) {
+		ARLOGe("bitGrow(): Out of memory.\n");
+		return (FALSE);
+	}
+	*array = p;
+	*max = n;
+	return (TRUE);
+}
+
+// Worst cases over the labeled interior, so that labeling never has to
+// grow its arrays mid-stream: alternating pixels give a run per two
+// columns on every row, and isolated pixels (8-connected) a component
+// per 2x2 block. About 6 MB for 640x480.
+static int bitMaxRuns(int xsize, int ysize)
+{
+	return ((xsize - 2 + 1) / 2) * (ysize - 2);
+}
+
+static int bitMaxComps(int xsize, int ysize)
+{
+	return ((xsize - 2 + 1) / 2) * ((ysize - 2 + 1) / 2);
+}
+
+int bitLabelInit(BitLabel *bl, int xsize, int ysize)
+{
+	memset(bl, 0, sizeof(BitLabel));
+	bl->black = TRUE;
+	bl->areaMin = AR_AREA_MIN;
+	bl->areaMax = AR_AREA_MAX;
+	bl->image.xsize = xsize;
+	bl->image.ysize = ysize;
+	bl->image.wordsPerRow = (xsize + 63) / 64;
+	bl->image.bits = (uint64_t *)calloc((size_t)bl->image.wordsPerRow * ysize, sizeof(uint64_t));
+	bl->coordX = (int *)malloc((BIT_CHAIN_MAX + 1) * sizeof(int));
+	bl->coordY = (int *)malloc((BIT_CHAIN_MAX + 1) * sizeof(int));
+	if (!bl->image.bits || !bl->coordX || !bl->coordY ||
+		!bitGrow((void **)&bl->runs, &bl->runMax, bitMaxRuns(xsize, ysize), sizeof(BitRun)) ||
+		!bitGrow((void **)&bl->comps, &bl->compMax, bitMaxComps(xsize, ysize), sizeof(BitComponent))) {
+		ARLOGe("bitLabelInit(): Out of memory.\n");
+		bitLabelFinal(bl);
+		return (FALSE);
+	}
+	return (TRUE);
+}
+
+void bitLabelFinal(BitLabel *bl)
+{
+	free(bl->image.bits);
+	free(bl->runs);
+	free(bl->comps);
+	free(bl->coordX);
+	free(bl->coordY);
+	memset(bl, 0, sizeof(BitLabel));
+}
+
+// ============================================================================
+//	Thresholding
+// ============================================================================
+
+// Luma as ARToolKit's labeling sees it. RGB formats compare the sum of
+// the three channels against 3 * thresh, so the sum is returned with the
+// threshold scaled to match.
+static int bitLumaScale(AR_PIXEL_FORMAT pixFormat)
+{
+	switch (pixFormat) {
+	case AR_PIXEL_FORMAT_RGB:
+	case AR_PIXEL_FORMAT_BGR:
+	case AR_PIXEL_FORMAT_RGBA:
+	case AR_PIXEL_FORMAT_BGRA:
+	case AR_PIXEL_FORMAT_ARGB:
+	case AR_PIXEL_FORMAT_ABGR:
+		return 3;
+	default:
+		return 1;
+	}
+}
+
+static int bitLuma(const ARUint8 *image, AR_PIXEL_FORMAT pixFormat, int i)
+{
+	const ARUint8 *p;
+
+	switch (pixFormat) {
+	case AR_PIXEL_FORMAT_RGB:
+	case AR_PIXEL_FORMAT_BGR:
+		p = image + i * 3;
+		return p[0] + p[1] + p[2];
+	case AR_PIXEL_FORMAT_RGBA:
+	case AR_PIXEL_FORMAT_BGRA:
+		p = image + i * 4;
+		return p[0] + p[1] + p[2];
+	case AR_PIXEL_FORMAT_ARGB:
+	case AR_PIXEL_FORMAT_ABGR:
+		p = image + i * 4;
+		return p[1] + p[2] + p[3];
+	case AR_PIXEL_FORMAT_2vuy:
+		return image[i * 2 + 1];
+	case AR_PIXEL_FORMAT_yuvs:
+		return image[i * 2];
+	default:                            // MONO and the planar YUV formats.
+		return image[i];
+	}
+}
+
+// Formats whose luma is a plane of bytes, which kernelThreshold() takes
+// directly.
+static int bitLumaPlanar(AR_PIXEL_FORMAT pixFormat)
+{
+	switch (pixFormat) {
+	case AR_PIXEL_FORMAT_MONO:
+	case AR_PIXEL_FORMAT_420v:
+	case AR_PIXEL_FORMAT_420f:
+	case AR_PIXEL_FORMAT_NV21:
+		return (TRUE);
+	default:
+		return (FALSE);
+	}
+}
+
+#ifdef BIT_LABEL_SSE2
+// 16 luma bytes starting at pixel i, for the packed formats with an 8 bit
+// luma channel. Returns FALSE for the others.
+static int bitLoadLuma16(const ARUint8 *image, AR_PIXEL_FORMAT pixFormat, int i, __m128i *out)
+{
+	__m128i a, b;
+
+	switch (pixFormat) {
+	case AR_PIXEL_FORMAT_yuvs:
+		a = _mm_loadu_si128((const __m128i *)(image + i * 2));
+		b = _mm_loadu_si128((const __m128i *)(image + i * 2 + 16));
+		*out = _mm_packus_epi16(_mm_and_si128(a, _mm_set1_epi16(0xFF)), _mm_and_si128(b, _mm_set1_epi16(0xFF)));
+		return (TRUE);
+	case AR_PIXEL_FORMAT_2vuy:
+		a = _mm_loadu_si128((const __m128i *)(image + i * 2));
+		b = _mm_loadu_si128((const __m128i *)(image + i * 2 + 16));
+		*out = _mm_packus_epi16(_mm_srli_epi16(a, 8), _mm_srli_epi16(b, 8));
+		return (TRUE);
+	default:
+		return (FALSE);
+	}
+}
+#endif
+
+void bitThreshold(BitLabel *bl, const ARUint8 *image, AR_PIXEL_FORMAT pixFormat, int thresh)
+{
+	BitImage *bi = &bl->image;
+	uint64_t *row, word, invert;
+	int x, y, w, k, t, xsize, planar;
+#ifdef BIT_LABEL_SSE2
+	__m128i l, tv;
+	int simd;
+#endif
+
+	xsize = bi->xsize;
+	t = thresh * bitLumaScale(pixFormat);
+	invert = bl->black ? 0 : ~(uint64_t)0;
+	planar = (bitLumaPlanar(pixFormat) && thresh >= 0 && thresh <= 255);
+#ifdef BIT_LABEL_SSE2
+	tv = _mm_set1_epi8((char)(thresh < 0 ? 0 : thresh > 255 ? 255 : thresh));
+	simd = ((pixFormat == AR_PIXEL_FORMAT_yuvs || pixFormat == AR_PIXEL_FORMAT_2vuy) && thresh >= 0 && thresh <= 255);
+#endif
+
+	memset(bi->bits, 0, (size_t)bi->wordsPerRow * sizeof(uint64_t));
+	for (y = 1; y < bi->ysize - 1; y++) {
+		row = bi->bits + (size_t)y * bi->wordsPerRow;
+		x = w = 0;
+		if (planar) {
+			// Whole words straight from the plane; the rest of the row below.
+			w = xsize >> 6;
+			kernelThreshold(image + (size_t)y * xsize, w, thresh, row);
+			for (k = 0; k < w; k++) row[k] ^= invert;
+			x = w << 6;
+		}
+		for (; w < bi->wordsPerRow; w++) {
+			word = 0;
+#ifdef BIT_LABEL_SSE2
+			if (simd && x + 64 <= xsize) {
+				for (k = 0; k < 4; k++) {
+					bitLoadLuma16(image, pixFormat, y * xsize + x + k * 16, &l);
+					// l <= t  <=>  min(l, t) == l
+					word |= (uint64_t)(unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_min_epu8(l, tv), l)) << (k * 16);
+				}
+				word ^= invert;
+				x += 64;
+			}
+			else
+#endif
+			{
+				for (k = 0; k < 64 && x < xsize; k++, x++) {
+					if ((bitLuma(image, pixFormat, y * xsize + x) <= t) == (bl->black != 0)) word |= (uint64_t)1 << k;
+				}
+			}
+			row[w] = word;
+		}
+		// Clear the border columns and the padding past xsize.
+		row[0] &= ~(uint64_t)1;
+		row[(xsize - 1) >> 6] &= ((uint64_t)1 << ((xsize - 1) & 63)) - 1;
+	}
+	memset(bi->bits + (size_t)(bi->ysize - 1) * bi->wordsPerRow, 0, (size_t)bi->wordsPerRow * sizeof(uint64_t));
+}
+
+static int bitPixel(const void *data, int xsize, int x, int y)
+{
+	const BitImage *bi = (const BitImage *)data;
+
+	(void)xsize;
+	return (int)((bi->bits[(size_t)y * bi->wordsPerRow + (x >> 6)] >> (x & 63)) & 1);
+}
+
+// ============================================================================
+//	Run-length labeling
+// ============================================================================
+
+static int bitFind(BitRun *runs, int i)
+{
+	int r, n;
+
+	r = i;
+	while (runs[r].parent != r) r = runs[r].parent;
+	while (runs[i].parent != r) {
+		n = runs[i].parent;
+		runs[i].parent = r;
+		i = n;
+	}
+	return r;
+}
+
+// The root is always the lowest index, i.e. the first run in raster order.
+static void bitUnion(BitRun *runs, int a, int b)
+{
+	a = bitFind(runs, a);
+	b = bitFind(runs, b);
+	if (a < b) runs[b].parent = a;
+	else if (b < a) runs[a].parent = b;
+}
+
+// Pull the runs out of the bit image. A run starts or ends wherever a
+// bit differs from the one before it, so the transitions of a word are
+// word ^ (word << 1 | carry) and each one costs a single ctz.
+static int bitRuns(BitLabel *bl)
+{
+	BitImage *bi = &bl->image;
+	const uint64_t *row;
+	uint64_t v, t, carry;
+	int x, y, w, i, start;
+
+	bl->runNum = 0;
+	for (y = 1; y < bi->ysize - 1; y++) {
+		row = bi->bits + (size_t)y * bi->wordsPerRow;
+		carry = 0;
+		start = 0;
+		for (w = 0; w < bi->wordsPerRow; w++) {
+			v = row[w];
+			t = v ^ ((v << 1) | carry);
+			carry = v >> 63;
+			while (t) {
+				i = bitCtz64(t);
+				t &= t - 1;
+				x = w * 64 + i;
+				if ((v >> i) & 1) {
+					start = x;
+					continue;
+				}
+				if (bl->runNum == bl->runMax &&
+					!bitGrow((void **)&bl->runs, &bl->runMax, bl->runNum + 1, sizeof(BitRun))) return (FALSE);
+				bl->runs[bl->runNum].x0 = start;
+				bl->runs[bl->runNum].x1 = x;
+				bl->runs[bl->runNum].y = y;
+				bl->runs[bl->runNum].parent = bl->runNum;
+				bl->runNum++;
+			}
+		}
+	}
+	return (TRUE);
+}
+
+// 8-connected labeling of the runs. Runs [x0, x1) on neighbouring rows
+// touch (including diagonally) when a.x0 <= b.x1 and b.x0 <= a.x1.
+static int bitLabelRuns(BitLabel *bl)
+{
+	BitRun *runs = bl->runs;
+	BitComponent *c;
+	int i, p, q, r, prevStart, prevEnd, curStart, root, len;
+
+	prevStart = prevEnd = 0;
+	for (curStart = 0; curStart < bl->runNum; curStart = i) {
+		for (i = curStart; i < bl->runNum && runs[i].y == runs[curStart].y; i++);
+		if (prevEnd > prevStart && runs[prevStart].y == runs[curStart].y - 1) {
+			p = prevStart;
+			for (q = curStart; q < i; q++) {
+				while (p < prevEnd && runs[p].x1 < runs[q].x0) p++;
+				for (r = p; r < prevEnd && runs[r].x0 <= runs[q].x1; r++) bitUnion(runs, q, r);
+			}
+		}
+		prevStart = curStart;
+		prevEnd = i;
+	}
+
+	// Components in order of their first run, which is also the order in
+	// which ARToolKit numbers its labels. Parents always have lower indices,
+	// so one pass in order flattens every run onto its root; a root then
+	// stores its component as -1 - index.
+	bl->compNum = 0;
+	for (i = 0; i < bl->runNum; i++) {
+		p = runs[i].parent;
+		if (p == i) {
+			if (bl->compNum == bl->compMax &&
+				!bitGrow((void **)&bl->comps, &bl->compMax, bl->compNum + 1, sizeof(BitComponent))) return (FALSE);
+			c = &bl->comps[bl->compNum];
+			c->area = 0;
+			c->sumX = c->sumY = 0.0;
+			c->clip[0] = runs[i].x0; c->clip[1] = runs[i].x1 - 1;
+			c->clip[2] = c->clip[3] = runs[i].y;
+			c->sx = runs[i].x0;
+			c->sy = runs[i].y;
+			runs[i].parent = -1 - bl->compNum++;
+			root = i;
+		}
+		else {
+			root = runs[p].parent < 0 ? p : runs[p].parent;
+			runs[i].parent = root;
+		}
+		c = &bl->comps[-1 - runs[root].parent];
+		len = runs[i].x1 - runs[i].x0;
+		c->area += len;
+		c->sumX += (double)(runs[i].x0 + runs[i].x1 - 1) * len * 0.5;
+		c->sumY += (double)runs[i].y * len;
+		if (runs[i].x0 < c->clip[0]) c->clip[0] = runs[i].x0;
+		if (runs[i].x1 - 1 > c->clip[1]) c->clip[1] = runs[i].x1 - 1;
+		c->clip[3] = runs[i].y;
+	}
+	return (TRUE);
+}
+
+// ============================================================================
+//	Contour and square fitting, after arDetectMarker2()
+// ============================================================================
+
+static void bitReverse(int *a, int i, int j)
+{
+	int t;
+
+	for (j--; i < j; i++, j--) {
+		t = a[i];
+		a[i] = a[j];
+		a[j] = t;
+	}
+}
+
+// Rotate a[0..num) left by k, in place.
+static void bitRotate(int *a, int num, int k)
+{
+	bitReverse(a, 0, k);
+	bitReverse(a, k, num);
+	bitReverse(a, 0, num);
+}
+
+static int bitGetContour(const void *data, BitPixelFunc fg, int xsize, const BitComponent *c, int *xc, int *yc)
+{
+	static const int xdir[8] = { 0, 1, 1, 1, 0, -1, -1, -1 };
+	static const int ydir[8] = { -1, -1, 0, 1, 1, 1, 0, -1 };
+	int x, y, dir, i, num, v1, d, dmax;
+
+	x = c->sx;
+	y = c->sy;
+	num = 0;
+	xc[num] = x;
+	yc[num] = y;
+	num++;
+	dir = 5;
+	for (;;) {
+		dir = (dir + 5) % 8;
+		for (i = 0; i < 8; i++) {
+			if (fg(data, xsize, x + xdir[dir], y + ydir[dir])) break;
+			dir = (dir + 1) % 8;
+		}
+		if (i == 8) return (-1);        // Single pixel; cannot happen above areaMin.
+		x += xdir[dir];
+		y += ydir[dir];
+		xc[num] = x;
+		yc[num] = y;
+		if (x == c->sx && y == c->sy) break;
+		num++;
+		if (num == BIT_CHAIN_MAX - 1) return (-1);
+	}
+
+	// Start the contour at the point furthest from where tracing started.
+	dmax = 0;
+	v1 = 0;
+	for (i = 1; i < num; i++) {
+		d = (xc[i] - xc[0]) * (xc[i] - xc[0]) + (yc[i] - yc[0]) * (yc[i] - yc[0]);
+		if (d > dmax) {
+			dmax = d;
+			v1 = i;
+		}
+	}
+	bitRotate(xc, num, v1);
+	bitRotate(yc, num, v1);
+	xc[num] = xc[0];
+	yc[num] = yc[0];
+	return num + 1;
+}
+
+static int bitGetVertex(const int *xc, const int *yc, int st, int ed, double thresh, int vertex[], int *vnum)
+{
+	double a, b, c, d, dmax;
+	int i, v1 = 0;
+
+	a = yc[ed] - yc[st];
+	b = xc[st] - xc[ed];
+	c = (double)xc[ed] * yc[st] - (double)yc[ed] * xc[st];
+	dmax = 0;
+	for (i = st + 1; i < ed; i++) {
+		d = a*xc[i] + b*yc[i] + c;
+		if (d*d > dmax) {
+			dmax = d*d;
+			v1 = i;
+		}
+	}
+	if (dmax / (a*a + b*b) > thresh) {
+		if (bitGetVertex(xc, yc, st, v1, thresh, vertex, vnum) < 0) return (-1);
+		if ((*vnum) > 5) return (-1);
+		vertex[*vnum] = v1;
+		(*vnum)++;
+		if (bitGetVertex(xc, yc, v1, ed, thresh, vertex, vnum) < 0) return (-1);
+	}
+	return (0);
+}
+
+static int bitCheckSquare(int area, const int *xc, const int *yc, int num, int vertex[4])
+{
+	int sx, sy, d, dmax, i, v1, v2;
+	int wv1[10], wv2[10], wvnum1, wvnum2;
+	double thresh;
+
+	sx = xc[0];
+	sy = yc[0];
+	dmax = 0;
+	v1 = 0;
+	for (i = 1; i < num - 1; i++) {
+		d = (xc[i] - sx)*(xc[i] - sx) + (yc[i] - sy)*(yc[i] - sy);
+		if (d > dmax) {
+			dmax = d;
+			v1 = i;
+		}
+	}
+
+	thresh = (area / 0.75) * 0.01 * AR_SQUARE_FIT_THRESH;
+	wvnum1 = wvnum2 = 0;
+	if (bitGetVertex(xc, yc, 0, v1, thresh, wv1, &wvnum1) < 0) return (FALSE);
+	if (bitGetVertex(xc, yc, v1, num - 1, thresh, wv2, &wvnum2) < 0) return (FALSE);
+
+	if (wvnum1 == 1 && wvnum2 == 1) {
+		vertex[0] = 0; vertex[1] = wv1[0]; vertex[2] = v1; vertex[3] = wv2[0];
+	}
+	else if (wvnum1 > 1 && wvnum2 == 0) {
+		v2 = v1 / 2;
+		wvnum1 = wvnum2 = 0;
+		if (bitGetVertex(xc, yc, 0, v2, thresh, wv1, &wvnum1) < 0) return (FALSE);
+		if (bitGetVertex(xc, yc, v2, v1, thresh, wv2, &wvnum2) < 0) return (FALSE);
+		if (wvnum1 != 1 || wvnum2 != 1) return (FALSE);
+		vertex[0] = 0; vertex[1] = wv1[0]; vertex[2] = wv2[0]; vertex[3] = v1;
+	}
+	else if (wvnum1 == 0 && wvnum2 > 1) {
+		v2 = (v1 + num - 1) / 2;
+		wvnum1 = wvnum2 = 0;
+		if (bitGetVertex(xc, yc, v1, v2, thresh, wv1, &wvnum1) < 0) return (FALSE);
+		if (bitGetVertex(xc, yc, v2, num - 1, thresh, wv2, &wvnum2) < 0) return (FALSE);
+		if (wvnum1 != 1 || wvnum2 != 1) return (FALSE);
+		vertex[0] = 0; vertex[1] = v1; vertex[2] = wv1[0]; vertex[3] = wv2[0];
+	}
+	else {
+		return (FALSE);
+	}
+	return (TRUE);
+}
+
+// Candidate selection shared by both paths: area and border checks, then
+// contour and square fit, then removal of candidates nested in larger ones.
+static int bitCandidates(BitLabel *bl, const void *data, BitPixelFunc fg, const BitComponent *comps, int compNum, BitCandidate *out)
+{
+	const BitComponent *c;
+	int xsize, ysize, i, j, k, n, num, vertex[4];
+	double dx, dy, d;
+
+	xsize = bl->image.xsize;
+	ysize = bl->image.ysize;
+	n = 0;
+	for (i = 0; i < compNum && n < BIT_CANDIDATE_MAX; i++) {
+		c = &comps[i];
+		if (c->area < bl->areaMin || c->area > bl->areaMax) continue;
+		if (c->clip[0] == 1 || c->clip[1] == xsize - 2 || c->clip[2] == 1 || c->clip[3] == ysize - 2) continue;
+		if ((num = bitGetContour(data, fg, xsize, c, bl->coordX, bl->coordY)) < 0) continue;
+		if (!bitCheckSquare(c->area, bl->coordX, bl->coordY, num, vertex)) continue;
+		out[n].area = c->area;
+		out[n].pos[0] = c->sumX / c->area;
+		out[n].pos[1] = c->sumY / c->area;
+		for (k = 0; k < 4; k++) {
+			out[n].vertex[k][0] = bl->coordX[vertex[k]];
+			out[n].vertex[k][1] = bl->coordY[vertex[k]];
+		}
+		n++;
+	}
+
+	for (i = 0; i < n; i++) {
+		for (j = i + 1; j < n; j++) {
+			dx = out[i].pos[0] - out[j].pos[0];
+			dy = out[i].pos[1] - out[j].pos[1];
+			d = dx*dx + dy*dy;
+			if (out[i].area > out[j].area) {
+				if (d < out[i].area / 4) out[j].area = 0;
+			}
+			else {
+				if (d < out[j].area / 4) out[i].area = 0;
+			}
+		}
+	}
+	for (i = j = 0; i < n; i++) {
+		if (out[i].area == 0) continue;
+		if (i != j) out[j] = out[i];
+		j++;
+	}
+	return j;
+}
+
+int bitLabelDetect(BitLabel *bl, const ARUint8 *image, AR_PIXEL_FORMAT pixFormat, int thresh)
+{
+	bitThreshold(bl, image, pixFormat, thresh);
+	if (!bitRuns(bl) || !bitLabelRuns(bl)) {
+		bl->candidateNum = 0;
+		return 0;
+	}
+	bl->candidateNum = bitCandidates(bl, &bl->image, bitPixel, bl->comps, bl->compNum, bl->candidates);
+	return bl->candidateNum;
+}
+
+// ============================================================================
+//	Byte per pixel reference
+// ============================================================================
+
+static int bytePixel(const void *data, int xsize, int x, int y)
+{
+	return ((const ARUint8 *)data)[y * xsize + x];
+}
+
+static int byteFind(int *parent, int i)
+{
+	while (parent[i] != i) i = parent[i] = parent[parent[i]];
+	return i;
+}
+
+int bitLabelReference(BitLabel *bl, const ARUint8 *image, AR_PIXEL_FORMAT pixFormat, int thresh, BitCandidate *candidates)
+{
+	static const int nx[4] = { -1, 0, 1, -1 }, ny[4] = { -1, -1, -1, 0 };
+	ARUint8 *binary;
+	int *label, *parent, *compOf;
+	BitComponent *comps, *c;
+	int xsize, ysize, x, y, k, l, a, b, t, labelNum, compNum, n;
+
+	xsize = bl->image.xsize;
+	ysize = bl->image.ysize;
+	binary = (ARUint8 *)calloc((size_t)xsize * ysize, 1);
+	label = (int *)calloc((size_t)xsize * ysize, sizeof(int));
+	parent = (int *)malloc(((size_t)xsize * ysize / 2 + 2) * sizeof(int));
+	compOf = (int *)malloc(((size_t)xsize * ysize / 2 + 2) * sizeof(int));
+	comps = (BitComponent *)malloc(((size_t)xsize * ysize / 2 + 2) * sizeof(BitComponent));
+	if (!binary || !label || !parent || !compOf || !comps) {
+		n = -1;
+		goto done;
+	}
+
+	t = thresh * bitLumaScale(pixFormat);
+	for (y = 1; y < ysize - 1; y++) {
+		for (x = 1; x < xsize - 1; x++) {
+			binary[y*xsize + x] = ((bitLuma(image, pixFormat, y*xsize + x) <= t) == (bl->black != 0));
+		}
+	}
+
+	// Classic two pass labeling over the already labeled 8-neighbours.
+	labelNum = 0;
+	for (y = 1; y < ysize - 1; y++) {
+		for (x = 1; x < xsize - 1; x++) {
+			if (!binary[y*xsize + x]) continue;
+			l = 0;
+			for (k = 0; k < 4; k++) {
+				if (!(a = label[(y + ny[k])*xsize + x + nx[k]])) continue;
+				if (!l) {
+					l = a;
+					continue;
+				}
+				a = byteFind(parent, a);
+				b = byteFind(parent, l);
+				if (a < b) parent[b] = a;
+				else if (b < a) parent[a] = b;
+			}
+			if (!l) {
+				l = ++labelNum;
+				parent[l] = l;
+			}
+			label[y*xsize + x] = l;
+		}
+	}
+
+	compNum = 0;
+	for (l = 1; l <= labelNum; l++) compOf[l] = -1;
+	for (y = 1; y < ysize - 1; y++) {
+		for (x = 1; x < xsize - 1; x++) {
+			if (!(l = label[y*xsize + x])) continue;
+			l = byteFind(parent, l);
+			if (compOf[l] < 0) {
+				compOf[l] = compNum;
+				c = &comps[compNum++];
+				c->area = 0;
+				c->sumX = c->sumY = 0.0;
+				c->clip[0] = c->clip[1] = x;
+				c->clip[2] = c->clip[3] = y;
+				c->sx = x;
+				c->sy = y;
+			}
+			c = &comps[compOf[l]];
+			c->area++;
+			c->sumX += x;
+			c->sumY += y;
+			if (x < c->clip[0]) c->clip[0] = x;
+			if (x > c->clip[1]) c->clip[1] = x;
+			c->clip[3] = y;
+		}
+	}
+
+	n = bitCandidates(bl, binary, bytePixel, comps, compNum, candidates);
+
+done:
+	free(binary);
+	free(label);
+	free(parent);
+	free(compOf);
+	free(comps);
+	return n;
+}
+
+int bitLabelCompare(const BitCandidate *a, int aNum, const BitCandidate *b, int bNum)
+{
+	int i, j, k;
+
+	if (aNum != bNum) return (FALSE);
+	for (i = 0; i < aNum; i++) {
+		for (j = 0; j < bNum; j++) {
+			if (a[i].area != b[j].area || fabs(a[i].pos[0] - b[j].pos[0]) > 1e-6 || fabs(a[i].pos[1] - b[j].pos[1]) > 1e-6) continue;
+			for (k = 0; k < 4; k++) {
+				if (a[i].vertex[k][0] != b[j].vertex[k][0] || a[i].vertex[k][1] != b[j].vertex[k][1]) break;
+			}
+			if (k == 4) break;
+		}
+		if (j == bNum) return (FALSE);
+	}
+	return (TRUE);
+}
+
+int bitLabelCompareAR(const BitLabel *bl, const ARHandle *arHandle)
+{
+	int i, j;
+
+	if (bl->candidateNum != arHandle->marker2_num) return (FALSE);
+	for (i = 0; i < bl->candidateNum; i++) {
+		for (j = 0; j < arHandle->marker2_num; j++) {
+			if (bl->candidates[i].area == arHandle->markerInfo2[j].area &&
+				fabs(bl->candidates[i].pos[0] - arHandle->markerInfo2[j].pos[0]) < 0.1 &&
+				fabs(bl->candidates[i].pos[1] - arHandle->markerInfo2[j].pos[1]) < 0.1) break;
+		}
+		if (j == arHandle->marker2_num) return (FALSE);
+	}
+	return (TRUE);
+}
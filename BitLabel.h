@@ -0,0 +1,92 @@
+/*
+*  BitLabel.h
+*
+*  Bit-packed binarization and run-length labeling of marker candidates.
+*
+*  The threshold kernel packs 64 pixels into each word (SSE2 compare and
+*  movemask where available), labeling works on the runs read straight
+*  out of those words, and contour tracing and square fitting follow
+*  arDetectMarker2() so that the candidates match ARToolKit's
+*  markerInfo2. A 640x480 frame is 38 KB of bits instead of the 300 KB
+*  byte image and 600 KB label image of the byte path.
+*
+*  bitLabelReference() runs the same candidate search on a byte per
+*  pixel image with pixel-wise labeling; bitLabelCompare() checks the
+*  two agree.
+*
+*/
+
+#ifndef BIT_LABEL_H
+#define BIT_LABEL_H
+
+#include <stdint.h>
+#include <AR/ar.h>
+
+#define BIT_CANDIDATE_MAX   60          // Same as AR_SQUARE_MAX.
+#define BIT_CHAIN_MAX       10000       // Same as AR_CHAIN_MAX.
+
+typedef struct {
+	int       xsize, ysize;
+	int       wordsPerRow;
+	uint64_t  *bits;                    // Bit x of a row is bit (x & 63) of word (x >> 6).
+} BitImage;
+
+typedef struct {
+	int       x0, x1, y;                // Pixels [x0, x1) of row y.
+	int       parent;                   // Union-find, then component index.
+} BitRun;
+
+typedef struct {
+	int       area;
+	double    sumX, sumY;
+	int       clip[4];                  // xmin, xmax, ymin, ymax.
+	int       sx, sy;                   // First pixel in raster order, where tracing starts.
+} BitComponent;
+
+typedef struct {
+	int       area;
+	double    pos[2];                   // Centroid.
+	int       vertex[4][2];             // Corners in contour order.
+} BitCandidate;
+
+typedef struct {
+	BitImage      image;
+	int           black;                // Label dark regions (TRUE) or light ones.
+	int           areaMin, areaMax;
+
+	BitRun        *runs;
+	int           runNum, runMax;
+	BitComponent  *comps;
+	int           compNum, compMax;
+	int           *coordX, *coordY;     // Contour scratch, BIT_CHAIN_MAX + 1 each.
+
+	BitCandidate  candidates[BIT_CANDIDATE_MAX];
+	int           candidateNum;
+} BitLabel;
+
+int  bitLabelInit(BitLabel *bl, int xsize, int ysize);
+void bitLabelFinal(BitLabel *bl);
+
+// Binarize the image into bl->image. Pixels are foreground when their
+// luma is <= thresh (black regions) or > thresh (white regions), with
+// the same per-format luma as ARToolKit's labeling. The one pixel image
+// border is always background.
+void bitThreshold(BitLabel *bl, const ARUint8 *image, AR_PIXEL_FORMAT pixFormat, int thresh);
+
+// Threshold, label and fit squares. Returns the number of candidates,
+// which are left in bl->candidates.
+int  bitLabelDetect(BitLabel *bl, const ARUint8 *image, AR_PIXEL_FORMAT pixFormat, int thresh);
+
+// Byte per pixel reference for bitLabelDetect(). Allocates per call, so
+// only meant for checking. Returns the number of candidates, or -1.
+int  bitLabelReference(BitLabel *bl, const ARUint8 *image, AR_PIXEL_FORMAT pixFormat, int thresh, BitCandidate *candidates);
+
+// TRUE if both sets hold the same candidates (in any order).
+int  bitLabelCompare(const BitCandidate *a, int aNum, const BitCandidate *b, int bNum);
+
+// TRUE if the candidates match ARToolKit's markerInfo2 from the last
+// arDetectMarker() on the same frame (same areas, centroids within a
+// tenth of a pixel).
+int  bitLabelCompareAR(const BitLabel *bl, const ARHandle *arHandle);
+
+#endif // !BIT_LABEL_H
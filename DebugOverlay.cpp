@@ -0,0 +1,268 @@
+/*
+*  DebugOverlay.cpp
+*
+*  Detection's labels, candidates and markers over the video. See
+*  DebugOverlay.h.
+*
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef _WIN32
+#  define snprintf _snprintf
+#endif
+#include <AR/ar.h>
+#include "DebugOverlay.h"
+#include "Timing.h"
+
+#define DEBUG_CPU_SMOOTHING     0.05    // Weight of each frame in the mean CPU time.
+
+int debugOverlayInit(DebugOverlay *dov, int xsize, int ysize, int imageInterval)
+{
+	memset(dov, 0, sizeof(DebugOverlay));
+	dov->xsize = xsize;
+	dov->ysize = ysize;
+	dov->imageInterval = imageInterval > 0 ? imageInterval : 1;
+	dov->imageWidth = xsize / DEBUG_IMAGE_SCALE;
+	dov->imageHeight = ysize / DEBUG_IMAGE_SCALE;
+	if (!(dov->image = (unsigned char *)calloc((size_t)dov->imageWidth * dov->imageHeight, 1))) {
+		ARLOGe("debugOverlayInit(): Out of memory.\n");
+		return (FALSE);
+	}
+	dov->imageDetection = -1;
+	return (TRUE);
+}
+
+void debugOverlayFinal(DebugOverlay *dov)
+{
+	if (dov->texture) glDeleteTextures(1, &dov->texture);
+	free(dov->image);
+	memset(dov, 0, sizeof(DebugOverlay));
+}
+
+void debugOverlaySetMode(DebugOverlay *dov, DEBUG_OVERLAY_MODE mode)
+{
+	dov->mode = mode;
+	dov->detections = 0;
+	dov->imageDue = (mode == DEBUG_OVERLAY_IMAGE);
+	dov->labelNum = dov->candidateNum = dov->markerNum = 0;
+	dov->imageDetection = -1;
+	dov->cpu = dov->pending = 0.0;
+}
+
+const char *debugOverlayModeName(DEBUG_OVERLAY_MODE mode)
+{
+	switch (mode) {
+	case DEBUG_OVERLAY_OFF:   return "off";
+	case DEBUG_OVERLAY_ON:    return "overlay";
+	case DEBUG_OVERLAY_IMAGE: return "overlay and binarized image";
+	default: return "?";
+	}
+}
+
+int debugOverlayWantsImage(const DebugOverlay *dov)
+{
+	return (dov->mode == DEBUG_OVERLAY_IMAGE && dov->imageDue);
+}
+
+// Every DEBUG_IMAGE_SCALEth pixel of ARToolKit's binarized image, which
+// is of the field in field mode.
+static void debugOverlayCopyImage(DebugOverlay *dov, const ARUint8 *bw, int field)
+{
+	const int step = field ? DEBUG_IMAGE_SCALE / 2 : DEBUG_IMAGE_SCALE;
+	const int width = field ? dov->xsize / 2 : dov->xsize;
+	unsigned char *d = dov->image;
+	const ARUint8 *row;
+	int i, j;
+
+	for (j = 0; j < dov->imageHeight; j++) {
+		row = bw + (size_t)j * step * width;
+		for (i = 0; i < dov->imageWidth; i++) *d++ = row[i * step];
+	}
+	dov->imageNew = TRUE;
+	dov->imageDetection = dov->detections;
+}
+
+void debugOverlayAfterDetect(DebugOverlay *dov, ARHandle *arHandle, int detected)
+{
+	const ARLabelInfo *li = &arHandle->labelInfo;
+	const ARMarkerInfo2 *m2;
+	double start;
+	int i, k, mode, scale;
+
+	if (dov->mode == DEBUG_OVERLAY_OFF) return;
+	start = timingNow();
+	arGetImageProcMode(arHandle, &mode);
+	if (detected) {
+		// Labels are of the field in field mode; candidates and markers
+		// are scaled back to the frame.
+		scale = (mode == AR_IMAGE_PROC_FIELD_IMAGE) ? 2 : 1;
+		dov->labelNum = 0;
+		for (i = 0; i < li->label_num && dov->labelNum < DEBUG_LABELS_MAX; i++) {
+			if (li->area[i] * scale * scale < DEBUG_LABEL_AREA_MIN) continue;
+			for (k = 0; k < 4; k++) dov->labels[dov->labelNum][k] = (short)(li->clip[i][k] * scale);
+			dov->labelNum++;
+		}
+		dov->candidateNum = arHandle->marker2_num;
+		for (i = 0; i < dov->candidateNum; i++) {
+			m2 = &arHandle->markerInfo2[i];
+			for (k = 0; k < 4; k++) {
+				dov->candidates[i][k][0] = (float)m2->x_coord[m2->vertex[k]];
+				dov->candidates[i][k][1] = (float)m2->y_coord[m2->vertex[k]];
+			}
+		}
+		dov->markerNum = arHandle->marker_num;
+		for (i = 0; i < dov->markerNum; i++) {
+			for (k = 0; k < 4; k++) {
+				dov->markers[i].vertex[k][0] = (float)arHandle->markerInfo[i].vertex[k][0];
+				dov->markers[i].vertex[k][1] = (float)arHandle->markerInfo[i].vertex[k][1];
+			}
+			dov->markers[i].id = arHandle->markerInfo[i].id;
+			dov->markers[i].cf = (float)arHandle->markerInfo[i].cf;
+		}
+		arGetLabelingThresh(arHandle, &dov->thresh);    // As the auto modes set it for this frame.
+		arGetLabelingThreshMode(arHandle, &dov->threshMode);
+		dov->detections++;
+	}
+
+	// ARToolKit's debug mode only for the one detection; argl would
+	// otherwise draw the binarized image in place of the video. It was
+	// not switched on for a frame that was skipped.
+	if (dov->mode == DEBUG_OVERLAY_IMAGE && dov->imageDue) {
+		if (detected) {
+			if (li->bwImage) {
+				debugOverlayCopyImage(dov, li->bwImage, mode == AR_IMAGE_PROC_FIELD_IMAGE);
+				dov->imageDue = FALSE;
+			}
+			arSetDebugMode(arHandle, AR_DEBUG_DISABLE);
+		}
+	}
+	else if (dov->mode == DEBUG_OVERLAY_IMAGE && dov->detections - dov->imageDetection >= dov->imageInterval) {
+		dov->imageDue = TRUE;
+	}
+	dov->pending += timingNow() - start;
+}
+
+static void debugOverlayText(const char *text, float x, float y)
+{
+	glRasterPos2f(x, y);
+	while (*text) glutBitmapCharacter(GLUT_BITMAP_HELVETICA_10, *text++);
+}
+
+void debugOverlayDraw(DebugOverlay *dov, int windowWidth, int windowHeight)
+{
+	const float sx = (float)windowWidth / (float)dov->xsize, sy = (float)windowHeight / (float)dov->ysize;
+	const char *threshMode;
+	char text[64];
+	float x, y, w, h;
+	double start;
+	int i, k;
+
+	if (dov->mode == DEBUG_OVERLAY_OFF) return;
+	start = timingNow();
+
+	glPushAttrib(GL_ENABLE_BIT | GL_CURRENT_BIT | GL_TEXTURE_BIT | GL_LINE_BIT | GL_POINT_BIT);
+	glDisable(GL_LIGHTING);
+	glDisable(GL_DEPTH_TEST);
+	glDisable(GL_TEXTURE_2D);
+
+	// Frame pixels, y down, to window coordinates, y up.
+#define DEBUG_X(px) ((px) * sx)
+#define DEBUG_Y(py) ((float)windowHeight - (py) * sy)
+
+	glLineWidth(1.0f);
+	glBegin(GL_LINES);
+	glColor3f(0.3f, 0.5f, 1.0f);
+	for (i = 0; i < dov->labelNum; i++) {
+		x = DEBUG_X(dov->labels[i][0]); w = DEBUG_X(dov->labels[i][1]);
+		y = DEBUG_Y(dov->labels[i][2]); h = DEBUG_Y(dov->labels[i][3]);
+		glVertex2f(x, y); glVertex2f(w, y);
+		glVertex2f(w, y); glVertex2f(w, h);
+		glVertex2f(w, h); glVertex2f(x, h);
+		glVertex2f(x, h); glVertex2f(x, y);
+	}
+	glColor3f(1.0f, 1.0f, 0.0f);
+	for (i = 0; i < dov->candidateNum; i++) {
+		for (k = 0; k < 4; k++) {
+			glVertex2f(DEBUG_X(dov->candidates[i][k][0]), DEBUG_Y(dov->candidates[i][k][1]));
+			glVertex2f(DEBUG_X(dov->candidates[i][(k + 1) % 4][0]), DEBUG_Y(dov->candidates[i][(k + 1) % 4][1]));
+		}
+	}
+	glEnd();
+
+	// Markers: green if a pattern matched, red if not, corner 0 marked.
+	glLineWidth(2.0f);
+	for (i = 0; i < dov->markerNum; i++) {
+		if (dov->markers[i].id >= 0) glColor3f(0.0f, 1.0f, 0.0f);
+		else glColor3f(1.0f, 0.0f, 0.0f);
+		glBegin(GL_LINE_LOOP);
+		for (k = 0; k < 4; k++) glVertex2f(DEBUG_X(dov->markers[i].vertex[k][0]), DEBUG_Y(dov->markers[i].vertex[k][1]));
+		glEnd();
+		glPointSize(5.0f);
+		glBegin(GL_POINTS);
+		glVertex2f(DEBUG_X(dov->markers[i].vertex[0][0]), DEBUG_Y(dov->markers[i].vertex[0][1]));
+		glEnd();
+		x = y = 0.0f;
+		for (k = 0; k < 4; k++) {
+			x += dov->markers[i].vertex[k][0] * 0.25f;
+			y += dov->markers[i].vertex[k][1] * 0.25f;
+		}
+		snprintf(text, sizeof(text), "%d %0.2f", dov->markers[i].id, dov->markers[i].cf);
+		debugOverlayText(text, DEBUG_X(x), DEBUG_Y(y));
+	}
+
+#undef DEBUG_X
+#undef DEBUG_Y
+
+	// The last binarized image, bottom right.
+	w = (float)windowWidth / DEBUG_IMAGE_SCALE;
+	h = (float)windowHeight / DEBUG_IMAGE_SCALE;
+	x = (float)windowWidth - w;
+	if (dov->mode == DEBUG_OVERLAY_IMAGE && dov->imageDetection >= 0) {
+		if (!dov->texture) {
+			glGenTextures(1, &dov->texture);
+			glBindTexture(GL_TEXTURE_2D, dov->texture);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+			glTexImage2D(GL_TEXTURE_2D, 0, GL_LUMINANCE, dov->imageWidth, dov->imageHeight, 0, GL_LUMINANCE, GL_UNSIGNED_BYTE, NULL);
+		}
+		else glBindTexture(GL_TEXTURE_2D, dov->texture);
+		if (dov->imageNew) {
+			glPushClientAttrib(GL_CLIENT_PIXEL_STORE_BIT);
+			glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+			glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, dov->imageWidth, dov->imageHeight, GL_LUMINANCE, GL_UNSIGNED_BYTE, dov->image);
+			glPopClientAttrib();
+			dov->imageNew = FALSE;
+		}
+		glEnable(GL_TEXTURE_2D);
+		glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_REPLACE);
+		glBegin(GL_QUADS);
+		glTexCoord2f(0.0f, 1.0f); glVertex2f(x, 0.0f);
+		glTexCoord2f(1.0f, 1.0f); glVertex2f(x + w, 0.0f);
+		glTexCoord2f(1.0f, 0.0f); glVertex2f(x + w, h);
+		glTexCoord2f(0.0f, 0.0f); glVertex2f(x, h);
+		glEnd();
+		glDisable(GL_TEXTURE_2D);
+		glBindTexture(GL_TEXTURE_2D, 0);
+	}
+
+	switch (dov->threshMode) {
+	case AR_LABELING_THRESH_MODE_MANUAL:        threshMode = "manual"; break;
+	case AR_LABELING_THRESH_MODE_AUTO_MEDIAN:   threshMode = "median"; break;
+	case AR_LABELING_THRESH_MODE_AUTO_OTSU:     threshMode = "Otsu"; break;
+	case AR_LABELING_THRESH_MODE_AUTO_ADAPTIVE: threshMode = "adaptive"; break;
+	default: threshMode = "?"; break;
+	}
+	if (dov->threshMode == AR_LABELING_THRESH_MODE_AUTO_ADAPTIVE) snprintf(text, sizeof(text), "Threshold %s", threshMode);
+	else snprintf(text, sizeof(text), "Threshold %d (%s)", dov->thresh, threshMode);
+	glColor3f(1.0f, 1.0f, 1.0f);
+	debugOverlayText(text, x + 2.0f, (dov->mode == DEBUG_OVERLAY_IMAGE ? h : 0.0f) + 2.0f);
+
+	glPopAttrib();
+	dov->pending += timingNow() - start;
+	dov->cpu += (dov->pending - dov->cpu) * DEBUG_CPU_SMOOTHING;
+	dov->pending = 0.0;
+}
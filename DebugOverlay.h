@@ -0,0 +1,86 @@
+/*
+*  DebugOverlay.h
+*
+*  What detection saw, drawn over the video cheaply enough to leave on.
+*
+*  ARToolKit's debug mode makes arDetectMarker() write a binarized copy of
+*  every frame, and argl then draws that in place of the video. Here
+*  ARToolKit's debug mode stays off. After each detection the overlay
+*  copies out what it found: the labelled regions' bounding boxes, the
+*  candidate squares (markerInfo2) and the markers with their ids and
+*  confidences (markerInfo), and the threshold. These are drawn as lines
+*  and text over the video, a few hundred vertices at most.
+*
+*  In DEBUG_OVERLAY_IMAGE mode ARToolKit's debug mode is also switched on
+*  for one detection in every imageInterval, by the tracker and only on a
+*  frame it detects. The binarized image from that detection is kept at a
+*  quarter of the size and drawn as an inset.
+*
+*/
+
+#ifndef DEBUG_OVERLAY_H
+#define DEBUG_OVERLAY_H
+
+#include <AR/ar.h>
+#include "GLMExt.h"
+
+#define DEBUG_LABELS_MAX        256     // Labelled regions drawn, the first found.
+#define DEBUG_LABEL_AREA_MIN    70      // Pixels. Smaller regions are not drawn (ARToolKit's AR_AREA_MIN).
+#define DEBUG_IMAGE_SCALE       4       // The binarized image inset is 1/this the size of the frame.
+
+typedef enum {
+	DEBUG_OVERLAY_OFF = 0,
+	DEBUG_OVERLAY_ON,                   // Labels, candidates and markers.
+	DEBUG_OVERLAY_IMAGE,                // And the binarized image every imageInterval detections.
+	DEBUG_OVERLAY_MODE_COUNT
+} DEBUG_OVERLAY_MODE;
+
+typedef struct {
+	float       vertex[4][2];           // Frame pixels.
+	int         id;                     // -1 if no pattern matched.
+	float       cf;
+} DebugMarker;
+
+typedef struct {
+	DEBUG_OVERLAY_MODE mode;
+	int         xsize, ysize;
+	int         imageInterval;
+	long        detections;             // Since the mode was set.
+	int         imageDue;               // ARToolKit's debug mode is on for the next detection.
+
+	short       labels[DEBUG_LABELS_MAX][4]; // Bounding boxes: x0, x1, y0, y1 in frame pixels.
+	int         labelNum;
+	float       candidates[AR_SQUARE_MAX][4][2];
+	int         candidateNum;
+	DebugMarker markers[AR_SQUARE_MAX];
+	int         markerNum;
+	int         thresh;
+	AR_LABELING_THRESH_MODE threshMode;
+
+	unsigned char *image;               // Binarized, reduced by DEBUG_IMAGE_SCALE.
+	int         imageWidth, imageHeight;
+	int         imageNew;               // Not yet uploaded.
+	long        imageDetection;         // Detection it came from.
+	GLuint      texture;
+
+	double      cpu;                    // Mean CPU seconds per frame spent here.
+	double      pending;                // Spent since the last draw.
+} DebugOverlay;
+
+// imageInterval is in detections. FALSE if out of memory.
+int         debugOverlayInit(DebugOverlay *dov, int xsize, int ysize, int imageInterval);
+void        debugOverlayFinal(DebugOverlay *dov);
+void        debugOverlaySetMode(DebugOverlay *dov, DEBUG_OVERLAY_MODE mode);
+const char *debugOverlayModeName(DEBUG_OVERLAY_MODE mode);
+
+// Before each call that may run arDetectMarker(): TRUE if a detection
+// should run in ARToolKit's debug mode (TrackerContext debugImage).
+int         debugOverlayWantsImage(const DebugOverlay *dov);
+// After it; detected says whether it ran. Switches debug mode off again.
+void        debugOverlayAfterDetect(DebugOverlay *dov, ARHandle *arHandle, int detected);
+
+// In window coordinates (glOrtho over the window), with the frame filling
+// the window. GL state is left as it was found.
+void        debugOverlayDraw(DebugOverlay *dov, int windowWidth, int windowHeight);
+
+#endif // !DEBUG_OVERLAY_H
@@ -0,0 +1,320 @@
+/*
+*  FramePacing.cpp
+*
+*  Explicit frame pacing with present latency and jitter. See
+*  FramePacing.h.
+*
+*/
+
+#include <string.h>
+#include <math.h>
+#ifdef _WIN32
+#  include <windows.h>
+#else
+#  include <time.h>
+#endif
+#include <AR/ar.h>
+#include "GLMExt.h"
+#include "FramePacing.h"
+#include "Timing.h"
+
+#define PACING_RING         4       // Presents awaiting their timestamp.
+#define PACING_FENCE_MAX    4
+#define PACING_MARGIN       0.0015  // Seconds of slack before the predicted vblank in wait mode.
+#define PACING_CALIBRATE    5.0     // Seconds between GPU/CPU clock offset updates.
+#define PACING_SMOOTH       0.1
+
+typedef struct {
+	GLuint          query;
+	double          capture;
+	int             pending;
+} PacingPresent;
+
+static struct {
+	PACING_MODE     mode;
+	int             framesAhead;
+	int             timestamps;
+
+	PacingPresent   ring[PACING_RING];
+	int             next;
+	double          offset;         // CPU clock minus GL clock, seconds.
+	double          calibrated;
+
+	GLMsync         fences[PACING_FENCE_MAX + 1];
+	int             fenceNum;
+
+	double          capture;        // Camera image for the next present, 0 if none.
+	double          lastPresent;
+	double          refresh, work;  // Wait mode: refresh period, capture to swap time.
+	double          nextStart;
+
+	PacingStats     stats;
+	double          latencyM2, intervalM2;
+	long            intervals;
+} gPacing;
+
+static const char *pacingModeNames[PACING_MODE_COUNT] = { "driver", "off", "vsync", "adaptive", "wait" };
+static const char *pacingMeasureNames[] = { "swap return", "present", "present" };
+
+static double pacingSmooth(double average, double value)
+{
+	return average > 0.0 ? average + PACING_SMOOTH * (value - average) : value;
+}
+
+static void pacingSleep(double seconds)
+{
+#ifdef _WIN32
+	Sleep((DWORD)(seconds * 1000.0));
+#else
+	struct timespec ts;
+
+	ts.tv_sec = (time_t)seconds;
+	ts.tv_nsec = (long)((seconds - (double)ts.tv_sec) * 1e9);
+	nanosleep(&ts, NULL);
+#endif
+}
+
+// Welford running mean and deviation of latency and present interval.
+static void pacingPresented(double capture, double present)
+{
+	PacingStats *st = &gPacing.stats;
+	double d, delta;
+
+	if (capture > 0.0) {
+		d = present - capture;
+		st->frames++;
+		delta = d - st->latencyMean;
+		st->latencyMean += delta / st->frames;
+		gPacing.latencyM2 += delta * (d - st->latencyMean);
+		st->latencyStd = st->frames > 1 ? sqrt(gPacing.latencyM2 / (st->frames - 1)) : 0.0;
+		if (d > st->latencyMax) st->latencyMax = d;
+	}
+	if (gPacing.lastPresent > 0.0 && (d = present - gPacing.lastPresent) < 1.0) {
+		gPacing.intervals++;
+		delta = d - st->intervalMean;
+		st->intervalMean += delta / gPacing.intervals;
+		gPacing.intervalM2 += delta * (d - st->intervalMean);
+		st->intervalStd = gPacing.intervals > 1 ? sqrt(gPacing.intervalM2 / (gPacing.intervals - 1)) : 0.0;
+	}
+	gPacing.lastPresent = present;
+}
+
+// Read back present timestamps the GPU has reached, oldest first.
+static void pacingCollect(void)
+{
+	PacingPresent *p;
+	GLMuint64 t;
+	GLint available;
+	int i;
+
+	if (!gPacing.timestamps) return;
+	for (i = 0; i < PACING_RING; i++) {
+		p = &gPacing.ring[(gPacing.next + i) % PACING_RING];
+		if (!p->pending) continue;
+		glmextGetQueryObjectiv(p->query, GL_QUERY_RESULT_AVAILABLE, &available);
+		if (!available) break;
+		glmextGetQueryObjectui64v(p->query, GL_QUERY_RESULT, &t);
+		pacingPresented(p->capture, (double)t * 1e-9 + gPacing.offset);
+		p->pending = FALSE;
+	}
+}
+
+// Offset between the GL timestamp clock and timingNow(), taken from
+// the middle of the CPU reads around the GL read.
+static void pacingCalibrate(void)
+{
+	GLMint64 g;
+	double t0, t1;
+
+	t0 = timingNow();
+	if (t0 - gPacing.calibrated < PACING_CALIBRATE) return;
+	glmextGetInteger64v(GL_TIMESTAMP, &g);
+	t1 = timingNow();
+	gPacing.offset = 0.5 * (t0 + t1) - (double)g * 1e-9;
+	gPacing.calibrated = t1;
+}
+
+static void pacingDrainFences(int keep)
+{
+	while (gPacing.fenceNum > keep) {
+		glmextClientWaitSync(gPacing.fences[0], GL_SYNC_FLUSH_COMMANDS_BIT, 100000000ull);   // 100 ms at most.
+		glmextDeleteSync(gPacing.fences[0]);
+		memmove(gPacing.fences, gPacing.fences + 1, --gPacing.fenceNum * sizeof(GLMsync));
+	}
+}
+
+static void pacingResetStats(void)
+{
+	int i;
+
+	memset(&gPacing.stats, 0, sizeof(gPacing.stats));
+	gPacing.stats.mode = gPacing.mode;
+	if (gPacing.mode == PACING_WAIT_FOR_SWAP) gPacing.stats.measure = PACING_MEASURE_FINISH;
+	else if (gPacing.timestamps) gPacing.stats.measure = PACING_MEASURE_TIMESTAMP;
+	else gPacing.stats.measure = PACING_MEASURE_SWAP_RETURN;
+	gPacing.latencyM2 = gPacing.intervalM2 = 0.0;
+	gPacing.intervals = 0;
+	gPacing.lastPresent = 0.0;
+	gPacing.refresh = gPacing.work = gPacing.nextStart = 0.0;
+	for (i = 0; i < PACING_RING; i++) gPacing.ring[i].pending = FALSE;
+}
+
+int pacingInit(PACING_MODE mode, int framesAhead)
+{
+	int i;
+
+	memset(&gPacing, 0, sizeof(gPacing));
+	glmExtInit();
+	gPacing.timestamps = (glmExtHasTimers() == GLM_TIMER_TIMESTAMP);
+	if (gPacing.timestamps) {
+		for (i = 0; i < PACING_RING; i++) glmextGenQueries(1, &gPacing.ring[i].query);
+	}
+	if (framesAhead < 0) framesAhead = 0;
+	if (framesAhead > PACING_FENCE_MAX - 1) framesAhead = PACING_FENCE_MAX - 1;
+	if (framesAhead && !glmExtHasSync()) {
+		ARLOGw("pacingInit(): No sync objects, buffering depth left to the driver.\n");
+		framesAhead = 0;
+	}
+	gPacing.framesAhead = framesAhead;
+	gPacing.mode = PACING_DRIVER;
+	pacingResetStats();
+	return pacingSetMode(mode);
+}
+
+void pacingFinal(void)
+{
+	int i;
+
+	pacingLogStats();
+	if (glmExtHasSync()) pacingDrainFences(0);
+	if (gPacing.timestamps) {
+		for (i = 0; i < PACING_RING; i++) glmextDeleteQueries(1, &gPacing.ring[i].query);
+		gPacing.timestamps = FALSE;
+	}
+}
+
+int pacingSetMode(PACING_MODE mode)
+{
+	GLint interval;
+	int ok = TRUE;
+
+	if (gPacing.stats.frames) pacingLogStats();
+	switch (mode) {
+	case PACING_VSYNC_OFF: interval = 0; break;
+	case PACING_ADAPTIVE: interval = -1; break;
+	case PACING_VSYNC_ON:
+	case PACING_WAIT_FOR_SWAP: interval = 1; break;
+	default: interval = -2; break;      // Driver's choice, untouched.
+	}
+	if (interval != -2 && !glmExtSwapInterval(interval)) {
+		if (interval == -1 && glmExtSwapInterval(1)) {
+			ARLOGw("pacingSetMode(): Adaptive vsync not supported, using vsync.\n");
+		}
+		else {
+			ARLOGw("pacingSetMode(): Unable to set swap interval %d.\n", interval);
+		}
+		ok = FALSE;
+	}
+	gPacing.mode = mode;
+	pacingResetStats();
+	return ok;
+}
+
+PACING_MODE pacingMode(void)
+{
+	return gPacing.mode;
+}
+
+const char *pacingModeName(PACING_MODE mode)
+{
+	return (mode >= 0 && mode < PACING_MODE_COUNT) ? pacingModeNames[mode] : "unknown";
+}
+
+int pacingModeFromName(const char *name, PACING_MODE *mode)
+{
+	int i;
+
+	for (i = 0; i < PACING_MODE_COUNT; i++) {
+		if (strcmp(name, pacingModeNames[i]) == 0) {
+			*mode = (PACING_MODE)i;
+			return (TRUE);
+		}
+	}
+	return (FALSE);
+}
+
+void pacingWaitForStart(void)
+{
+	double remaining;
+
+	pacingCollect();
+	if (gPacing.mode != PACING_WAIT_FOR_SWAP || gPacing.nextStart == 0.0) return;
+	remaining = gPacing.nextStart - timingNow();
+	if (remaining > 0.0 && remaining < 0.1) pacingSleep(remaining);
+	gPacing.nextStart = 0.0;
+}
+
+void pacingCaptured(void)
+{
+	gPacing.capture = timingNow();
+}
+
+void pacingSwap(void)
+{
+	PacingPresent *p;
+	double swapCall, present, d;
+
+	pacingCollect();
+	swapCall = timingNow();
+	if (gPacing.capture > 0.0) gPacing.work = pacingSmooth(gPacing.work, swapCall - gPacing.capture);
+
+	glutSwapBuffers();
+
+	if (gPacing.mode == PACING_WAIT_FOR_SWAP) {
+		// Returns once the swap is done; the next frame starts just in
+		// time for the vblank after.
+		glFinish();
+		present = timingNow();
+		if (gPacing.lastPresent > 0.0) {
+			d = present - gPacing.lastPresent;
+			if (d > 0.004 && d < 0.05 && (gPacing.refresh == 0.0 || d < 1.5 * gPacing.refresh)) gPacing.refresh = pacingSmooth(gPacing.refresh, d);
+		}
+		pacingPresented(gPacing.capture, present);
+		gPacing.stats.refresh = gPacing.refresh;
+		if (gPacing.refresh > 0.0) gPacing.nextStart = present + gPacing.refresh - gPacing.work - PACING_MARGIN;
+	}
+	else if (gPacing.timestamps) {
+		pacingCalibrate();
+		p = &gPacing.ring[gPacing.next];
+		if (!p->pending) {
+			glmextQueryCounter(p->query, GL_TIMESTAMP);
+			p->capture = gPacing.capture;
+			p->pending = TRUE;
+			gPacing.next = (gPacing.next + 1) % PACING_RING;
+		}
+	}
+	else {
+		pacingPresented(gPacing.capture, timingNow());
+	}
+	gPacing.capture = 0.0;
+
+	if (gPacing.framesAhead && gPacing.mode != PACING_WAIT_FOR_SWAP) {
+		gPacing.fences[gPacing.fenceNum++] = glmextFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		pacingDrainFences(gPacing.framesAhead);
+	}
+}
+
+const PacingStats *pacingStats(void)
+{
+	return &gPacing.stats;
+}
+
+void pacingLogStats(void)
+{
+	const PacingStats *st = &gPacing.stats;
+
+	if (!st->frames) return;
+	ARLOGi("Pacing %s: %ld frames, latency to %s %0.1f ms (sd %0.1f, max %0.1f), interval %0.2f ms (jitter %0.2f).\n",
+		pacingModeName(st->mode), st->frames, pacingMeasureNames[st->measure], st->latencyMean * 1000.0,
+		st->latencyStd * 1000.0, st->latencyMax * 1000.0, st->intervalMean * 1000.0, st->intervalStd * 1000.0);
+}
@@ -0,0 +1,81 @@
+/*
+*  FramePacing.h
+*
+*  Explicit frame pacing for the GLUT window, with present latency and
+*  jitter measured per mode.
+*
+*  Modes:
+*    driver    Leave the swap interval as the driver set it.
+*    off       Swap interval 0: lowest latency, may tear.
+*    vsync     Swap interval 1: no tearing, frames queue up behind vblank.
+*    adaptive  Swap interval -1: vsync, but a late frame swaps at once
+*              and tears instead of waiting a whole refresh.
+*    wait      Vsync, and after each swap wait until it has happened, then
+*              hold the next frame back until just before the following
+*              vblank (by the running estimate of how long a frame takes),
+*              so the camera image is as fresh as possible when shown.
+*
+*  Buffering depth (framesAhead) limits how many swapped frames may still
+*  be in flight on the GPU when pacingSwap() returns: with 1 the CPU can
+*  prepare the next frame while the GPU finishes this one, but no more.
+*  0 leaves it to the driver. It needs sync objects (OpenGL 3.2 or
+*  ARB_sync).
+*
+*  Latency is measured from pacingCaptured() (camera image fetched) to
+*  the frame being presented. The present time is a GL_TIMESTAMP query
+*  issued after the swap, converted to the CPU clock, where timer queries
+*  are available; in wait mode it is when the post swap wait returns;
+*  otherwise latency is only measured to glutSwapBuffers() returning.
+*
+*/
+
+#ifndef FRAME_PACING_H
+#define FRAME_PACING_H
+
+typedef enum {
+	PACING_DRIVER = 0,
+	PACING_VSYNC_OFF,
+	PACING_VSYNC_ON,
+	PACING_ADAPTIVE,
+	PACING_WAIT_FOR_SWAP,
+	PACING_MODE_COUNT
+} PACING_MODE;
+
+typedef enum {
+	PACING_MEASURE_SWAP_RETURN = 0,
+	PACING_MEASURE_TIMESTAMP,
+	PACING_MEASURE_FINISH
+} PACING_MEASURE;
+
+typedef struct {
+	PACING_MODE     mode;
+	PACING_MEASURE  measure;
+	long            frames;
+	double          latencyMean, latencyStd, latencyMax;    // Seconds.
+	double          intervalMean, intervalStd;              // Between presents; the std is the jitter.
+	double          refresh;                                // Estimated refresh period, wait mode only.
+} PacingStats;
+
+// After the GL context is current.
+int             pacingInit(PACING_MODE mode, int framesAhead);
+void            pacingFinal(void);
+
+// Switches mode, logging the stats of the old one. FALSE if the swap
+// interval the mode needs could not be set (the mode is still entered).
+int             pacingSetMode(PACING_MODE mode);
+PACING_MODE     pacingMode(void);
+const char      *pacingModeName(PACING_MODE mode);
+int             pacingModeFromName(const char *name, PACING_MODE *mode);
+
+// In mainLoop(): blocks until the next frame should start (wait mode
+// only), then marks when the camera image for the next display was got.
+void            pacingWaitForStart(void);
+void            pacingCaptured(void);
+
+// Replaces glutSwapBuffers().
+void            pacingSwap(void);
+
+const PacingStats *pacingStats(void);
+void            pacingLogStats(void);
+
+#endif // !FRAME_PACING_H
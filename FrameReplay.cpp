@@ -0,0 +1,287 @@
+/*
+*  FrameReplay.cpp
+*
+*  Recording and replay of raw camera frames. See FrameReplay.h.
+*
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include "FrameReplay.h"
+
+#define FRAME_REPLAY_VERSION    1
+#define FRAME_REPLAY_HEADER     24      // Magic and five 32 bit integers.
+#define FRAME_REPLAY_SIDE_MAX   16384   // Largest width or height; a frame then fits a 32 bit size_t.
+
+#ifdef _WIN32
+#  define frameSeek     _fseeki64
+#  define frameTell     _ftelli64
+#else
+#  define frameSeek     fseeko
+#  define frameTell     ftello
+#endif
+
+size_t frameSize(int xsize, int ysize, AR_PIXEL_FORMAT pixFormat)
+{
+	switch (pixFormat) {
+	case AR_PIXEL_FORMAT_420v:
+	case AR_PIXEL_FORMAT_420f:
+	case AR_PIXEL_FORMAT_NV21:
+		return (size_t)xsize * ysize * 3 / 2;     // Luma plane plus half size chroma.
+	default:
+		return (size_t)xsize * ysize * arUtilGetPixelSize(pixFormat);
+	}
+}
+
+static void framePut32(ARUint8 *p, int v)
+{
+	p[0] = (ARUint8)v;
+	p[1] = (ARUint8)(v >> 8);
+	p[2] = (ARUint8)(v >> 16);
+	p[3] = (ARUint8)(v >> 24);
+}
+
+static int frameGet32(const ARUint8 *p)
+{
+	return (int)((uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24));
+}
+
+int frameReplayOpen(FrameReplay *fr, const char *path)
+{
+	ARUint8 header[FRAME_REPLAY_HEADER];
+	FILE *fp;
+	long long length;
+
+	memset(fr, 0, sizeof(FrameReplay));
+	if ((fp = fopen(path, "rb")) == NULL) {
+		ARLOGe("frameReplayOpen(): Unable to open %s.\n", path);
+		return (FALSE);
+	}
+	if (fread(header, 1, sizeof(header), fp) != sizeof(header) || memcmp(header, "ARFR", 4) != 0 ||
+		frameGet32(header + 4) != FRAME_REPLAY_VERSION) {
+		ARLOGe("frameReplayOpen(): %s is not a frame recording.\n", path);
+		fclose(fp);
+		return (FALSE);
+	}
+	fr->xsize = frameGet32(header + 8);
+	fr->ysize = frameGet32(header + 12);
+	fr->pixFormat = (AR_PIXEL_FORMAT)frameGet32(header + 16);
+	fr->frameCount = frameGet32(header + 20);
+	if (fr->xsize <= 0 || fr->ysize <= 0 || fr->xsize > FRAME_REPLAY_SIDE_MAX || fr->ysize > FRAME_REPLAY_SIDE_MAX ||
+		fr->frameCount <= 0 || (fr->frameSize = frameSize(fr->xsize, fr->ysize, fr->pixFormat)) == 0) {
+		ARLOGe("frameReplayOpen(): %s holds no frames.\n", path);
+		fclose(fp);
+		return (FALSE);
+	}
+
+	// The header is not trusted with the size of the allocation.
+	if ((size_t)fr->frameCount > SIZE_MAX / fr->frameSize) {
+		ARLOGe("frameReplayOpen(): %s has more frames than fit in memory.\n", path);
+		fclose(fp);
+		return (FALSE);
+	}
+	if (frameSeek(fp, 0, SEEK_END) != 0 || (length = (long long)frameTell(fp)) < 0 ||
+		frameSeek(fp, FRAME_REPLAY_HEADER, SEEK_SET) != 0) {
+		ARLOGe("frameReplayOpen(): Unable to read %s.\n", path);
+		fclose(fp);
+		return (FALSE);
+	}
+	if ((unsigned long long)(length - FRAME_REPLAY_HEADER) < (unsigned long long)fr->frameSize * fr->frameCount) {
+		ARLOGe("frameReplayOpen(): %s is truncated.\n", path);
+		fclose(fp);
+		return (FALSE);
+	}
+
+	if ((fr->frames = (ARUint8 *)malloc(fr->frameSize * fr->frameCount)) == NULL) {
+		ARLOGe("frameReplayOpen(): Out of memory for %d frames.\n", fr->frameCount);
+		fclose(fp);
+		return (FALSE);
+	}
+	if (fread(fr->frames, fr->frameSize, fr->frameCount, fp) != (size_t)fr->frameCount) {
+		ARLOGe("frameReplayOpen(): %s is truncated.\n", path);
+		frameReplayClose(fr);
+		fclose(fp);
+		return (FALSE);
+	}
+	fclose(fp);
+	return (TRUE);
+}
+
+// The first of the four orientations of a .patt file, in grey: 4 x 3
+// planes of size x size numbers, one plane per colour channel.
+static ARUint8 *frameLoadPattern(const char *path, int *size)
+{
+	ARUint8 *grey;
+	FILE *fp;
+	int *values, count, max, n, c, i, v;
+
+	if ((fp = fopen(path, "r")) == NULL) {
+		ARLOGe("frameReplaySynthetic(): Unable to open pattern %s.\n", path);
+		return (NULL);
+	}
+	max = 12 * 64 * 64;
+	if ((values = (int *)malloc(max * sizeof(int))) == NULL) {
+		fclose(fp);
+		return (NULL);
+	}
+	for (count = 0; count < max && fscanf(fp, "%d", &v) == 1; count++) values[count] = v;
+	fclose(fp);
+
+	for (n = 1; 12 * n * n < count; n++);
+	if (12 * n * n != count) {
+		ARLOGe("frameReplaySynthetic(): %s is not a pattern file.\n", path);
+		free(values);
+		return (NULL);
+	}
+	if ((grey = (ARUint8 *)malloc(n * n)) == NULL) {
+		free(values);
+		return (NULL);
+	}
+	for (i = 0; i < n * n; i++) {
+		for (v = c = 0; c < 3; c++) v += values[c * n * n + i];
+		grey[i] = (ARUint8)(v / 3);
+	}
+	free(values);
+	*size = n;
+	return (grey);
+}
+
+int frameReplaySynthetic(FrameReplay *fr, int xsize, int ysize, int frameCount, const char *pattName)
+{
+	ARUint8 *p, *patt;
+	unsigned int seed = 1;
+	float a, c, s, cx, cy, half, u, v, m;
+	int f, x, y, x0, x1, y0, y1, n, i, j;
+
+	memset(fr, 0, sizeof(FrameReplay));
+	// The marker's loop is the first three quarters of the frames.
+	if (xsize <= 0 || ysize <= 0 || xsize > FRAME_REPLAY_SIDE_MAX || ysize > FRAME_REPLAY_SIDE_MAX ||
+		frameCount < 4 || (size_t)frameCount > SIZE_MAX / ((size_t)xsize * ysize)) {
+		ARLOGe("frameReplaySynthetic(): Bad size %dx%d or frame count %d (at least 4).\n", xsize, ysize, frameCount);
+		return (FALSE);
+	}
+	if ((patt = frameLoadPattern(pattName, &n)) == NULL) return (FALSE);
+	fr->xsize = xsize;
+	fr->ysize = ysize;
+	fr->pixFormat = AR_PIXEL_FORMAT_MONO;
+	fr->frameCount = frameCount;
+	fr->frameSize = (size_t)xsize * ysize;
+	if ((fr->frames = (ARUint8 *)malloc(fr->frameSize * frameCount)) == NULL) {
+		ARLOGe("frameReplaySynthetic(): Out of memory for %d frames.\n", frameCount);
+		free(patt);
+		return (FALSE);
+	}
+
+	half = ysize / 6.0f;
+	for (f = 0; f < frameCount; f++) {
+		p = fr->frames + fr->frameSize * f;
+		for (x = 0; x < (int)fr->frameSize; x++) {
+			seed = seed * 1103515245u + 12345u;
+			p[x] = (ARUint8)(140 + ((seed >> 16) & 15));
+		}
+		if (f >= frameCount * 3 / 4) continue;
+
+		// Centre on an ellipse, turning a quarter turn per loop.
+		a = 6.2831853f * f / (frameCount * 3 / 4);
+		cx = xsize / 2 + xsize / 4 * cosf(a);
+		cy = ysize / 2 + ysize / 5 * sinf(a);
+		c = cosf(a / 4);
+		s = sinf(a / 4);
+		x0 = (int)(cx - half * 1.5f); x1 = (int)(cx + half * 1.5f);
+		y0 = (int)(cy - half * 1.5f); y1 = (int)(cy + half * 1.5f);
+		if (x0 < 0) x0 = 0;
+		if (y0 < 0) y0 = 0;
+		if (x1 > xsize - 1) x1 = xsize - 1;
+		if (y1 > ysize - 1) y1 = ysize - 1;
+		for (y = y0; y <= y1; y++) {
+			for (x = x0; x <= x1; x++) {
+				// Marker coordinates, -1..1 across the outline.
+				u = ((x - cx) * c + (y - cy) * s) / half;
+				v = (-(x - cx) * s + (y - cy) * c) / half;
+				m = fabsf(u) > fabsf(v) ? fabsf(u) : fabsf(v);
+				if (m > 1.0f) continue;
+				if (m > 0.5f) {
+					p[y * xsize + x] = 20;      // Border, as wide as the default pattern ratio of 0.5 leaves.
+					continue;
+				}
+				// The pattern fills the middle half, row 0 at the top.
+				i = (int)((u + 0.5f) * n);
+				j = (int)((v + 0.5f) * n);
+				if (i > n - 1) i = n - 1;
+				if (j > n - 1) j = n - 1;
+				p[y * xsize + x] = patt[j * n + i];
+			}
+		}
+	}
+	free(patt);
+	return (TRUE);
+}
+
+ARUint8 *frameReplayNext(FrameReplay *fr)
+{
+	ARUint8 *frame;
+
+	frame = fr->frames + fr->frameSize * fr->next;
+	if (++fr->next == fr->frameCount) fr->next = 0;
+	fr->served++;
+	return frame;
+}
+
+void frameReplayClose(FrameReplay *fr)
+{
+	free(fr->frames);
+	fr->frames = NULL;
+	fr->frameCount = 0;
+}
+
+int frameRecordOpen(FrameRecorder *rec, const char *path, int xsize, int ysize, AR_PIXEL_FORMAT pixFormat)
+{
+	ARUint8 header[FRAME_REPLAY_HEADER];
+
+	rec->frameSize = frameSize(xsize, ysize, pixFormat);
+	rec->frameCount = 0;
+	if ((rec->fp = fopen(path, "wb")) == NULL) {
+		ARLOGe("frameRecordOpen(): Unable to create %s.\n", path);
+		return (FALSE);
+	}
+	memcpy(header, "ARFR", 4);
+	framePut32(header + 4, FRAME_REPLAY_VERSION);
+	framePut32(header + 8, xsize);
+	framePut32(header + 12, ysize);
+	framePut32(header + 16, (int)pixFormat);
+	framePut32(header + 20, 0);     // Patched by frameRecordClose().
+	if (fwrite(header, 1, sizeof(header), rec->fp) != sizeof(header)) {
+		ARLOGe("frameRecordOpen(): Unable to write %s.\n", path);
+		fclose(rec->fp);
+		rec->fp = NULL;
+		return (FALSE);
+	}
+	return (TRUE);
+}
+
+int frameRecordWrite(FrameRecorder *rec, const ARUint8 *image)
+{
+	if (!rec->fp) return (FALSE);
+	if (fwrite(image, 1, rec->frameSize, rec->fp) != rec->frameSize) {
+		ARLOGe("frameRecordWrite(): Write failed, recording stopped at %d frames.\n", rec->frameCount);
+		frameRecordClose(rec);
+		return (FALSE);
+	}
+	rec->frameCount++;
+	return (TRUE);
+}
+
+void frameRecordClose(FrameRecorder *rec)
+{
+	ARUint8 count[4];
+
+	if (!rec->fp) return;
+	framePut32(count, rec->frameCount);
+	if (fseek(rec->fp, 20, SEEK_SET) != 0 || fwrite(count, 1, 4, rec->fp) != 4) {
+		ARLOGe("frameRecordClose(): Unable to finish the recording.\n");
+	}
+	fclose(rec->fp);
+	rec->fp = NULL;
+}
@@ -0,0 +1,51 @@
+/*
+*  FrameReplay.h
+*
+*  Recording and replay of raw camera frames, so that the detection and
+*  drawing pipeline can be run on the same input again without a camera.
+*
+*  File layout: the four bytes "ARFR", then five little endian 32 bit
+*  integers (version, xsize, ysize, AR_PIXEL_FORMAT, frame count), then
+*  the frames back to back exactly as arVideoGetImage() returned them.
+*
+*/
+
+#ifndef FRAME_REPLAY_H
+#define FRAME_REPLAY_H
+
+#include <stdio.h>
+#include <AR/ar.h>
+
+typedef struct {
+	int             xsize, ysize;
+	AR_PIXEL_FORMAT pixFormat;
+	size_t          frameSize;
+	int             frameCount;
+	ARUint8         *frames;            // All frames, read at open.
+	int             next;
+	long            served;             // Frames returned so far (passes * frameCount + next).
+} FrameReplay;
+
+typedef struct {
+	FILE            *fp;
+	size_t          frameSize;
+	int             frameCount;
+} FrameRecorder;
+
+// Bytes in one frame of the given size and format.
+size_t   frameSize(int xsize, int ysize, AR_PIXEL_FORMAT pixFormat);
+
+int      frameReplayOpen(FrameReplay *fr, const char *path);
+// A generated AR_PIXEL_FORMAT_MONO sequence instead of a recording: the
+// marker of the .patt file pattName (its first orientation, in grey,
+// inside a black border) wandering and turning over a noisy background,
+// out of view for the last quarter of the loop. At least 4 frames.
+int      frameReplaySynthetic(FrameReplay *fr, int xsize, int ysize, int frameCount, const char *pattName);
+ARUint8  *frameReplayNext(FrameReplay *fr);     // Loops back to the first frame at the end.
+void     frameReplayClose(FrameReplay *fr);
+
+int      frameRecordOpen(FrameRecorder *rec, const char *path, int xsize, int ysize, AR_PIXEL_FORMAT pixFormat);
+int      frameRecordWrite(FrameRecorder *rec, const ARUint8 *image);
+void     frameRecordClose(FrameRecorder *rec);
+
+#endif // !FRAME_REPLAY_H
@@ -14,9 +14,21 @@
 #include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <stddef.h>
 #include <string.h>
+#include <ctype.h>
 #include <assert.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
 #include "GLM.h"
+#include "GLMExt.h"
+#include "Kernels.h"
 
 
 #define T(x) (model->triangles[(x)])
@@ -158,7 +170,7 @@ glmWeldVectors(GLfloat* vectors, GLuint* numvectors, GLfloat epsilon)
 
 /* glmFindGroup: Find a group in the model */
 GLMgroup*
-glmFindGroup(GLMmodel* model, char* name)
+glmFindGroup(GLMmodel* model, const char* name)
 {
 	GLMgroup* group;
 
@@ -176,7 +188,7 @@ glmFindGroup(GLMmodel* model, char* name)
 
 /* glmAddGroup: Add a group to the model */
 GLMgroup*
-glmAddGroup(GLMmodel* model, char* name)
+glmAddGroup(GLMmodel* model, const char* name)
 {
 	GLMgroup* group;
 
@@ -186,7 +198,7 @@ glmAddGroup(GLMmodel* model, char* name)
 		group->name = _strdup(name);
 		group->material = 0;
 		group->numtriangles = 0;
-		group->triangles = NULL;
+		group->first = 0;
 		group->next = model->groups;
 		model->groups = group;
 		model->numgroups++;
@@ -257,6 +269,146 @@ glmDirName(char* path)
 }
 
 
+/* glmMapFile: map a whole file read-only into memory
+ *
+ * filename - name of the file to map
+ * size     - will contain the size of the file (in bytes) on return
+ *
+ * Returns NULL if the file can't be opened or is empty.  The mapping
+ * must be released with glmUnmapFile().
+ */
+static const GLubyte*
+glmMapFile(const char* filename, size_t* size)
+{
+	const GLubyte* data;
+
+#ifdef _WIN32
+	HANDLE file, mapping;
+	LARGE_INTEGER filesize;
+
+	file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL,
+		OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+		return NULL;
+	if (!GetFileSizeEx(file, &filesize) || filesize.QuadPart == 0) {
+		CloseHandle(file);
+		return NULL;
+	}
+	mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	CloseHandle(file);
+	if (!mapping)
+		return NULL;
+	data = (const GLubyte*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	CloseHandle(mapping);
+	if (!data)
+		return NULL;
+	*size = (size_t)filesize.QuadPart;
+#else
+	int fd;
+	struct stat st;
+	void* map;
+
+	fd = open(filename, O_RDONLY);
+	if (fd < 0)
+		return NULL;
+	if (fstat(fd, &st) < 0 || st.st_size == 0) {
+		close(fd);
+		return NULL;
+	}
+	map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED)
+		return NULL;
+	madvise(map, (size_t)st.st_size, MADV_SEQUENTIAL);
+	data = (const GLubyte*)map;
+	*size = (size_t)st.st_size;
+#endif
+
+	return data;
+}
+
+/* glmUnmapFile: release a mapping made by glmMapFile() */
+static GLvoid
+glmUnmapFile(const GLubyte* data, size_t size)
+{
+#ifdef _WIN32
+	(void)size;
+	UnmapViewOfFile(data);
+#else
+	munmap((void*)data, size);
+#endif
+}
+
+/* glmFileTime: the time a file was last written, in the units of the
+ * host (100 ns on Windows, ns elsewhere), or 0 if it can't be found
+ */
+static unsigned long long
+glmFileTime(const char* filename)
+{
+#ifdef _WIN32
+	WIN32_FILE_ATTRIBUTE_DATA info;
+
+	if (!GetFileAttributesExA(filename, GetFileExInfoStandard, &info))
+		return 0;
+	return (unsigned long long)info.ftLastWriteTime.dwHighDateTime << 32 |
+		info.ftLastWriteTime.dwLowDateTime;
+#else
+	struct stat st;
+
+	if (stat(filename, &st) < 0)
+		return 0;
+#ifdef __APPLE__
+	return (unsigned long long)st.st_mtimespec.tv_sec * 1000000000ULL + st.st_mtimespec.tv_nsec;
+#else
+	return (unsigned long long)st.st_mtim.tv_sec * 1000000000ULL + st.st_mtim.tv_nsec;
+#endif
+#endif
+}
+
+/* glmHostIsLittleEndian: returns GL_TRUE on little-endian hosts */
+static GLboolean
+glmHostIsLittleEndian(GLvoid)
+{
+	GLuint one = 1;
+
+	return *(GLubyte*)&one ? GL_TRUE : GL_FALSE;
+}
+
+/* glmStrcasecmp: case insensitive string compare */
+static int
+glmStrcasecmp(const char* a, const char* b)
+{
+	int ca, cb;
+
+	do {
+		ca = tolower((unsigned char)*a++);
+		cb = tolower((unsigned char)*b++);
+	} while (ca && ca == cb);
+
+	return ca - cb;
+}
+
+/* glmInitMaterial: set a material to the default glm values */
+static GLvoid
+glmInitMaterial(GLMmaterial* material)
+{
+	material->name = NULL;
+	material->shininess = 65.0f;
+	material->diffuse[0] = 0.8f;
+	material->diffuse[1] = 0.8f;
+	material->diffuse[2] = 0.8f;
+	material->diffuse[3] = 1.0f;
+	material->ambient[0] = 0.2f;
+	material->ambient[1] = 0.2f;
+	material->ambient[2] = 0.2f;
+	material->ambient[3] = 1.0f;
+	material->specular[0] = 0.0f;
+	material->specular[1] = 0.0f;
+	material->specular[2] = 0.0f;
+	material->specular[3] = 1.0f;
+}
+
+
 /* glmReadMTL: read a wavefront material library file
  *
  * model - properly initialized GLMmodel structure
@@ -311,22 +463,8 @@ glmReadMTL(GLMmodel* model, char* name)
 	model->nummaterials = nummaterials;
 
 	/* set the default material */
-	for (i = 0; i < nummaterials; i++) {
-		model->materials[i].name = NULL;
-		model->materials[i].shininess = 65.0f;
-		model->materials[i].diffuse[0] = 0.8f;
-		model->materials[i].diffuse[1] = 0.8f;
-		model->materials[i].diffuse[2] = 0.8f;
-		model->materials[i].diffuse[3] = 1.0f;
-		model->materials[i].ambient[0] = 0.2f;
-		model->materials[i].ambient[1] = 0.2f;
-		model->materials[i].ambient[2] = 0.2f;
-		model->materials[i].ambient[3] = 1.0f;
-		model->materials[i].specular[0] = 0.0f;
-		model->materials[i].specular[1] = 0.0f;
-		model->materials[i].specular[2] = 0.0f;
-		model->materials[i].specular[3] = 1.0f;
-	}
+	for (i = 0; i < nummaterials; i++)
+		glmInitMaterial(&model->materials[i]);
 	model->materials[0].name = _strdup("glm_default");
 
 	/* now, read in the data */
@@ -572,10 +710,13 @@ glmFirstPass(GLMmodel* model, FILE* file)
 	model->numtexcoords = numtexcoords;
 	model->numtriangles = numtriangles;
 
-	/* allocate memory for the triangles in each group */
+	/* lay the groups out one after another in model->triangles, the
+	second pass fills each range in turn */
+	numtriangles = 0;
 	group = model->groups;
 	while (group) {
-		group->triangles = (GLuint*)malloc(sizeof(GLuint) * group->numtriangles);
+		group->first = numtriangles;
+		numtriangles += group->numtriangles;
 		group->numtriangles = 0;
 		group = group->next;
 	}
@@ -593,7 +734,7 @@ glmSecondPass(GLMmodel* model, FILE* file)
 	GLuint numvertices;        /* number of vertices in model */
 	GLuint numnormals;         /* number of normals in model */
 	GLuint numtexcoords;       /* number of texcoords in model */
-	GLuint numtriangles;       /* number of triangles in model */
+	GLuint numtriangles;       /* next triangle in the current group */
 	GLfloat* vertices;         /* array of vertices  */
 	GLfloat* normals;          /* array of normals */
 	GLfloat* texcoords;        /* array of texture coordinates */
@@ -661,6 +802,7 @@ glmSecondPass(GLMmodel* model, FILE* file)
 			break;
 		case 'f':               /* face */
 			v = n = t = 0;
+			numtriangles = group->first + group->numtriangles;
 			fscanf(file, "%s", buf);
 			/* can be one of %d, %d//%d, %d/%d, %d/%d/%d %d//%d */
 			if (strstr(buf, "//")) {
@@ -674,7 +816,7 @@ glmSecondPass(GLMmodel* model, FILE* file)
 				fscanf(file, "%d//%d", &v, &n);
 				T(numtriangles).vindices[2] = v < 0 ? v + numvertices : v;
 				T(numtriangles).nindices[2] = n < 0 ? n + numnormals : n;
-				group->triangles[group->numtriangles++] = numtriangles;
+				group->numtriangles++;
 				numtriangles++;
 				while (fscanf(file, "%d//%d", &v, &n) > 0) {
 					T(numtriangles).vindices[0] = T(numtriangles - 1).vindices[0];
@@ -683,7 +825,7 @@ glmSecondPass(GLMmodel* model, FILE* file)
 					T(numtriangles).nindices[1] = T(numtriangles - 1).nindices[2];
 					T(numtriangles).vindices[2] = v < 0 ? v + numvertices : v;
 					T(numtriangles).nindices[2] = n < 0 ? n + numnormals : n;
-					group->triangles[group->numtriangles++] = numtriangles;
+					group->numtriangles++;
 					numtriangles++;
 				}
 			}
@@ -700,7 +842,7 @@ glmSecondPass(GLMmodel* model, FILE* file)
 				T(numtriangles).vindices[2] = v < 0 ? v + numvertices : v;
 				T(numtriangles).tindices[2] = t < 0 ? t + numtexcoords : t;
 				T(numtriangles).nindices[2] = n < 0 ? n + numnormals : n;
-				group->triangles[group->numtriangles++] = numtriangles;
+				group->numtriangles++;
 				numtriangles++;
 				while (fscanf(file, "%d/%d/%d", &v, &t, &n) > 0) {
 					T(numtriangles).vindices[0] = T(numtriangles - 1).vindices[0];
@@ -712,7 +854,7 @@ glmSecondPass(GLMmodel* model, FILE* file)
 					T(numtriangles).vindices[2] = v < 0 ? v + numvertices : v;
 					T(numtriangles).tindices[2] = t < 0 ? t + numtexcoords : t;
 					T(numtriangles).nindices[2] = n < 0 ? n + numnormals : n;
-					group->triangles[group->numtriangles++] = numtriangles;
+					group->numtriangles++;
 					numtriangles++;
 				}
 			}
@@ -726,7 +868,7 @@ glmSecondPass(GLMmodel* model, FILE* file)
 				fscanf(file, "%d/%d", &v, &t);
 				T(numtriangles).vindices[2] = v < 0 ? v + numvertices : v;
 				T(numtriangles).tindices[2] = t < 0 ? t + numtexcoords : t;
-				group->triangles[group->numtriangles++] = numtriangles;
+				group->numtriangles++;
 				numtriangles++;
 				while (fscanf(file, "%d/%d", &v, &t) > 0) {
 					T(numtriangles).vindices[0] = T(numtriangles - 1).vindices[0];
@@ -735,7 +877,7 @@ glmSecondPass(GLMmodel* model, FILE* file)
 					T(numtriangles).tindices[1] = T(numtriangles - 1).tindices[2];
 					T(numtriangles).vindices[2] = v < 0 ? v + numvertices : v;
 					T(numtriangles).tindices[2] = t < 0 ? t + numtexcoords : t;
-					group->triangles[group->numtriangles++] = numtriangles;
+					group->numtriangles++;
 					numtriangles++;
 				}
 			}
@@ -747,13 +889,13 @@ glmSecondPass(GLMmodel* model, FILE* file)
 				T(numtriangles).vindices[1] = v < 0 ? v + numvertices : v;
 				fscanf(file, "%d", &v);
 				T(numtriangles).vindices[2] = v < 0 ? v + numvertices : v;
-				group->triangles[group->numtriangles++] = numtriangles;
+				group->numtriangles++;
 				numtriangles++;
 				while (fscanf(file, "%d", &v) > 0) {
 					T(numtriangles).vindices[0] = T(numtriangles - 1).vindices[0];
 					T(numtriangles).vindices[1] = T(numtriangles - 1).vindices[2];
 					T(numtriangles).vindices[2] = v < 0 ? v + numvertices : v;
-					group->triangles[group->numtriangles++] = numtriangles;
+					group->numtriangles++;
 					numtriangles++;
 				}
 			}
@@ -776,741 +918,3118 @@ glmSecondPass(GLMmodel* model, FILE* file)
 #endif
 }
 
-/* deal with the lines*/
+/* glmSortGroups: order the groups by material, otherwise keeping
+ * their order, and move the triangles to match, so that the groups'
+ * ranges follow each other in model->triangles in the order the
+ * groups are walked, and groups sharing a material are adjacent.
+ *
+ * model - properly initialized GLMmodel structure
+ */
 static GLvoid
-glmThirdPass(GLMmodel* model)
+glmSortGroups(GLMmodel* model)
 {
+	GLMgroup** groups;
+	GLMgroup* group;
+	GLMtriangle* triangles;
+	GLuint i, j, numtriangles;
+
+	if (model->numgroups < 2)
+		return;
+
+	groups = (GLMgroup**)malloc(sizeof(GLMgroup*) * model->numgroups);
+	for (group = model->groups, i = 0; group; group = group->next, i++)
+		groups[i] = group;
+
+	/* insertion sort: stable, and there are few groups */
+	for (i = 1; i < model->numgroups; i++) {
+		group = groups[i];
+		for (j = i; j > 0 && groups[j - 1]->material > group->material; j--)
+			groups[j] = groups[j - 1];
+		groups[j] = group;
+	}
 
-	GLuint numtriangles;
-	numtriangles = model->numtriangles;
-	model->numLines = 0;
-	model->lines = (GLMLine*)malloc(3 * numtriangles*sizeof(GLMLine));
-	for (int i = 0; i < numtriangles; i++)
-	{
-
-		GLuint v0 = model->triangles[i].vindices[0];
-		GLuint v1 = model->triangles[i].vindices[1];
-		GLuint v2 = model->triangles[i].vindices[2];
-
-		bool f1 = false, f2 = false, f3 = false;
-		//for(int j=0; j<model->lines.size(); j++)
-		for (int j = 0; j < model->numLines; j++)
-		{
-			if ((model->lines[j].vindices[0] == v0 && model->lines[j].vindices[1] == v1) || (model->lines[j].vindices[0] == v1 && model->lines[j].vindices[1] == v0))
-			{
-				model->triangles[i].lindices[0] = j;
-				f1 = true;
-			}
-			if ((model->lines[j].vindices[0] == v0 && model->lines[j].vindices[1] == v2) || (model->lines[j].vindices[0] == v2 && model->lines[j].vindices[1] == v0))
-			{
-				model->triangles[i].lindices[1] = j;
-				f2 = true;
-			}
-			if ((model->lines[j].vindices[0] == v1 && model->lines[j].vindices[1] == v2) || (model->lines[j].vindices[0] == v2 && model->lines[j].vindices[1] == v1))
-			{
-				model->triangles[i].lindices[2] = j;
-				f3 = true;
-			}
-			if (f1 == true && f2 == true && f3 == true)
-				break;
-
-		}
-		if (f1 == false)
-		{
-
-			GLMLine line;
-			line.vindices[0] = v0; line.vindices[1] = v1;
-			line.e1 = 0; line.e2 = 0;
-			//model->lines.push_back(line);
-			model->triangles[i].lindices[0] = model->numLines;
-			model->lines[model->numLines] = line;
-			model->numLines++;
-		}
-		if (f2 == false)
-		{
-			GLMLine line;
-			line.vindices[0] = v0; line.vindices[1] = v2;
-			line.e1 = 0; line.e2 = 0;
-			//model->lines.push_back(line);
-			model->triangles[i].lindices[1] = model->numLines;
-			model->lines[model->numLines] = line;
-			model->numLines++;
-		}
-		if (f3 == false)
-		{
-			GLMLine line;
-			line.vindices[0] = v1; line.vindices[1] = v2;
-			line.e1 = 0; line.e2 = 0;
-			//model->lines.push_back(line);
-			model->triangles[i].lindices[2] = model->numLines;
-			model->lines[model->numLines] = line;
-			model->numLines++;
-		}
-
-
+	triangles = (GLMtriangle*)malloc(sizeof(GLMtriangle) * (model->numtriangles + 1));
+	numtriangles = 0;
+	for (i = 0; i < model->numgroups; i++) {
+		group = groups[i];
+		memcpy(&triangles[numtriangles], model->triangles + group->first,
+			sizeof(GLMtriangle) * group->numtriangles);
+		group->first = numtriangles;
+		numtriangles += group->numtriangles;
+		group->next = i + 1 < model->numgroups ? groups[i + 1] : NULL;
 	}
+	model->groups = groups[0];
+	free(model->triangles);
+	model->triangles = triangles;
+	free(groups);
 }
 
-/* public functions */
-
-
-/* glmUnitize: "unitize" a model by translating it to the origin and
- * scaling it to fit in a unit cube around the origin.   Returns the
- * scalefactor used.
- *
- * model - properly initialized GLMmodel structure
+/* glmTableSize: number of entries of an open addressed hash table for
+ * up to count keys: a power of two at least twice count, so the table
+ * is at most half full.  Returns 0 if that doesn't fit in a size_t.
  */
-GLfloat
-glmUnitize(GLMmodel* model)
+static size_t
+glmTableSize(size_t count)
 {
-	GLuint i;
-	GLfloat maxx, minx, maxy, miny, maxz, minz;
-	GLfloat cx, cy, cz, w, h, d;
-	GLfloat scale;
-
-	assert(model);
-	assert(model->vertices);
+	size_t size;
 
-	/* get the max/mins */
-	maxx = minx = model->vertices[3 + 0];
-	maxy = miny = model->vertices[3 + 1];
-	maxz = minz = model->vertices[3 + 2];
-	for (i = 1; i <= model->numvertices; i++) {
-		if (maxx < model->vertices[3 * i + 0])
-			maxx = model->vertices[3 * i + 0];
-		if (minx > model->vertices[3 * i + 0])
-			minx = model->vertices[3 * i + 0];
+	size = 16;
+	while (size / 2 < count) {
+		if (size > (size_t)-1 / 2)
+			return 0;
+		size <<= 1;
+	}
 
-		if (maxy < model->vertices[3 * i + 1])
-			maxy = model->vertices[3 * i + 1];
-		if (miny > model->vertices[3 * i + 1])
-			miny = model->vertices[3 * i + 1];
+	return size;
+}
 
-		if (maxz < model->vertices[3 * i + 2])
-			maxz = model->vertices[3 * i + 2];
-		if (minz > model->vertices[3 * i + 2])
-			minz = model->vertices[3 * i + 2];
+/* glmLineSlot: find the slot of an undirected edge in the line hash
+ * table used by glmThirdPass().  Returns the slot holding the edge, or
+ * the empty slot it should be inserted at.
+ *
+ * table - open addressed table of (line index + 1), 0 = empty
+ * mask  - table size - 1 (table size is a power of two)
+ * a, b  - vertex indices of the edge
+ */
+static size_t
+glmLineSlot(GLMmodel* model, GLuint* table, size_t mask, GLuint a, GLuint b)
+{
+	GLuint lo, hi;
+	size_t slot;
+	GLMLine* line;
+
+	lo = a < b ? a : b;
+	hi = a < b ? b : a;
+	slot = (size_t)((lo * 0x9E3779B1u) ^ (hi * 0x85EBCA77u)) & mask;
+	while (table[slot]) {
+		line = &model->lines[table[slot] - 1];
+		if ((line->vindices[0] == a && line->vindices[1] == b) ||
+			(line->vindices[0] == b && line->vindices[1] == a))
+			break;
+		slot = (slot + 1) & mask;
 	}
 
-	/* calculate model width, height, and depth */
-	w = glmAbs(maxx) + glmAbs(minx);
-	h = glmAbs(maxy) + glmAbs(miny);
-	d = glmAbs(maxz) + glmAbs(minz);
-
-	/* calculate center of the model */
-	cx = (maxx + minx) / 2.0f;
-	cy = (maxy + miny) / 2.0f;
-	cz = (maxz + minz) / 2.0f;
-	model->position[0] = cx; model->position[1] = cy; model->position[2] = cz;
-	/* calculate unitizing scale factor */
-	scale = 2.0f / glmMax(glmMax(w, h), d);
+	return slot;
+}
 
-	/* translate around center then scale */
-	for (i = 1; i <= model->numvertices; i++) {
-		model->vertices[3 * i + 0] -= cx;
-		model->vertices[3 * i + 1] -= cy;
-		model->vertices[3 * i + 2] -= cz;
-		model->vertices[3 * i + 0] *= scale;
-		model->vertices[3 * i + 1] *= scale;
-		model->vertices[3 * i + 2] *= scale;
+/* glmAddLine: look up the edge (a, b), adding it to the model's lines
+ * if it isn't there yet.  Returns the index of the line.
+ */
+static GLuint
+glmAddLine(GLMmodel* model, GLuint* table, size_t mask, GLuint a, GLuint b)
+{
+	size_t slot;
+	GLMLine* line;
+
+	slot = glmLineSlot(model, table, mask, a, b);
+	if (!table[slot]) {
+		line = &model->lines[model->numLines];
+		line->vindices[0] = a; line->vindices[1] = b;
+		line->e1 = 0; line->e2 = 0;
+		table[slot] = ++model->numLines;
 	}
 
-	return scale;
+	return table[slot] - 1;
 }
 
-GLfloat
-glmMaxRadius(GLMmodel* model)
+/* deal with the lines: build the unique edge list of the model and
+ * point each triangle's lindices at its three edges.  Edges are found
+ * through a hash table so this stays linear in the number of
+ * triangles.  A model too large for the table is left without lines.
+ */
+static GLvoid
+glmThirdPass(GLMmodel* model)
 {
+	GLuint numtriangles;
+	GLuint* table;
 	GLuint i;
-	GLfloat maxx, minx, maxy, miny, maxz, minz;
-	GLfloat cx, cy, cz, w, h, d;
-	GLfloat R;
-	GLfloat max;
+	GLuint v0, v1, v2;
+	size_t size;
 
-	assert(model);
-	assert(model->vertices);
-
-	/* get the max/mins */
-	maxx = minx = model->vertices[3 + 0];
-	maxy = miny = model->vertices[3 + 1];
-	maxz = minz = model->vertices[3 + 2];
-	for (i = 1; i <= model->numvertices; i++) {
-		if (maxx < model->vertices[3 * i + 0])
-			maxx = model->vertices[3 * i + 0];
-		if (minx > model->vertices[3 * i + 0])
-			minx = model->vertices[3 * i + 0];
+	numtriangles = model->numtriangles;
+	model->numLines = 0;
+	model->lines = NULL;
+	table = NULL;
+
+	/* up to 3 lines per triangle, numbered from 1 in the table */
+	size = 0;
+	if (numtriangles <= ((GLuint)-1 - 1) / 3 && numtriangles <= (size_t)-1 / 3 / sizeof(GLMLine))
+		size = glmTableSize(3 * (size_t)numtriangles);
+	if (size) {
+		model->lines = (GLMLine*)malloc(3 * (size_t)numtriangles * sizeof(GLMLine));
+		table = (GLuint*)calloc(size, sizeof(GLuint));
+	}
+	if (!model->lines || !table) {
+		fprintf(stderr, "glmThirdPass(): out of memory, the model has no lines.\n");
+		free(model->lines);
+		free(table);
+		model->lines = NULL;
+		for (i = 0; i < numtriangles; i++)
+			model->triangles[i].lindices[0] = model->triangles[i].lindices[1] =
+			model->triangles[i].lindices[2] = 0;
+		return;
+	}
 
-		if (maxy < model->vertices[3 * i + 1])
-			maxy = model->vertices[3 * i + 1];
-		if (miny > model->vertices[3 * i + 1])
-			miny = model->vertices[3 * i + 1];
+	for (i = 0; i < numtriangles; i++) {
+		v0 = model->triangles[i].vindices[0];
+		v1 = model->triangles[i].vindices[1];
+		v2 = model->triangles[i].vindices[2];
 
-		if (maxz < model->vertices[3 * i + 2])
-			maxz = model->vertices[3 * i + 2];
-		if (minz > model->vertices[3 * i + 2])
-			minz = model->vertices[3 * i + 2];
+		model->triangles[i].lindices[0] = glmAddLine(model, table, size - 1, v0, v1);
+		model->triangles[i].lindices[1] = glmAddLine(model, table, size - 1, v0, v2);
+		model->triangles[i].lindices[2] = glmAddLine(model, table, size - 1, v1, v2);
 	}
 
-	/* calculate model width, height, depth and radius */
-	w = glmAbs(maxx) + glmAbs(minx);
-	h = glmAbs(maxy) + glmAbs(miny);
-	d = glmAbs(maxz) + glmAbs(minz);
-	if (w >= h)
-		max = w;
-	else
-		max = h;
-	if (max >= d)
-		max = max;
-	else
-		max = d;
-	R = max;
-	/* calculate center of the model */
-	cx = (maxx + minx) / 2.0f;
-	cy = (maxy + miny) / 2.0f;
-	cz = (maxz + minz) / 2.0f;
-	return R;
+	free(table);
 }
-/* glmDimensions: Calculates the dimensions (width, height, depth) of
- * a model.
+
+/* glmNewModel: allocate an empty model for the file being read
  *
- * model   - initialized GLMmodel structure
- * dimensions - array of 3 GLfloats (GLfloat dimensions[3])
+ * filename - name of the file the model is read from
  */
-GLvoid
-glmDimensions(GLMmodel* model, GLfloat* dimensions)
+static GLMmodel*
+glmNewModel(char* filename)
 {
-	GLuint i;
-	GLfloat maxx, minx, maxy, miny, maxz, minz;
+	GLMmodel* model;
 
-	assert(model);
-	assert(model->vertices);
-	assert(dimensions);
+	model = (GLMmodel*)malloc(sizeof(GLMmodel));
+	model->pathname = _strdup(filename);
+	model->mtllibname = NULL;
+	model->numvertices = 0;
+	model->vertices = NULL;
+	model->numnormals = 0;
+	model->normals = NULL;
+	model->numtexcoords = 0;
+	model->texcoords = NULL;
+	model->numfacetnorms = 0;
+	model->facetnorms = NULL;
+	model->numtriangles = 0;
+	model->triangles = NULL;
+	model->nummaterials = 0;
+	model->materials = NULL;
+	model->numgroups = 0;
+	model->groups = NULL;
+	model->position[0] = 0.0;
+	model->position[1] = 0.0;
+	model->position[2] = 0.0;
+	model->numLines = 0;
+	model->lines = NULL;
 
-	/* get the max/mins */
-	maxx = minx = model->vertices[3 + 0];
-	maxy = miny = model->vertices[3 + 1];
-	maxz = minz = model->vertices[3 + 2];
-	for (i = 1; i <= model->numvertices; i++) {
-		if (maxx < model->vertices[3 * i + 0])
-			maxx = model->vertices[3 * i + 0];
-		if (minx > model->vertices[3 * i + 0])
-			minx = model->vertices[3 * i + 0];
+	return model;
+}
 
-		if (maxy < model->vertices[3 * i + 1])
-			maxy = model->vertices[3 * i + 1];
-		if (miny > model->vertices[3 * i + 1])
-			miny = model->vertices[3 * i + 1];
+/* glmSingleGroup: put every triangle of a model read from a format
+ * without groups into one "default" group using the default material.
+ */
+static GLvoid
+glmSingleGroup(GLMmodel* model)
+{
+	GLMgroup* group;
 
-		if (maxz < model->vertices[3 * i + 2])
-			maxz = model->vertices[3 * i + 2];
-		if (minz > model->vertices[3 * i + 2])
-			minz = model->vertices[3 * i + 2];
-	}
+	model->nummaterials = 1;
+	model->materials = (GLMmaterial*)malloc(sizeof(GLMmaterial));
+	glmInitMaterial(&model->materials[0]);
+	model->materials[0].name = _strdup("glm_default");
 
-	/* calculate model width, height, and depth */
-	dimensions[0] = glmAbs(maxx) + glmAbs(minx);
-	dimensions[1] = glmAbs(maxy) + glmAbs(miny);
-	dimensions[2] = glmAbs(maxz) + glmAbs(minz);
+	group = glmAddGroup(model, "default");
+	group->numtriangles = model->numtriangles;
+	group->first = 0;
 }
 
-/* glmScale: Scales a model by a given amount.
- *
- * model - properly initialized GLMmodel structure
- * scale - scalefactor (0.5 = half as large, 2.0 = twice as large)
- */
-GLvoid
-glmScale(GLMmodel* model, GLfloat scale)
+
+/* PLY property types */
+enum {
+	GLM_PLY_NONE, GLM_PLY_INT8, GLM_PLY_UINT8, GLM_PLY_INT16, GLM_PLY_UINT16,
+	GLM_PLY_INT32, GLM_PLY_UINT32, GLM_PLY_FLOAT32, GLM_PLY_FLOAT64
+};
+
+/* _GLMplyproperty: one property of a PLY element */
+typedef struct _GLMplyproperty {
+	char name[32];
+	int type;                     /* scalar type, or list index type */
+	int counttype;                /* list count type, GLM_PLY_NONE if scalar */
+	size_t offset;                /* byte offset in a fixed size record */
+} GLMplyproperty;
+
+/* _GLMplyelement: one element (vertex, face, ...) of a PLY file */
+typedef struct _GLMplyelement {
+	char name[32];
+	GLuint count;
+	GLuint numproperties;
+	GLMplyproperty properties[16];
+	size_t stride;                /* record size, 0 if it holds lists */
+} GLMplyelement;
+
+/* glmPlyType: map a PLY type name to its type, GLM_PLY_NONE if unknown */
+static int
+glmPlyType(const char* name)
 {
-	GLuint i;
+	if (!strcmp(name, "char") || !strcmp(name, "int8")) return GLM_PLY_INT8;
+	if (!strcmp(name, "uchar") || !strcmp(name, "uint8")) return GLM_PLY_UINT8;
+	if (!strcmp(name, "short") || !strcmp(name, "int16")) return GLM_PLY_INT16;
+	if (!strcmp(name, "ushort") || !strcmp(name, "uint16")) return GLM_PLY_UINT16;
+	if (!strcmp(name, "int") || !strcmp(name, "int32")) return GLM_PLY_INT32;
+	if (!strcmp(name, "uint") || !strcmp(name, "uint32")) return GLM_PLY_UINT32;
+	if (!strcmp(name, "float") || !strcmp(name, "float32")) return GLM_PLY_FLOAT32;
+	if (!strcmp(name, "double") || !strcmp(name, "float64")) return GLM_PLY_FLOAT64;
+	return GLM_PLY_NONE;
+}
 
-	for (i = 1; i <= model->numvertices; i++) {
-		model->vertices[3 * i + 0] *= scale;
-		model->vertices[3 * i + 1] *= scale;
-		model->vertices[3 * i + 2] *= scale;
+/* glmPlySize: size in bytes of a PLY type */
+static size_t
+glmPlySize(int type)
+{
+	switch (type) {
+	case GLM_PLY_INT8: case GLM_PLY_UINT8: return 1;
+	case GLM_PLY_INT16: case GLM_PLY_UINT16: return 2;
+	case GLM_PLY_INT32: case GLM_PLY_UINT32: case GLM_PLY_FLOAT32: return 4;
+	case GLM_PLY_FLOAT64: return 8;
 	}
+	return 0;
 }
 
-/* glmReverseWinding: Reverse the polygon winding for all polygons in
- * this model.   Default winding is counter-clockwise.  Also changes
- * the direction of the normals.
- *
- * model - properly initialized GLMmodel structure
+/* glmPlyLoad: load a value of the given type, byte swapping if the
+ * file endianness doesn't match the host.
  */
-GLvoid
-glmReverseWinding(GLMmodel* model)
+static double
+glmPlyLoad(const GLubyte* p, int type, GLboolean swap)
 {
-	GLuint i, swap;
-
-	assert(model);
+	GLubyte b[8];
+	size_t i, n;
+	union { GLbyte c; GLubyte uc; GLshort s; GLushort us; GLint i; GLuint ui; GLfloat f; GLdouble d; } u;
+
+	n = glmPlySize(type);
+	if (swap) {
+		for (i = 0; i < n; i++)
+			b[i] = p[n - 1 - i];
+		p = b;
+	}
+	memcpy(&u, p, n);
+
+	switch (type) {
+	case GLM_PLY_INT8: return u.c;
+	case GLM_PLY_UINT8: return u.uc;
+	case GLM_PLY_INT16: return u.s;
+	case GLM_PLY_UINT16: return u.us;
+	case GLM_PLY_INT32: return u.i;
+	case GLM_PLY_UINT32: return u.ui;
+	case GLM_PLY_FLOAT32: return u.f;
+	case GLM_PLY_FLOAT64: return u.d;
+	}
+	return 0.0;
+}
 
+/* glmPlyIndex: load an unsigned list count or vertex index */
+static GLuint
+glmPlyIndex(const GLubyte* p, int type, GLboolean swap)
+{
+	GLuint v;
+
+	switch (type) {
+	case GLM_PLY_INT8: case GLM_PLY_UINT8:
+		return p[0];
+	case GLM_PLY_INT32: case GLM_PLY_UINT32:
+		memcpy(&v, p, 4);
+		if (swap)
+			v = (v >> 24) | ((v >> 8) & 0xff00) | ((v << 8) & 0xff0000) | (v << 24);
+		return v;
+	}
+	return (GLuint)glmPlyLoad(p, type, swap);
+}
+
+/* glmPlySkip: returns the size in bytes of one (variable size) record
+ * of an element, or 0 if it would run past end.
+ */
+static size_t
+glmPlySkip(GLMplyelement* element, const GLubyte* p, const GLubyte* end, GLboolean swap)
+{
+	const GLubyte* start;
+	GLMplyproperty* property;
+	size_t size;
+	GLuint i, count;
+
+	start = p;
+	for (i = 0; i < element->numproperties; i++) {
+		property = &element->properties[i];
+		if (property->counttype == GLM_PLY_NONE) {
+			p += glmPlySize(property->type);
+			continue;
+		}
+		size = glmPlySize(property->counttype);
+		if (p + size > end)
+			return 0;
+		count = glmPlyIndex(p, property->counttype, swap);
+		p += size + count * glmPlySize(property->type);
+	}
+
+	return p > end ? 0 : (size_t)(p - start);
+}
+
+/* glmPlyFind: index of the named property in an element, -1 if none */
+static int
+glmPlyFind(GLMplyelement* element, const char* name)
+{
+	GLuint i;
+
+	for (i = 0; i < element->numproperties; i++) {
+		if (!strcmp(element->properties[i].name, name))
+			return (int)i;
+	}
+	return -1;
+}
+
+/* glmPlyHeader: parse the ASCII header of a binary PLY file
+ *
+ * data     - the mapped file
+ * size     - size of the mapped file
+ * elements - array of at least 8 elements to fill in
+ * swap     - set to GL_TRUE if the file endianness isn't the host's
+ *
+ * Returns the number of elements, 0 if the header isn't valid.  The
+ * offset of the body is returned in *body.
+ */
+static GLuint
+glmPlyHeader(const GLubyte* data, size_t size, GLMplyelement* elements,
+	GLboolean* swap, size_t* body)
+{
+	char line[256], a[64], b[64], c[64], d[64];
+	GLMplyelement* element;
+	GLMplyproperty* property;
+	GLuint numelements, i;
+	size_t pos, len;
+	int n;
+
+	if (size < 4 || memcmp(data, "ply", 3))
+		return 0;
+
+	numelements = 0;
+	element = NULL;
+	*body = 0;
+	pos = 0;
+	while (pos < size) {
+		/* copy out the next header line */
+		len = 0;
+		while (pos < size && data[pos] != '\n') {
+			if (len < sizeof(line) - 1 && data[pos] != '\r')
+				line[len++] = data[pos];
+			pos++;
+		}
+		line[len] = '\0';
+		pos++;
+
+		n = sscanf(line, "%63s %63s %63s %63s", a, b, c, d);
+		if (n < 1)
+			continue;
+		if (!strcmp(a, "format")) {
+			if (!strcmp(b, "binary_little_endian"))
+				*swap = !glmHostIsLittleEndian();
+			else if (!strcmp(b, "binary_big_endian"))
+				*swap = glmHostIsLittleEndian();
+			else
+				return 0;   /* ascii PLY isn't handled here */
+		}
+		else if (!strcmp(a, "element") && n == 3) {
+			if (numelements == 8)
+				return 0;
+			element = &elements[numelements++];
+			len = strlen(b) < sizeof(element->name) - 1 ? strlen(b) : sizeof(element->name) - 1;
+			memcpy(element->name, b, len);
+			element->name[len] = '\0';
+			element->count = (GLuint)strtoul(c, NULL, 10);
+			element->numproperties = 0;
+			element->stride = 0;
+		}
+		else if (!strcmp(a, "property") && element) {
+			if (element->numproperties == 16)
+				return 0;
+			property = &element->properties[element->numproperties++];
+			if (!strcmp(b, "list") && n == 4) {
+				property->counttype = glmPlyType(c);
+				property->type = glmPlyType(d);
+				sscanf(line, "%*s %*s %*s %*s %31s", property->name);
+				if (property->counttype == GLM_PLY_NONE)
+					return 0;
+			}
+			else {
+				property->counttype = GLM_PLY_NONE;
+				property->type = glmPlyType(b);
+				len = strlen(c) < sizeof(property->name) - 1 ? strlen(c) : sizeof(property->name) - 1;
+				memcpy(property->name, c, len);
+				property->name[len] = '\0';
+			}
+			if (property->type == GLM_PLY_NONE)
+				return 0;
+		}
+		else if (!strcmp(a, "end_header")) {
+			*body = pos;
+			break;
+		}
+	}
+	if (!*body)
+		return 0;
+
+	/* work out the record layout of the fixed size elements */
+	for (element = elements; element < elements + numelements; element++) {
+		len = 0;
+		for (i = 0; i < element->numproperties; i++) {
+			property = &element->properties[i];
+			if (property->counttype != GLM_PLY_NONE) {
+				len = 0;
+				break;
+			}
+			property->offset = len;
+			len += glmPlySize(property->type);
+		}
+		element->stride = len;
+	}
+
+	return numelements;
+}
+
+/* glmPlyVertices: bulk convert the vertex element of a PLY file into
+ * the model's vertex (and normal/texcoord) arrays.
+ */
+static GLvoid
+glmPlyVertices(GLMmodel* model, GLMplyelement* element, const GLubyte* p,
+	GLboolean swap)
+{
+	GLMplyproperty* properties;
+	int x, y, z, nx, ny, nz, s, t;
+	GLuint i;
+
+	properties = element->properties;
+	x = glmPlyFind(element, "x");
+	y = glmPlyFind(element, "y");
+	z = glmPlyFind(element, "z");
+	nx = glmPlyFind(element, "nx");
+	ny = glmPlyFind(element, "ny");
+	nz = glmPlyFind(element, "nz");
+	s = glmPlyFind(element, "s");
+	if (s < 0) s = glmPlyFind(element, "u");
+	if (s < 0) s = glmPlyFind(element, "texture_u");
+	t = glmPlyFind(element, "t");
+	if (t < 0) t = glmPlyFind(element, "v");
+	if (t < 0) t = glmPlyFind(element, "texture_v");
+
+	model->numvertices = element->count;
+	model->vertices = (GLfloat*)malloc(sizeof(GLfloat) * 3 * (model->numvertices + 1));
+	if (nx >= 0 && ny >= 0 && nz >= 0) {
+		model->numnormals = element->count;
+		model->normals = (GLfloat*)malloc(sizeof(GLfloat) * 3 * (model->numnormals + 1));
+	}
+	if (s >= 0 && t >= 0) {
+		model->numtexcoords = element->count;
+		model->texcoords = (GLfloat*)malloc(sizeof(GLfloat) * 2 * (model->numtexcoords + 1));
+	}
+
+	/* the common "float x, y, z" layout with matching endianness is a
+	   strided copy, everything else goes through glmPlyLoad() */
+	if (!swap && x == 0 && y == 1 && z == 2 &&
+		properties[0].type == GLM_PLY_FLOAT32 &&
+		properties[1].type == GLM_PLY_FLOAT32 &&
+		properties[2].type == GLM_PLY_FLOAT32) {
+		if (element->stride == 3 * sizeof(GLfloat)) {
+			memcpy(&model->vertices[3], p, element->stride * element->count);
+		}
+		else {
+			for (i = 1; i <= model->numvertices; i++)
+				memcpy(&model->vertices[3 * i], p + element->stride * (i - 1), 3 * sizeof(GLfloat));
+		}
+	}
+	else {
+		for (i = 1; i <= model->numvertices; i++) {
+			const GLubyte* r = p + element->stride * (i - 1);
+			model->vertices[3 * i + 0] = (GLfloat)glmPlyLoad(r + properties[x].offset, properties[x].type, swap);
+			model->vertices[3 * i + 1] = (GLfloat)glmPlyLoad(r + properties[y].offset, properties[y].type, swap);
+			model->vertices[3 * i + 2] = (GLfloat)glmPlyLoad(r + properties[z].offset, properties[z].type, swap);
+		}
+	}
+
+	if (model->normals) {
+		for (i = 1; i <= model->numnormals; i++) {
+			const GLubyte* r = p + element->stride * (i - 1);
+			model->normals[3 * i + 0] = (GLfloat)glmPlyLoad(r + properties[nx].offset, properties[nx].type, swap);
+			model->normals[3 * i + 1] = (GLfloat)glmPlyLoad(r + properties[ny].offset, properties[ny].type, swap);
+			model->normals[3 * i + 2] = (GLfloat)glmPlyLoad(r + properties[nz].offset, properties[nz].type, swap);
+		}
+	}
+	if (model->texcoords) {
+		for (i = 1; i <= model->numtexcoords; i++) {
+			const GLubyte* r = p + element->stride * (i - 1);
+			model->texcoords[2 * i + 0] = (GLfloat)glmPlyLoad(r + properties[s].offset, properties[s].type, swap);
+			model->texcoords[2 * i + 1] = (GLfloat)glmPlyLoad(r + properties[t].offset, properties[t].type, swap);
+		}
+	}
+}
+
+/* glmPlyFaces: triangulate the face element of a PLY file into the
+ * model's triangles.  Polygons are split into fans like glmSecondPass()
+ * does for OBJ faces.  Returns GL_FALSE if the face data is corrupt.
+ */
+static GLboolean
+glmPlyFaces(GLMmodel* model, GLMplyelement* element, const GLubyte* p,
+	const GLubyte* end, GLboolean swap)
+{
+	GLMplyproperty* list;
+	const GLubyte* q;
+	GLuint numtriangles, count, i, j, k, v[3];
+	size_t isize, csize, record, before;
+	int index;
+
+	index = glmPlyFind(element, "vertex_indices");
+	if (index < 0)
+		index = glmPlyFind(element, "vertex_index");
+	if (index < 0 || element->properties[index].counttype == GLM_PLY_NONE)
+		return GL_FALSE;
+	list = &element->properties[index];
+	isize = glmPlySize(list->type);
+	csize = glmPlySize(list->counttype);
+
+	/* offset of the index list in a record (any scalar properties in
+	   front of it are fixed size) */
+	before = 0;
+	for (k = 0; k < (GLuint)index; k++) {
+		if (element->properties[k].counttype != GLM_PLY_NONE)
+			return GL_FALSE;
+		before += glmPlySize(element->properties[k].type);
+	}
+
+	/* count the triangles */
+	numtriangles = 0;
+	q = p;
+	for (i = 0; i < element->count; i++) {
+		if (q + before + csize > end)
+			return GL_FALSE;
+		count = glmPlyIndex(q + before, list->counttype, swap);
+		if (count >= 3)
+			numtriangles += count - 2;
+		if (!(record = glmPlySkip(element, q, end, swap)))
+			return GL_FALSE;
+		q += record;
+	}
+
+	model->numtriangles = numtriangles;
+	model->triangles = (GLMtriangle*)malloc(sizeof(GLMtriangle) * numtriangles);
+
+	numtriangles = 0;
+	q = p;
+	for (i = 0; i < element->count; i++) {
+		count = glmPlyIndex(q + before, list->counttype, swap);
+		record = glmPlySkip(element, q, end, swap);
+		if (count >= 3) {
+			const GLubyte* r = q + before + csize;
+			v[0] = glmPlyIndex(r, list->type, swap) + 1;
+			v[2] = glmPlyIndex(r + isize, list->type, swap) + 1;
+			for (j = 2; j < count; j++) {
+				v[1] = v[2];
+				v[2] = glmPlyIndex(r + j * isize, list->type, swap) + 1;
+				for (k = 0; k < 3; k++) {
+					if (v[k] == 0 || v[k] > model->numvertices)
+						return GL_FALSE;
+					T(numtriangles).vindices[k] = v[k];
+					T(numtriangles).nindices[k] = model->normals ? v[k] : 0;
+					T(numtriangles).tindices[k] = model->texcoords ? v[k] : 0;
+				}
+				T(numtriangles).findex = 0;
+				numtriangles++;
+			}
+		}
+		q += record;
+	}
+
+	return GL_TRUE;
+}
+
+/* _GLMstlvertex: key of the vertex dedup table used by glmReadSTL() */
+typedef struct _GLMstlvertex {
+	GLuint bits[3];               /* bit pattern of x, y, z */
+	GLuint index;                 /* model vertex index, 0 = empty */
+} GLMstlvertex;
+
+/* JSON token types */
+enum {
+	GLM_JSON_OBJECT = 1, GLM_JSON_ARRAY, GLM_JSON_STRING, GLM_JSON_PRIMITIVE
+};
+
+/* _GLMjson: a JSON token.  Tokens are stored in document order; the
+ * value of an object key directly follows the key token.
+ */
+typedef struct _GLMjson {
+	int type;                     /* GLM_JSON_* */
+	int start, end;               /* character range of the token */
+	int size;                     /* number of keys/elements */
+	int next;                     /* index of the token after this subtree */
+} GLMjson;
+
+/* _GLMjsonparser: state of glmJsonValue() */
+typedef struct _GLMjsonparser {
+	const char* js;
+	int len;
+	int pos;
+	GLMjson* tokens;              /* NULL to only count tokens */
+	int num;
+} GLMjsonparser;
+
+/* glmJsonSpace: skip white space */
+static GLvoid
+glmJsonSpace(GLMjsonparser* p)
+{
+	while (p->pos < p->len && (p->js[p->pos] == ' ' || p->js[p->pos] == '\t' ||
+		p->js[p->pos] == '\n' || p->js[p->pos] == '\r'))
+		p->pos++;
+}
+
+/* glmJsonValue: parse one JSON value and its children.  Returns the
+ * index of its token, or -1 on a syntax error.
+ */
+static int
+glmJsonValue(GLMjsonparser* p, int depth)
+{
+	GLMjson token;
+	int index, child;
+	char c, close;
+
+	glmJsonSpace(p);
+	if (p->pos >= p->len || depth > 64)
+		return -1;
+
+	index = p->num++;
+	token.start = p->pos;
+	token.size = 0;
+	c = p->js[p->pos];
+	if (c == '{' || c == '[') {
+		token.type = c == '{' ? GLM_JSON_OBJECT : GLM_JSON_ARRAY;
+		close = c == '{' ? '}' : ']';
+		p->pos++;
+		glmJsonSpace(p);
+		if (p->pos < p->len && p->js[p->pos] == close) {
+			p->pos++;
+		}
+		else {
+			for (;;) {
+				if (token.type == GLM_JSON_OBJECT) {
+					child = glmJsonValue(p, depth + 1);
+					if (child < 0 || (p->tokens && p->tokens[child].type != GLM_JSON_STRING))
+						return -1;
+					glmJsonSpace(p);
+					if (p->pos >= p->len || p->js[p->pos] != ':')
+						return -1;
+					p->pos++;
+				}
+				if (glmJsonValue(p, depth + 1) < 0)
+					return -1;
+				token.size++;
+				glmJsonSpace(p);
+				if (p->pos >= p->len)
+					return -1;
+				c = p->js[p->pos++];
+				if (c == close)
+					break;
+				if (c != ',')
+					return -1;
+			}
+		}
+		token.end = p->pos;
+	}
+	else if (c == '"') {
+		token.type = GLM_JSON_STRING;
+		token.start = ++p->pos;
+		while (p->pos < p->len && p->js[p->pos] != '"') {
+			if (p->js[p->pos] == '\\')
+				p->pos++;
+			p->pos++;
+		}
+		if (p->pos >= p->len)
+			return -1;
+		token.end = p->pos++;
+	}
+	else {
+		token.type = GLM_JSON_PRIMITIVE;
+		while (p->pos < p->len && !strchr(" \t\r\n,:]}", p->js[p->pos]))
+			p->pos++;
+		token.end = p->pos;
+		if (token.end == token.start)
+			return -1;
+	}
+
+	token.next = p->num;
+	if (p->tokens)
+		p->tokens[index] = token;
+
+	return index;
+}
+
+/* glmJsonParse: tokenize a JSON document.  Returns the token array
+ * (free'd by the caller), or NULL on a syntax error.
+ */
+static GLMjson*
+glmJsonParse(const char* js, int len)
+{
+	GLMjsonparser p;
+
+	p.js = js;
+	p.len = len;
+	p.pos = 0;
+	p.tokens = NULL;
+	p.num = 0;
+	if (glmJsonValue(&p, 0) < 0)
+		return NULL;
+
+	p.tokens = (GLMjson*)malloc(sizeof(GLMjson) * p.num);
+	p.pos = 0;
+	p.num = 0;
+	glmJsonValue(&p, 0);
+
+	return p.tokens;
+}
+
+/* glmJsonKey: index of the value of key in object token obj, -1 if none */
+static int
+glmJsonKey(const char* js, GLMjson* t, int obj, const char* key)
+{
+	int i, k;
+	size_t len;
+
+	if (obj < 0 || t[obj].type != GLM_JSON_OBJECT)
+		return -1;
+
+	len = strlen(key);
+	i = obj + 1;
+	for (k = 0; k < t[obj].size; k++) {
+		if (t[i].end - t[i].start == (int)len && !memcmp(js + t[i].start, key, len))
+			return i + 1;
+		i = t[i + 1].next;
+	}
+	return -1;
+}
+
+/* glmJsonAt: index of element n of array token arr, -1 if none */
+static int
+glmJsonAt(GLMjson* t, int arr, int n)
+{
+	int i;
+
+	if (arr < 0 || t[arr].type != GLM_JSON_ARRAY || n < 0 || n >= t[arr].size)
+		return -1;
+
+	i = arr + 1;
+	while (n--)
+		i = t[i].next;
+	return i;
+}
+
+/* glmJsonNumber: value of number token i, def if it isn't a number */
+static double
+glmJsonNumber(const char* js, GLMjson* t, int i, double def)
+{
+	char buf[64];
+	char* end;
+	int len;
+	double value;
+
+	if (i < 0 || t[i].type != GLM_JSON_PRIMITIVE)
+		return def;
+	len = t[i].end - t[i].start;
+	if (len >= (int)sizeof(buf))
+		return def;
+	memcpy(buf, js + t[i].start, len);
+	buf[len] = '\0';
+	value = strtod(buf, &end);
+	return end == buf ? def : value;
+}
+
+/* glmJsonEq: GL_TRUE if token i is the string s */
+static GLboolean
+glmJsonEq(const char* js, GLMjson* t, int i, const char* s)
+{
+	size_t len;
+
+	len = strlen(s);
+	return i >= 0 && t[i].type == GLM_JSON_STRING &&
+		t[i].end - t[i].start == (int)len && !memcmp(js + t[i].start, s, len);
+}
+
+/* glmJsonString: strdup of string token i, NULL if it isn't a string */
+static char*
+glmJsonString(const char* js, GLMjson* t, int i)
+{
+	char* s;
+	int len;
+
+	if (i < 0 || t[i].type != GLM_JSON_STRING)
+		return NULL;
+	len = t[i].end - t[i].start;
+	s = (char*)malloc(len + 1);
+	memcpy(s, js + t[i].start, len);
+	s[len] = '\0';
+	return s;
+}
+
+/* glmGltfUint: a JSON number that must be a whole GLuint; sizes and
+ * offsets from the file are only used once they pass this.
+ */
+static GLboolean
+glmGltfUint(double number, GLuint* value)
+{
+	if (number < 0.0 || number > 4294967295.0 || number != floor(number))
+		return GL_FALSE;
+	*value = (GLuint)number;
+	return GL_TRUE;
+}
+
+/* glmGltfAccessor: resolve and validate a glTF accessor
+ *
+ * accessor - index of the accessor
+ * size     - required number of components
+ * target   - GL_ARRAY_BUFFER (float data) or GL_ELEMENT_ARRAY_BUFFER
+ *            (unsigned indices)
+ *
+ * Checks that the accessor is a plain (non sparse) accessor of the
+ * right type whose last element lies inside its buffer view, that
+ * the view lies inside the binary chunk and that it isn't used both
+ * for vertices and indices.  Returns GL_FALSE if any check fails.
+ */
+static GLboolean
+glmGltfAccessor(GLMgltf* gltf, const char* js, GLMjson* t, int root,
+	int accessor, GLint size, GLenum target, GLMgltfattrib* attrib)
+{
+	GLMgltfview* view;
+	int a, v;
+	GLenum type;
+	GLuint csize, esize, stride;
+	unsigned long long last;
+
+	a = glmJsonAt(t, glmJsonKey(js, t, root, "accessors"), accessor);
+	if (a < 0 || glmJsonKey(js, t, a, "sparse") >= 0)
+		return GL_FALSE;
+
+	attrib->view = (GLint)glmJsonNumber(js, t, glmJsonKey(js, t, a, "bufferView"), -1);
+	if (attrib->view < 0 || (GLuint)attrib->view >= gltf->numviews)
+		return GL_FALSE;
+	view = &gltf->views[attrib->view];
+
+	v = glmJsonKey(js, t, a, "type");
+	if (glmJsonEq(js, t, v, "SCALAR")) attrib->size = 1;
+	else if (glmJsonEq(js, t, v, "VEC2")) attrib->size = 2;
+	else if (glmJsonEq(js, t, v, "VEC3")) attrib->size = 3;
+	else if (glmJsonEq(js, t, v, "VEC4")) attrib->size = 4;
+	else return GL_FALSE;
+	if (attrib->size != size)
+		return GL_FALSE;
+
+	/* glTF component types are the GL enums */
+	type = (GLenum)glmJsonNumber(js, t, glmJsonKey(js, t, a, "componentType"), 0);
+	switch (type) {
+	case GL_BYTE: case GL_UNSIGNED_BYTE: csize = 1; break;
+	case GL_SHORT: case GL_UNSIGNED_SHORT: csize = 2; break;
+	case GL_UNSIGNED_INT: case GL_FLOAT: csize = 4; break;
+	default: return GL_FALSE;
+	}
+	if (target == GL_ELEMENT_ARRAY_BUFFER && type != GL_UNSIGNED_BYTE &&
+		type != GL_UNSIGNED_SHORT && type != GL_UNSIGNED_INT)
+		return GL_FALSE;
+	if (target == GL_ARRAY_BUFFER && type != GL_FLOAT)
+		return GL_FALSE;
+	attrib->type = type;
+
+	if (!glmGltfUint(glmJsonNumber(js, t, glmJsonKey(js, t, a, "count"), 0), &attrib->count) ||
+		!glmGltfUint(glmJsonNumber(js, t, glmJsonKey(js, t, a, "byteOffset"), 0), &attrib->offset) ||
+		!glmGltfUint(glmJsonNumber(js, t, glmJsonKey(js, t,
+		glmJsonAt(t, glmJsonKey(js, t, root, "bufferViews"), attrib->view), "byteStride"), 0), &stride))
+		return GL_FALSE;
+	esize = csize * attrib->size;
+	/* glTF strides are 4 to 252; indices are tightly packed for GL */
+	if (attrib->count == 0 || (stride && (stride < esize || stride > 252)) ||
+		(stride && target == GL_ELEMENT_ARRAY_BUFFER) ||
+		((unsigned long long)view->offset + attrib->offset) % csize)
+		return GL_FALSE;
+	attrib->stride = (GLsizei)stride;
+
+	/* the last element must end inside the view; in 64 bits, as the
+	product of a count and a stride from the file can wrap a GLuint */
+	last = (unsigned long long)attrib->offset +
+		(unsigned long long)(stride ? stride : esize) * (attrib->count - 1) + esize;
+	if (last > view->length)
+		return GL_FALSE;
+
+	if (view->target && view->target != target)
+		return GL_FALSE;
+	view->target = target;
+
+	return GL_TRUE;
+}
+
+/* glmGltfIndices: check that every index of a primitive is below the
+ * number of vertices it has.  The indices are dereferenced on the CPU
+ * when they are drawn from the mapped file, so a bad one would read
+ * past the attribute arrays.
+ */
+static GLboolean
+glmGltfIndices(GLMgltf* gltf, GLMgltfattrib* indices, GLuint numvertices)
+{
+	const GLubyte* p;
+	GLushort u16;
+	GLuint u32, i;
+
+	p = gltf->bin + gltf->views[indices->view].offset + indices->offset;
+	for (i = 0; i < indices->count; i++) {
+		switch (indices->type) {
+		case GL_UNSIGNED_BYTE:
+			u32 = p[i];
+			break;
+		case GL_UNSIGNED_SHORT:
+			memcpy(&u16, p + 2 * i, 2);
+			u32 = u16;
+			break;
+		default:
+			memcpy(&u32, p + 4 * i, 4);
+			break;
+		}
+		if (u32 >= numvertices)
+			return GL_FALSE;
+	}
+
+	return GL_TRUE;
+}
+
+/* glmGltfBounds: fold the min/max of a POSITION accessor into the bounds */
+static GLvoid
+glmGltfBounds(GLMgltf* gltf, const char* js, GLMjson* t, int root, int accessor)
+{
+	int a, mn, mx, k;
+
+	a = glmJsonAt(t, glmJsonKey(js, t, root, "accessors"), accessor);
+	mn = glmJsonKey(js, t, a, "min");
+	mx = glmJsonKey(js, t, a, "max");
+	if (mn < 0 || mx < 0)
+		return;
+	for (k = 0; k < 3; k++) {
+		GLfloat lo = (GLfloat)glmJsonNumber(js, t, glmJsonAt(t, mn, k), 0.0);
+		GLfloat hi = (GLfloat)glmJsonNumber(js, t, glmJsonAt(t, mx, k), 0.0);
+		if (lo < gltf->min[k]) gltf->min[k] = lo;
+		if (hi > gltf->max[k]) gltf->max[k] = hi;
+	}
+}
+
+/* glmGltfMeshes: read the buffer views, materials and mesh primitives
+ * of a glTF document.  Returns GL_FALSE if anything doesn't validate.
+ */
+static GLboolean
+glmGltfMeshes(GLMgltf* gltf, const char* js, GLMjson* t)
+{
+	GLMgltfprimitive* primitive;
+	GLMgltfview* view;
+	GLMgroup* group;
+	char name[32];
+	int root, views, materials, meshes, mesh, prims, p, attrs, m, k, c;
+	GLuint numprimitives;
+	double buffer;
+
+	root = 0;
+	if (t[root].type != GLM_JSON_OBJECT)
+		return GL_FALSE;
+
+	/* buffer views; only buffer 0 (the binary chunk) can be used */
+	views = glmJsonKey(js, t, root, "bufferViews");
+	gltf->numviews = views >= 0 ? t[views].size : 0;
+	gltf->views = (GLMgltfview*)calloc(gltf->numviews + 1, sizeof(GLMgltfview));
+	for (k = 0; k < (int)gltf->numviews; k++) {
+		m = glmJsonAt(t, views, k);
+		view = &gltf->views[k];
+		buffer = glmJsonNumber(js, t, glmJsonKey(js, t, m, "buffer"), -1);
+		if (buffer != 0 ||
+			!glmGltfUint(glmJsonNumber(js, t, glmJsonKey(js, t, m, "byteOffset"), 0), &view->offset) ||
+			!glmGltfUint(glmJsonNumber(js, t, glmJsonKey(js, t, m, "byteLength"), 0), &view->length) ||
+			view->offset > gltf->binlength ||
+			view->length > gltf->binlength - view->offset)
+			return GL_FALSE;
+	}
+
+	/* materials, index 0 is the glm default */
+	materials = glmJsonKey(js, t, root, "materials");
+	gltf->nummaterials = 1 + (materials >= 0 ? t[materials].size : 0);
+	gltf->materials = (GLMmaterial*)malloc(sizeof(GLMmaterial) * gltf->nummaterials);
+	for (k = 0; k < (int)gltf->nummaterials; k++)
+		glmInitMaterial(&gltf->materials[k]);
+	gltf->materials[0].name = _strdup("glm_default");
+	for (k = 1; k < (int)gltf->nummaterials; k++) {
+		m = glmJsonAt(t, materials, k - 1);
+		gltf->materials[k].name = glmJsonString(js, t, glmJsonKey(js, t, m, "name"));
+		if (!gltf->materials[k].name) {
+			sprintf(name, "material%d", k - 1);
+			gltf->materials[k].name = _strdup(name);
+		}
+		m = glmJsonKey(js, t, glmJsonKey(js, t, m, "pbrMetallicRoughness"), "baseColorFactor");
+		for (c = 0; c < 4; c++)
+			gltf->materials[k].diffuse[c] = (GLfloat)glmJsonNumber(js, t, glmJsonAt(t, m, c),
+			gltf->materials[k].diffuse[c]);
+	}
+
+	/* count the primitives */
+	meshes = glmJsonKey(js, t, root, "meshes");
+	if (meshes < 0 || t[meshes].size == 0)
+		return GL_FALSE;
+	numprimitives = 0;
+	for (k = 0; k < t[meshes].size; k++) {
+		prims = glmJsonKey(js, t, glmJsonAt(t, meshes, k), "primitives");
+		if (prims < 0 || t[prims].type != GLM_JSON_ARRAY)
+			return GL_FALSE;
+		numprimitives += t[prims].size;
+	}
+	gltf->numprimitives = numprimitives;
+	gltf->primitives = (GLMgltfprimitive*)malloc(sizeof(GLMgltfprimitive) * (numprimitives + 1));
+
+	gltf->min[0] = gltf->min[1] = gltf->min[2] = 1e30f;
+	gltf->max[0] = gltf->max[1] = gltf->max[2] = -1e30f;
+
+	numprimitives = 0;
+	for (k = 0; k < t[meshes].size; k++) {
+		mesh = glmJsonAt(t, meshes, k);
+		prims = glmJsonKey(js, t, mesh, "primitives");
+
+		/* one metadata-only group per mesh */
+		group = (GLMgroup*)malloc(sizeof(GLMgroup));
+		group->name = glmJsonString(js, t, glmJsonKey(js, t, mesh, "name"));
+		if (!group->name) {
+			sprintf(name, "mesh%d", k);
+			group->name = _strdup(name);
+		}
+		group->numtriangles = 0;
+		group->first = 0;
+		group->material = 0;
+		group->next = gltf->groups;
+		gltf->groups = group;
+		gltf->numgroups++;
+
+		for (p = 0; p < t[prims].size; p++) {
+			m = glmJsonAt(t, prims, p);
+			primitive = &gltf->primitives[numprimitives++];
+			primitive->mode = (GLenum)glmJsonNumber(js, t, glmJsonKey(js, t, m, "mode"), GL_TRIANGLES);
+			if (primitive->mode > GL_TRIANGLE_FAN)
+				return GL_FALSE;
+			primitive->material = (GLuint)(glmJsonNumber(js, t, glmJsonKey(js, t, m, "material"), -1) + 1);
+			if (primitive->material >= gltf->nummaterials)
+				return GL_FALSE;
+			if (p == 0)
+				group->material = primitive->material;
+
+			attrs = glmJsonKey(js, t, m, "attributes");
+			c = (int)glmJsonNumber(js, t, glmJsonKey(js, t, attrs, "POSITION"), -1);
+			if (!glmGltfAccessor(gltf, js, t, root, c, 3, GL_ARRAY_BUFFER, &primitive->position))
+				return GL_FALSE;
+			glmGltfBounds(gltf, js, t, root, c);
+
+			primitive->normal.view = -1;
+			c = (int)glmJsonNumber(js, t, glmJsonKey(js, t, attrs, "NORMAL"), -1);
+			if (c >= 0 && !glmGltfAccessor(gltf, js, t, root, c, 3, GL_ARRAY_BUFFER, &primitive->normal))
+				return GL_FALSE;
+			primitive->texcoord.view = -1;
+			c = (int)glmJsonNumber(js, t, glmJsonKey(js, t, attrs, "TEXCOORD_0"), -1);
+			if (c >= 0 && !glmGltfAccessor(gltf, js, t, root, c, 2, GL_ARRAY_BUFFER, &primitive->texcoord))
+				return GL_FALSE;
+			primitive->indices.view = -1;
+			c = (int)glmJsonNumber(js, t, glmJsonKey(js, t, m, "indices"), -1);
+			if (c >= 0 && !glmGltfAccessor(gltf, js, t, root, c, 1, GL_ELEMENT_ARRAY_BUFFER, &primitive->indices))
+				return GL_FALSE;
+
+			/* every vertex drawn must have its normal and texcoord */
+			if ((primitive->normal.view >= 0 && primitive->normal.count < primitive->position.count) ||
+				(primitive->texcoord.view >= 0 && primitive->texcoord.count < primitive->position.count))
+				return GL_FALSE;
+			if (primitive->indices.view >= 0 &&
+				!glmGltfIndices(gltf, &primitive->indices, primitive->position.count))
+				return GL_FALSE;
+
+			if (primitive->mode == GL_TRIANGLES)
+				group->numtriangles += (primitive->indices.view >= 0 ?
+				primitive->indices.count : primitive->position.count) / 3;
+		}
+	}
+
+	return GL_TRUE;
+}
+
+/* glmGltfPointer: the pointer to pass to gl*Pointer for an attribute,
+ * a buffer offset once uploaded or the mapped data before that.  Also
+ * binds the attribute's buffer to target.
+ */
+static const GLvoid*
+glmGltfPointer(GLMgltf* gltf, GLMgltfattrib* attrib, GLenum target)
+{
+	GLMgltfview* view;
+
+	view = &gltf->views[attrib->view];
+	if (view->buffer) {
+		glmextBindBuffer(target, view->buffer);
+		return (const GLvoid*)(size_t)attrib->offset;
+	}
+	if (glmExtHasBuffers())
+		glmextBindBuffer(target, 0);
+	return gltf->bin + view->offset + attrib->offset;
+}
+
+/* glmMortonSpread: spread the low 10 bits of x so there are two zero
+ * bits between each of them.
+ */
+static GLuint
+glmMortonSpread(GLuint x)
+{
+	x &= 0x3ff;
+	x = (x | (x << 16)) & 0x030000ff;
+	x = (x | (x << 8)) & 0x0300f00f;
+	x = (x | (x << 4)) & 0x030c30c3;
+	x = (x | (x << 2)) & 0x09249249;
+	return x;
+}
+
+/* glmSortKeys: sort an array of (key << 32 | index) pairs with an LSD
+ * radix sort, 8 bits at a time.  Passes over bytes that are the same
+ * for every pair are skipped.
+ */
+static GLvoid
+glmSortKeys(unsigned long long* keys, GLuint count)
+{
+	unsigned long long* buffer;
+	unsigned long long* from;
+	unsigned long long* to;
+	unsigned long long* swap;
+	GLuint histogram[256];
+	GLuint pass, i, sum, digit;
+
+	if (count < 2)
+		return;
+
+	buffer = (unsigned long long*)malloc(sizeof(unsigned long long) * count);
+	from = keys;
+	to = buffer;
+	for (pass = 0; pass < 64; pass += 8) {
+		memset(histogram, 0, sizeof(histogram));
+		for (i = 0; i < count; i++)
+			histogram[(from[i] >> pass) & 0xff]++;
+		if (histogram[(from[0] >> pass) & 0xff] == count)
+			continue;
+		for (sum = 0, i = 0; i < 256; i++) {
+			digit = histogram[i];
+			histogram[i] = sum;
+			sum += digit;
+		}
+		for (i = 0; i < count; i++)
+			to[histogram[(from[i] >> pass) & 0xff]++] = from[i];
+		swap = from; from = to; to = swap;
+	}
+	if (from != keys)
+		memcpy(keys, from, sizeof(unsigned long long) * count);
+	free(buffer);
+}
+
+/* glmReorderByUse: renumber an array of vectors (normals, texcoords)
+ * in the order the triangles first reference them.  Vectors no
+ * triangle references keep their relative order after the used ones.
+ *
+ * vectors - array of size * (count + 1) GLfloats, 1 based
+ * count   - number of vectors
+ * size    - GLfloats per vector
+ * field   - byte offset of the GLuint[3] index array in GLMtriangle
+ */
+static GLvoid
+glmReorderByUse(GLMmodel* model, GLfloat* vectors, GLuint count, GLuint size,
+	size_t field)
+{
+	GLuint* remap;
+	GLuint* indices;
+	GLfloat* copies;
+	GLuint next, i, j;
+
+	if (!vectors || !count)
+		return;
+
+	remap = (GLuint*)calloc(count + 1, sizeof(GLuint));
+	next = 1;
 	for (i = 0; i < model->numtriangles; i++) {
-		swap = T(i).vindices[0];
-		T(i).vindices[0] = T(i).vindices[2];
-		T(i).vindices[2] = swap;
+		indices = (GLuint*)((GLubyte*)&T(i) + field);
+		for (j = 0; j < 3; j++) {
+			if (indices[j] && indices[j] <= count && !remap[indices[j]])
+				remap[indices[j]] = next++;
+		}
+	}
+	for (i = 1; i <= count; i++) {
+		if (!remap[i])
+			remap[i] = next++;
+	}
+
+	copies = (GLfloat*)malloc(sizeof(GLfloat) * size * (count + 1));
+	for (i = 1; i <= count; i++)
+		memcpy(&copies[size * remap[i]], &vectors[size * i], sizeof(GLfloat) * size);
+	memcpy(&vectors[size], &copies[size], sizeof(GLfloat) * size * count);
+	free(copies);
+
+	for (i = 0; i < model->numtriangles; i++) {
+		indices = (GLuint*)((GLubyte*)&T(i) + field);
+		for (j = 0; j < 3; j++) {
+			if (indices[j] && indices[j] <= count)
+				indices[j] = remap[indices[j]];
+		}
+	}
+	free(remap);
+}
+
+/* OBJ group index (glmWriteOBJIndex(), glmReadOBJGroups()).  The file
+ * is the header, the spans grouped by group, the file offsets of every
+ * GLM_INDEX_BLOCK'th vertex, normal and texcoord line, the groups, and
+ * their names.  It is a cache for the machine that built it, so
+ * everything is in host byte order.
+ */
+#define GLM_INDEX_VERSION 2
+#define GLM_INDEX_BLOCK   64          /* vectors per recorded file offset */
+
+/* _GLMindexheader: start of an index file */
+typedef struct _GLMindexheader {
+	char   magic[4];              /* "GLMI" */
+	GLuint version;
+	unsigned long long objsize;   /* size of the OBJ file it indexes */
+	unsigned long long objtime;   /* and when it was last written, glmFileTime() */
+	GLuint numvertices;           /* vectors in the OBJ file */
+	GLuint numnormals;
+	GLuint numtexcoords;
+	GLuint numgroups;
+	GLuint numspans;
+	GLuint block;                 /* GLM_INDEX_BLOCK when built */
+	GLuint strings;               /* bytes of names at the end */
+	GLuint mtllib;                /* name offset of the material library */
+} GLMindexheader;
+
+/* _GLMindexspan: a run of face lines of one group, with no vectors
+ * defined inside it, so that relative indices in it resolve against
+ * the counts before it.
+ */
+typedef struct _GLMindexspan {
+	unsigned long long offset;    /* byte offset of the first line */
+	GLuint length;                /* bytes */
+	GLuint numvertices;           /* vectors defined before the span */
+	GLuint numnormals;
+	GLuint numtexcoords;
+} GLMindexspan;
+
+/* _GLMindexgroup: a group in an index file */
+typedef struct _GLMindexgroup {
+	GLuint name;                  /* name offset */
+	GLuint material;              /* name offset of its material, 0 if none */
+	GLuint numtriangles;
+	GLuint firstspan;
+	GLuint numspans;
+} GLMindexgroup;
+
+/* glmIndexGrow: make room for one more element in a growing array */
+static GLvoid*
+glmIndexGrow(GLvoid* array, GLuint* max, GLuint count, size_t size)
+{
+	if (count < *max)
+		return array;
+	*max = *max ? *max * 2 : 64;
+	return realloc(array, size * *max);
+}
+
+/* glmIndexLine: the end of the line starting at p, past its '\n' */
+static const char*
+glmIndexLine(const char* p, const char* end)
+{
+	while (p < end && *p != '\n')
+		p++;
+	return p < end ? p + 1 : end;
+}
+
+/* glmIndexSpace: skip spaces and tabs */
+static const char*
+glmIndexSpace(const char* p, const char* end)
+{
+	while (p < end && (*p == ' ' || *p == '\t'))
+		p++;
+	return p;
+}
+
+/* glmIndexTag: GL_TRUE if the line at p starts with the keyword tag.
+ * *rest is set to just past it.
+ */
+static GLboolean
+glmIndexTag(const char* p, const char* end, const char* tag, const char** rest)
+{
+	p = glmIndexSpace(p, end);
+	while (*tag) {
+		if (p == end || *p != *tag)
+			return GL_FALSE;
+		p++;
+		tag++;
+	}
+	if (p < end && *p != ' ' && *p != '\t' && *p != '\r' && *p != '\n')
+		return GL_FALSE;
+	*rest = p;
+	return GL_TRUE;
+}
+
+/* glmIndexName: copy of the rest of a line without the surrounding
+ * white space.  The copy should be free'd.
+ */
+static char*
+glmIndexName(const char* p, const char* end)
+{
+	const char* last;
+	char* name;
+
+	p = glmIndexSpace(p, end);
+	last = glmIndexLine(p, end);
+	while (last > p && isspace((unsigned char)last[-1]))
+		last--;
+	name = (char*)malloc(last - p + 1);
+	memcpy(name, p, last - p);
+	name[last - p] = '\0';
+	return name;
+}
+
+/* glmIndexInt: parse a decimal integer at *p, advancing past it.
+ * Returns GL_FALSE if there is none.
+ */
+static GLboolean
+glmIndexInt(const char** p, const char* end, int* v)
+{
+	const char* s = *p;
+	GLboolean negative = GL_FALSE;
+	int value = 0;
+
+	if (s < end && (*s == '-' || *s == '+'))
+		negative = *s++ == '-';
+	if (s == end || !isdigit((unsigned char)*s))
+		return GL_FALSE;
+	while (s < end && isdigit((unsigned char)*s))
+		value = value * 10 + (*s++ - '0');
+	*v = negative ? -value : value;
+	*p = s;
+	return GL_TRUE;
+}
+
+/* glmIndexFloat: parse the next number on a line.  The mapped file is
+ * not terminated, so the number is copied out for strtod().
+ */
+static GLfloat
+glmIndexFloat(const char** p, const char* end)
+{
+	char buf[64];
+	const char* s;
+	size_t n;
+
+	s = glmIndexSpace(*p, end);
+	for (n = 0; s + n < end && n < sizeof(buf) - 1 && !isspace((unsigned char)s[n]); n++)
+		buf[n] = s[n];
+	buf[n] = '\0';
+	*p = s + n;
+	return (GLfloat)strtod(buf, NULL);
+}
+
+/* glmIndexFace: read one face line of a span into model->triangles,
+ * as a fan like glmSecondPass() does.  Relative indices resolve
+ * against the span's counts, and every index is checked against the
+ * index's totals.  Returns the number of triangles read, or -1 if the
+ * line doesn't fit.
+ *
+ * next   - triangle to read into
+ * max    - first triangle past the group's range
+ */
+static int
+glmIndexFace(GLMmodel* model, const char* p, const char* end,
+	const GLMindexspan* span, const GLMindexheader* header,
+	GLuint next, GLuint max)
+{
+	GLuint corner[3];
+	GLuint first, count;
+	int v, t, n;
+
+	first = next;
+	for (count = 0; ; count++) {
+		p = glmIndexSpace(p, end);
+		if (!glmIndexInt(&p, end, &v))
+			break;
+		t = n = 0;
+		if (p < end && *p == '/') {
+			p++;
+			glmIndexInt(&p, end, &t);
+			if (p < end && *p == '/') {
+				p++;
+				glmIndexInt(&p, end, &n);
+			}
+		}
+		corner[0] = v < 0 ? v + span->numvertices + 1 : v;
+		corner[1] = t < 0 ? t + span->numtexcoords + 1 : t;
+		corner[2] = n < 0 ? n + span->numnormals + 1 : n;
+		if (!corner[0] || corner[0] > header->numvertices ||
+			corner[1] > header->numtexcoords || corner[2] > header->numnormals)
+			return -1;
+		if (count < 2) {
+			if (next >= max)
+				return -1;
+			T(next).vindices[count] = corner[0];
+			T(next).tindices[count] = corner[1];
+			T(next).nindices[count] = corner[2];
+			continue;
+		}
+		if (count > 2) {
+			/* fan: the first corner, the last one, the new one */
+			if (next + 1 >= max)
+				return -1;
+			next++;
+			T(next).vindices[0] = T(next - 1).vindices[0];
+			T(next).tindices[0] = T(next - 1).tindices[0];
+			T(next).nindices[0] = T(next - 1).nindices[0];
+			T(next).vindices[1] = T(next - 1).vindices[2];
+			T(next).tindices[1] = T(next - 1).tindices[2];
+			T(next).nindices[1] = T(next - 1).nindices[2];
+		}
+		T(next).vindices[2] = corner[0];
+		T(next).tindices[2] = corner[1];
+		T(next).nindices[2] = corner[2];
+	}
+
+	return count < 3 ? (count ? -1 : 0) : (int)(next - first + 1);
+}
+
+/* glmIndexVectors: read the vectors (vertices, normals or texcoords)
+ * the triangles use, and renumber the triangles' indices to match.
+ * The uses are sorted by index, so the file is read forwards, and
+ * each vector is found from the nearest recorded offset before it.
+ * Returns the 1 based array, or NULL if the triangles use none.
+ *
+ * blocks - file offset of every GLM_INDEX_BLOCK'th line tagged tag
+ * size   - GLfloats per vector
+ * field  - byte offset of the GLuint[3] index array in GLMtriangle
+ * count  - set to the number of vectors read
+ */
+static GLfloat*
+glmIndexVectors(GLMmodel* model, const char* data, const char* end,
+	const unsigned long long* blocks, const char* tag, GLuint size,
+	size_t field, GLuint* count)
+{
+	unsigned long long* keys;
+	GLuint* indices;
+	GLfloat* vectors;
+	const char* p;
+	const char* rest;
+	GLuint numkeys, index, line, i, j, k;
+
+	/* (index << 32 | corner) for every corner using a vector */
+	keys = (unsigned long long*)malloc(sizeof(unsigned long long) *
+		(3 * model->numtriangles + 1));
+	numkeys = 0;
+	for (i = 0; i < model->numtriangles; i++) {
+		indices = (GLuint*)((GLubyte*)&T(i) + field);
+		for (j = 0; j < 3; j++) {
+			if (indices[j])
+				keys[numkeys++] = (unsigned long long)indices[j] << 32 | (3 * i + j);
+		}
+	}
+	*count = 0;
+	if (!numkeys) {
+		free(keys);
+		return NULL;
+	}
+	glmSortKeys(keys, numkeys);
+
+	for (i = 0, index = 0; i < numkeys; i++) {
+		if ((GLuint)(keys[i] >> 32) != index) {
+			index = (GLuint)(keys[i] >> 32);
+			(*count)++;
+		}
+	}
+	vectors = (GLfloat*)calloc(size * (*count + 1), sizeof(GLfloat));
+
+	p = NULL;
+	line = 0;                     /* index of the next tagged line at p */
+	k = 0;
+	for (i = 0, index = 0; i < numkeys; i++) {
+		if ((GLuint)(keys[i] >> 32) != index) {
+			index = (GLuint)(keys[i] >> 32);
+			k++;
+			/* jump when the vector is behind or a block or more ahead */
+			if (!p || index < line || index - line >= GLM_INDEX_BLOCK) {
+				p = data + blocks[(index - 1) / GLM_INDEX_BLOCK];
+				line = (index - 1) / GLM_INDEX_BLOCK * GLM_INDEX_BLOCK + 1;
+			}
+			for (; p < end; p = glmIndexLine(p, end)) {
+				if (!glmIndexTag(p, end, tag, &rest))
+					continue;
+				if (line++ < index)
+					continue;
+				for (j = 0; j < size; j++)
+					vectors[size * k + j] = glmIndexFloat(&rest, end);
+				p = glmIndexLine(p, end);
+				break;
+			}
+		}
+		j = (GLuint)(keys[i] & 0xffffffffu);
+		((GLuint*)((GLubyte*)&T(j / 3) + field))[j % 3] = k;
+	}
+	free(keys);
+
+	return vectors;
+}
+
+
+/* glmDrawMode: drop the parts of a render mode the model has no data
+ * for, printing a warning for each like glmDraw() always has.
+ *
+ * model  - initialized GLMmodel structure
+ * mode   - requested GLM_* render mode
+ * caller - name of the calling function for the warnings
+ */
+static GLuint
+glmDrawMode(GLMmodel* model, GLuint mode, const char* caller)
+{
+	if (mode & GLM_FLAT && !model->facetnorms) {
+		printf("%s() warning: flat render mode requested "
+			"with no facet normals defined.\n", caller);
+		mode &= ~GLM_FLAT;
+	}
+	if (mode & GLM_SMOOTH && !model->normals) {
+		printf("%s() warning: smooth render mode requested "
+			"with no normals defined.\n", caller);
+		mode &= ~GLM_SMOOTH;
+	}
+	if (mode & GLM_TEXTURE && !model->texcoords) {
+		printf("%s() warning: texture render mode requested "
+			"with no texture coordinates defined.\n", caller);
+		mode &= ~GLM_TEXTURE;
+	}
+	if (mode & GLM_FLAT && mode & GLM_SMOOTH) {
+		printf("%s() warning: flat render mode requested "
+			"and smooth render mode requested (using smooth).\n", caller);
+		mode &= ~GLM_FLAT;
+	}
+	if (mode & GLM_COLOR && !model->materials) {
+		printf("%s() warning: color render mode requested "
+			"with no materials defined.\n", caller);
+		mode &= ~GLM_COLOR;
+	}
+	if (mode & GLM_MATERIAL && !model->materials) {
+		printf("%s() warning: material render mode requested "
+			"with no materials defined.\n", caller);
+		mode &= ~GLM_MATERIAL;
+	}
+	if (mode & GLM_COLOR && mode & GLM_MATERIAL) {
+		printf("%s() warning: color and material render mode requested "
+			"using only material mode.\n", caller);
+		mode &= ~GLM_COLOR;
+	}
+
+	return mode;
+}
+
+/* public functions */
+
+
+/* glmUnitize: "unitize" a model by translating it to the origin and
+ * scaling it to fit in a unit cube around the origin.   Returns the
+ * scalefactor used.
+ *
+ * model - properly initialized GLMmodel structure
+ */
+GLfloat
+glmUnitize(GLMmodel* model)
+{
+	GLuint i;
+	GLfloat maxx, minx, maxy, miny, maxz, minz;
+	GLfloat lo[3], hi[3];
+	GLfloat cx, cy, cz, w, h, d;
+	GLfloat scale;
+
+	assert(model);
+	assert(model->vertices);
+
+	/* get the max/mins */
+	kernelBounds(&model->vertices[3], model->numvertices, lo, hi);
+	maxx = hi[0]; minx = lo[0];
+	maxy = hi[1]; miny = lo[1];
+	maxz = hi[2]; minz = lo[2];
+
+	/* calculate model width, height, and depth */
+	w = glmAbs(maxx) + glmAbs(minx);
+	h = glmAbs(maxy) + glmAbs(miny);
+	d = glmAbs(maxz) + glmAbs(minz);
+
+	/* calculate center of the model */
+	cx = (maxx + minx) / 2.0f;
+	cy = (maxy + miny) / 2.0f;
+	cz = (maxz + minz) / 2.0f;
+	model->position[0] = cx; model->position[1] = cy; model->position[2] = cz;
+	/* calculate unitizing scale factor */
+	scale = 2.0f / glmMax(glmMax(w, h), d);
+
+	/* translate around center then scale */
+	for (i = 1; i <= model->numvertices; i++) {
+		model->vertices[3 * i + 0] -= cx;
+		model->vertices[3 * i + 1] -= cy;
+		model->vertices[3 * i + 2] -= cz;
+		model->vertices[3 * i + 0] *= scale;
+		model->vertices[3 * i + 1] *= scale;
+		model->vertices[3 * i + 2] *= scale;
+	}
+
+	return scale;
+}
+
+GLfloat
+glmMaxRadius(GLMmodel* model)
+{
+	GLfloat maxx, minx, maxy, miny, maxz, minz;
+	GLfloat lo[3], hi[3];
+	GLfloat cx, cy, cz, w, h, d;
+	GLfloat R;
+	GLfloat max;
+
+	assert(model);
+	assert(model->vertices);
+
+	/* get the max/mins */
+	kernelBounds(&model->vertices[3], model->numvertices, lo, hi);
+	maxx = hi[0]; minx = lo[0];
+	maxy = hi[1]; miny = lo[1];
+	maxz = hi[2]; minz = lo[2];
+
+	/* calculate model width, height, depth and radius */
+	w = glmAbs(maxx) + glmAbs(minx);
+	h = glmAbs(maxy) + glmAbs(miny);
+	d = glmAbs(maxz) + glmAbs(minz);
+	if (w >= h)
+		max = w;
+	else
+		max = h;
+	if (max >= d)
+		max = max;
+	else
+		max = d;
+	R = max;
+	/* calculate center of the model */
+	cx = (maxx + minx) / 2.0f;
+	cy = (maxy + miny) / 2.0f;
+	cz = (maxz + minz) / 2.0f;
+	return R;
+}
+/* glmDimensions: Calculates the dimensions (width, height, depth) of
+ * a model.
+ *
+ * model   - initialized GLMmodel structure
+ * dimensions - array of 3 GLfloats (GLfloat dimensions[3])
+ */
+GLvoid
+glmDimensions(GLMmodel* model, GLfloat* dimensions)
+{
+	GLfloat maxx, minx, maxy, miny, maxz, minz;
+	GLfloat lo[3], hi[3];
+
+	assert(model);
+	assert(model->vertices);
+	assert(dimensions);
+
+	/* get the max/mins */
+	kernelBounds(&model->vertices[3], model->numvertices, lo, hi);
+	maxx = hi[0]; minx = lo[0];
+	maxy = hi[1]; miny = lo[1];
+	maxz = hi[2]; minz = lo[2];
+
+	/* calculate model width, height, and depth */
+	dimensions[0] = glmAbs(maxx) + glmAbs(minx);
+	dimensions[1] = glmAbs(maxy) + glmAbs(miny);
+	dimensions[2] = glmAbs(maxz) + glmAbs(minz);
+}
+
+/* glmScale: Scales a model by a given amount.
+ *
+ * model - properly initialized GLMmodel structure
+ * scale - scalefactor (0.5 = half as large, 2.0 = twice as large)
+ */
+GLvoid
+glmScale(GLMmodel* model, GLfloat scale)
+{
+	GLuint i;
+
+	for (i = 1; i <= model->numvertices; i++) {
+		model->vertices[3 * i + 0] *= scale;
+		model->vertices[3 * i + 1] *= scale;
+		model->vertices[3 * i + 2] *= scale;
+	}
+}
+
+/* glmReverseWinding: Reverse the polygon winding for all polygons in
+ * this model.   Default winding is counter-clockwise.  Also changes
+ * the direction of the normals.
+ *
+ * model - properly initialized GLMmodel structure
+ */
+GLvoid
+glmReverseWinding(GLMmodel* model)
+{
+	GLuint i, swap;
+
+	assert(model);
+
+	for (i = 0; i < model->numtriangles; i++) {
+		swap = T(i).vindices[0];
+		T(i).vindices[0] = T(i).vindices[2];
+		T(i).vindices[2] = swap;
+
+		if (model->numnormals) {
+			swap = T(i).nindices[0];
+			T(i).nindices[0] = T(i).nindices[2];
+			T(i).nindices[2] = swap;
+		}
+
+		if (model->numtexcoords) {
+			swap = T(i).tindices[0];
+			T(i).tindices[0] = T(i).tindices[2];
+			T(i).tindices[2] = swap;
+		}
+	}
+
+	/* reverse facet normals */
+	for (i = 1; i <= model->numfacetnorms; i++) {
+		model->facetnorms[3 * i + 0] = -model->facetnorms[3 * i + 0];
+		model->facetnorms[3 * i + 1] = -model->facetnorms[3 * i + 1];
+		model->facetnorms[3 * i + 2] = -model->facetnorms[3 * i + 2];
+	}
+
+	/* reverse vertex normals */
+	for (i = 1; i <= model->numnormals; i++) {
+		model->normals[3 * i + 0] = -model->normals[3 * i + 0];
+		model->normals[3 * i + 1] = -model->normals[3 * i + 1];
+		model->normals[3 * i + 2] = -model->normals[3 * i + 2];
+	}
+}
+
+/* glmFacetNormals: Generates facet normals for a model (by taking the
+ * cross product of the two vectors derived from the sides of each
+ * triangle).  Assumes a counter-clockwise winding.
+ *
+ * model - initialized GLMmodel structure
+ */
+GLvoid
+glmFacetNormals(GLMmodel* model)
+{
+	GLuint  i;
+	GLfloat u[3];
+	GLfloat v[3];
+
+	assert(model);
+	assert(model->vertices);
+
+	/* clobber any old facetnormals */
+	if (model->facetnorms)
+		free(model->facetnorms);
+
+	/* allocate memory for the new facet normals */
+	model->numfacetnorms = model->numtriangles;
+	model->facetnorms = (GLfloat*)malloc(sizeof(GLfloat) *
+		3 * (model->numfacetnorms + 1));
+
+	for (i = 0; i < model->numtriangles; i++) {
+		model->triangles[i].findex = i + 1;
+
+		u[0] = model->vertices[3 * T(i).vindices[1] + 0] -
+			model->vertices[3 * T(i).vindices[0] + 0];
+		u[1] = model->vertices[3 * T(i).vindices[1] + 1] -
+			model->vertices[3 * T(i).vindices[0] + 1];
+		u[2] = model->vertices[3 * T(i).vindices[1] + 2] -
+			model->vertices[3 * T(i).vindices[0] + 2];
+
+		v[0] = model->vertices[3 * T(i).vindices[2] + 0] -
+			model->vertices[3 * T(i).vindices[0] + 0];
+		v[1] = model->vertices[3 * T(i).vindices[2] + 1] -
+			model->vertices[3 * T(i).vindices[0] + 1];
+		v[2] = model->vertices[3 * T(i).vindices[2] + 2] -
+			model->vertices[3 * T(i).vindices[0] + 2];
+
+		glmCross(u, v, &model->facetnorms[3 * (i + 1)]);
+		glmNormalize(&model->facetnorms[3 * (i + 1)]);
+	}
+}
+
+/* glmVertexNormals: Generates smooth vertex normals for a model.
+ * First builds a list of all the triangles each vertex is in.   Then
+ * loops through each vertex in the the list averaging all the facet
+ * normals of the triangles each vertex is in.   Finally, sets the
+ * normal index in the triangle for the vertex to the generated smooth
+ * normal.   If the dot product of a facet normal and the facet normal
+ * associated with the first triangle in the list of triangles the
+ * current vertex is in is greater than the cosine of the angle
+ * parameter to the function, that facet normal is not added into the
+ * average normal calculation and the corresponding vertex is given
+ * the facet normal.  This tends to preserve hard edges.  The angle to
+ * use depends on the model, but 90 degrees is usually a good start.
+ *
+ * model - initialized GLMmodel structure
+ * angle - maximum angle (in degrees) to smooth across
+ */
+GLvoid
+glmVertexNormals(GLMmodel* model, GLfloat angle)
+{
+	GLMnode* node;
+	GLMnode* tail;
+	GLMnode** members;
+	GLfloat* normals;
+	GLuint numnormals;
+	GLfloat average[3];
+	GLfloat dot, cos_angle;
+	GLuint i, avg;
+
+	assert(model);
+	assert(model->facetnorms);
+
+	/* calculate the cosine of the angle (in degrees) */
+	cos_angle = cos(angle * M_PI / 180.0f);
+
+	/* nuke any previous normals */
+	if (model->normals)
+		free(model->normals);
+
+	/* allocate space for new normals */
+	model->numnormals = model->numtriangles * 3; /* 3 normals per triangle */
+	model->normals = (GLfloat*)malloc(sizeof(GLfloat) * 3 * (model->numnormals + 1));
+
+	/* allocate a structure that will hold a linked list of triangle
+	indices for each vertex */
+	members = (GLMnode**)malloc(sizeof(GLMnode*) * (model->numvertices + 1));
+	for (i = 1; i <= model->numvertices; i++)
+		members[i] = NULL;
+
+	/* for every triangle, create a node for each vertex in it */
+	for (i = 0; i < model->numtriangles; i++) {
+		node = (GLMnode*)malloc(sizeof(GLMnode));
+		node->index = i;
+		node->next = members[T(i).vindices[0]];
+		members[T(i).vindices[0]] = node;
+
+		node = (GLMnode*)malloc(sizeof(GLMnode));
+		node->index = i;
+		node->next = members[T(i).vindices[1]];
+		members[T(i).vindices[1]] = node;
+
+		node = (GLMnode*)malloc(sizeof(GLMnode));
+		node->index = i;
+		node->next = members[T(i).vindices[2]];
+		members[T(i).vindices[2]] = node;
+	}
+
+	/* calculate the average normal for each vertex */
+	numnormals = 1;
+	for (i = 1; i <= model->numvertices; i++) {
+		/* calculate an average normal for this vertex by averaging the
+			facet normal of every triangle this vertex is in */
+		node = members[i];
+		if (!node)
+			fprintf(stderr, "glmVertexNormals(): vertex w/o a triangle\n");
+		average[0] = 0.0; average[1] = 0.0; average[2] = 0.0;
+		avg = 0;
+		while (node) {
+			/* only average if the dot product of the angle between the two
+			facet normals is greater than the cosine of the threshold
+			angle -- or, said another way, the angle between the two
+			facet normals is less than (or equal to) the threshold angle */
+			dot = glmDot(&model->facetnorms[3 * T(node->index).findex],
+				&model->facetnorms[3 * T(members[i]->index).findex]);
+			if (dot > cos_angle) {
+				node->averaged = GL_TRUE;
+				average[0] += model->facetnorms[3 * T(node->index).findex + 0];
+				average[1] += model->facetnorms[3 * T(node->index).findex + 1];
+				average[2] += model->facetnorms[3 * T(node->index).findex + 2];
+				avg = 1;            /* we averaged at least one normal! */
+			}
+			else {
+				node->averaged = GL_FALSE;
+			}
+			node = node->next;
+		}
+
+		if (avg) {
+			/* normalize the averaged normal */
+			glmNormalize(average);
+
+			/* add the normal to the vertex normals list */
+			model->normals[3 * numnormals + 0] = average[0];
+			model->normals[3 * numnormals + 1] = average[1];
+			model->normals[3 * numnormals + 2] = average[2];
+			avg = numnormals;
+			numnormals++;
+		}
+
+		/* set the normal of this vertex in each triangle it is in */
+		node = members[i];
+		while (node) {
+			if (node->averaged) {
+				/* if this node was averaged, use the average normal */
+				if (T(node->index).vindices[0] == i)
+					T(node->index).nindices[0] = avg;
+				else if (T(node->index).vindices[1] == i)
+					T(node->index).nindices[1] = avg;
+				else if (T(node->index).vindices[2] == i)
+					T(node->index).nindices[2] = avg;
+			}
+			else {
+				/* if this node wasn't averaged, use the facet normal */
+				model->normals[3 * numnormals + 0] =
+					model->facetnorms[3 * T(node->index).findex + 0];
+				model->normals[3 * numnormals + 1] =
+					model->facetnorms[3 * T(node->index).findex + 1];
+				model->normals[3 * numnormals + 2] =
+					model->facetnorms[3 * T(node->index).findex + 2];
+				if (T(node->index).vindices[0] == i)
+					T(node->index).nindices[0] = numnormals;
+				else if (T(node->index).vindices[1] == i)
+					T(node->index).nindices[1] = numnormals;
+				else if (T(node->index).vindices[2] == i)
+					T(node->index).nindices[2] = numnormals;
+				numnormals++;
+			}
+			node = node->next;
+		}
+	}
+
+	model->numnormals = numnormals - 1;
+
+	/* free the member information */
+	for (i = 1; i <= model->numvertices; i++) {
+		node = members[i];
+		while (node) {
+			tail = node;
+			node = node->next;
+			free(tail);
+		}
+	}
+	free(members);
+
+	/* pack the normals array (we previously allocated the maximum
+	number of normals that could possibly be created (numtriangles *
+	3), so get rid of some of them (usually alot unless none of the
+	facet normals were averaged)) */
+	normals = model->normals;
+	model->normals = (GLfloat*)malloc(sizeof(GLfloat) * 3 * (model->numnormals + 1));
+	for (i = 1; i <= model->numnormals; i++) {
+		model->normals[3 * i + 0] = normals[3 * i + 0];
+		model->normals[3 * i + 1] = normals[3 * i + 1];
+		model->normals[3 * i + 2] = normals[3 * i + 2];
+	}
+	free(normals);
+}
+
+
+/* glmLinearTexture: Generates texture coordinates according to a
+ * linear projection of the texture map.  It generates these by
+ * linearly mapping the vertices onto a square.
+ *
+ * model - pointer to initialized GLMmodel structure
+ */
+GLvoid
+glmLinearTexture(GLMmodel* model)
+{
+	GLMgroup *group;
+	GLfloat dimensions[3];
+	GLfloat x, y, scalefactor;
+	GLuint i;
+
+	assert(model);
+
+	if (model->texcoords)
+		free(model->texcoords);
+	model->numtexcoords = model->numvertices;
+	model->texcoords = (GLfloat*)malloc(sizeof(GLfloat) * 2 * (model->numtexcoords + 1));
+
+	glmDimensions(model, dimensions);
+	scalefactor = 2.0f /
+		glmAbs(glmMax(glmMax(dimensions[0], dimensions[1]), dimensions[2]));
+
+	/* do the calculations */
+	for (i = 1; i <= model->numvertices; i++) {
+		x = model->vertices[3 * i + 0] * scalefactor;
+		y = model->vertices[3 * i + 2] * scalefactor;
+		model->texcoords[2 * i + 0] = (x + 1.0f) / 2.0f;
+		model->texcoords[2 * i + 1] = (y + 1.0f) / 2.0f;
+	}
+
+	/* go through and put texture coordinate indices in all the triangles */
+	group = model->groups;
+	while (group) {
+		for (i = 0; i < group->numtriangles; i++) {
+			T(group->first + i).tindices[0] = T(group->first + i).vindices[0];
+			T(group->first + i).tindices[1] = T(group->first + i).vindices[1];
+			T(group->first + i).tindices[2] = T(group->first + i).vindices[2];
+		}
+		group = group->next;
+	}
+
+#if 0
+	printf("glmLinearTexture(): generated %d linear texture coordinates\n",
+		model->numtexcoords);
+#endif
+}
+
+/* glmSpheremapTexture: Generates texture coordinates according to a
+ * spherical projection of the texture map.  Sometimes referred to as
+ * spheremap, or reflection map texture coordinates.  It generates
+ * these by using the normal to calculate where that vertex would map
+ * onto a sphere.  Since it is impossible to map something flat
+ * perfectly onto something spherical, there is distortion at the
+ * poles.  This particular implementation causes the poles along the X
+ * axis to be distorted.
+ *
+ * model - pointer to initialized GLMmodel structure
+ */
+GLvoid
+glmSpheremapTexture(GLMmodel* model)
+{
+	GLMgroup* group;
+	GLfloat theta, phi, rho, x, y, z, r;
+	GLuint i;
+
+	assert(model);
+	assert(model->normals);
+
+	if (model->texcoords)
+		free(model->texcoords);
+	model->numtexcoords = model->numnormals;
+	model->texcoords = (GLfloat*)malloc(sizeof(GLfloat) * 2 * (model->numtexcoords + 1));
+
+	for (i = 1; i <= model->numnormals; i++) {
+		z = model->normals[3 * i + 0];  /* re-arrange for pole distortion */
+		y = model->normals[3 * i + 1];
+		x = model->normals[3 * i + 2];
+		r = sqrt((x * x) + (y * y));
+		rho = sqrt((r * r) + (z * z));
+
+		if (r == 0.0) {
+			theta = 0.0;
+			phi = 0.0;
+		}
+		else {
+			if (z == 0.0)
+				phi = 3.14159265f / 2.0f;
+			else
+				phi = acos(z / rho);
+
+			if (y == 0.0)
+				theta = 3.141592365f / 2.0f;
+			else
+				theta = asin(y / r) + (3.14159265f / 2.0f);
+		}
+
+		model->texcoords[2 * i + 0] = theta / 3.14159265f;
+		model->texcoords[2 * i + 1] = phi / 3.14159265f;
+	}
+
+	/* go through and put texcoord indices in all the triangles */
+	group = model->groups;
+	while (group) {
+		for (i = 0; i < group->numtriangles; i++) {
+			T(group->first + i).tindices[0] = T(group->first + i).nindices[0];
+			T(group->first + i).tindices[1] = T(group->first + i).nindices[1];
+			T(group->first + i).tindices[2] = T(group->first + i).nindices[2];
+		}
+		group = group->next;
+	}
+}
+
+/* glmDelete: Deletes a GLMmodel structure.
+ *
+ * model - initialized GLMmodel structure
+ */
+GLvoid
+glmDelete(GLMmodel* model)
+{
+	GLMgroup* group;
+	GLuint i;
+
+	assert(model);
+
+	if (model->pathname)     free(model->pathname);
+	if (model->mtllibname) free(model->mtllibname);
+	if (model->vertices)     free(model->vertices);
+	if (model->normals)  free(model->normals);
+	if (model->texcoords)  free(model->texcoords);
+	if (model->facetnorms) free(model->facetnorms);
+	if (model->triangles)  free(model->triangles);
+	if (model->lines)      free(model->lines);
+	if (model->materials) {
+		for (i = 0; i < model->nummaterials; i++)
+			free(model->materials[i].name);
+	}
+	free(model->materials);
+	while (model->groups) {
+		group = model->groups;
+		model->groups = model->groups->next;
+		free(group->name);
+		free(group);
+	}
+
+	free(model);
+}
+
+/* glmReadOBJ: Reads a model description from a Wavefront .OBJ file.
+ * Returns a pointer to the created object which should be free'd with
+ * glmDelete().
+ *
+ * filename - name of the file containing the Wavefront .OBJ format data.
+ */
+GLMmodel*
+glmReadOBJ(char* filename)
+{
+	GLMmodel* model;
+	FILE* file;
+
+	/* open the file */
+	file = fopen(filename, "r");
+	if (!file) {
+		fprintf(stderr, "glmReadOBJ() failed: can't open data file \"%s\".\n",
+			filename);
+		exit(1);
+	}
+
+	/* allocate a new model */
+	model = glmNewModel(filename);
+
+	/* make a first pass through the file to get a count of the number
+	of vertices, normals, texcoords & triangles */
+	glmFirstPass(model, file);
+
+	/* allocate memory */
+	model->vertices = (GLfloat*)malloc(sizeof(GLfloat) *
+		3 * (model->numvertices + 1));
+	model->triangles = (GLMtriangle*)malloc(sizeof(GLMtriangle) *
+		model->numtriangles);
+	if (model->numnormals) {
+		model->normals = (GLfloat*)malloc(sizeof(GLfloat) *
+			3 * (model->numnormals + 1));
+	}
+	if (model->numtexcoords) {
+		model->texcoords = (GLfloat*)malloc(sizeof(GLfloat) *
+			2 * (model->numtexcoords + 1));
+	}
+
+	/* rewind to beginning of file and read in the data this pass */
+	rewind(file);
+
+	glmSecondPass(model, file);
+	glmSortGroups(model);
+	glmThirdPass(model);
+	/* close the file */
+	fclose(file);
+
+	return model;
+}
+
+/* glmReadPLY: Reads a model from a binary (little- or big-endian) .PLY
+ * file.  Returns a pointer to the created object which should be
+ * free'd with glmDelete(), or NULL if the file can't be read.
+ *
+ * filename - name of the file containing the binary PLY data.
+ */
+GLMmodel*
+glmReadPLY(char* filename)
+{
+	GLMmodel* model;
+	GLMplyelement elements[8];
+	GLMplyelement* vertex;
+	GLMplyelement* face;
+	const GLubyte* data;
+	const GLubyte* p;
+	const GLubyte* end;
+	const GLubyte* vertexdata;
+	const GLubyte* facedata;
+	GLboolean swap;
+	GLuint numelements, i, j;
+	size_t size, body, record;
+
+	data = glmMapFile(filename, &size);
+	if (!data) {
+		fprintf(stderr, "glmReadPLY() failed: can't open data file \"%s\".\n",
+			filename);
+		return NULL;
+	}
+	end = data + size;
 
-		if (model->numnormals) {
-			swap = T(i).nindices[0];
-			T(i).nindices[0] = T(i).nindices[2];
-			T(i).nindices[2] = swap;
-		}
+	swap = GL_FALSE;
+	numelements = glmPlyHeader(data, size, elements, &swap, &body);
+	if (!numelements) {
+		fprintf(stderr, "glmReadPLY() failed: \"%s\" is not a binary PLY file.\n",
+			filename);
+		glmUnmapFile(data, size);
+		return NULL;
+	}
 
-		if (model->numtexcoords) {
-			swap = T(i).tindices[0];
-			T(i).tindices[0] = T(i).tindices[2];
-			T(i).tindices[2] = swap;
+	/* find the vertex and face data, skipping any other elements */
+	vertex = face = NULL;
+	vertexdata = facedata = NULL;
+	p = data + body;
+	for (i = 0; i < numelements && p <= end; i++) {
+		if (!strcmp(elements[i].name, "vertex")) {
+			vertex = &elements[i];
+			vertexdata = p;
+		}
+		else if (!strcmp(elements[i].name, "face")) {
+			face = &elements[i];
+			facedata = p;
+		}
+		if (elements[i].stride) {
+			p += elements[i].stride * elements[i].count;
+			continue;
+		}
+		for (j = 0; j < elements[i].count; j++) {
+			if (!(record = glmPlySkip(&elements[i], p, end, swap)))
+				break;
+			p += record;
 		}
+		if (j < elements[i].count)
+			break;
 	}
-
-	/* reverse facet normals */
-	for (i = 1; i <= model->numfacetnorms; i++) {
-		model->facetnorms[3 * i + 0] = -model->facetnorms[3 * i + 0];
-		model->facetnorms[3 * i + 1] = -model->facetnorms[3 * i + 1];
-		model->facetnorms[3 * i + 2] = -model->facetnorms[3 * i + 2];
+	if (i < numelements || p > end || !vertex || !vertex->stride ||
+		glmPlyFind(vertex, "x") < 0 || glmPlyFind(vertex, "y") < 0 ||
+		glmPlyFind(vertex, "z") < 0) {
+		fprintf(stderr, "glmReadPLY() failed: \"%s\" has no usable vertex data.\n",
+			filename);
+		glmUnmapFile(data, size);
+		return NULL;
 	}
 
-	/* reverse vertex normals */
-	for (i = 1; i <= model->numnormals; i++) {
-		model->normals[3 * i + 0] = -model->normals[3 * i + 0];
-		model->normals[3 * i + 1] = -model->normals[3 * i + 1];
-		model->normals[3 * i + 2] = -model->normals[3 * i + 2];
+	model = glmNewModel(filename);
+	glmPlyVertices(model, vertex, vertexdata, swap);
+
+	if (face && !glmPlyFaces(model, face, facedata, end, swap)) {
+		fprintf(stderr, "glmReadPLY() failed: \"%s\" has corrupt face data.\n",
+			filename);
+		glmUnmapFile(data, size);
+		glmDelete(model);
+		return NULL;
 	}
+	glmUnmapFile(data, size);
+
+	glmSingleGroup(model);
+	glmThirdPass(model);
+
+	return model;
 }
 
-/* glmFacetNormals: Generates facet normals for a model (by taking the
- * cross product of the two vectors derived from the sides of each
- * triangle).  Assumes a counter-clockwise winding.
+/* glmReadSTL: Reads a model from a binary .STL file.  Vertices shared
+ * between facets are merged (exact position match), and the facet
+ * normals stored in the file become the model's facet normals.
+ * Returns a pointer to the created object which should be free'd with
+ * glmDelete(), or NULL if the file can't be read.
  *
- * model - initialized GLMmodel structure
+ * filename - name of the file containing the binary STL data.
  */
-GLvoid
-glmFacetNormals(GLMmodel* model)
+GLMmodel*
+glmReadSTL(char* filename)
 {
-	GLuint  i;
-	GLfloat u[3];
-	GLfloat v[3];
+	GLMmodel* model;
+	GLMstlvertex* table;
+	GLMstlvertex* entry;
+	const GLubyte* data;
+	const GLubyte* p;
+	GLuint numfacets, i, j;
+	GLfloat facet[12];
+	GLfloat* position;
+	size_t size, entries, mask, hash;
+
+	data = glmMapFile(filename, &size);
+	if (!data) {
+		fprintf(stderr, "glmReadSTL() failed: can't open data file \"%s\".\n",
+			filename);
+		return NULL;
+	}
 
-	assert(model);
-	assert(model->vertices);
+	/* 80 byte header, facet count, then 50 bytes per facet */
+	numfacets = 0;
+	if (size >= 84) {
+		memcpy(&numfacets, data + 80, 4);
+		if (!glmHostIsLittleEndian())
+			numfacets = (numfacets >> 24) | ((numfacets >> 8) & 0xff00) |
+			((numfacets << 8) & 0xff0000) | (numfacets << 24);
+	}
+	if (size < 84 || (size - 84) / 50 != numfacets) {
+		fprintf(stderr, "glmReadSTL() failed: \"%s\" is not a binary STL file.\n",
+			filename);
+		glmUnmapFile(data, size);
+		return NULL;
+	}
 
-	/* clobber any old facetnormals */
-	if (model->facetnorms)
-		free(model->facetnorms);
+	model = glmNewModel(filename);
+	model->numtriangles = numfacets;
+	model->numfacetnorms = numfacets;
+	table = NULL;
+	/* at most 3 unique vertices per facet, numbered from 1; the
+	   vertices are trimmed below.  The vertex table is open addressed. */
+	entries = 0;
+	if (numfacets <= ((GLuint)-1 - 1) / 3 && numfacets <= ((size_t)-1 / sizeof(GLfloat) - 3) / 9)
+		entries = glmTableSize(3 * (size_t)numfacets);
+	if (entries) {
+		model->triangles = (GLMtriangle*)malloc(sizeof(GLMtriangle) * numfacets);
+		model->facetnorms = (GLfloat*)malloc(sizeof(GLfloat) * 3 * ((size_t)numfacets + 1));
+		model->vertices = (GLfloat*)malloc(sizeof(GLfloat) * 3 * (3 * (size_t)numfacets + 1));
+		table = (GLMstlvertex*)calloc(entries, sizeof(GLMstlvertex));
+	}
+	if (!model->triangles || !model->facetnorms || !model->vertices || !table) {
+		fprintf(stderr, "glmReadSTL() failed: out of memory for the %u facets of \"%s\".\n",
+			numfacets, filename);
+		free(table);
+		glmDelete(model);
+		glmUnmapFile(data, size);
+		return NULL;
+	}
+	mask = entries - 1;
+
+	p = data + 84;
+	for (i = 0; i < numfacets; i++, p += 50) {
+		memcpy(facet, p, sizeof(facet));
+		if (!glmHostIsLittleEndian()) {
+			for (j = 0; j < 12; j++) {
+				GLuint v;
+				memcpy(&v, &facet[j], 4);
+				v = (v >> 24) | ((v >> 8) & 0xff00) | ((v << 8) & 0xff0000) | (v << 24);
+				memcpy(&facet[j], &v, 4);
+			}
+		}
 
-	/* allocate memory for the new facet normals */
-	model->numfacetnorms = model->numtriangles;
-	model->facetnorms = (GLfloat*)malloc(sizeof(GLfloat) *
-		3 * (model->numfacetnorms + 1));
+		model->facetnorms[3 * (i + 1) + 0] = facet[0];
+		model->facetnorms[3 * (i + 1) + 1] = facet[1];
+		model->facetnorms[3 * (i + 1) + 2] = facet[2];
+		T(i).findex = i + 1;
+
+		for (j = 0; j < 3; j++) {
+			GLuint bits[3];
+
+			position = &facet[3 + 3 * j];
+			/* fold -0.0 onto 0.0 so they hash alike */
+			position[0] += 0.0f; position[1] += 0.0f; position[2] += 0.0f;
+			memcpy(bits, position, sizeof(bits));
+
+			hash = (bits[0] * 73856093u) ^ (bits[1] * 19349663u) ^ (bits[2] * 83492791u);
+			hash = (hash ^ (hash >> 16)) & mask;
+			for (;;) {
+				entry = &table[hash];
+				if (!entry->index) {
+					entry->bits[0] = bits[0];
+					entry->bits[1] = bits[1];
+					entry->bits[2] = bits[2];
+					entry->index = ++model->numvertices;
+					memcpy(&model->vertices[3 * entry->index], position, 3 * sizeof(GLfloat));
+					break;
+				}
+				if (entry->bits[0] == bits[0] && entry->bits[1] == bits[1] &&
+					entry->bits[2] == bits[2])
+					break;
+				hash = (hash + 1) & mask;
+			}
 
-	for (i = 0; i < model->numtriangles; i++) {
-		model->triangles[i].findex = i + 1;
+			T(i).vindices[j] = entry->index;
+			T(i).nindices[j] = 0;
+			T(i).tindices[j] = 0;
+		}
+	}
 
-		u[0] = model->vertices[3 * T(i).vindices[1] + 0] -
-			model->vertices[3 * T(i).vindices[0] + 0];
-		u[1] = model->vertices[3 * T(i).vindices[1] + 1] -
-			model->vertices[3 * T(i).vindices[0] + 1];
-		u[2] = model->vertices[3 * T(i).vindices[1] + 2] -
-			model->vertices[3 * T(i).vindices[0] + 2];
+	free(table);
+	glmUnmapFile(data, size);
 
-		v[0] = model->vertices[3 * T(i).vindices[2] + 0] -
-			model->vertices[3 * T(i).vindices[0] + 0];
-		v[1] = model->vertices[3 * T(i).vindices[2] + 1] -
-			model->vertices[3 * T(i).vindices[0] + 1];
-		v[2] = model->vertices[3 * T(i).vindices[2] + 2] -
-			model->vertices[3 * T(i).vindices[0] + 2];
+	model->vertices = (GLfloat*)realloc(model->vertices,
+		sizeof(GLfloat) * 3 * (model->numvertices + 1));
 
-		glmCross(u, v, &model->facetnorms[3 * (i + 1)]);
-		glmNormalize(&model->facetnorms[3 * (i + 1)]);
-	}
+	glmSingleGroup(model);
+	glmThirdPass(model);
+
+	return model;
 }
 
-/* glmVertexNormals: Generates smooth vertex normals for a model.
- * First builds a list of all the triangles each vertex is in.   Then
- * loops through each vertex in the the list averaging all the facet
- * normals of the triangles each vertex is in.   Finally, sets the
- * normal index in the triangle for the vertex to the generated smooth
- * normal.   If the dot product of a facet normal and the facet normal
- * associated with the first triangle in the list of triangles the
- * current vertex is in is greater than the cosine of the angle
- * parameter to the function, that facet normal is not added into the
- * average normal calculation and the corresponding vertex is given
- * the facet normal.  This tends to preserve hard edges.  The angle to
- * use depends on the model, but 90 degrees is usually a good start.
+/* glmReadModel: Reads a model, picking the reader from the file
+ * extension (.ply, .stl, anything else is read as .obj).  Returns a
+ * pointer to the created object which should be free'd with
+ * glmDelete(), or NULL if a binary file can't be read.
  *
- * model - initialized GLMmodel structure
- * angle - maximum angle (in degrees) to smooth across
+ * filename - name of the model file.
  */
-GLvoid
-glmVertexNormals(GLMmodel* model, GLfloat angle)
+GLMmodel*
+glmReadModel(char* filename)
 {
-	GLMnode* node;
-	GLMnode* tail;
-	GLMnode** members;
-	GLfloat* normals;
-	GLuint numnormals;
-	GLfloat average[3];
-	GLfloat dot, cos_angle;
-	GLuint i, avg;
-
-	assert(model);
-	assert(model->facetnorms);
-
-	/* calculate the cosine of the angle (in degrees) */
-	cos_angle = cos(angle * M_PI / 180.0f);
-
-	/* nuke any previous normals */
-	if (model->normals)
-		free(model->normals);
-
-	/* allocate space for new normals */
-	model->numnormals = model->numtriangles * 3; /* 3 normals per triangle */
-	model->normals = (GLfloat*)malloc(sizeof(GLfloat) * 3 * (model->numnormals + 1));
-
-	/* allocate a structure that will hold a linked list of triangle
-	indices for each vertex */
-	members = (GLMnode**)malloc(sizeof(GLMnode*) * (model->numvertices + 1));
-	for (i = 1; i <= model->numvertices; i++)
-		members[i] = NULL;
+	char* ext;
+
+	ext = strrchr(filename, '.');
+	if (ext) {
+		if (!glmStrcasecmp(ext, ".ply"))
+			return glmReadPLY(filename);
+		if (!glmStrcasecmp(ext, ".stl"))
+			return glmReadSTL(filename);
+	}
 
-	/* for every triangle, create a node for each vertex in it */
-	for (i = 0; i < model->numtriangles; i++) {
-		node = (GLMnode*)malloc(sizeof(GLMnode));
-		node->index = i;
-		node->next = members[T(i).vindices[0]];
-		members[T(i).vindices[0]] = node;
+	return glmReadOBJ(filename);
+}
 
-		node = (GLMnode*)malloc(sizeof(GLMnode));
-		node->index = i;
-		node->next = members[T(i).vindices[1]];
-		members[T(i).vindices[1]] = node;
+/* glmWriteOBJIndex: Writes a sidecar index of a Wavefront .OBJ file
+ * for glmReadOBJGroups().  Returns GL_FALSE if either file can't be
+ * opened.
+ *
+ * filename  - name of the .OBJ file.
+ * indexname - name of the index file to write.
+ */
+GLboolean
+glmWriteOBJIndex(char* filename, char* indexname)
+{
+	/* a group while building: names are malloc'd */
+	typedef struct {
+		char*  name;
+		char*  material;
+		GLuint numtriangles;
+		GLuint numspans;
+		GLuint firstspan;
+	} BuildGroup;
+	/* a span while building, with the group it belongs to */
+	typedef struct {
+		GLMindexspan span;
+		GLuint group;
+	} BuildSpan;
+
+	GLMindexheader header;
+	GLMindexgroup entry;
+	BuildGroup* groups;
+	BuildSpan* spans;
+	GLMindexspan* sorted;
+	unsigned long long* blocks[3];
+	GLuint numblocks[3], maxblocks[3], numvectors[3];
+	GLuint numgroups, maxgroups, numspans, maxspans;
+	GLuint group, strings, length, i, j, k;
+	GLboolean open, ok;
+	const GLubyte* data;
+	const char* p;
+	const char* end;
+	const char* next;
+	const char* rest;
+	char* material;
+	char* mtllib;
+	unsigned long long objtime;
+	size_t size;
+	FILE* file;
 
-		node = (GLMnode*)malloc(sizeof(GLMnode));
-		node->index = i;
-		node->next = members[T(i).vindices[2]];
-		members[T(i).vindices[2]] = node;
+	objtime = glmFileTime(filename);
+	data = glmMapFile(filename, &size);
+	if (!data) {
+		fprintf(stderr, "glmWriteOBJIndex() failed: can't open data file \"%s\".\n",
+			filename);
+		return GL_FALSE;
+	}
+	p = (const char*)data;
+	end = p + size;
+
+	/* faces before the first group line are in "default" */
+	numgroups = maxgroups = 0;
+	groups = (BuildGroup*)glmIndexGrow(NULL, &maxgroups, 0, sizeof(BuildGroup));
+	groups[0].name = _strdup("default");
+	groups[0].material = NULL;
+	groups[0].numtriangles = groups[0].numspans = 0;
+	numgroups = 1;
+	group = 0;
+	numspans = maxspans = 0;
+	spans = NULL;
+	open = GL_FALSE;
+	material = mtllib = NULL;
+	for (i = 0; i < 3; i++) {
+		blocks[i] = NULL;
+		numblocks[i] = maxblocks[i] = numvectors[i] = 0;
 	}
 
-	/* calculate the average normal for each vertex */
-	numnormals = 1;
-	for (i = 1; i <= model->numvertices; i++) {
-		/* calculate an average normal for this vertex by averaging the
-			facet normal of every triangle this vertex is in */
-		node = members[i];
-		if (!node)
-			fprintf(stderr, "glmVertexNormals(): vertex w/o a triangle\n");
-		average[0] = 0.0; average[1] = 0.0; average[2] = 0.0;
-		avg = 0;
-		while (node) {
-			/* only average if the dot product of the angle between the two
-			facet normals is greater than the cosine of the threshold
-			angle -- or, said another way, the angle between the two
-			facet normals is less than (or equal to) the threshold angle */
-			dot = glmDot(&model->facetnorms[3 * T(node->index).findex],
-				&model->facetnorms[3 * T(members[i]->index).findex]);
-			if (dot > cos_angle) {
-				node->averaged = GL_TRUE;
-				average[0] += model->facetnorms[3 * T(node->index).findex + 0];
-				average[1] += model->facetnorms[3 * T(node->index).findex + 1];
-				average[2] += model->facetnorms[3 * T(node->index).findex + 2];
-				avg = 1;            /* we averaged at least one normal! */
+	for (; p < end; p = next) {
+		next = glmIndexLine(p, end);
+		k = glmIndexTag(p, end, "v", &rest) ? 0 :
+			glmIndexTag(p, end, "vn", &rest) ? 1 :
+			glmIndexTag(p, end, "vt", &rest) ? 2 : 3;
+		if (k < 3) {
+			if (numvectors[k] % GLM_INDEX_BLOCK == 0) {
+				blocks[k] = (unsigned long long*)glmIndexGrow(blocks[k], &maxblocks[k],
+					numblocks[k], sizeof(unsigned long long));
+				blocks[k][numblocks[k]++] = (unsigned long long)(p - (const char*)data);
 			}
-			else {
-				node->averaged = GL_FALSE;
+			numvectors[k]++;
+			open = GL_FALSE;
+		}
+		else if (glmIndexTag(p, end, "f", &rest)) {
+			if (!open) {
+				spans = (BuildSpan*)glmIndexGrow(spans, &maxspans, numspans, sizeof(BuildSpan));
+				spans[numspans].span.offset = (unsigned long long)(p - (const char*)data);
+				spans[numspans].span.length = 0;
+				spans[numspans].span.numvertices = numvectors[0];
+				spans[numspans].span.numnormals = numvectors[1];
+				spans[numspans].span.numtexcoords = numvectors[2];
+				spans[numspans].group = group;
+				groups[group].numspans++;
+				numspans++;
+				open = GL_TRUE;
 			}
-			node = node->next;
+			spans[numspans - 1].span.length =
+				(GLuint)(next - (const char*)data - spans[numspans - 1].span.offset);
+			/* a fan of corners - 2 triangles */
+			for (j = 0; ; j++) {
+				rest = glmIndexSpace(rest, end);
+				if (rest == end || isspace((unsigned char)*rest))
+					break;
+				while (rest < end && !isspace((unsigned char)*rest))
+					rest++;
+			}
+			if (j >= 3)
+				groups[group].numtriangles += j - 2;
+		}
+		else if (glmIndexTag(p, end, "g", &rest)) {
+			char* name = glmIndexName(rest, end);
+			for (group = 0; group < numgroups; group++) {
+				if (!strcmp(groups[group].name, name))
+					break;
+			}
+			if (group == numgroups) {
+				groups = (BuildGroup*)glmIndexGrow(groups, &maxgroups, numgroups, sizeof(BuildGroup));
+				groups[group].name = name;
+				groups[group].material = NULL;
+				groups[group].numtriangles = groups[group].numspans = 0;
+				numgroups++;
+			}
+			else
+				free(name);
+			/* like glmSecondPass(), a group takes the current material */
+			free(groups[group].material);
+			groups[group].material = material ? _strdup(material) : NULL;
+			open = GL_FALSE;
+		}
+		else if (glmIndexTag(p, end, "usemtl", &rest)) {
+			free(material);
+			material = glmIndexName(rest, end);
+			free(groups[group].material);
+			groups[group].material = _strdup(material);
+		}
+		else if (!mtllib && glmIndexTag(p, end, "mtllib", &rest)) {
+			mtllib = glmIndexName(rest, end);
 		}
+	}
 
-		if (avg) {
-			/* normalize the averaged normal */
-			glmNormalize(average);
+	/* spans in group order, otherwise in file order */
+	sorted = (GLMindexspan*)malloc(sizeof(GLMindexspan) * (numspans + 1));
+	for (i = 0, j = 0; i < numgroups; i++) {
+		groups[i].firstspan = j;
+		j += groups[i].numspans;
+		groups[i].numspans = 0;
+	}
+	for (i = 0; i < numspans; i++) {
+		k = spans[i].group;
+		sorted[groups[k].firstspan + groups[k].numspans++] = spans[i].span;
+	}
 
-			/* add the normal to the vertex normals list */
-			model->normals[3 * numnormals + 0] = average[0];
-			model->normals[3 * numnormals + 1] = average[1];
-			model->normals[3 * numnormals + 2] = average[2];
-			avg = numnormals;
-			numnormals++;
+	/* names follow the groups; offset 0 is the empty name */
+	strings = 1;
+	for (i = 0; i < numgroups; i++) {
+		strings += (GLuint)strlen(groups[i].name) + 1;
+		if (groups[i].material)
+			strings += (GLuint)strlen(groups[i].material) + 1;
+	}
+	if (mtllib)
+		strings += (GLuint)strlen(mtllib) + 1;
+
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, "GLMI", 4);
+	header.version = GLM_INDEX_VERSION;
+	header.objsize = size;
+	header.objtime = objtime;
+	header.numvertices = numvectors[0];
+	header.numnormals = numvectors[1];
+	header.numtexcoords = numvectors[2];
+	header.numgroups = numgroups;
+	header.numspans = numspans;
+	header.block = GLM_INDEX_BLOCK;
+	header.strings = strings;
+
+	ok = GL_FALSE;
+	file = fopen(indexname, "wb");
+	if (!file) {
+		fprintf(stderr, "glmWriteOBJIndex() failed: can't open file \"%s\" to write.\n",
+			indexname);
+	}
+	else {
+		strings = 1;
+		if (mtllib) {
+			header.mtllib = strings;
+			strings += (GLuint)strlen(mtllib) + 1;
 		}
-
-		/* set the normal of this vertex in each triangle it is in */
-		node = members[i];
-		while (node) {
-			if (node->averaged) {
-				/* if this node was averaged, use the average normal */
-				if (T(node->index).vindices[0] == i)
-					T(node->index).nindices[0] = avg;
-				else if (T(node->index).vindices[1] == i)
-					T(node->index).nindices[1] = avg;
-				else if (T(node->index).vindices[2] == i)
-					T(node->index).nindices[2] = avg;
-			}
-			else {
-				/* if this node wasn't averaged, use the facet normal */
-				model->normals[3 * numnormals + 0] =
-					model->facetnorms[3 * T(node->index).findex + 0];
-				model->normals[3 * numnormals + 1] =
-					model->facetnorms[3 * T(node->index).findex + 1];
-				model->normals[3 * numnormals + 2] =
-					model->facetnorms[3 * T(node->index).findex + 2];
-				if (T(node->index).vindices[0] == i)
-					T(node->index).nindices[0] = numnormals;
-				else if (T(node->index).vindices[1] == i)
-					T(node->index).nindices[1] = numnormals;
-				else if (T(node->index).vindices[2] == i)
-					T(node->index).nindices[2] = numnormals;
-				numnormals++;
+		fwrite(&header, sizeof(header), 1, file);
+		fwrite(sorted, sizeof(GLMindexspan), numspans, file);
+		for (i = 0; i < 3; i++)
+			fwrite(blocks[i], sizeof(unsigned long long), numblocks[i], file);
+		for (i = 0; i < numgroups; i++) {
+			entry.name = strings;
+			strings += (GLuint)strlen(groups[i].name) + 1;
+			entry.material = 0;
+			if (groups[i].material) {
+				entry.material = strings;
+				strings += (GLuint)strlen(groups[i].material) + 1;
 			}
-			node = node->next;
+			entry.numtriangles = groups[i].numtriangles;
+			entry.firstspan = groups[i].firstspan;
+			entry.numspans = groups[i].numspans;
+			fwrite(&entry, sizeof(entry), 1, file);
 		}
+		fputc('\0', file);
+		if (mtllib)
+			fwrite(mtllib, strlen(mtllib) + 1, 1, file);
+		for (i = 0; i < numgroups; i++) {
+			fwrite(groups[i].name, strlen(groups[i].name) + 1, 1, file);
+			if (groups[i].material)
+				fwrite(groups[i].material, strlen(groups[i].material) + 1, 1, file);
+		}
+		ok = !ferror(file);
+		if (fclose(file) != 0)
+			ok = GL_FALSE;
+		if (!ok)
+			fprintf(stderr, "glmWriteOBJIndex() failed: can't write \"%s\".\n", indexname);
+	}
+
+	length = 0;
+	for (i = 0; i < numgroups; i++) {
+		length += groups[i].numtriangles;
+		free(groups[i].name);
+		free(groups[i].material);
+	}
+	if (ok) {
+		printf("glmWriteOBJIndex(): %s: %u groups, %u triangles in %u spans.\n",
+			indexname, numgroups, length, numspans);
+	}
+	free(groups);
+	free(spans);
+	free(sorted);
+	for (i = 0; i < 3; i++)
+		free(blocks[i]);
+	free(material);
+	free(mtllib);
+	glmUnmapFile(data, size);
+
+	return ok;
+}
+
+/* glmReadOBJGroups: Reads some of the groups of a Wavefront .OBJ file
+ * through its index, parsing only their faces and the vectors those
+ * use.  Returns a pointer to the created object which should be
+ * free'd with glmDelete(), or NULL if either file can't be read or
+ * the index is not for this file.
+ *
+ * filename  - name of the .OBJ file.
+ * indexname - name of its index, from glmWriteOBJIndex().
+ * names     - names of the groups to read
+ * numnames  - number of names
+ */
+GLMmodel*
+glmReadOBJGroups(char* filename, char* indexname, char** names, GLuint numnames)
+{
+	GLMmodel* model;
+	GLMgroup* group;
+	const GLMindexheader* header;
+	const GLMindexspan* spans;
+	const GLMindexgroup* groups;
+	const GLMindexgroup** chosen;
+	const unsigned long long* blocks[3];
+	const GLubyte* index;
+	const GLubyte* data;
+	const char* strings;
+	const char* p;
+	const char* end;
+	const char* last;
+	const char* rest;
+	size_t indexsize, size, offset;
+	GLuint numchosen, numtriangles, next, i, j, k;
+	int read;
+
+	index = glmMapFile(indexname, &indexsize);
+	if (!index) {
+		fprintf(stderr, "glmReadOBJGroups() failed: can't open index file \"%s\".\n",
+			indexname);
+		return NULL;
+	}
+
+	/* the parts of the index, checked against its size */
+	header = (const GLMindexheader*)index;
+	offset = sizeof(GLMindexheader);
+	if (indexsize < offset || memcmp(header->magic, "GLMI", 4) ||
+		header->version != GLM_INDEX_VERSION || header->block != GLM_INDEX_BLOCK) {
+		fprintf(stderr, "glmReadOBJGroups() failed: \"%s\" is not an OBJ index.\n",
+			indexname);
+		glmUnmapFile(index, indexsize);
+		return NULL;
+	}
+	spans = (const GLMindexspan*)(index + offset);
+	offset += sizeof(GLMindexspan) * (size_t)header->numspans;
+	blocks[0] = (const unsigned long long*)(index + offset);
+	offset += sizeof(unsigned long long) * ((header->numvertices + GLM_INDEX_BLOCK - 1) / GLM_INDEX_BLOCK);
+	blocks[1] = (const unsigned long long*)(index + offset);
+	offset += sizeof(unsigned long long) * ((header->numnormals + GLM_INDEX_BLOCK - 1) / GLM_INDEX_BLOCK);
+	blocks[2] = (const unsigned long long*)(index + offset);
+	offset += sizeof(unsigned long long) * ((header->numtexcoords + GLM_INDEX_BLOCK - 1) / GLM_INDEX_BLOCK);
+	groups = (const GLMindexgroup*)(index + offset);
+	offset += sizeof(GLMindexgroup) * (size_t)header->numgroups;
+	strings = (const char*)(index + offset);
+	if (offset + header->strings != indexsize || !header->strings ||
+		strings[header->strings - 1] != '\0') {
+		fprintf(stderr, "glmReadOBJGroups() failed: \"%s\" is truncated.\n",
+			indexname);
+		glmUnmapFile(index, indexsize);
+		return NULL;
 	}
 
-	model->numnormals = numnormals - 1;
+	/* an edit that keeps the size still changes the time */
+	data = glmMapFile(filename, &size);
+	if (!data || size != header->objsize || glmFileTime(filename) != header->objtime) {
+		fprintf(stderr, "glmReadOBJGroups() failed: \"%s\" is not the file \"%s\" indexes.\n",
+			filename, indexname);
+		if (data)
+			glmUnmapFile(data, size);
+		glmUnmapFile(index, indexsize);
+		return NULL;
+	}
+#ifndef _WIN32
+	madvise((void*)data, size, MADV_RANDOM);
+#endif
+	end = (const char*)data + size;
 
-	/* free the member information */
-	for (i = 1; i <= model->numvertices; i++) {
-		node = members[i];
-		while (node) {
-			tail = node;
-			node = node->next;
-			free(tail);
+	/* the groups asked for, each once */
+	chosen = (const GLMindexgroup**)malloc(sizeof(GLMindexgroup*) * (numnames + 1));
+	numchosen = 0;
+	numtriangles = 0;
+	for (i = 0; i < numnames; i++) {
+		for (j = 0; j < header->numgroups; j++) {
+			if (groups[j].name < header->strings && !strcmp(strings + groups[j].name, names[i]))
+				break;
 		}
+		if (j == header->numgroups) {
+			fprintf(stderr, "glmReadOBJGroups() failed: no group \"%s\" in \"%s\".\n",
+				names[i], filename);
+			free(chosen);
+			glmUnmapFile(data, size);
+			glmUnmapFile(index, indexsize);
+			return NULL;
+		}
+		for (k = 0; k < numchosen && chosen[k] != &groups[j]; k++)
+			;
+		if (k < numchosen)
+			continue;
+		chosen[numchosen++] = &groups[j];
+		numtriangles += groups[j].numtriangles;
 	}
-	free(members);
 
-	/* pack the normals array (we previously allocated the maximum
-	number of normals that could possibly be created (numtriangles *
-	3), so get rid of some of them (usually alot unless none of the
-	facet normals were averaged)) */
-	normals = model->normals;
-	model->normals = (GLfloat*)malloc(sizeof(GLfloat) * 3 * (model->numnormals + 1));
-	for (i = 1; i <= model->numnormals; i++) {
-		model->normals[3 * i + 0] = normals[3 * i + 0];
-		model->normals[3 * i + 1] = normals[3 * i + 1];
-		model->normals[3 * i + 2] = normals[3 * i + 2];
+	model = glmNewModel(filename);
+	if (header->mtllib && header->mtllib < header->strings) {
+		model->mtllibname = _strdup(strings + header->mtllib);
+		glmReadMTL(model, model->mtllibname);
+	}
+	model->numtriangles = numtriangles;
+	model->triangles = (GLMtriangle*)malloc(sizeof(GLMtriangle) * (numtriangles + 1));
+
+	/* the faces of each group, span by span */
+	next = 0;
+	for (i = 0; i < numchosen; i++) {
+		group = glmAddGroup(model, strings + chosen[i]->name);
+		group->first = next;
+		if (chosen[i]->material && chosen[i]->material < header->strings)
+			group->material = glmFindMaterial(model, (char*)strings + chosen[i]->material);
+		for (j = 0; j < chosen[i]->numspans; j++) {
+			k = chosen[i]->firstspan + j;
+			if (k >= header->numspans || spans[k].offset + spans[k].length > size)
+				break;
+			p = (const char*)data + spans[k].offset;
+			last = p + spans[k].length;
+			for (; p < last; p = glmIndexLine(p, last)) {
+				if (!glmIndexTag(p, last, "f", &rest))
+					continue;
+				read = glmIndexFace(model, rest, last, &spans[k], header,
+					next, group->first + chosen[i]->numtriangles);
+				if (read < 0)
+					break;
+				next += read;
+			}
+			if (p < last)
+				break;
+		}
+		group->numtriangles = next - group->first;
+		if (j < chosen[i]->numspans || group->numtriangles != chosen[i]->numtriangles)
+			break;
+	}
+	free(chosen);
+	if (i < numchosen) {
+		fprintf(stderr, "glmReadOBJGroups() failed: \"%s\" doesn't match \"%s\".\n",
+			indexname, filename);
+		glmUnmapFile(data, size);
+		glmUnmapFile(index, indexsize);
+		glmDelete(model);
+		return NULL;
 	}
-	free(normals);
-}
 
+	/* only the vectors those faces use */
+	model->vertices = glmIndexVectors(model, (const char*)data, end, blocks[0], "v", 3,
+		offsetof(GLMtriangle, vindices), &model->numvertices);
+	model->normals = glmIndexVectors(model, (const char*)data, end, blocks[1], "vn", 3,
+		offsetof(GLMtriangle, nindices), &model->numnormals);
+	model->texcoords = glmIndexVectors(model, (const char*)data, end, blocks[2], "vt", 2,
+		offsetof(GLMtriangle, tindices), &model->numtexcoords);
+	if (!model->vertices)
+		model->vertices = (GLfloat*)calloc(3, sizeof(GLfloat));
 
-/* glmLinearTexture: Generates texture coordinates according to a
- * linear projection of the texture map.  It generates these by
- * linearly mapping the vertices onto a square.
- *
- * model - pointer to initialized GLMmodel structure
- */
-GLvoid
-glmLinearTexture(GLMmodel* model)
-{
-	GLMgroup *group;
-	GLfloat dimensions[3];
-	GLfloat x, y, scalefactor;
-	GLuint i;
+	glmUnmapFile(data, size);
+	glmUnmapFile(index, indexsize);
 
-	assert(model);
+	glmSortGroups(model);
+	glmThirdPass(model);
 
-	if (model->texcoords)
-		free(model->texcoords);
-	model->numtexcoords = model->numvertices;
-	model->texcoords = (GLfloat*)malloc(sizeof(GLfloat) * 2 * (model->numtexcoords + 1));
+	return model;
+}
 
-	glmDimensions(model, dimensions);
-	scalefactor = 2.0f /
-		glmAbs(glmMax(glmMax(dimensions[0], dimensions[1]), dimensions[2]));
+/* glmReadGLB: Reads a model from a binary glTF 2.0 (.glb) file.  The
+ * file is memory mapped and every accessor used by a mesh primitive is
+ * validated.  Only the index data is read, to check it against the
+ * vertex count; vertex data is neither touched nor copied.  Returns a
+ * pointer to the created object which should be free'd with
+ * glmDeleteGLB(), or NULL if the file can't be read.
+ *
+ * filename - name of the .glb file.
+ */
+GLMgltf*
+glmReadGLB(char* filename)
+{
+	GLMgltf* gltf;
+	GLMjson* tokens;
+	const GLubyte* data;
+	const char* json;
+	GLuint header[3], chunk[2], jsonlength;
+	size_t size, length, pos;
+
+	data = glmMapFile(filename, &size);
+	if (!data) {
+		fprintf(stderr, "glmReadGLB() failed: can't open data file \"%s\".\n",
+			filename);
+		return NULL;
+	}
 
-	/* do the calculations */
-	for (i = 1; i <= model->numvertices; i++) {
-		x = model->vertices[3 * i + 0] * scalefactor;
-		y = model->vertices[3 * i + 2] * scalefactor;
-		model->texcoords[2 * i + 0] = (x + 1.0f) / 2.0f;
-		model->texcoords[2 * i + 1] = (y + 1.0f) / 2.0f;
+	/* header (magic, version, length) then a JSON chunk; GLB is always
+	   little-endian */
+	if (size >= 20)
+		memcpy(header, data, sizeof(header));
+	if (size < 20 || !glmHostIsLittleEndian() || memcmp(data, "glTF", 4) ||
+		header[1] != 2 || header[2] < 20 || header[2] > size) {
+		fprintf(stderr, "glmReadGLB() failed: \"%s\" is not a glTF 2.0 binary file.\n",
+			filename);
+		glmUnmapFile(data, size);
+		return NULL;
 	}
+	/* the header length bounds the chunks; size stays the mapped length
+	   for glmUnmapFile() */
+	length = header[2];
 
-	/* go through and put texture coordinate indices in all the triangles */
-	group = model->groups;
-	while (group) {
-		for (i = 0; i < group->numtriangles; i++) {
-			T(group->triangles[i]).tindices[0] = T(group->triangles[i]).vindices[0];
-			T(group->triangles[i]).tindices[1] = T(group->triangles[i]).vindices[1];
-			T(group->triangles[i]).tindices[2] = T(group->triangles[i]).vindices[2];
+	memcpy(chunk, data + 12, sizeof(chunk));
+	if (memcmp(data + 16, "JSON", 4) || chunk[0] > length - 20) {
+		fprintf(stderr, "glmReadGLB() failed: \"%s\" has no JSON chunk.\n",
+			filename);
+		glmUnmapFile(data, size);
+		return NULL;
+	}
+	json = (const char*)data + 20;
+	jsonlength = chunk[0];
+
+	gltf = (GLMgltf*)calloc(1, sizeof(GLMgltf));
+	gltf->pathname = _strdup(filename);
+	gltf->data = data;
+	gltf->size = size;
+	gltf->scale = 1.0f;
+
+	/* optional BIN chunk right after the (4 byte aligned) JSON chunk */
+	pos = 20 + ((jsonlength + 3) & ~3u);
+	if (pos + 8 <= length && !memcmp(data + pos + 4, "BIN\0", 4)) {
+		memcpy(chunk, data + pos, sizeof(chunk));
+		if (chunk[0] <= length - pos - 8) {
+			gltf->bin = data + pos + 8;
+			gltf->binlength = chunk[0];
 		}
-		group = group->next;
 	}
 
-#if 0
-	printf("glmLinearTexture(): generated %d linear texture coordinates\n",
-		model->numtexcoords);
-#endif
+	tokens = glmJsonParse(json, (int)jsonlength);
+	if (!tokens || !glmGltfMeshes(gltf, json, tokens)) {
+		fprintf(stderr, "glmReadGLB() failed: \"%s\" has invalid or unsupported content.\n",
+			filename);
+		free(tokens);
+		glmDeleteGLB(gltf);
+		return NULL;
+	}
+	free(tokens);
+
+	return gltf;
 }
 
-/* glmSpheremapTexture: Generates texture coordinates according to a
- * spherical projection of the texture map.  Sometimes referred to as
- * spheremap, or reflection map texture coordinates.  It generates
- * these by using the normal to calculate where that vertex would map
- * onto a sphere.  Since it is impossible to map something flat
- * perfectly onto something spherical, there is distortion at the
- * poles.  This particular implementation causes the poles along the X
- * axis to be distorted.
+/* glmUploadGLB: Creates one GL buffer object per buffer view straight
+ * from the mapped binary chunk and releases the file.  Returns
+ * GL_FALSE if buffer objects aren't available.
  *
- * model - pointer to initialized GLMmodel structure
+ * gltf - model returned by glmReadGLB()
  */
-GLvoid
-glmSpheremapTexture(GLMmodel* model)
+GLboolean
+glmUploadGLB(GLMgltf* gltf)
 {
-	GLMgroup* group;
-	GLfloat theta, phi, rho, x, y, z, r;
+	GLMgltfview* view;
 	GLuint i;
 
-	assert(model);
-	assert(model->normals);
+	assert(gltf);
+
+	if (!gltf->data)
+		return GL_TRUE;     /* already uploaded */
+	if (!glmExtInit())
+		return GL_FALSE;
+
+	for (i = 0; i < gltf->numviews; i++) {
+		view = &gltf->views[i];
+		if (!view->target)
+			continue;       /* not referenced by any primitive */
+		glmextGenBuffers(1, &view->buffer);
+		glmextBindBuffer(view->target, view->buffer);
+		glmextBufferData(view->target, view->length, gltf->bin + view->offset, GL_STATIC_DRAW);
+		glmextBindBuffer(view->target, 0);
+	}
 
-	if (model->texcoords)
-		free(model->texcoords);
-	model->numtexcoords = model->numnormals;
-	model->texcoords = (GLfloat*)malloc(sizeof(GLfloat) * 2 * (model->numtexcoords + 1));
+	glmUnmapFile(gltf->data, gltf->size);
+	gltf->data = NULL;
+	gltf->bin = NULL;
 
-	for (i = 1; i <= model->numnormals; i++) {
-		z = model->normals[3 * i + 0];  /* re-arrange for pole distortion */
-		y = model->normals[3 * i + 1];
-		x = model->normals[3 * i + 2];
-		r = sqrt((x * x) + (y * y));
-		rho = sqrt((r * r) + (z * z));
+	return GL_TRUE;
+}
 
-		if (r == 0.0) {
-			theta = 0.0;
-			phi = 0.0;
-		}
-		else {
-			if (z == 0.0)
-				phi = 3.14159265f / 2.0f;
-			else
-				phi = acos(z / rho);
+/* glmUnitizeGLB: sets the draw transform of a GLB model so it is
+ * centered on the origin and fits in a unit cube.  Returns the
+ * scalefactor used.
+ *
+ * gltf - model returned by glmReadGLB()
+ */
+GLfloat
+glmUnitizeGLB(GLMgltf* gltf)
+{
+	GLfloat w, h, d;
 
-			if (y == 0.0)
-				theta = 3.141592365f / 2.0f;
-			else
-				theta = asin(y / r) + (3.14159265f / 2.0f);
-		}
+	assert(gltf);
 
-		model->texcoords[2 * i + 0] = theta / 3.14159265f;
-		model->texcoords[2 * i + 1] = phi / 3.14159265f;
-	}
+	w = gltf->max[0] - gltf->min[0];
+	h = gltf->max[1] - gltf->min[1];
+	d = gltf->max[2] - gltf->min[2];
 
-	/* go through and put texcoord indices in all the triangles */
-	group = model->groups;
-	while (group) {
-		for (i = 0; i < group->numtriangles; i++) {
-			T(group->triangles[i]).tindices[0] = T(group->triangles[i]).nindices[0];
-			T(group->triangles[i]).tindices[1] = T(group->triangles[i]).nindices[1];
-			T(group->triangles[i]).tindices[2] = T(group->triangles[i]).nindices[2];
-		}
-		group = group->next;
-	}
+	gltf->position[0] = -(gltf->max[0] + gltf->min[0]) / 2.0f;
+	gltf->position[1] = -(gltf->max[1] + gltf->min[1]) / 2.0f;
+	gltf->position[2] = -(gltf->max[2] + gltf->min[2]) / 2.0f;
+	gltf->scale = 2.0f / glmMax(glmMax(w, h), d);
+
+	return gltf->scale;
 }
 
-/* glmDelete: Deletes a GLMmodel structure.
+/* glmDrawGLB: Renders a GLB model to the current OpenGL context.
  *
- * model - initialized GLMmodel structure
+ * gltf - model returned by glmReadGLB()
+ * mode - a bitwise OR of GLM_SMOOTH, GLM_TEXTURE, GLM_COLOR and
+ *        GLM_MATERIAL, as for glmDraw()
  */
 GLvoid
-glmDelete(GLMmodel* model)
+glmDrawGLB(GLMgltf* gltf, GLuint mode)
 {
-	GLMgroup* group;
+	GLMgltfprimitive* primitive;
+	GLMmaterial* material;
+	const GLvoid* pointer;
 	GLuint i;
 
-	assert(model);
+	assert(gltf);
 
-	if (model->pathname)     free(model->pathname);
-	if (model->mtllibname) free(model->mtllibname);
-	if (model->vertices)     free(model->vertices);
-	if (model->normals)  free(model->normals);
-	if (model->texcoords)  free(model->texcoords);
-	if (model->facetnorms) free(model->facetnorms);
-	if (model->triangles)  free(model->triangles);
-	if (model->materials) {
-		for (i = 0; i < model->nummaterials; i++)
-			free(model->materials[i].name);
-	}
-	free(model->materials);
-	while (model->groups) {
-		group = model->groups;
-		model->groups = model->groups->next;
-		free(group->name);
-		free(group->triangles);
-		free(group);
-	}
+	if (mode & GLM_COLOR && mode & GLM_MATERIAL)
+		mode &= ~GLM_COLOR;
+	if (mode & GLM_COLOR)
+		glEnable(GL_COLOR_MATERIAL);
+	else if (mode & GLM_MATERIAL)
+		glDisable(GL_COLOR_MATERIAL);
 
-	free(model);
-}
+	glPushMatrix();
+	glScalef(gltf->scale, gltf->scale, gltf->scale);
+	glTranslatef(gltf->position[0], gltf->position[1], gltf->position[2]);
+	glEnableClientState(GL_VERTEX_ARRAY);
 
-/* glmReadOBJ: Reads a model description from a Wavefront .OBJ file.
- * Returns a pointer to the created object which should be free'd with
- * glmDelete().
- *
- * filename - name of the file containing the Wavefront .OBJ format data.
- */
-GLMmodel*
-glmReadOBJ(char* filename)
-{
-	GLMmodel* model;
-	FILE* file;
+	for (i = 0; i < gltf->numprimitives; i++) {
+		primitive = &gltf->primitives[i];
 
-	/* open the file */
-	file = fopen(filename, "r");
-	if (!file) {
-		fprintf(stderr, "glmReadOBJ() failed: can't open data file \"%s\".\n",
-			filename);
-		exit(1);
-	}
+		material = &gltf->materials[primitive->material];
+		if (mode & GLM_MATERIAL) {
+			glMaterialfv(GL_FRONT_AND_BACK, GL_AMBIENT, material->ambient);
+			glMaterialfv(GL_FRONT_AND_BACK, GL_DIFFUSE, material->diffuse);
+			glMaterialfv(GL_FRONT_AND_BACK, GL_SPECULAR, material->specular);
+			glMaterialf(GL_FRONT_AND_BACK, GL_SHININESS, material->shininess);
+		}
+		if (mode & GLM_COLOR)
+			glColor4fv(material->diffuse);
 
-	/* allocate a new model */
-	model = (GLMmodel*)malloc(sizeof(GLMmodel));
-	//new (&model->cao) std::vector<int>;
-	model->pathname = _strdup(filename);
-	model->mtllibname = NULL;
-	model->numvertices = 0;
-	model->vertices = NULL;
-	model->numnormals = 0;
-	model->normals = NULL;
-	model->numtexcoords = 0;
-	model->texcoords = NULL;
-	model->numfacetnorms = 0;
-	model->facetnorms = NULL;
-	model->numtriangles = 0;
-	model->triangles = NULL;
-	model->nummaterials = 0;
-	model->materials = NULL;
-	model->numgroups = 0;
-	model->groups = NULL;
-	model->position[0] = 0.0;
-	model->position[1] = 0.0;
-	model->position[2] = 0.0;
+		pointer = glmGltfPointer(gltf, &primitive->position, GL_ARRAY_BUFFER);
+		glVertexPointer(3, GL_FLOAT, primitive->position.stride, pointer);
 
-	/* make a first pass through the file to get a count of the number
-	of vertices, normals, texcoords & triangles */
-	glmFirstPass(model, file);
+		if (mode & GLM_SMOOTH && primitive->normal.view >= 0) {
+			pointer = glmGltfPointer(gltf, &primitive->normal, GL_ARRAY_BUFFER);
+			glNormalPointer(GL_FLOAT, primitive->normal.stride, pointer);
+			glEnableClientState(GL_NORMAL_ARRAY);
+		}
+		if (mode & GLM_TEXTURE && primitive->texcoord.view >= 0) {
+			pointer = glmGltfPointer(gltf, &primitive->texcoord, GL_ARRAY_BUFFER);
+			glTexCoordPointer(2, GL_FLOAT, primitive->texcoord.stride, pointer);
+			glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+		}
 
-	/* allocate memory */
-	model->vertices = (GLfloat*)malloc(sizeof(GLfloat) *
-		3 * (model->numvertices + 1));
-	model->triangles = (GLMtriangle*)malloc(sizeof(GLMtriangle) *
-		model->numtriangles);
-	if (model->numnormals) {
-		model->normals = (GLfloat*)malloc(sizeof(GLfloat) *
-			3 * (model->numnormals + 1));
+		if (primitive->indices.view >= 0) {
+			pointer = glmGltfPointer(gltf, &primitive->indices, GL_ELEMENT_ARRAY_BUFFER);
+			glDrawElements(primitive->mode, primitive->indices.count,
+				primitive->indices.type, pointer);
+		}
+		else {
+			glDrawArrays(primitive->mode, 0, primitive->position.count);
+		}
+
+		glDisableClientState(GL_NORMAL_ARRAY);
+		glDisableClientState(GL_TEXTURE_COORD_ARRAY);
 	}
-	if (model->numtexcoords) {
-		model->texcoords = (GLfloat*)malloc(sizeof(GLfloat) *
-			2 * (model->numtexcoords + 1));
+
+	glDisableClientState(GL_VERTEX_ARRAY);
+	if (glmExtHasBuffers()) {
+		glmextBindBuffer(GL_ARRAY_BUFFER, 0);
+		glmextBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 	}
+	glPopMatrix();
+}
 
-	/* rewind to beginning of file and read in the data this pass */
-	rewind(file);
+/* glmDeleteGLB: Deletes a GLMgltf structure and its buffer objects.
+ *
+ * gltf - model returned by glmReadGLB()
+ */
+GLvoid
+glmDeleteGLB(GLMgltf* gltf)
+{
+	GLMgroup* group;
+	GLuint i;
 
-	glmSecondPass(model, file);
-	glmThirdPass(model);
-	/* close the file */
-	fclose(file);
+	assert(gltf);
 
-	return model;
+	if (gltf->data)
+		glmUnmapFile(gltf->data, gltf->size);
+	for (i = 0; i < gltf->numviews; i++) {
+		if (gltf->views[i].buffer)
+			glmextDeleteBuffers(1, &gltf->views[i].buffer);
+	}
+	free(gltf->views);
+	free(gltf->primitives);
+	if (gltf->materials) {
+		for (i = 0; i < gltf->nummaterials; i++)
+			free(gltf->materials[i].name);
+	}
+	free(gltf->materials);
+	while (gltf->groups) {
+		group = gltf->groups;
+		gltf->groups = gltf->groups->next;
+		free(group->name);
+		free(group);
+	}
+	free(gltf->pathname);
+	free(gltf);
 }
 
 /* glmWriteOBJ: Writes a model description in Wavefront .OBJ format to
@@ -1654,57 +4173,57 @@ glmWriteOBJ(GLMmodel* model, char* filename, GLuint mode)
 		for (i = 0; i < group->numtriangles; i++) {
 			if (mode & GLM_SMOOTH && mode & GLM_TEXTURE) {
 				fprintf(file, "f %d/%d/%d %d/%d/%d %d/%d/%d\n",
-					T(group->triangles[i]).vindices[0],
-					T(group->triangles[i]).tindices[0],
-					T(group->triangles[i]).nindices[0],
-					T(group->triangles[i]).vindices[1],
-					T(group->triangles[i]).tindices[1],
-					T(group->triangles[i]).nindices[1],
-					T(group->triangles[i]).vindices[2],
-					T(group->triangles[i]).tindices[2],
-					T(group->triangles[i]).nindices[2]);
+					T(group->first + i).vindices[0],
+					T(group->first + i).tindices[0],
+					T(group->first + i).nindices[0],
+					T(group->first + i).vindices[1],
+					T(group->first + i).tindices[1],
+					T(group->first + i).nindices[1],
+					T(group->first + i).vindices[2],
+					T(group->first + i).tindices[2],
+					T(group->first + i).nindices[2]);
 			}
 			else if (mode & GLM_FLAT && mode & GLM_TEXTURE) {
 				fprintf(file, "f %d/%d %d/%d %d/%d\n",
-					T(group->triangles[i]).vindices[0],
-					T(group->triangles[i]).findex,
-					T(group->triangles[i]).vindices[1],
-					T(group->triangles[i]).findex,
-					T(group->triangles[i]).vindices[2],
-					T(group->triangles[i]).findex);
+					T(group->first + i).vindices[0],
+					T(group->first + i).findex,
+					T(group->first + i).vindices[1],
+					T(group->first + i).findex,
+					T(group->first + i).vindices[2],
+					T(group->first + i).findex);
 			}
 			else if (mode & GLM_TEXTURE) {
 				fprintf(file, "f %d/%d %d/%d %d/%d\n",
-					T(group->triangles[i]).vindices[0],
-					T(group->triangles[i]).tindices[0],
-					T(group->triangles[i]).vindices[1],
-					T(group->triangles[i]).tindices[1],
-					T(group->triangles[i]).vindices[2],
-					T(group->triangles[i]).tindices[2]);
+					T(group->first + i).vindices[0],
+					T(group->first + i).tindices[0],
+					T(group->first + i).vindices[1],
+					T(group->first + i).tindices[1],
+					T(group->first + i).vindices[2],
+					T(group->first + i).tindices[2]);
 			}
 			else if (mode & GLM_SMOOTH) {
 				fprintf(file, "f %d//%d %d//%d %d//%d\n",
-					T(group->triangles[i]).vindices[0],
-					T(group->triangles[i]).nindices[0],
-					T(group->triangles[i]).vindices[1],
-					T(group->triangles[i]).nindices[1],
-					T(group->triangles[i]).vindices[2],
-					T(group->triangles[i]).nindices[2]);
+					T(group->first + i).vindices[0],
+					T(group->first + i).nindices[0],
+					T(group->first + i).vindices[1],
+					T(group->first + i).nindices[1],
+					T(group->first + i).vindices[2],
+					T(group->first + i).nindices[2]);
 			}
 			else if (mode & GLM_FLAT) {
 				fprintf(file, "f %d//%d %d//%d %d//%d\n",
-					T(group->triangles[i]).vindices[0],
-					T(group->triangles[i]).findex,
-					T(group->triangles[i]).vindices[1],
-					T(group->triangles[i]).findex,
-					T(group->triangles[i]).vindices[2],
-					T(group->triangles[i]).findex);
+					T(group->first + i).vindices[0],
+					T(group->first + i).findex,
+					T(group->first + i).vindices[1],
+					T(group->first + i).findex,
+					T(group->first + i).vindices[2],
+					T(group->first + i).findex);
 			}
 			else {
 				fprintf(file, "f %d %d %d\n",
-					T(group->triangles[i]).vindices[0],
-					T(group->triangles[i]).vindices[1],
-					T(group->triangles[i]).vindices[2]);
+					T(group->first + i).vindices[0],
+					T(group->first + i).vindices[1],
+					T(group->first + i).vindices[2]);
 			}
 		}
 		fprintf(file, "\n");
@@ -1731,50 +4250,15 @@ glmWriteOBJ(GLMmodel* model, char* filename, GLuint mode)
 GLvoid
 glmDraw(GLMmodel* model, GLuint mode)
 {
-	static GLuint i;
-	static GLMgroup* group;
-	static GLMtriangle* triangle;
-	static GLMmaterial* material;
+	GLuint i;
+	GLMgroup* group;
+	GLMtriangle* triangle;
+	GLMmaterial* material;
 
 	assert(model);
 	assert(model->vertices);
 
-	/* do a bit of warning */
-	if (mode & GLM_FLAT && !model->facetnorms) {
-		printf("glmDraw() warning: flat render mode requested "
-			"with no facet normals defined.\n");
-		mode &= ~GLM_FLAT;
-	}
-	if (mode & GLM_SMOOTH && !model->normals) {
-		printf("glmDraw() warning: smooth render mode requested "
-			"with no normals defined.\n");
-		mode &= ~GLM_SMOOTH;
-	}
-	if (mode & GLM_TEXTURE && !model->texcoords) {
-		printf("glmDraw() warning: texture render mode requested "
-			"with no texture coordinates defined.\n");
-		mode &= ~GLM_TEXTURE;
-	}
-	if (mode & GLM_FLAT && mode & GLM_SMOOTH) {
-		printf("glmDraw() warning: flat render mode requested "
-			"and smooth render mode requested (using smooth).\n");
-		mode &= ~GLM_FLAT;
-	}
-	if (mode & GLM_COLOR && !model->materials) {
-		printf("glmDraw() warning: color render mode requested "
-			"with no materials defined.\n");
-		mode &= ~GLM_COLOR;
-	}
-	if (mode & GLM_MATERIAL && !model->materials) {
-		printf("glmDraw() warning: material render mode requested "
-			"with no materials defined.\n");
-		mode &= ~GLM_MATERIAL;
-	}
-	if (mode & GLM_COLOR && mode & GLM_MATERIAL) {
-		printf("glmDraw() warning: color and material render mode requested "
-			"using only material mode.\n");
-		mode &= ~GLM_COLOR;
-	}
+	mode = glmDrawMode(model, mode, "glmDraw");
 	if (mode & GLM_COLOR)
 	{
 		glEnable(GL_COLOR_MATERIAL);
@@ -1809,7 +4293,7 @@ glmDraw(GLMmodel* model, GLuint mode)
 
 		// draw triangles
 		for (i = 0; i < group->numtriangles; i++) {
-			triangle = &T(group->triangles[i]);
+			triangle = &T(group->first + i);
 
 			// flat shader needs the normal of each facet
 			if (mode & GLM_FLAT)
@@ -1867,6 +4351,581 @@ glmList(GLMmodel* model, GLuint mode)
 	return list;
 }
 
+/* glmBuildDrawable: Flattens a model into an interleaved vertex array
+ * for the mode specified, one range per group.  Makes no GL calls.
+ *
+ * model - initialized GLMmodel structure
+ * mode  - a bitwise OR of values describing what is to be rendered.
+ */
+GLMdrawable*
+glmBuildDrawable(GLMmodel* model, GLuint mode)
+{
+	GLMdrawable* drawable;
+	GLMgroup* group;
+	GLMtriangle* triangle;
+	GLfloat* p;
+	GLuint floats, numvertices, i, j;
+
+	assert(model);
+	assert(model->vertices);
+
+	mode = glmDrawMode(model, mode, "glmBuildDrawable");
+
+	drawable = (GLMdrawable*)malloc(sizeof(GLMdrawable));
+	drawable->model = model;
+	drawable->mode = mode;
+	drawable->buffer = 0;
+
+	floats = 3;
+	if (mode & (GLM_FLAT | GLM_SMOOTH))
+		floats += 3;
+	if (mode & GLM_TEXTURE)
+		floats += 2;
+	drawable->stride = floats * sizeof(GLfloat);
+
+	numvertices = 0;
+	drawable->numranges = 0;
+	for (group = model->groups; group; group = group->next) {
+		numvertices += 3 * group->numtriangles;
+		drawable->numranges++;
+	}
+	drawable->numvertices = numvertices;
+	drawable->arrays = (GLfloat*)malloc(sizeof(GLfloat) * floats * (numvertices + 1));
+	drawable->ranges = (GLMrange*)malloc(sizeof(GLMrange) * (drawable->numranges + 1));
+
+	/* ranges in the order glmDraw() walks the groups */
+	p = drawable->arrays;
+	numvertices = 0;
+	for (group = model->groups, i = 0; group; group = group->next, i++) {
+		drawable->ranges[i].first = numvertices;
+		drawable->ranges[i].count = 3 * group->numtriangles;
+		drawable->ranges[i].material = group->material;
+		numvertices += 3 * group->numtriangles;
+
+		for (j = 0; j < group->numtriangles; j++) {
+			GLuint k;
+
+			triangle = &T(group->first + j);
+			for (k = 0; k < 3; k++) {
+				if (mode & GLM_SMOOTH) {
+					memcpy(p, &model->normals[3 * triangle->nindices[k]], 3 * sizeof(GLfloat));
+					p += 3;
+				}
+				else if (mode & GLM_FLAT) {
+					memcpy(p, &model->facetnorms[3 * triangle->findex], 3 * sizeof(GLfloat));
+					p += 3;
+				}
+				if (mode & GLM_TEXTURE) {
+					memcpy(p, &model->texcoords[2 * triangle->tindices[k]], 2 * sizeof(GLfloat));
+					p += 2;
+				}
+				memcpy(p, &model->vertices[3 * triangle->vindices[k]], 3 * sizeof(GLfloat));
+				p += 3;
+			}
+		}
+	}
+
+	return drawable;
+}
+
+/* glmUploadDrawable: Copies a drawable's arrays into a buffer object.
+ *
+ * drawable - drawable returned by glmBuildDrawable()
+ */
+GLvoid
+glmUploadDrawable(GLMdrawable* drawable)
+{
+	assert(drawable);
+
+	if (drawable->buffer || !glmExtInit())
+		return;
+
+	glmextGenBuffers(1, &drawable->buffer);
+	glmextBindBuffer(GL_ARRAY_BUFFER, drawable->buffer);
+	glmextBufferData(GL_ARRAY_BUFFER, drawable->stride * drawable->numvertices,
+		drawable->arrays, GL_STATIC_DRAW);
+	glmextBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+/* glmDeleteDrawable: Deletes a drawable and its buffer object.
+ *
+ * drawable - drawable returned by glmBuildDrawable()
+ */
+GLvoid
+glmDeleteDrawable(GLMdrawable* drawable)
+{
+	assert(drawable);
+
+	if (drawable->buffer)
+		glmextDeleteBuffers(1, &drawable->buffer);
+	free(drawable->arrays);
+	free(drawable->ranges);
+	free(drawable);
+}
+
+/* glmInitCommands: set up an empty command list */
+GLvoid
+glmInitCommands(GLMcommandlist* list)
+{
+	assert(list);
+
+	list->numcommands = list->maxcommands = 0;
+	list->commands = NULL;
+	list->nummatrices = list->maxmatrices = 0;
+	list->matrices = NULL;
+}
+
+/* glmResetCommands: empty a command list, keeping its storage */
+GLvoid
+glmResetCommands(GLMcommandlist* list)
+{
+	assert(list);
+
+	list->numcommands = 0;
+	list->nummatrices = 0;
+}
+
+/* glmFreeCommands: release the storage of a command list */
+GLvoid
+glmFreeCommands(GLMcommandlist* list)
+{
+	assert(list);
+
+	free(list->commands);
+	free(list->matrices);
+	glmInitCommands(list);
+}
+
+/* glmReserveCommands: grow a command list ahead of time */
+GLvoid
+glmReserveCommands(GLMcommandlist* list, GLuint commands, GLuint matrices)
+{
+	assert(list);
+
+	if (commands > list->maxcommands) {
+		list->maxcommands = commands;
+		list->commands = (GLMcommand*)realloc(list->commands,
+			sizeof(GLMcommand) * list->maxcommands);
+	}
+	if (matrices > list->maxmatrices) {
+		list->maxmatrices = matrices;
+		list->matrices = (GLfloat*)realloc(list->matrices,
+			sizeof(GLfloat) * 16 * list->maxmatrices);
+	}
+}
+
+/* glmCountCommands: number of commands glmPrepare() records */
+GLuint
+glmCountCommands(GLMdrawable* drawable)
+{
+	GLuint i, material, count;
+
+	assert(drawable);
+
+	count = 1;
+	material = (GLuint)-1;
+	for (i = 0; i < drawable->numranges; i++) {
+		if (!drawable->ranges[i].count)
+			continue;
+		if (drawable->mode & (GLM_MATERIAL | GLM_COLOR) && drawable->ranges[i].material != material) {
+			material = drawable->ranges[i].material;
+			count++;
+		}
+		count++;
+	}
+	return count;
+}
+
+/* glmAddCommand: append a command to a list, growing it if needed */
+static GLvoid
+glmAddCommand(GLMcommandlist* list, GLuint type, GLuint first, GLuint count,
+	GLMdrawable* drawable)
+{
+	GLMcommand* command;
+
+	if (list->numcommands == list->maxcommands) {
+		list->maxcommands = list->maxcommands ? 2 * list->maxcommands : 64;
+		list->commands = (GLMcommand*)realloc(list->commands,
+			sizeof(GLMcommand) * list->maxcommands);
+	}
+	command = &list->commands[list->numcommands++];
+	command->type = type;
+	command->first = first;
+	command->count = count;
+	command->drawable = drawable;
+}
+
+/* glmPrepare: Records the commands that draw a drawable with the
+ * given transform into a command list.  Reentrant, no GL calls.
+ *
+ * drawable  - drawable returned by glmBuildDrawable()
+ * transform - array of 16 GLfloats (column major), or NULL
+ * list      - command list to append to
+ */
+GLvoid
+glmPrepare(GLMdrawable* drawable, const GLfloat* transform, GLMcommandlist* list)
+{
+	GLMrange* range;
+	GLuint i, material;
+
+	assert(drawable);
+	assert(list);
+
+	if (transform) {
+		if (list->nummatrices == list->maxmatrices) {
+			list->maxmatrices = list->maxmatrices ? 2 * list->maxmatrices : 16;
+			list->matrices = (GLfloat*)realloc(list->matrices,
+				sizeof(GLfloat) * 16 * list->maxmatrices);
+		}
+		memcpy(&list->matrices[16 * list->nummatrices], transform, 16 * sizeof(GLfloat));
+		glmAddCommand(list, GLM_CMD_TRANSFORM, 16 * list->nummatrices++, 0, drawable);
+	}
+	else {
+		glmAddCommand(list, GLM_CMD_TRANSFORM, (GLuint)-1, 0, drawable);
+	}
+
+	/* only bind a material when it changes */
+	material = (GLuint)-1;
+	for (i = 0; i < drawable->numranges; i++) {
+		range = &drawable->ranges[i];
+		if (!range->count)
+			continue;
+		if (drawable->mode & (GLM_MATERIAL | GLM_COLOR) && range->material != material) {
+			material = range->material;
+			glmAddCommand(list, GLM_CMD_MATERIAL, material, 0, drawable);
+		}
+		glmAddCommand(list, GLM_CMD_DRAW, range->first, range->count, drawable);
+	}
+}
+
+/* glmBindDrawable: point the client arrays at a drawable's data */
+static GLvoid
+glmBindDrawable(GLMdrawable* drawable)
+{
+	const GLubyte* base;
+
+	if (drawable->buffer) {
+		glmextBindBuffer(GL_ARRAY_BUFFER, drawable->buffer);
+		base = NULL;
+	}
+	else {
+		if (glmExtHasBuffers())
+			glmextBindBuffer(GL_ARRAY_BUFFER, 0);
+		base = (const GLubyte*)drawable->arrays;
+	}
+
+	if (drawable->mode & (GLM_FLAT | GLM_SMOOTH)) {
+		glNormalPointer(GL_FLOAT, drawable->stride, base);
+		glEnableClientState(GL_NORMAL_ARRAY);
+		base += 3 * sizeof(GLfloat);
+	}
+	else {
+		glDisableClientState(GL_NORMAL_ARRAY);
+	}
+	if (drawable->mode & GLM_TEXTURE) {
+		glTexCoordPointer(2, GL_FLOAT, drawable->stride, base);
+		glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+		base += 2 * sizeof(GLfloat);
+	}
+	else {
+		glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+	}
+	glVertexPointer(3, GL_FLOAT, drawable->stride, base);
+
+	if (drawable->mode & GLM_COLOR)
+		glEnable(GL_COLOR_MATERIAL);
+	else if (drawable->mode & GLM_MATERIAL)
+		glDisable(GL_COLOR_MATERIAL);
+}
+
+/* glmSubmit: Executes a command list on the current context.
+ *
+ * list - command list filled by glmPrepare()
+ */
+GLvoid
+glmSubmit(GLMcommandlist* list)
+{
+	GLMcommand* command;
+	GLMdrawable* bound;
+	GLMmaterial* material;
+	GLuint i;
+
+	assert(list);
+
+	if (!list->numcommands)
+		return;
+
+	glPushMatrix();
+	glEnableClientState(GL_VERTEX_ARRAY);
+	bound = NULL;
+	for (i = 0; i < list->numcommands; i++) {
+		command = &list->commands[i];
+		switch (command->type) {
+		case GLM_CMD_TRANSFORM:
+			glPopMatrix();
+			glPushMatrix();
+			if (command->first != (GLuint)-1)
+				glMultMatrixf(&list->matrices[command->first]);
+			if (command->drawable != bound) {
+				bound = command->drawable;
+				glmBindDrawable(bound);
+			}
+			break;
+		case GLM_CMD_MATERIAL:
+			material = &command->drawable->model->materials[command->first];
+			if (command->drawable->mode & GLM_MATERIAL) {
+				glMaterialfv(GL_FRONT_AND_BACK, GL_AMBIENT, material->ambient);
+				glMaterialfv(GL_FRONT_AND_BACK, GL_DIFFUSE, material->diffuse);
+				glMaterialfv(GL_FRONT_AND_BACK, GL_SPECULAR, material->specular);
+				glMaterialf(GL_FRONT_AND_BACK, GL_SHININESS, material->shininess);
+			}
+			else {
+				glColor3fv(material->diffuse);
+			}
+			break;
+		case GLM_CMD_DRAW:
+			glDrawArrays(GL_TRIANGLES, command->first, command->count);
+			break;
+		}
+	}
+	glDisableClientState(GL_VERTEX_ARRAY);
+	glDisableClientState(GL_NORMAL_ARRAY);
+	glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+	if (glmExtHasBuffers())
+		glmextBindBuffer(GL_ARRAY_BUFFER, 0);
+	glPopMatrix();
+}
+
+/* glmBuildSplats: Builds a point cloud of a model's vertices, in
+ * random order so that any prefix is an even subsample.
+ *
+ * model - initialized GLMmodel structure
+ */
+GLMsplats*
+glmBuildSplats(GLMmodel* model)
+{
+	GLMsplats* splats;
+	GLMgroup* group;
+	GLMtriangle* triangle;
+	GLMmaterial* material;
+	GLfloat* normals;
+	GLubyte* colors;
+	GLuint* order;
+	GLfloat e1[3], e2[3], n[3], lo[3], hi[3], d[3];
+	GLfloat edges, r2, dist2;
+	GLuint numpoints, i, j, k, v, swap;
+	unsigned long seed;
+
+	assert(model);
+	assert(model->vertices);
+
+	/* area weighted vertex normals straight from the triangles, and the
+	 * colour of the first group to use each vertex */
+	normals = (GLfloat*)calloc(3 * (model->numvertices + 1), sizeof(GLfloat));
+	colors = (GLubyte*)calloc(4 * (model->numvertices + 1), sizeof(GLubyte));
+	edges = 0.0f;
+	for (group = model->groups; group; group = group->next) {
+		material = model->materials ? &model->materials[group->material] : NULL;
+		for (j = 0; j < group->numtriangles; j++) {
+			triangle = &T(group->first + j);
+			for (k = 0; k < 3; k++) {
+				e1[k] = model->vertices[3 * triangle->vindices[1] + k] - model->vertices[3 * triangle->vindices[0] + k];
+				e2[k] = model->vertices[3 * triangle->vindices[2] + k] - model->vertices[3 * triangle->vindices[0] + k];
+			}
+			glmCross(e1, e2, n);
+			edges += (GLfloat)(sqrt(glmDot(e1, e1)) + sqrt(glmDot(e2, e2)));
+			for (k = 0; k < 3; k++) {
+				v = triangle->vindices[k];
+				normals[3 * v + 0] += n[0];
+				normals[3 * v + 1] += n[1];
+				normals[3 * v + 2] += n[2];
+				if (!colors[4 * v + 3]) {
+					colors[4 * v + 0] = (GLubyte)(255.0f * (material ? material->diffuse[0] : 0.8f));
+					colors[4 * v + 1] = (GLubyte)(255.0f * (material ? material->diffuse[1] : 0.8f));
+					colors[4 * v + 2] = (GLubyte)(255.0f * (material ? material->diffuse[2] : 0.8f));
+					colors[4 * v + 3] = 255;
+				}
+			}
+		}
+	}
+
+	/* vertices no triangle uses have no colour, leave them out */
+	order = (GLuint*)malloc(sizeof(GLuint) * (model->numvertices + 1));
+	numpoints = 0;
+	for (i = 1; i <= model->numvertices; i++) {
+		if (colors[4 * i + 3])
+			order[numpoints++] = i;
+	}
+
+	/* Fisher-Yates with a fixed seed, so the same model subsamples the
+	 * same way every run */
+	seed = 1;
+	for (i = numpoints; i > 1; i--) {
+		seed = seed * 1103515245UL + 12345UL;
+		j = (GLuint)((seed >> 8) % i);
+		swap = order[i - 1];
+		order[i - 1] = order[j];
+		order[j] = swap;
+	}
+
+	splats = (GLMsplats*)malloc(sizeof(GLMsplats));
+	splats->model = model;
+	splats->numpoints = numpoints;
+	splats->buffer = 0;
+	splats->spacing = model->numtriangles ? edges / (2 * model->numtriangles) : 0.0f;
+	splats->arrays = (GLfloat*)malloc(sizeof(GLfloat) * 6 * (numpoints + 1));
+	splats->colors = (GLubyte*)malloc(sizeof(GLubyte) * 4 * (numpoints + 1));
+	for (i = 0; i < numpoints; i++) {
+		v = order[i];
+		if (glmDot(&normals[3 * v], &normals[3 * v]) > 0.0f)
+			glmNormalize(&normals[3 * v]);
+		memcpy(&splats->arrays[6 * i], &normals[3 * v], 3 * sizeof(GLfloat));
+		memcpy(&splats->arrays[6 * i + 3], &model->vertices[3 * v], 3 * sizeof(GLfloat));
+		memcpy(&splats->colors[4 * i], &colors[4 * v], 4 * sizeof(GLubyte));
+	}
+	free(order);
+	free(colors);
+	free(normals);
+
+	/* bounding sphere around the centre of the box */
+	splats->radius = 0.0f;
+	splats->center[0] = splats->center[1] = splats->center[2] = 0.0f;
+	if (numpoints) {
+		for (k = 0; k < 3; k++)
+			lo[k] = hi[k] = splats->arrays[3 + k];
+		for (i = 1; i < numpoints; i++) {
+			for (k = 0; k < 3; k++) {
+				if (splats->arrays[6 * i + 3 + k] < lo[k]) lo[k] = splats->arrays[6 * i + 3 + k];
+				if (splats->arrays[6 * i + 3 + k] > hi[k]) hi[k] = splats->arrays[6 * i + 3 + k];
+			}
+		}
+		for (k = 0; k < 3; k++)
+			splats->center[k] = 0.5f * (lo[k] + hi[k]);
+		r2 = 0.0f;
+		for (i = 0; i < numpoints; i++) {
+			for (k = 0; k < 3; k++)
+				d[k] = splats->arrays[6 * i + 3 + k] - splats->center[k];
+			dist2 = glmDot(d, d);
+			if (dist2 > r2) r2 = dist2;
+		}
+		splats->radius = (GLfloat)sqrt(r2);
+	}
+
+	return splats;
+}
+
+/* glmUploadSplats: Copies the points into a buffer object, normals
+ * and positions first, colours after them.
+ *
+ * splats - splats returned by glmBuildSplats()
+ */
+GLvoid
+glmUploadSplats(GLMsplats* splats)
+{
+	GLMsizeiptr arrays, colors;
+
+	assert(splats);
+
+	if (splats->buffer || !splats->numpoints || !glmExtInit())
+		return;
+
+	arrays = sizeof(GLfloat) * 6 * splats->numpoints;
+	colors = sizeof(GLubyte) * 4 * splats->numpoints;
+	glmextGenBuffers(1, &splats->buffer);
+	glmextBindBuffer(GL_ARRAY_BUFFER, splats->buffer);
+	glmextBufferData(GL_ARRAY_BUFFER, arrays + colors, NULL, GL_STATIC_DRAW);
+	glmextBufferSubData(GL_ARRAY_BUFFER, 0, arrays, splats->arrays);
+	glmextBufferSubData(GL_ARRAY_BUFFER, arrays, colors, splats->colors);
+	glmextBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+/* glmDrawSplats: Draws the first count points as squares.
+ *
+ * splats   - splats returned by glmBuildSplats()
+ * count    - number of points to draw
+ * scale    - pixels one unit covers at unit eye distance
+ * distance - eye distance of the model
+ */
+GLvoid
+glmDrawSplats(GLMsplats* splats, GLuint count, GLfloat scale, GLfloat distance)
+{
+	static const GLfloat none[3] = { 1.0f, 0.0f, 0.0f };
+	const GLubyte* base;
+	GLfloat size, attenuation[3];
+
+	assert(splats);
+
+	if (count > splats->numpoints)
+		count = splats->numpoints;
+	if (!count)
+		return;
+
+	/* a subsample leaves wider gaps between the points */
+	size = splats->spacing * scale * (GLfloat)sqrt((double)splats->numpoints / count);
+
+	if (splats->buffer) {
+		glmextBindBuffer(GL_ARRAY_BUFFER, splats->buffer);
+		base = NULL;
+	}
+	else {
+		if (glmExtHasBuffers())
+			glmextBindBuffer(GL_ARRAY_BUFFER, 0);
+		base = (const GLubyte*)splats->arrays;
+	}
+	glNormalPointer(GL_FLOAT, 6 * sizeof(GLfloat), base);
+	glVertexPointer(3, GL_FLOAT, 6 * sizeof(GLfloat), base + 3 * sizeof(GLfloat));
+	if (splats->buffer)
+		glColorPointer(4, GL_UNSIGNED_BYTE, 0, base + sizeof(GLfloat) * 6 * splats->numpoints);
+	else
+		glColorPointer(4, GL_UNSIGNED_BYTE, 0, splats->colors);
+	glEnableClientState(GL_NORMAL_ARRAY);
+	glEnableClientState(GL_VERTEX_ARRAY);
+	glEnableClientState(GL_COLOR_ARRAY);
+
+	glPushAttrib(GL_ENABLE_BIT | GL_LIGHTING_BIT | GL_POINT_BIT);
+	glColorMaterial(GL_FRONT_AND_BACK, GL_AMBIENT_AND_DIFFUSE);
+	glEnable(GL_COLOR_MATERIAL);
+	glDisable(GL_POINT_SMOOTH);
+	if (glmExtHasPointParameters()) {
+		/* size / d: size^2 / d^2 under the square root */
+		attenuation[0] = 0.0f;
+		attenuation[1] = 0.0f;
+		attenuation[2] = 1.0f / (size * size);
+		glPointSize(1.0f);
+		glmextPointParameterf(GL_POINT_SIZE_MIN, 1.0f);
+		glmextPointParameterfv(GL_POINT_DISTANCE_ATTENUATION, attenuation);
+	}
+	else {
+		glPointSize(distance > 0.0f && size > distance ? size / distance : 1.0f);
+	}
+	glDrawArrays(GL_POINTS, 0, count);
+	if (glmExtHasPointParameters())
+		glmextPointParameterfv(GL_POINT_DISTANCE_ATTENUATION, none);
+	glPopAttrib();
+
+	glDisableClientState(GL_COLOR_ARRAY);
+	glDisableClientState(GL_VERTEX_ARRAY);
+	glDisableClientState(GL_NORMAL_ARRAY);
+	if (glmExtHasBuffers())
+		glmextBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+/* glmDeleteSplats: Deletes splats and their buffer object.
+ *
+ * splats - splats returned by glmBuildSplats()
+ */
+GLvoid
+glmDeleteSplats(GLMsplats* splats)
+{
+	assert(splats);
+
+	if (splats->buffer)
+		glmextDeleteBuffers(1, &splats->buffer);
+	free(splats->arrays);
+	free(splats->colors);
+	free(splats);
+}
+
 /* glmWeld: eliminate (weld) vectors that are within an epsilon of
  * each other.
  *
@@ -1917,6 +4976,148 @@ glmWeld(GLMmodel* model, GLfloat epsilon)
 	free(copies);
 }
 
+/* glmReorder: reorder a model for memory locality.  Vertices are
+ * sorted along a Morton (Z-order) curve through the model's bounding
+ * box, triangles are sorted by their lowest new vertex index within
+ * their group's range, and facet normals, vertex normals, texcoords and
+ * lines are renumbered in the order the triangles use them.  Every index
+ * (triangle vindices, nindices, tindices, findex, lindices and line
+ * vindices) is remapped, so the model draws and processes exactly as
+ * before, only with neighbouring data close together in memory.
+ *
+ * model - initialized GLMmodel structure
+ */
+GLvoid
+glmReorder(GLMmodel* model)
+{
+	unsigned long long* keys;
+	GLuint* remap;
+	GLMtriangle* triangles;
+	GLfloat* copies;
+	GLMLine* lines;
+	GLMgroup* group;
+	GLfloat minimum[3], maximum[3], scale[3];
+	GLuint i, j, k, v, code, numvertices, numtriangles;
+
+	assert(model);
+	assert(model->vertices);
+
+	numvertices = model->numvertices;
+	numtriangles = model->numtriangles;
+	if (!numvertices)
+		return;
+
+	/* quantize positions to 10 bits per axis of the bounding box */
+	minimum[0] = minimum[1] = minimum[2] = 1e30f;
+	maximum[0] = maximum[1] = maximum[2] = -1e30f;
+	for (i = 1; i <= numvertices; i++) {
+		for (k = 0; k < 3; k++) {
+			if (model->vertices[3 * i + k] < minimum[k])
+				minimum[k] = model->vertices[3 * i + k];
+			if (model->vertices[3 * i + k] > maximum[k])
+				maximum[k] = model->vertices[3 * i + k];
+		}
+	}
+	for (k = 0; k < 3; k++)
+		scale[k] = maximum[k] > minimum[k] ? 1023.0f / (maximum[k] - minimum[k]) : 0.0f;
+
+	/* sort the vertices by Morton code, ties keep their old order */
+	keys = (unsigned long long*)malloc(sizeof(unsigned long long) *
+		(numvertices > numtriangles ? numvertices : numtriangles));
+	for (i = 1; i <= numvertices; i++) {
+		code = 0;
+		for (k = 0; k < 3; k++) {
+			GLfloat q = (model->vertices[3 * i + k] - minimum[k]) * scale[k];
+			code |= glmMortonSpread(q < 0.0f ? 0 : q > 1023.0f ? 1023 : (GLuint)q) << k;
+		}
+		keys[i - 1] = ((unsigned long long)code << 32) | i;
+	}
+	glmSortKeys(keys, numvertices);
+
+	remap = (GLuint*)malloc(sizeof(GLuint) * (numvertices + 1));
+	copies = (GLfloat*)malloc(sizeof(GLfloat) * 3 * (numvertices + 1));
+	remap[0] = 0;
+	for (i = 1; i <= numvertices; i++) {
+		v = (GLuint)keys[i - 1];
+		remap[v] = i;
+		memcpy(&copies[3 * i], &model->vertices[3 * v], 3 * sizeof(GLfloat));
+	}
+	free(model->vertices);
+	model->vertices = copies;
+
+	for (i = 0; i < numtriangles; i++) {
+		T(i).vindices[0] = remap[T(i).vindices[0]];
+		T(i).vindices[1] = remap[T(i).vindices[1]];
+		T(i).vindices[2] = remap[T(i).vindices[2]];
+	}
+	for (i = 0; i < model->numLines; i++) {
+		model->lines[i].vindices[0] = remap[model->lines[i].vindices[0]];
+		model->lines[i].vindices[1] = remap[model->lines[i].vindices[1]];
+	}
+	free(remap);
+
+	/* sort the triangles of each group by their lowest vertex index,
+	 * leaving every group's range where it is */
+	for (i = 0; i < numtriangles; i++) {
+		v = T(i).vindices[0];
+		if (T(i).vindices[1] < v) v = T(i).vindices[1];
+		if (T(i).vindices[2] < v) v = T(i).vindices[2];
+		keys[i] = ((unsigned long long)v << 32) | i;
+	}
+	for (group = model->groups; group; group = group->next)
+		glmSortKeys(keys + group->first, group->numtriangles);
+
+	triangles = (GLMtriangle*)malloc(sizeof(GLMtriangle) * (numtriangles + 1));
+	for (i = 0; i < numtriangles; i++)
+		triangles[i] = T((GLuint)keys[i]);
+	free(keys);
+	free(model->triangles);
+	model->triangles = triangles;
+
+	/* facet normals are one per triangle, so they follow the triangles */
+	if (model->facetnorms && model->numfacetnorms == numtriangles) {
+		copies = (GLfloat*)malloc(sizeof(GLfloat) * 3 * (numtriangles + 1));
+		for (i = 0; i < numtriangles; i++) {
+			memcpy(&copies[3 * (i + 1)], &model->facetnorms[3 * T(i).findex], 3 * sizeof(GLfloat));
+			T(i).findex = i + 1;
+		}
+		free(model->facetnorms);
+		model->facetnorms = copies;
+	}
+
+	glmReorderByUse(model, model->normals, model->numnormals, 3,
+		offsetof(GLMtriangle, nindices));
+	glmReorderByUse(model, model->texcoords, model->numtexcoords, 2,
+		offsetof(GLMtriangle, tindices));
+
+	/* lines in the order the triangles reach them */
+	if (model->lines && model->numLines) {
+		remap = (GLuint*)malloc(sizeof(GLuint) * model->numLines);
+		for (i = 0; i < model->numLines; i++)
+			remap[i] = (GLuint)-1;
+		lines = (GLMLine*)malloc(sizeof(GLMLine) * model->numLines);
+		k = 0;
+		for (i = 0; i < numtriangles; i++) {
+			for (j = 0; j < 3; j++) {
+				v = T(i).lindices[j];
+				if (v < model->numLines && remap[v] == (GLuint)-1) {
+					remap[v] = k;
+					lines[k++] = model->lines[v];
+				}
+				if (v < model->numLines)
+					T(i).lindices[j] = remap[v];
+			}
+		}
+		for (i = 0; i < model->numLines; i++) {
+			if (remap[i] == (GLuint)-1)
+				lines[k++] = model->lines[i];
+		}
+		free(model->lines);
+		model->lines = lines;
+		free(remap);
+	}
+}
+
 /* glmReadPPM: read a PPM raw (type P6) file.  The PPM file has a header
  * that should look something like:
  *
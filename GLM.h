@@ -42,16 +42,25 @@ typedef struct _GLMtriangle {
 	GLuint lindices[3];
 } GLMtriangle;
 
-/* GLMgroup: Structure that defines a group in a model.
+/* GLMgroup: Structure that defines a group in a model.  The
+* triangles of a group are the range [first, first + numtriangles) of
+* model->triangles; the loaders lay the groups out one after another in
+* list order, with groups sharing a material next to each other.
 */
 typedef struct _GLMgroup {
 	char*             name;           /* name of this group */
 	GLuint            numtriangles;   /* number of triangles in this group */
-	GLuint*           triangles;      /* array of triangle indices */
+	GLuint            first;          /* index of the group's first triangle */
 	GLuint            material;       /* index to material for group */
 	struct _GLMgroup* next;           /* pointer to next group in model */
 } GLMgroup;
 
+/* glmGroupTriangle: index into model->triangles of triangle i of a
+* group, for code written against the per-group triangles arrays
+* (group->triangles[i]) that groups used to hold.
+*/
+#define glmGroupTriangle(group, i) ((group)->first + (i))
+
 typedef struct _GLMLine {
 	GLuint vindices[2];
 	GLuint e1, e2;
@@ -92,6 +101,140 @@ typedef struct _GLMmodel {
 
 } GLMmodel;
 
+/* GLMrange: Structure that defines the vertices of one group in a
+* drawable.
+*/
+typedef struct _GLMrange {
+	GLuint first;                 /* first vertex of the range */
+	GLuint count;                 /* number of vertices in the range */
+	GLuint material;              /* index to material for range */
+} GLMrange;
+
+/* GLMdrawable: Structure that defines a model flattened into one
+* interleaved vertex array (normal, texcoord, position per vertex, as
+* selected by mode) with one range per group.  Built once from a
+* model; read only afterwards, so any number of threads can record
+* commands for it at the same time.
+*/
+typedef struct _GLMdrawable {
+	GLMmodel* model;              /* model the drawable was built from */
+	GLuint    mode;               /* render mode the arrays hold */
+	GLuint    numvertices;        /* number of vertices in arrays */
+	GLsizei   stride;             /* bytes per vertex */
+	GLfloat*  arrays;             /* interleaved vertex data */
+	GLuint    numranges;          /* number of ranges (groups) */
+	GLMrange* ranges;             /* array of ranges */
+	GLuint    buffer;             /* buffer object once uploaded, else 0 */
+} GLMdrawable;
+
+#define GLM_CMD_TRANSFORM  0      /* bind drawable, multiply in matrices[first] */
+#define GLM_CMD_MATERIAL   1      /* bind material first of the drawable */
+#define GLM_CMD_DRAW       2      /* draw count vertices from first */
+
+/* GLMcommand: Structure that defines one recorded draw command.
+*/
+typedef struct _GLMcommand {
+	GLuint       type;            /* GLM_CMD_* */
+	GLuint       first;           /* first vertex, material or matrix offset */
+	GLuint       count;           /* number of vertices */
+	GLMdrawable* drawable;        /* drawable the command refers to */
+} GLMcommand;
+
+/* GLMcommandlist: Structure that defines a list of recorded commands.
+* A list is filled by glmPrepare() on any thread and executed by
+* glmSubmit() on the GL thread.  Its storage only grows, so a list
+* that is reset and refilled every frame stops allocating.
+*/
+typedef struct _GLMcommandlist {
+	GLuint      numcommands;      /* number of recorded commands */
+	GLuint      maxcommands;      /* allocated commands */
+	GLMcommand* commands;         /* array of commands */
+	GLuint      nummatrices;      /* number of recorded matrices */
+	GLuint      maxmatrices;      /* allocated matrices */
+	GLfloat*    matrices;         /* array of 16 float matrices */
+} GLMcommandlist;
+
+/* GLMsplats: Structure that defines a model as a cloud of points, one
+* per vertex with an area weighted normal and the diffuse colour of
+* the first group using it.  The points are in random order, so the
+* first n of them are an even subsample of the whole model.
+*/
+typedef struct _GLMsplats {
+	GLMmodel* model;              /* model the splats were built from */
+	GLuint    numpoints;          /* number of points */
+	GLfloat*  arrays;             /* normal and position per point */
+	GLubyte*  colors;             /* RGBA per point */
+	GLfloat   spacing;            /* mean edge length of the mesh */
+	GLfloat   center[3];          /* bounding sphere of the points */
+	GLfloat   radius;
+	GLuint    buffer;             /* buffer object once uploaded, else 0 */
+} GLMsplats;
+
+/* GLMgltfview: Structure that defines a buffer view of a GLB file: a
+* byte range of the binary chunk that becomes one GL buffer object.
+*/
+typedef struct _GLMgltfview {
+	GLuint offset;                /* byte offset into the binary chunk */
+	GLuint length;                /* length in bytes */
+	GLenum target;                /* GL_ARRAY_BUFFER or GL_ELEMENT_ARRAY_BUFFER */
+	GLuint buffer;                /* GL buffer object, 0 until uploaded */
+} GLMgltfview;
+
+/* GLMgltfattrib: Structure that defines a vertex attribute or index
+* stream of a glTF primitive, in place inside a buffer view.
+*/
+typedef struct _GLMgltfattrib {
+	GLint     view;               /* buffer view index, -1 if absent */
+	GLuint    offset;             /* byte offset into the buffer view */
+	GLsizei   stride;             /* byte stride, 0 if tightly packed */
+	GLenum    type;               /* GL component type */
+	GLint     size;               /* components per element */
+	GLuint    count;              /* number of elements */
+} GLMgltfattrib;
+
+/* GLMgltfprimitive: Structure that defines one draw call of a glTF mesh.
+*/
+typedef struct _GLMgltfprimitive {
+	GLenum        mode;           /* GL primitive type */
+	GLMgltfattrib position;       /* POSITION (always present) */
+	GLMgltfattrib normal;         /* NORMAL */
+	GLMgltfattrib texcoord;       /* TEXCOORD_0 */
+	GLMgltfattrib indices;        /* indices, view -1 if not indexed */
+	GLuint        material;       /* index to material for primitive */
+} GLMgltfprimitive;
+
+/* GLMgltf: Structure that defines a model read from a binary glTF
+* (.glb) file.  The vertex and index data is never copied into client
+* arrays: it stays in the mapped file until glmUploadGLB() hands each
+* buffer view to the GL, after which the file is released.  Groups and
+* materials hold only the metadata (one group per mesh, counting its
+* triangles; first is 0).
+*/
+typedef struct _GLMgltf {
+	char*    pathname;            /* path to this model */
+
+	const GLubyte* data;          /* mapped file, NULL once uploaded */
+	size_t         size;          /* size of the mapped file */
+	const GLubyte* bin;           /* binary chunk inside data */
+	GLuint         binlength;     /* length of the binary chunk */
+
+	GLuint       numviews;        /* number of buffer views */
+	GLMgltfview* views;           /* array of buffer views */
+
+	GLuint            numprimitives; /* number of primitives */
+	GLMgltfprimitive* primitives;    /* array of primitives */
+
+	GLuint       nummaterials;    /* number of materials in model */
+	GLMmaterial* materials;       /* array of materials */
+
+	GLuint       numgroups;       /* number of groups (meshes) in model */
+	GLMgroup*    groups;          /* linked list of groups */
+
+	GLfloat min[3], max[3];       /* bounds of all POSITION accessors */
+	GLfloat position[3];          /* translation applied when drawing */
+	GLfloat scale;                /* scale applied when drawing */
+} GLMgltf;
+
 
 /* glmUnitize: "unitize" a model by translating it to the origin and
 * scaling it to fit in a unit cube around the origin.  Returns the
@@ -198,6 +341,118 @@ glmDelete(GLMmodel* model);
 GLMmodel*
 glmReadOBJ(char* filename);
 
+/* glmReadPLY: Reads a model from a binary (little- or big-endian) .PLY
+* file.  The file is memory mapped and converted in bulk; vertex
+* normals (nx, ny, nz) and texcoords (s, t / u, v) are read when
+* present.  Returns a pointer to the created object which should be
+* free'd with glmDelete(), or NULL if the file can't be read.
+*
+* filename - name of the file containing the binary PLY data.
+*/
+GLMmodel*
+glmReadPLY(char* filename);
+
+/* glmReadSTL: Reads a model from a binary .STL file.  The file is
+* memory mapped, vertices shared between facets are merged through a
+* hash table and the stored facet normals become the model's facet
+* normals.  Returns a pointer to the created object which should be
+* free'd with glmDelete(), or NULL if the file can't be read.
+*
+* filename - name of the file containing the binary STL data.
+*/
+GLMmodel*
+glmReadSTL(char* filename);
+
+/* glmReadModel: Reads a model, choosing glmReadPLY(), glmReadSTL() or
+* glmReadOBJ() from the file extension.
+*
+* filename - name of the model file.
+*/
+GLMmodel*
+glmReadModel(char* filename);
+
+/* glmWriteOBJIndex: Writes a sidecar index of a Wavefront .OBJ file
+* for glmReadOBJGroups(): each group's name, material, triangle count
+* and the byte ranges of its faces, and the file offset of every 64th
+* vertex, normal and texcoord.  Build it once per version of the file;
+* it records the file's size and write time and is refused if either
+* has changed.  Returns GL_FALSE if either file can't be opened.
+*
+* filename  - name of the .OBJ file.
+* indexname - name of the index file to write.
+*/
+GLboolean
+glmWriteOBJIndex(char* filename, char* indexname);
+
+/* glmReadOBJGroups: Reads only the named groups of a Wavefront .OBJ
+* file, through its index.  Both files are memory mapped; just the
+* groups' faces and the vertices, normals and texcoords they use are
+* parsed, and the model holds only those, renumbered.  Memory and load
+* time follow the groups read rather than the file.  Group names are
+* matched without the surrounding white space (glmReadOBJ() keeps the
+* space after "g").  Returns a pointer to the created object which
+* should be free'd with glmDelete(), or NULL if either file can't be
+* read, the index is not for this version of the file, or a name is not
+* a group in it.
+*
+* filename  - name of the .OBJ file.
+* indexname - name of its index, from glmWriteOBJIndex().
+* names     - names of the groups to read.
+* numnames  - number of names.
+*/
+GLMmodel*
+glmReadOBJGroups(char* filename, char* indexname, char** names, GLuint numnames);
+
+/* glmReadGLB: Reads a model from a binary glTF 2.0 (.glb) file.  The
+* file is memory mapped and every accessor used by a mesh primitive is
+* checked against its buffer view and the binary chunk; of the data
+* itself only the indices are read, to check them against the vertex
+* count.  Returns a pointer to the created object which should be
+* free'd with glmDeleteGLB(), or NULL if the file can't be read or
+* doesn't validate.  glmReadModel() does not read .glb files, as a
+* GLMgltf is not a GLMmodel.
+*
+* filename - name of the .glb file.
+*/
+GLMgltf*
+glmReadGLB(char* filename);
+
+/* glmUploadGLB: Creates one GL buffer object per buffer view straight
+* from the mapped binary chunk, then releases the file.  Needs a
+* current context.  Returns GL_FALSE if buffer objects aren't
+* available; the model then stays mapped and glmDrawGLB() draws from
+* client memory.
+*
+* gltf - model returned by glmReadGLB()
+*/
+GLboolean
+glmUploadGLB(GLMgltf* gltf);
+
+/* glmUnitizeGLB: sets the draw transform of a GLB model so it is
+* centered on the origin and fits in a unit cube (see glmUnitize()).
+* Returns the scalefactor used.
+*
+* gltf - model returned by glmReadGLB()
+*/
+GLfloat
+glmUnitizeGLB(GLMgltf* gltf);
+
+/* glmDrawGLB: Renders a GLB model to the current OpenGL context.
+*
+* gltf - model returned by glmReadGLB()
+* mode - a bitwise OR of GLM_SMOOTH, GLM_TEXTURE, GLM_COLOR and
+*        GLM_MATERIAL, as for glmDraw()
+*/
+GLvoid
+glmDrawGLB(GLMgltf* gltf, GLuint mode);
+
+/* glmDeleteGLB: Deletes a GLMgltf structure and its buffer objects.
+*
+* gltf - model returned by glmReadGLB()
+*/
+GLvoid
+glmDeleteGLB(GLMgltf* gltf);
+
 /* glmWriteOBJ: Writes a model description in Wavefront .OBJ format to
 * a file.
 *
@@ -241,6 +496,123 @@ glmDraw(GLMmodel* model, GLuint mode);
 GLuint
 glmList(GLMmodel* model, GLuint mode);
 
+/* glmBuildDrawable: Flattens a model into an interleaved vertex array
+* for the mode specified (GLM_FLAT or GLM_SMOOTH normals, GLM_TEXTURE,
+* GLM_COLOR or GLM_MATERIAL).  Makes no GL calls.  Returns a pointer
+* that should be free'd with glmDeleteDrawable().  The model must
+* outlive the drawable.
+*
+* model    - initialized GLMmodel structure
+* mode     - a bitwise OR of values describing what is to be rendered.
+*/
+GLMdrawable*
+glmBuildDrawable(GLMmodel* model, GLuint mode);
+
+/* glmUploadDrawable: Copies a drawable's arrays into a buffer object.
+* Optional; needs a current context.
+*
+* drawable - drawable returned by glmBuildDrawable()
+*/
+GLvoid
+glmUploadDrawable(GLMdrawable* drawable);
+
+/* glmDeleteDrawable: Deletes a drawable and its buffer object.
+*
+* drawable - drawable returned by glmBuildDrawable()
+*/
+GLvoid
+glmDeleteDrawable(GLMdrawable* drawable);
+
+/* glmInitCommands / glmResetCommands / glmFreeCommands: set up an
+* empty command list, empty it for reuse and release its storage.
+*
+* list     - command list
+*/
+GLvoid
+glmInitCommands(GLMcommandlist* list);
+GLvoid
+glmResetCommands(GLMcommandlist* list);
+GLvoid
+glmFreeCommands(GLMcommandlist* list);
+
+/* glmReserveCommands: grow a command list ahead of time so that
+* recording into it does not allocate.
+*
+* list      - command list
+* commands  - number of commands to make room for
+* matrices  - number of transforms to make room for
+*/
+GLvoid
+glmReserveCommands(GLMcommandlist* list, GLuint commands, GLuint matrices);
+
+/* glmCountCommands: number of commands glmPrepare() records for a
+* drawable (one of them the transform).
+*
+* drawable - drawable returned by glmBuildDrawable()
+*/
+GLuint
+glmCountCommands(GLMdrawable* drawable);
+
+/* glmPrepare: Records the commands that draw a drawable with the
+* given transform (column major, as for glMultMatrixf, NULL for none)
+* into a command list.  Reentrant and free of GL calls, so it can run
+* on worker threads, one list per thread.
+*
+* drawable  - drawable returned by glmBuildDrawable()
+* transform - array of 16 GLfloats, or NULL
+* list      - command list to append to
+*/
+GLvoid
+glmPrepare(GLMdrawable* drawable, const GLfloat* transform, GLMcommandlist* list);
+
+/* glmSubmit: Executes a command list on the current context.  Each
+* transform is applied on top of the modelview matrix current at the
+* time of the call, which is restored afterwards.
+*
+* list     - command list filled by glmPrepare()
+*/
+GLvoid
+glmSubmit(GLMcommandlist* list);
+
+/* glmBuildSplats: Builds a point cloud of a model's vertices for
+* glmDrawSplats().  Makes no GL calls.  Returns a pointer that should
+* be free'd with glmDeleteSplats().  Unused vertices are left out.
+*
+* model    - initialized GLMmodel structure
+*/
+GLMsplats*
+glmBuildSplats(GLMmodel* model);
+
+/* glmUploadSplats: Copies the points into a buffer object.  Optional;
+* needs a current context.
+*
+* splats   - splats returned by glmBuildSplats()
+*/
+GLvoid
+glmUploadSplats(GLMsplats* splats);
+
+/* glmDrawSplats: Draws the first count points, lit, as squares sized
+* to cover the surface: the spacing of the mesh, grown by the square
+* root of the fraction of points left out.  With point parameters
+* (OpenGL 1.4) each point is sized by its own eye distance, otherwise
+* all of them by distance.
+*
+* splats   - splats returned by glmBuildSplats()
+* count    - number of points to draw, at most splats->numpoints
+* scale    - pixels one unit covers at unit eye distance
+*            (projection[5] * viewport height / 2)
+* distance - eye distance of the model
+*/
+GLvoid
+glmDrawSplats(GLMsplats* splats, GLuint count, GLfloat scale, GLfloat distance);
+
+/* glmDeleteSplats: Deletes splats and their buffer object.
+*
+* splats   - splats returned by glmBuildSplats()
+*/
+GLvoid
+glmDeleteSplats(GLMsplats* splats);
+
 /* glmWeld: eliminate (weld) vectors that are within an epsilon of
 * each other.
 *
@@ -252,6 +624,18 @@ glmList(GLMmodel* model, GLuint mode);
 GLvoid
 glmWeld(GLMmodel* model, GLfloat epsilon);
 
+/* glmReorder: reorder a model for memory locality.  Vertices are
+* sorted along a Morton (Z-order) curve, triangles by their lowest
+* vertex within each group, and normals, texcoords, facet normals and lines in the order
+* the triangles use them.  All index arrays are remapped, so the model
+* is unchanged apart from its memory layout.  Call once after loading,
+* before the normal/weld passes.
+*
+* model      - initialized GLMmodel structure
+*/
+GLvoid
+glmReorder(GLMmodel* model);
+
 /* glmReadPPM: read a PPM raw (type P6) file.  The PPM file has a header
 * that should look something like:
 *
@@ -0,0 +1,400 @@
+/*
+	  GLMExt.cpp
+
+	  Runtime lookup of the OpenGL entry points newer than 1.1.
+
+	  */
+
+#ifdef _WIN32
+#include <windows.h>
+#elif defined(__APPLE__)
+#include <OpenGL/OpenGL.h>
+#else
+#include <GL/glx.h>
+#endif
+#include <stdio.h>
+#include <string.h>
+#include "GLMExt.h"
+
+
+GLMPFNGENBUFFERS    glmextGenBuffers = NULL;
+GLMPFNDELETEBUFFERS glmextDeleteBuffers = NULL;
+GLMPFNBINDBUFFER    glmextBindBuffer = NULL;
+GLMPFNBUFFERDATA    glmextBufferData = NULL;
+GLMPFNBUFFERSUBDATA glmextBufferSubData = NULL;
+GLMPFNGENQUERIES          glmextGenQueries = NULL;
+GLMPFNDELETEQUERIES       glmextDeleteQueries = NULL;
+GLMPFNBEGINQUERY          glmextBeginQuery = NULL;
+GLMPFNENDQUERY            glmextEndQuery = NULL;
+GLMPFNGETQUERYOBJECTIV    glmextGetQueryObjectiv = NULL;
+GLMPFNGETQUERYOBJECTUI64V glmextGetQueryObjectui64v = NULL;
+GLMPFNQUERYCOUNTER        glmextQueryCounter = NULL;
+GLMPFNGETINTEGER64V       glmextGetInteger64v = NULL;
+GLMPFNFENCESYNC           glmextFenceSync = NULL;
+GLMPFNCLIENTWAITSYNC      glmextClientWaitSync = NULL;
+GLMPFNDELETESYNC          glmextDeleteSync = NULL;
+GLMPFNPOINTPARAMETERF         glmextPointParameterf = NULL;
+GLMPFNPOINTPARAMETERFV        glmextPointParameterfv = NULL;
+GLMPFNGENFRAMEBUFFERS         glmextGenFramebuffers = NULL;
+GLMPFNDELETEFRAMEBUFFERS      glmextDeleteFramebuffers = NULL;
+GLMPFNBINDFRAMEBUFFER         glmextBindFramebuffer = NULL;
+GLMPFNFRAMEBUFFERTEXTURE2D    glmextFramebufferTexture2D = NULL;
+GLMPFNCHECKFRAMEBUFFERSTATUS  glmextCheckFramebufferStatus = NULL;
+GLMPFNGENRENDERBUFFERS        glmextGenRenderbuffers = NULL;
+GLMPFNDELETERENDERBUFFERS     glmextDeleteRenderbuffers = NULL;
+GLMPFNBINDRENDERBUFFER        glmextBindRenderbuffer = NULL;
+GLMPFNRENDERBUFFERSTORAGE     glmextRenderbufferStorage = NULL;
+GLMPFNFRAMEBUFFERRENDERBUFFER glmextFramebufferRenderbuffer = NULL;
+GLMPFNGENERATEMIPMAP          glmextGenerateMipmap = NULL;
+GLMPFNCREATESHADER            glmextCreateShader = NULL;
+GLMPFNSHADERSOURCE            glmextShaderSource = NULL;
+GLMPFNCOMPILESHADER           glmextCompileShader = NULL;
+GLMPFNGETSHADERIV             glmextGetShaderiv = NULL;
+GLMPFNGETSHADERINFOLOG        glmextGetShaderInfoLog = NULL;
+GLMPFNDELETESHADER            glmextDeleteShader = NULL;
+GLMPFNCREATEPROGRAM           glmextCreateProgram = NULL;
+GLMPFNATTACHSHADER            glmextAttachShader = NULL;
+GLMPFNLINKPROGRAM             glmextLinkProgram = NULL;
+GLMPFNGETPROGRAMIV            glmextGetProgramiv = NULL;
+GLMPFNGETPROGRAMINFOLOG       glmextGetProgramInfoLog = NULL;
+GLMPFNDELETEPROGRAM           glmextDeleteProgram = NULL;
+GLMPFNUSEPROGRAM              glmextUseProgram = NULL;
+GLMPFNGETUNIFORMLOCATION      glmextGetUniformLocation = NULL;
+GLMPFNUNIFORM1I               glmextUniform1i = NULL;
+GLMPFNUNIFORM1F               glmextUniform1f = NULL;
+GLMPFNUNIFORM2F               glmextUniform2f = NULL;
+GLMPFNUNIFORM1FV              glmextUniform1fv = NULL;
+GLMPFNACTIVETEXTURE           glmextActiveTexture = NULL;
+
+static GLint glmextTimers = GLM_TIMER_NONE;
+
+
+/* glmExtProc: find an entry point, trying the core name first and the
+ * ARB suffixed one after that.
+ */
+static void*
+glmExtProc(const char* name, const char* arbname)
+{
+	void* proc;
+
+#if defined(_WIN32)
+	proc = (void*)wglGetProcAddress(name);
+	if (!proc && arbname)
+		proc = (void*)wglGetProcAddress(arbname);
+#elif defined(__APPLE__)
+	proc = NULL;   /* resolved at link time, see glmExtInit() */
+#else
+	proc = (void*)glXGetProcAddressARB((const GLubyte*)name);
+	if (!proc && arbname)
+		proc = (void*)glXGetProcAddressARB((const GLubyte*)arbname);
+#endif
+
+	return proc;
+}
+
+/* glmExtSupported: whether the current context is at least the given
+ * OpenGL version (major 0 to skip) or lists the given extension.
+ * glXGetProcAddressARB() returns an address for any name, so a non
+ * NULL entry point alone says nothing.
+ */
+static GLboolean
+glmExtInList(const char* extensions, const char* extension)
+{
+	const char* p;
+	size_t len;
+
+	if (!extensions || !extension)
+		return GL_FALSE;
+	len = strlen(extension);
+	for (p = extensions; (p = strstr(p, extension)) != NULL; p += len) {
+		if ((p == extensions || p[-1] == ' ') && (p[len] == ' ' || p[len] == '\0'))
+			return GL_TRUE;
+	}
+	return GL_FALSE;
+}
+
+static GLboolean
+glmExtSupported(int major, int minor, const char* extension)
+{
+	const char* version = (const char*)glGetString(GL_VERSION);
+	int maj, min;
+
+	if (major && version && sscanf(version, "%d.%d", &maj, &min) == 2 &&
+		(maj > major || (maj == major && min >= minor)))
+		return GL_TRUE;
+	return glmExtInList((const char*)glGetString(GL_EXTENSIONS), extension);
+}
+
+#if !defined(__APPLE__)
+/* glmExtProcSuffixed: find name with the given suffix appended */
+static void*
+glmExtProcSuffixed(const char* name, const char* suffix)
+{
+	char buf[64];
+
+	sprintf(buf, "%s%s", name, suffix);   /* names are known and short */
+	return glmExtProc(buf, NULL);
+}
+#endif
+
+GLboolean
+glmExtInit(GLvoid)
+{
+	static GLboolean initialized = GL_FALSE;
+#if !defined(__APPLE__)
+	const char* fbo = NULL;
+#endif
+
+	if (initialized)
+		return glmExtHasBuffers();
+
+#if defined(__APPLE__)
+	glmextGenBuffers = (GLMPFNGENBUFFERS)glGenBuffers;
+	glmextDeleteBuffers = (GLMPFNDELETEBUFFERS)glDeleteBuffers;
+	glmextBindBuffer = (GLMPFNBINDBUFFER)glBindBuffer;
+	glmextBufferData = (GLMPFNBUFFERDATA)glBufferData;
+	glmextBufferSubData = (GLMPFNBUFFERSUBDATA)glBufferSubData;
+	glmextPointParameterf = (GLMPFNPOINTPARAMETERF)glPointParameterf;
+	glmextPointParameterfv = (GLMPFNPOINTPARAMETERFV)glPointParameterfv;
+	if (glmExtSupported(0, 0, "GL_EXT_timer_query")) {
+		glmextGenQueries = (GLMPFNGENQUERIES)glGenQueries;
+		glmextDeleteQueries = (GLMPFNDELETEQUERIES)glDeleteQueries;
+		glmextBeginQuery = (GLMPFNBEGINQUERY)glBeginQuery;
+		glmextEndQuery = (GLMPFNENDQUERY)glEndQuery;
+		glmextGetQueryObjectiv = (GLMPFNGETQUERYOBJECTIV)glGetQueryObjectiv;
+		glmextGetQueryObjectui64v = (GLMPFNGETQUERYOBJECTUI64V)glGetQueryObjectui64vEXT;
+		glmextTimers = GLM_TIMER_ELAPSED;
+	}
+	/* no sync objects: GLUT only creates legacy contexts, and those stop
+	 * at OpenGL 2.1 */
+	if (glmExtSupported(0, 0, "GL_EXT_framebuffer_object")) {
+		glmextGenFramebuffers = (GLMPFNGENFRAMEBUFFERS)glGenFramebuffersEXT;
+		glmextDeleteFramebuffers = (GLMPFNDELETEFRAMEBUFFERS)glDeleteFramebuffersEXT;
+		glmextBindFramebuffer = (GLMPFNBINDFRAMEBUFFER)glBindFramebufferEXT;
+		glmextFramebufferTexture2D = (GLMPFNFRAMEBUFFERTEXTURE2D)glFramebufferTexture2DEXT;
+		glmextCheckFramebufferStatus = (GLMPFNCHECKFRAMEBUFFERSTATUS)glCheckFramebufferStatusEXT;
+		glmextGenRenderbuffers = (GLMPFNGENRENDERBUFFERS)glGenRenderbuffersEXT;
+		glmextDeleteRenderbuffers = (GLMPFNDELETERENDERBUFFERS)glDeleteRenderbuffersEXT;
+		glmextBindRenderbuffer = (GLMPFNBINDRENDERBUFFER)glBindRenderbufferEXT;
+		glmextRenderbufferStorage = (GLMPFNRENDERBUFFERSTORAGE)glRenderbufferStorageEXT;
+		glmextFramebufferRenderbuffer = (GLMPFNFRAMEBUFFERRENDERBUFFER)glFramebufferRenderbufferEXT;
+		glmextGenerateMipmap = (GLMPFNGENERATEMIPMAP)glGenerateMipmapEXT;
+	}
+	if (glmExtSupported(2, 0, NULL)) {
+		glmextCreateShader = (GLMPFNCREATESHADER)glCreateShader;
+		glmextShaderSource = (GLMPFNSHADERSOURCE)glShaderSource;
+		glmextCompileShader = (GLMPFNCOMPILESHADER)glCompileShader;
+		glmextGetShaderiv = (GLMPFNGETSHADERIV)glGetShaderiv;
+		glmextGetShaderInfoLog = (GLMPFNGETSHADERINFOLOG)glGetShaderInfoLog;
+		glmextDeleteShader = (GLMPFNDELETESHADER)glDeleteShader;
+		glmextCreateProgram = (GLMPFNCREATEPROGRAM)glCreateProgram;
+		glmextAttachShader = (GLMPFNATTACHSHADER)glAttachShader;
+		glmextLinkProgram = (GLMPFNLINKPROGRAM)glLinkProgram;
+		glmextGetProgramiv = (GLMPFNGETPROGRAMIV)glGetProgramiv;
+		glmextGetProgramInfoLog = (GLMPFNGETPROGRAMINFOLOG)glGetProgramInfoLog;
+		glmextDeleteProgram = (GLMPFNDELETEPROGRAM)glDeleteProgram;
+		glmextUseProgram = (GLMPFNUSEPROGRAM)glUseProgram;
+		glmextGetUniformLocation = (GLMPFNGETUNIFORMLOCATION)glGetUniformLocation;
+		glmextUniform1i = (GLMPFNUNIFORM1I)glUniform1i;
+		glmextUniform1f = (GLMPFNUNIFORM1F)glUniform1f;
+		glmextUniform2f = (GLMPFNUNIFORM2F)glUniform2f;
+		glmextUniform1fv = (GLMPFNUNIFORM1FV)glUniform1fv;
+		glmextActiveTexture = (GLMPFNACTIVETEXTURE)glActiveTexture;
+	}
+#else
+	glmextGenBuffers = (GLMPFNGENBUFFERS)glmExtProc("glGenBuffers", "glGenBuffersARB");
+	glmextDeleteBuffers = (GLMPFNDELETEBUFFERS)glmExtProc("glDeleteBuffers", "glDeleteBuffersARB");
+	glmextBindBuffer = (GLMPFNBINDBUFFER)glmExtProc("glBindBuffer", "glBindBufferARB");
+	glmextBufferData = (GLMPFNBUFFERDATA)glmExtProc("glBufferData", "glBufferDataARB");
+	glmextBufferSubData = (GLMPFNBUFFERSUBDATA)glmExtProc("glBufferSubData", "glBufferSubDataARB");
+	if (glmExtSupported(1, 4, "GL_ARB_point_parameters")) {
+		glmextPointParameterf = (GLMPFNPOINTPARAMETERF)glmExtProc("glPointParameterf", "glPointParameterfARB");
+		glmextPointParameterfv = (GLMPFNPOINTPARAMETERFV)glmExtProc("glPointParameterfv", "glPointParameterfvARB");
+	}
+
+	/* timestamps need 3.3 or ARB_timer_query, elapsed time alone makes
+	 * do with EXT_timer_query on top of 1.5 queries */
+	if (glmExtSupported(3, 3, "GL_ARB_timer_query"))
+		glmextTimers = GLM_TIMER_TIMESTAMP;
+	else if (glmExtSupported(0, 0, "GL_EXT_timer_query"))
+		glmextTimers = GLM_TIMER_ELAPSED;
+	if (glmextTimers != GLM_TIMER_NONE) {
+		glmextGenQueries = (GLMPFNGENQUERIES)glmExtProc("glGenQueries", "glGenQueriesARB");
+		glmextDeleteQueries = (GLMPFNDELETEQUERIES)glmExtProc("glDeleteQueries", "glDeleteQueriesARB");
+		glmextBeginQuery = (GLMPFNBEGINQUERY)glmExtProc("glBeginQuery", "glBeginQueryARB");
+		glmextEndQuery = (GLMPFNENDQUERY)glmExtProc("glEndQuery", "glEndQueryARB");
+		glmextGetQueryObjectiv = (GLMPFNGETQUERYOBJECTIV)glmExtProc("glGetQueryObjectiv", "glGetQueryObjectivARB");
+		glmextGetQueryObjectui64v = (GLMPFNGETQUERYOBJECTUI64V)glmExtProc("glGetQueryObjectui64v", "glGetQueryObjectui64vEXT");
+		if (glmextTimers == GLM_TIMER_TIMESTAMP)
+			glmextQueryCounter = (GLMPFNQUERYCOUNTER)glmExtProc("glQueryCounter", NULL);
+		if (!glmextGenQueries || !glmextDeleteQueries || !glmextBeginQuery || !glmextEndQuery ||
+			!glmextGetQueryObjectiv || !glmextGetQueryObjectui64v)
+			glmextTimers = GLM_TIMER_NONE;
+		else if (glmextTimers == GLM_TIMER_TIMESTAMP && !glmextQueryCounter)
+			glmextTimers = GLM_TIMER_ELAPSED;
+		if (glmextTimers == GLM_TIMER_TIMESTAMP) {
+			glmextGetInteger64v = (GLMPFNGETINTEGER64V)glmExtProc("glGetInteger64v", NULL);
+			if (!glmextGetInteger64v)
+				glmextTimers = GLM_TIMER_ELAPSED;
+		}
+	}
+
+	if (glmExtSupported(3, 2, "GL_ARB_sync")) {
+		glmextFenceSync = (GLMPFNFENCESYNC)glmExtProc("glFenceSync", NULL);
+		glmextClientWaitSync = (GLMPFNCLIENTWAITSYNC)glmExtProc("glClientWaitSync", NULL);
+		glmextDeleteSync = (GLMPFNDELETESYNC)glmExtProc("glDeleteSync", NULL);
+	}
+
+	/* the EXT entry points carry the suffix, the ARB ones do not */
+	if (glmExtSupported(3, 0, "GL_ARB_framebuffer_object"))
+		fbo = "";
+	else if (glmExtSupported(0, 0, "GL_EXT_framebuffer_object"))
+		fbo = "EXT";
+	if (fbo) {
+		glmextGenFramebuffers = (GLMPFNGENFRAMEBUFFERS)glmExtProcSuffixed("glGenFramebuffers", fbo);
+		glmextDeleteFramebuffers = (GLMPFNDELETEFRAMEBUFFERS)glmExtProcSuffixed("glDeleteFramebuffers", fbo);
+		glmextBindFramebuffer = (GLMPFNBINDFRAMEBUFFER)glmExtProcSuffixed("glBindFramebuffer", fbo);
+		glmextFramebufferTexture2D = (GLMPFNFRAMEBUFFERTEXTURE2D)glmExtProcSuffixed("glFramebufferTexture2D", fbo);
+		glmextCheckFramebufferStatus = (GLMPFNCHECKFRAMEBUFFERSTATUS)glmExtProcSuffixed("glCheckFramebufferStatus", fbo);
+		glmextGenRenderbuffers = (GLMPFNGENRENDERBUFFERS)glmExtProcSuffixed("glGenRenderbuffers", fbo);
+		glmextDeleteRenderbuffers = (GLMPFNDELETERENDERBUFFERS)glmExtProcSuffixed("glDeleteRenderbuffers", fbo);
+		glmextBindRenderbuffer = (GLMPFNBINDRENDERBUFFER)glmExtProcSuffixed("glBindRenderbuffer", fbo);
+		glmextRenderbufferStorage = (GLMPFNRENDERBUFFERSTORAGE)glmExtProcSuffixed("glRenderbufferStorage", fbo);
+		glmextFramebufferRenderbuffer = (GLMPFNFRAMEBUFFERRENDERBUFFER)glmExtProcSuffixed("glFramebufferRenderbuffer", fbo);
+		glmextGenerateMipmap = (GLMPFNGENERATEMIPMAP)glmExtProcSuffixed("glGenerateMipmap", fbo);
+	}
+
+	/* core names only: the ARB_shader_objects entry points take handles,
+	 * not GLuint names */
+	if (glmExtSupported(2, 0, NULL)) {
+		glmextCreateShader = (GLMPFNCREATESHADER)glmExtProc("glCreateShader", NULL);
+		glmextShaderSource = (GLMPFNSHADERSOURCE)glmExtProc("glShaderSource", NULL);
+		glmextCompileShader = (GLMPFNCOMPILESHADER)glmExtProc("glCompileShader", NULL);
+		glmextGetShaderiv = (GLMPFNGETSHADERIV)glmExtProc("glGetShaderiv", NULL);
+		glmextGetShaderInfoLog = (GLMPFNGETSHADERINFOLOG)glmExtProc("glGetShaderInfoLog", NULL);
+		glmextDeleteShader = (GLMPFNDELETESHADER)glmExtProc("glDeleteShader", NULL);
+		glmextCreateProgram = (GLMPFNCREATEPROGRAM)glmExtProc("glCreateProgram", NULL);
+		glmextAttachShader = (GLMPFNATTACHSHADER)glmExtProc("glAttachShader", NULL);
+		glmextLinkProgram = (GLMPFNLINKPROGRAM)glmExtProc("glLinkProgram", NULL);
+		glmextGetProgramiv = (GLMPFNGETPROGRAMIV)glmExtProc("glGetProgramiv", NULL);
+		glmextGetProgramInfoLog = (GLMPFNGETPROGRAMINFOLOG)glmExtProc("glGetProgramInfoLog", NULL);
+		glmextDeleteProgram = (GLMPFNDELETEPROGRAM)glmExtProc("glDeleteProgram", NULL);
+		glmextUseProgram = (GLMPFNUSEPROGRAM)glmExtProc("glUseProgram", NULL);
+		glmextGetUniformLocation = (GLMPFNGETUNIFORMLOCATION)glmExtProc("glGetUniformLocation", NULL);
+		glmextUniform1i = (GLMPFNUNIFORM1I)glmExtProc("glUniform1i", NULL);
+		glmextUniform1f = (GLMPFNUNIFORM1F)glmExtProc("glUniform1f", NULL);
+		glmextUniform2f = (GLMPFNUNIFORM2F)glmExtProc("glUniform2f", NULL);
+		glmextUniform1fv = (GLMPFNUNIFORM1FV)glmExtProc("glUniform1fv", NULL);
+		glmextActiveTexture = (GLMPFNACTIVETEXTURE)glmExtProc("glActiveTexture", "glActiveTextureARB");
+	}
+#endif
+
+	initialized = GL_TRUE;
+	return glmExtHasBuffers();
+}
+
+GLboolean
+glmExtHasBuffers(GLvoid)
+{
+	return glmextGenBuffers && glmextDeleteBuffers && glmextBindBuffer &&
+		glmextBufferData && glmextBufferSubData;
+}
+
+GLint
+glmExtHasTimers(GLvoid)
+{
+	return glmextTimers;
+}
+
+GLboolean
+glmExtHasSync(GLvoid)
+{
+	return glmextFenceSync && glmextClientWaitSync && glmextDeleteSync;
+}
+
+GLboolean
+glmExtHasPointParameters(GLvoid)
+{
+	return glmextPointParameterf && glmextPointParameterfv;
+}
+
+GLboolean
+glmExtHasFramebuffers(GLvoid)
+{
+	return glmextGenFramebuffers && glmextDeleteFramebuffers && glmextBindFramebuffer &&
+		glmextFramebufferTexture2D && glmextCheckFramebufferStatus &&
+		glmextGenRenderbuffers && glmextDeleteRenderbuffers && glmextBindRenderbuffer &&
+		glmextRenderbufferStorage && glmextFramebufferRenderbuffer && glmextGenerateMipmap;
+}
+
+GLboolean
+glmExtHasShaders(GLvoid)
+{
+	return glmextCreateShader && glmextShaderSource && glmextCompileShader &&
+		glmextGetShaderiv && glmextGetShaderInfoLog && glmextDeleteShader &&
+		glmextCreateProgram && glmextAttachShader && glmextLinkProgram &&
+		glmextGetProgramiv && glmextGetProgramInfoLog && glmextDeleteProgram &&
+		glmextUseProgram && glmextGetUniformLocation && glmextUniform1i &&
+		glmextUniform1f && glmextUniform2f && glmextUniform1fv && glmextActiveTexture;
+}
+
+GLboolean
+glmExtSwapInterval(GLint interval)
+{
+#if defined(_WIN32)
+	typedef BOOL (WINAPI *SWAPINTERVAL)(int interval);
+	typedef const char* (WINAPI *EXTENSIONSSTRING)(void);
+	SWAPINTERVAL swapInterval;
+	EXTENSIONSSTRING extensionsString;
+	const char* extensions;
+
+	extensionsString = (EXTENSIONSSTRING)wglGetProcAddress("wglGetExtensionsStringEXT");
+	extensions = extensionsString ? extensionsString() : NULL;
+	if (!glmExtInList(extensions, "WGL_EXT_swap_control"))
+		return GL_FALSE;
+	if (interval < 0 && !glmExtInList(extensions, "WGL_EXT_swap_control_tear"))
+		return GL_FALSE;
+	swapInterval = (SWAPINTERVAL)wglGetProcAddress("wglSwapIntervalEXT");
+	return swapInterval && swapInterval(interval) ? GL_TRUE : GL_FALSE;
+#elif defined(__APPLE__)
+	GLint value = interval;
+
+	if (interval < 0)
+		return GL_FALSE;   /* no adaptive vsync in CGL */
+	return CGLSetParameter(CGLGetCurrentContext(), kCGLCPSwapInterval, &value) == kCGLNoError ? GL_TRUE : GL_FALSE;
+#else
+	typedef void (*SWAPINTERVALEXT)(Display* dpy, GLXDrawable drawable, int interval);
+	typedef int (*SWAPINTERVALMESA)(unsigned int interval);
+	typedef int (*SWAPINTERVALSGI)(int interval);
+	Display* dpy = glXGetCurrentDisplay();
+	GLXDrawable drawable = glXGetCurrentDrawable();
+	const char* extensions;
+	SWAPINTERVALEXT swapIntervalEXT;
+	SWAPINTERVALMESA swapIntervalMESA;
+	SWAPINTERVALSGI swapIntervalSGI;
+
+	if (!dpy || !drawable)
+		return GL_FALSE;
+	extensions = glXQueryExtensionsString(dpy, DefaultScreen(dpy));
+	if (glmExtInList(extensions, "GLX_EXT_swap_control")) {
+		if (interval < 0 && !glmExtInList(extensions, "GLX_EXT_swap_control_tear"))
+			return GL_FALSE;
+		swapIntervalEXT = (SWAPINTERVALEXT)glXGetProcAddressARB((const GLubyte*)"glXSwapIntervalEXT");
+		if (!swapIntervalEXT)
+			return GL_FALSE;
+		swapIntervalEXT(dpy, drawable, interval);
+		return GL_TRUE;
+	}
+	if (interval < 0)
+		return GL_FALSE;
+	if (glmExtInList(extensions, "GLX_MESA_swap_control")) {
+		swapIntervalMESA = (SWAPINTERVALMESA)glXGetProcAddressARB((const GLubyte*)"glXSwapIntervalMESA");
+		return swapIntervalMESA && swapIntervalMESA(interval) == 0 ? GL_TRUE : GL_FALSE;
+	}
+	if (interval > 0 && glmExtInList(extensions, "GLX_SGI_swap_control")) {
+		swapIntervalSGI = (SWAPINTERVALSGI)glXGetProcAddressARB((const GLubyte*)"glXSwapIntervalSGI");
+		return swapIntervalSGI && swapIntervalSGI(interval) == 0 ? GL_TRUE : GL_FALSE;
+	}
+	return GL_FALSE;
+#endif
+}
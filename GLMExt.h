@@ -0,0 +1,253 @@
+#ifndef _GLMEXT_
+#define _GLMEXT_
+#if defined(__APPLE__) || defined(MACOSX)
+#include <GLUT/glut.h>
+#else
+#include <GL/glut.h>
+#endif
+#include <stddef.h>
+
+/* GLMext: the OpenGL entry points above 1.1 used by the GLM library
+* and the sample.  Windows only exports OpenGL 1.1 from opengl32.dll,
+* so everything newer is looked up at runtime once a context is
+* current.  Call glmExtInit() after the window has been created.
+*/
+
+#ifndef APIENTRY
+#define APIENTRY
+#endif
+
+#ifndef GL_QUERY_RESULT
+#define GL_QUERY_RESULT              0x8866
+#define GL_QUERY_RESULT_AVAILABLE    0x8867
+#endif
+#ifndef GL_TIME_ELAPSED
+#define GL_TIME_ELAPSED              0x88BF
+#endif
+#ifndef GL_TIMESTAMP
+#define GL_TIMESTAMP                 0x8E28
+#endif
+
+#ifndef GL_SYNC_GPU_COMMANDS_COMPLETE
+#define GL_SYNC_GPU_COMMANDS_COMPLETE 0x9117
+#define GL_SYNC_FLUSH_COMMANDS_BIT   0x00000001
+#define GL_ALREADY_SIGNALED          0x911A
+#define GL_TIMEOUT_EXPIRED           0x911B
+#define GL_CONDITION_SATISFIED       0x911C
+#define GL_WAIT_FAILED               0x911D
+#endif
+
+#ifndef GL_FRAMEBUFFER
+#define GL_FRAMEBUFFER               0x8D40
+#define GL_RENDERBUFFER              0x8D41
+#define GL_COLOR_ATTACHMENT0         0x8CE0
+#define GL_DEPTH_ATTACHMENT          0x8D00
+#define GL_FRAMEBUFFER_COMPLETE      0x8CD5
+#endif
+#ifndef GL_DEPTH_COMPONENT24
+#define GL_DEPTH_COMPONENT24         0x81A6
+#endif
+#ifndef GL_TEXTURE_MAX_LEVEL
+#define GL_TEXTURE_MAX_LEVEL         0x813D
+#endif
+#ifndef GL_CLAMP_TO_EDGE
+#define GL_CLAMP_TO_EDGE             0x812F
+#endif
+
+#ifndef GL_POINT_SIZE_MIN
+#define GL_POINT_SIZE_MIN            0x8126
+#define GL_POINT_SIZE_MAX            0x8127
+#define GL_POINT_DISTANCE_ATTENUATION 0x8129
+#endif
+
+#ifndef GL_FRAGMENT_SHADER
+#define GL_FRAGMENT_SHADER           0x8B30
+#define GL_VERTEX_SHADER             0x8B31
+#define GL_COMPILE_STATUS            0x8B81
+#define GL_LINK_STATUS               0x8B82
+#define GL_INFO_LOG_LENGTH           0x8B84
+#endif
+#ifndef GL_TEXTURE0
+#define GL_TEXTURE0                  0x84C0
+#define GL_TEXTURE1                  0x84C1
+#endif
+
+#ifndef GL_ARRAY_BUFFER
+#define GL_ARRAY_BUFFER              0x8892
+#define GL_ELEMENT_ARRAY_BUFFER      0x8893
+#define GL_STATIC_DRAW               0x88E4
+#endif
+
+typedef ptrdiff_t GLMsizeiptr;
+typedef ptrdiff_t GLMintptr;
+typedef unsigned long long GLMuint64;
+typedef long long GLMint64;
+typedef struct __GLsync* GLMsync;
+typedef char GLMchar;
+
+typedef void (APIENTRY *GLMPFNGENBUFFERS)(GLsizei n, GLuint* buffers);
+typedef void (APIENTRY *GLMPFNDELETEBUFFERS)(GLsizei n, const GLuint* buffers);
+typedef void (APIENTRY *GLMPFNBINDBUFFER)(GLenum target, GLuint buffer);
+typedef void (APIENTRY *GLMPFNBUFFERDATA)(GLenum target, GLMsizeiptr size, const GLvoid* data, GLenum usage);
+typedef void (APIENTRY *GLMPFNBUFFERSUBDATA)(GLenum target, GLMintptr offset, GLMsizeiptr size, const GLvoid* data);
+typedef void (APIENTRY *GLMPFNGENQUERIES)(GLsizei n, GLuint* ids);
+typedef void (APIENTRY *GLMPFNDELETEQUERIES)(GLsizei n, const GLuint* ids);
+typedef void (APIENTRY *GLMPFNBEGINQUERY)(GLenum target, GLuint id);
+typedef void (APIENTRY *GLMPFNENDQUERY)(GLenum target);
+typedef void (APIENTRY *GLMPFNGETQUERYOBJECTIV)(GLuint id, GLenum pname, GLint* params);
+typedef void (APIENTRY *GLMPFNGETQUERYOBJECTUI64V)(GLuint id, GLenum pname, GLMuint64* params);
+typedef void (APIENTRY *GLMPFNQUERYCOUNTER)(GLuint id, GLenum target);
+typedef void (APIENTRY *GLMPFNGETINTEGER64V)(GLenum pname, GLMint64* data);
+typedef GLMsync (APIENTRY *GLMPFNFENCESYNC)(GLenum condition, GLbitfield flags);
+typedef GLenum (APIENTRY *GLMPFNCLIENTWAITSYNC)(GLMsync sync, GLbitfield flags, GLMuint64 timeout);
+typedef void (APIENTRY *GLMPFNDELETESYNC)(GLMsync sync);
+typedef void (APIENTRY *GLMPFNPOINTPARAMETERF)(GLenum pname, GLfloat param);
+typedef void (APIENTRY *GLMPFNPOINTPARAMETERFV)(GLenum pname, const GLfloat* params);
+typedef void (APIENTRY *GLMPFNGENFRAMEBUFFERS)(GLsizei n, GLuint* framebuffers);
+typedef void (APIENTRY *GLMPFNDELETEFRAMEBUFFERS)(GLsizei n, const GLuint* framebuffers);
+typedef void (APIENTRY *GLMPFNBINDFRAMEBUFFER)(GLenum target, GLuint framebuffer);
+typedef void (APIENTRY *GLMPFNFRAMEBUFFERTEXTURE2D)(GLenum target, GLenum attachment, GLenum textarget, GLuint texture, GLint level);
+typedef GLenum (APIENTRY *GLMPFNCHECKFRAMEBUFFERSTATUS)(GLenum target);
+typedef void (APIENTRY *GLMPFNGENRENDERBUFFERS)(GLsizei n, GLuint* renderbuffers);
+typedef void (APIENTRY *GLMPFNDELETERENDERBUFFERS)(GLsizei n, const GLuint* renderbuffers);
+typedef void (APIENTRY *GLMPFNBINDRENDERBUFFER)(GLenum target, GLuint renderbuffer);
+typedef void (APIENTRY *GLMPFNRENDERBUFFERSTORAGE)(GLenum target, GLenum internalformat, GLsizei width, GLsizei height);
+typedef void (APIENTRY *GLMPFNFRAMEBUFFERRENDERBUFFER)(GLenum target, GLenum attachment, GLenum renderbuffertarget, GLuint renderbuffer);
+typedef void (APIENTRY *GLMPFNGENERATEMIPMAP)(GLenum target);
+typedef GLuint (APIENTRY *GLMPFNCREATESHADER)(GLenum type);
+typedef void (APIENTRY *GLMPFNSHADERSOURCE)(GLuint shader, GLsizei count, const GLMchar* const* string, const GLint* length);
+typedef void (APIENTRY *GLMPFNCOMPILESHADER)(GLuint shader);
+typedef void (APIENTRY *GLMPFNGETSHADERIV)(GLuint shader, GLenum pname, GLint* params);
+typedef void (APIENTRY *GLMPFNGETSHADERINFOLOG)(GLuint shader, GLsizei bufSize, GLsizei* length, GLMchar* infoLog);
+typedef void (APIENTRY *GLMPFNDELETESHADER)(GLuint shader);
+typedef GLuint (APIENTRY *GLMPFNCREATEPROGRAM)(void);
+typedef void (APIENTRY *GLMPFNATTACHSHADER)(GLuint program, GLuint shader);
+typedef void (APIENTRY *GLMPFNLINKPROGRAM)(GLuint program);
+typedef void (APIENTRY *GLMPFNGETPROGRAMIV)(GLuint program, GLenum pname, GLint* params);
+typedef void (APIENTRY *GLMPFNGETPROGRAMINFOLOG)(GLuint program, GLsizei bufSize, GLsizei* length, GLMchar* infoLog);
+typedef void (APIENTRY *GLMPFNDELETEPROGRAM)(GLuint program);
+typedef void (APIENTRY *GLMPFNUSEPROGRAM)(GLuint program);
+typedef GLint (APIENTRY *GLMPFNGETUNIFORMLOCATION)(GLuint program, const GLMchar* name);
+typedef void (APIENTRY *GLMPFNUNIFORM1I)(GLint location, GLint v0);
+typedef void (APIENTRY *GLMPFNUNIFORM1F)(GLint location, GLfloat v0);
+typedef void (APIENTRY *GLMPFNUNIFORM2F)(GLint location, GLfloat v0, GLfloat v1);
+typedef void (APIENTRY *GLMPFNUNIFORM1FV)(GLint location, GLsizei count, const GLfloat *value);
+typedef void (APIENTRY *GLMPFNACTIVETEXTURE)(GLenum texture);
+
+/* buffer objects (OpenGL 1.5) */
+extern GLMPFNGENBUFFERS    glmextGenBuffers;
+extern GLMPFNDELETEBUFFERS glmextDeleteBuffers;
+extern GLMPFNBINDBUFFER    glmextBindBuffer;
+extern GLMPFNBUFFERDATA    glmextBufferData;
+extern GLMPFNBUFFERSUBDATA glmextBufferSubData;
+
+/* timer queries (OpenGL 3.3, ARB_timer_query or EXT_timer_query) */
+extern GLMPFNGENQUERIES          glmextGenQueries;
+extern GLMPFNDELETEQUERIES       glmextDeleteQueries;
+extern GLMPFNBEGINQUERY          glmextBeginQuery;
+extern GLMPFNENDQUERY            glmextEndQuery;
+extern GLMPFNGETQUERYOBJECTIV    glmextGetQueryObjectiv;
+extern GLMPFNGETQUERYOBJECTUI64V glmextGetQueryObjectui64v;
+extern GLMPFNQUERYCOUNTER        glmextQueryCounter;
+extern GLMPFNGETINTEGER64V       glmextGetInteger64v;     /* with GLM_TIMER_TIMESTAMP */
+
+/* sync objects (OpenGL 3.2 or ARB_sync) */
+extern GLMPFNFENCESYNC           glmextFenceSync;
+extern GLMPFNCLIENTWAITSYNC      glmextClientWaitSync;
+extern GLMPFNDELETESYNC          glmextDeleteSync;
+
+/* point parameters (OpenGL 1.4 or ARB_point_parameters) */
+extern GLMPFNPOINTPARAMETERF         glmextPointParameterf;
+extern GLMPFNPOINTPARAMETERFV        glmextPointParameterfv;
+
+/* framebuffer objects (OpenGL 3.0, ARB_ or EXT_framebuffer_object) */
+extern GLMPFNGENFRAMEBUFFERS         glmextGenFramebuffers;
+extern GLMPFNDELETEFRAMEBUFFERS      glmextDeleteFramebuffers;
+extern GLMPFNBINDFRAMEBUFFER         glmextBindFramebuffer;
+extern GLMPFNFRAMEBUFFERTEXTURE2D    glmextFramebufferTexture2D;
+extern GLMPFNCHECKFRAMEBUFFERSTATUS  glmextCheckFramebufferStatus;
+extern GLMPFNGENRENDERBUFFERS        glmextGenRenderbuffers;
+extern GLMPFNDELETERENDERBUFFERS     glmextDeleteRenderbuffers;
+extern GLMPFNBINDRENDERBUFFER        glmextBindRenderbuffer;
+extern GLMPFNRENDERBUFFERSTORAGE     glmextRenderbufferStorage;
+extern GLMPFNFRAMEBUFFERRENDERBUFFER glmextFramebufferRenderbuffer;
+extern GLMPFNGENERATEMIPMAP          glmextGenerateMipmap;
+
+/* shaders (OpenGL 2.0) and multitexture (OpenGL 1.3) */
+extern GLMPFNCREATESHADER            glmextCreateShader;
+extern GLMPFNSHADERSOURCE            glmextShaderSource;
+extern GLMPFNCOMPILESHADER           glmextCompileShader;
+extern GLMPFNGETSHADERIV             glmextGetShaderiv;
+extern GLMPFNGETSHADERINFOLOG        glmextGetShaderInfoLog;
+extern GLMPFNDELETESHADER            glmextDeleteShader;
+extern GLMPFNCREATEPROGRAM           glmextCreateProgram;
+extern GLMPFNATTACHSHADER            glmextAttachShader;
+extern GLMPFNLINKPROGRAM             glmextLinkProgram;
+extern GLMPFNGETPROGRAMIV            glmextGetProgramiv;
+extern GLMPFNGETPROGRAMINFOLOG       glmextGetProgramInfoLog;
+extern GLMPFNDELETEPROGRAM           glmextDeleteProgram;
+extern GLMPFNUSEPROGRAM              glmextUseProgram;
+extern GLMPFNGETUNIFORMLOCATION      glmextGetUniformLocation;
+extern GLMPFNUNIFORM1I               glmextUniform1i;
+extern GLMPFNUNIFORM1F               glmextUniform1f;
+extern GLMPFNUNIFORM2F               glmextUniform2f;
+extern GLMPFNUNIFORM1FV              glmextUniform1fv;
+extern GLMPFNACTIVETEXTURE           glmextActiveTexture;
+
+/* what glmExtHasTimers() found */
+#define GLM_TIMER_NONE       0    /* no timer queries */
+#define GLM_TIMER_ELAPSED    1    /* GL_TIME_ELAPSED only */
+#define GLM_TIMER_TIMESTAMP  2    /* GL_TIME_ELAPSED and GL_TIMESTAMP */
+
+/* glmExtInit: look up the entry points for the current context.
+* Returns GL_TRUE if buffer objects are available.  Safe to call more
+* than once.
+*/
+GLboolean
+glmExtInit(GLvoid);
+
+/* glmExtHasBuffers: GL_TRUE once glmExtInit() found buffer objects */
+GLboolean
+glmExtHasBuffers(GLvoid);
+
+/* glmExtHasTimers: which timer queries glmExtInit() found, one of
+* GLM_TIMER_NONE, GLM_TIMER_ELAPSED or GLM_TIMER_TIMESTAMP
+*/
+GLint
+glmExtHasTimers(GLvoid);
+
+/* glmExtHasSync: GL_TRUE once glmExtInit() found sync objects */
+GLboolean
+glmExtHasSync(GLvoid);
+
+/* glmExtHasPointParameters: GL_TRUE once glmExtInit() found point
+* parameters
+*/
+GLboolean
+glmExtHasPointParameters(GLvoid);
+
+/* glmExtHasFramebuffers: GL_TRUE once glmExtInit() found framebuffer
+* objects
+*/
+GLboolean
+glmExtHasFramebuffers(GLvoid);
+
+/* glmExtHasShaders: GL_TRUE once glmExtInit() found OpenGL 2.0
+* shaders and multitexture
+*/
+GLboolean
+glmExtHasShaders(GLvoid);
+
+/* glmExtSwapInterval: set the swap interval of the current context
+* through WGL_EXT_swap_control, GLX_EXT_swap_control (or the MESA and
+* SGI variants) or CGL.  0 swaps immediately, 1 waits for vertical
+* blank, -1 waits unless the frame is late (adaptive vsync, needs the
+* swap_control_tear extensions).  Returns GL_FALSE if the interval
+* could not be set.
+*
+* interval - swap interval
+*/
+GLboolean
+glmExtSwapInterval(GLint interval);
+
+#endif
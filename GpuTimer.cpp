@@ -0,0 +1,202 @@
+/*
+*  GpuTimer.cpp
+*
+*  GPU time per render pass from OpenGL timer queries. See GpuTimer.h.
+*
+*/
+
+#include <string.h>
+#include <AR/ar.h>
+#include "GLMExt.h"
+#include "GpuTimer.h"
+#include "Timing.h"
+
+#define GPU_TIMER_SMOOTH    0.1     // Weight of the newest frame in the averages.
+
+typedef struct {
+	GLuint          query[GPU_TIMER_PASS_MAX + 1];  // One per pass boundary (timestamps) or per pass (elapsed).
+	const char      *name[GPU_TIMER_PASS_MAX];
+	int             passNum;
+	int             pending;
+	double          cpu;
+} GpuTimerFrame;
+
+static struct {
+	int                 mode;       // GLM_TIMER_ELAPSED or GLM_TIMER_TIMESTAMP, 0 if off.
+	GpuTimerResultFunc  result;
+	GpuTimerFrame       ring[GPU_TIMER_RING];
+	int                 next;
+	GpuTimerFrame       *frame;     // Being recorded, NULL between frames.
+	double              cpuStart;
+	long                skipped;
+
+	int                 passNum;
+	const char          *passName[GPU_TIMER_PASS_MAX];
+	double              passMs[GPU_TIMER_PASS_MAX];
+	double              frameMs, cpuMs;
+} gGpuTimer;
+
+static double gpuTimerSmooth(double average, double ms)
+{
+	return average > 0.0 ? average + GPU_TIMER_SMOOTH * (ms - average) : ms;
+}
+
+static void gpuTimerAddPass(const char *name, double seconds)
+{
+	int i;
+
+	for (i = 0; i < gGpuTimer.passNum; i++) if (gGpuTimer.passName[i] == name) break;
+	if (i == gGpuTimer.passNum) {
+		if (i == GPU_TIMER_PASS_MAX) return;
+		gGpuTimer.passName[i] = name;
+		gGpuTimer.passMs[i] = 0.0;
+		gGpuTimer.passNum++;
+	}
+	gGpuTimer.passMs[i] = gpuTimerSmooth(gGpuTimer.passMs[i], seconds * 1000.0);
+	if (gGpuTimer.result) gGpuTimer.result(name, seconds);
+}
+
+// Read back a frame whose last query has completed.
+static void gpuTimerCollect(GpuTimerFrame *f)
+{
+	GLMuint64 t[GPU_TIMER_PASS_MAX + 1];
+	double total, seconds;
+	int i;
+
+	total = 0.0;
+	if (gGpuTimer.mode == GLM_TIMER_TIMESTAMP) {
+		for (i = 0; i <= f->passNum; i++) glmextGetQueryObjectui64v(f->query[i], GL_QUERY_RESULT, &t[i]);
+		for (i = 0; i < f->passNum; i++) {
+			seconds = (double)(t[i + 1] - t[i]) * 1e-9;
+			gpuTimerAddPass(f->name[i], seconds);
+		}
+		total = (double)(t[f->passNum] - t[0]) * 1e-9;
+	}
+	else {
+		for (i = 0; i < f->passNum; i++) {
+			glmextGetQueryObjectui64v(f->query[i], GL_QUERY_RESULT, &t[i]);
+			seconds = (double)t[i] * 1e-9;
+			gpuTimerAddPass(f->name[i], seconds);
+			total += seconds;
+		}
+	}
+	gGpuTimer.frameMs = gpuTimerSmooth(gGpuTimer.frameMs, total * 1000.0);
+	gGpuTimer.cpuMs = gpuTimerSmooth(gGpuTimer.cpuMs, f->cpu * 1000.0);
+	if (gGpuTimer.result) gGpuTimer.result(NULL, total);
+	f->pending = FALSE;
+}
+
+int gpuTimerInit(GpuTimerResultFunc result)
+{
+	int i;
+
+	memset(&gGpuTimer, 0, sizeof(gGpuTimer));
+	glmExtInit();
+	if (glmExtHasTimers() == GLM_TIMER_NONE) return (FALSE);
+	for (i = 0; i < GPU_TIMER_RING; i++) glmextGenQueries(GPU_TIMER_PASS_MAX + 1, gGpuTimer.ring[i].query);
+	gGpuTimer.mode = glmExtHasTimers();
+	gGpuTimer.result = result;
+	return (TRUE);
+}
+
+void gpuTimerFinal(void)
+{
+	int i;
+
+	if (!gGpuTimer.mode) return;
+	for (i = 0; i < GPU_TIMER_RING; i++) glmextDeleteQueries(GPU_TIMER_PASS_MAX + 1, gGpuTimer.ring[i].query);
+	gGpuTimer.mode = 0;
+}
+
+int gpuTimerAvailable(void)
+{
+	return (gGpuTimer.mode != 0);
+}
+
+void gpuTimerFrameBegin(void)
+{
+	GpuTimerFrame *f;
+	GLint available;
+	int i, last;
+
+	if (!gGpuTimer.mode) return;
+
+	// Read back finished frames, oldest first. The GPU completes them in
+	// order, so stop at the first that is not done.
+	for (i = 0; i < GPU_TIMER_RING; i++) {
+		f = &gGpuTimer.ring[(gGpuTimer.next + i) % GPU_TIMER_RING];
+		if (!f->pending) continue;
+		last = gGpuTimer.mode == GLM_TIMER_TIMESTAMP ? f->passNum : f->passNum - 1;
+		glmextGetQueryObjectiv(f->query[last], GL_QUERY_RESULT_AVAILABLE, &available);
+		if (!available) break;
+		gpuTimerCollect(f);
+	}
+
+	f = &gGpuTimer.ring[gGpuTimer.next];
+	if (f->pending) {
+		gGpuTimer.skipped++;    // GPU is a whole ring behind; don't wait.
+		return;
+	}
+	f->passNum = 0;
+	gGpuTimer.frame = f;
+	gGpuTimer.cpuStart = timingNow();
+}
+
+void gpuTimerPass(const char *pass)
+{
+	GpuTimerFrame *f = gGpuTimer.frame;
+
+	if (!f || f->passNum == GPU_TIMER_PASS_MAX) return;
+	if (gGpuTimer.mode == GLM_TIMER_TIMESTAMP) {
+		glmextQueryCounter(f->query[f->passNum], GL_TIMESTAMP);
+	}
+	else {
+		if (f->passNum) glmextEndQuery(GL_TIME_ELAPSED);
+		glmextBeginQuery(GL_TIME_ELAPSED, f->query[f->passNum]);
+	}
+	f->name[f->passNum++] = pass;
+}
+
+void gpuTimerFrameEnd(void)
+{
+	GpuTimerFrame *f = gGpuTimer.frame;
+
+	if (!f) return;
+	gGpuTimer.frame = NULL;
+	if (!f->passNum) return;
+	if (gGpuTimer.mode == GLM_TIMER_TIMESTAMP) glmextQueryCounter(f->query[f->passNum], GL_TIMESTAMP);
+	else glmextEndQuery(GL_TIME_ELAPSED);
+	f->cpu = timingNow() - gGpuTimer.cpuStart;
+	f->pending = TRUE;
+	gGpuTimer.next = (gGpuTimer.next + 1) % GPU_TIMER_RING;
+}
+
+int gpuTimerPassCount(void)
+{
+	return gGpuTimer.passNum;
+}
+
+const char *gpuTimerPassName(int i)
+{
+	return (i >= 0 && i < gGpuTimer.passNum) ? gGpuTimer.passName[i] : NULL;
+}
+
+double gpuTimerPassMs(int i)
+{
+	return (i >= 0 && i < gGpuTimer.passNum) ? gGpuTimer.passMs[i] : 0.0;
+}
+
+double gpuTimerFrameMs(void)
+{
+	return gGpuTimer.frameMs;
+}
+
+double gpuTimerCpuMs(void)
+{
+	return gGpuTimer.cpuMs;
+}
+
+long gpuTimerSkipped(void)
+{
+	return gGpuTimer.skipped;
+}
@@ -0,0 +1,47 @@
+/*
+*  GpuTimer.h
+*
+*  GPU time per render pass from OpenGL timer queries.
+*
+*  Display() brackets its frame with gpuTimerFrameBegin() and
+*  gpuTimerFrameEnd() and marks each pass with gpuTimerPass(). Marks issue
+*  GL_TIMESTAMP queries (or GL_TIME_ELAPSED where only EXT_timer_query is
+*  available) and never wait for them: the queries of a frame stay in a
+*  ring for up to GPU_TIMER_RING frames and are read back by a later
+*  gpuTimerFrameBegin() once the GPU has reached them. If the GPU falls
+*  further behind than that, frames go untimed rather than stall.
+*
+*/
+
+#ifndef GPU_TIMER_H
+#define GPU_TIMER_H
+
+#define GPU_TIMER_PASS_MAX      8
+#define GPU_TIMER_RING          4       // Frames of queries in flight.
+
+// Called for every pass read back, and once per frame with the pass
+// name NULL and the time of the whole frame. Seconds.
+typedef void (*GpuTimerResultFunc)(const char *pass, double seconds);
+
+// After the GL context is current. FALSE without timer queries.
+int         gpuTimerInit(GpuTimerResultFunc result);
+void        gpuTimerFinal(void);
+int         gpuTimerAvailable(void);
+
+// pass must be a string literal (only the pointer is kept). Outside a
+// frame gpuTimerPass() does nothing.
+void        gpuTimerFrameBegin(void);
+void        gpuTimerPass(const char *pass);
+void        gpuTimerFrameEnd(void);
+
+// Smoothed results in ms: each pass seen so far, the GPU time of the
+// whole frame, and the CPU time between gpuTimerFrameBegin() and
+// gpuTimerFrameEnd() for comparison.
+int         gpuTimerPassCount(void);
+const char  *gpuTimerPassName(int i);
+double      gpuTimerPassMs(int i);
+double      gpuTimerFrameMs(void);
+double      gpuTimerCpuMs(void);
+long        gpuTimerSkipped(void);      // Frames not timed because the ring was full.
+
+#endif // !GPU_TIMER_H
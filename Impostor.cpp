@@ -0,0 +1,342 @@
+/*
+*  Impostor.cpp
+*
+*  Impostors for models too small on screen to be worth their triangles.
+*  See Impostor.h.
+*
+*/
+
+#include <string.h>
+#include <math.h>
+#include <AR/ar.h>
+#include "GLMExt.h"
+#include "Impostor.h"
+
+#ifndef M_PI
+#  define M_PI 3.14159265358979323846
+#endif
+
+static const char *impostorPolicyNames[IMPOSTOR_POLICY_COUNT] = { "auto", "mesh only", "impostor only" };
+
+// out = a * b, column major. b may be NULL for the identity.
+static void impostorMultMatrix(const GLfloat a[16], const GLfloat b[16], GLfloat out[16])
+{
+	int i, j;
+
+	if (!b) {
+		memcpy(out, a, 16 * sizeof(GLfloat));
+		return;
+	}
+	for (j = 0; j < 4; j++) {
+		for (i = 0; i < 4; i++) {
+			out[j*4 + i] = a[i] * b[j*4] + a[4 + i] * b[j*4 + 1] + a[8 + i] * b[j*4 + 2] + a[12 + i] * b[j*4 + 3];
+		}
+	}
+}
+
+// Axis aligned box of the positions, which are the last three floats of
+// each vertex, and the sphere around it.
+static void impostorBounds(GLMdrawable *drawable, GLfloat center[3], GLfloat *radius)
+{
+	const GLfloat *v;
+	GLfloat lo[3], hi[3], d[3], r2, dist2;
+	GLuint i, floats;
+	int k;
+
+	floats = (GLuint)drawable->stride / sizeof(GLfloat);
+	*radius = 0.0f;
+	if (!drawable->numvertices) return;
+	v = drawable->arrays + floats - 3;
+	for (k = 0; k < 3; k++) lo[k] = hi[k] = v[k];
+	for (i = 1; i < drawable->numvertices; i++) {
+		v = drawable->arrays + i * floats + floats - 3;
+		for (k = 0; k < 3; k++) {
+			if (v[k] < lo[k]) lo[k] = v[k];
+			if (v[k] > hi[k]) hi[k] = v[k];
+		}
+	}
+	for (k = 0; k < 3; k++) center[k] = 0.5f * (lo[k] + hi[k]);
+	r2 = 0.0f;
+	for (i = 0; i < drawable->numvertices; i++) {
+		v = drawable->arrays + i * floats + floats - 3;
+		for (k = 0; k < 3; k++) d[k] = v[k] - center[k];
+		dist2 = d[0]*d[0] + d[1]*d[1] + d[2]*d[2];
+		if (dist2 > r2) r2 = dist2;
+	}
+	*radius = sqrtf(r2);
+}
+
+// Unit vector from the model towards the eye for an elevation and
+// azimuth (radians), and the right and up axes of the view. Up is
+// always towards +z, so views agree on roll.
+static void impostorBasis(float el, float az, GLfloat back[3], GLfloat right[3], GLfloat up[3])
+{
+	back[0] = cosf(el) * cosf(az);
+	back[1] = cosf(el) * sinf(az);
+	back[2] = sinf(el);
+	right[0] = -sinf(az);
+	right[1] = cosf(az);
+	right[2] = 0.0f;
+	up[0] = back[1] * right[2] - back[2] * right[1];
+	up[1] = back[2] * right[0] - back[0] * right[2];
+	up[2] = back[0] * right[1] - back[1] * right[0];
+}
+
+static float impostorElevation(int i)
+{
+	return (float)(-M_PI / 2.0 + (i + 0.5) * M_PI / IMPOSTOR_ELEVATIONS);
+}
+
+static float impostorAzimuth(int j)
+{
+	return (float)(j * 2.0 * M_PI / IMPOSTOR_AZIMUTHS);
+}
+
+int impostorBuild(Impostor *imp, GLMdrawable *drawable, int tileSize)
+{
+	GLMcommandlist list;
+	GLuint fbo, depth;
+	GLint maxSize;
+	GLfloat view[16], back[3], right[3], up[3], eye[3], r;
+	GLenum status;
+	int i, j, k, width, height, levels;
+
+	memset(imp, 0, sizeof(Impostor));
+	glmExtInit();
+	if (!glmExtHasFramebuffers()) {
+		ARLOGw("impostorBuild(): No framebuffer objects, impostors not available.\n");
+		return (FALSE);
+	}
+	impostorBounds(drawable, imp->center, &imp->radius);
+	if (imp->radius <= 0.0f) return (FALSE);
+	r = imp->radius;
+
+	glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxSize);
+	while (tileSize > 8 && IMPOSTOR_AZIMUTHS * tileSize > maxSize) tileSize /= 2;
+	width = IMPOSTOR_AZIMUTHS * tileSize;
+	height = IMPOSTOR_ELEVATIONS * tileSize;
+
+	glGenTextures(1, &imp->texture);
+	glBindTexture(GL_TEXTURE_2D, imp->texture);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	glmextGenFramebuffers(1, &fbo);
+	glmextBindFramebuffer(GL_FRAMEBUFFER, fbo);
+	glmextFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, imp->texture, 0);
+	glmextGenRenderbuffers(1, &depth);
+	glmextBindRenderbuffer(GL_RENDERBUFFER, depth);
+	glmextRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+	glmextFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depth);
+	status = glmextCheckFramebufferStatus(GL_FRAMEBUFFER);
+	if (status != GL_FRAMEBUFFER_COMPLETE) {
+		ARLOGw("impostorBuild(): Framebuffer incomplete (0x%04x), impostors not available.\n", status);
+		glmextBindFramebuffer(GL_FRAMEBUFFER, 0);
+		glmextDeleteRenderbuffers(1, &depth);
+		glmextDeleteFramebuffers(1, &fbo);
+		impostorFree(imp);
+		return (FALSE);
+	}
+
+	glPushAttrib(GL_ALL_ATTRIB_BITS);
+	glMatrixMode(GL_PROJECTION);
+	glPushMatrix();
+	glLoadIdentity();
+	glOrtho(-r, r, -r, r, r, 3.0f * r);     // Eye at twice the radius.
+	glMatrixMode(GL_MODELVIEW);
+	glPushMatrix();
+
+	// Transparent black around the model keeps the atlas premultiplied.
+	glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+	glEnable(GL_SCISSOR_TEST);
+	glEnable(GL_DEPTH_TEST);
+	glEnable(GL_LIGHTING);
+	glEnable(GL_LIGHT0);
+	glDisable(GL_BLEND);
+	glDisable(GL_TEXTURE_2D);
+
+	glmInitCommands(&list);
+	glmPrepare(drawable, NULL, &list);
+	for (i = 0; i < IMPOSTOR_ELEVATIONS; i++) {
+		for (j = 0; j < IMPOSTOR_AZIMUTHS; j++) {
+			glViewport(j * tileSize, i * tileSize, tileSize, tileSize);
+			glScissor(j * tileSize, i * tileSize, tileSize, tileSize);
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+			impostorBasis(impostorElevation(i), impostorAzimuth(j), back, right, up);
+			for (k = 0; k < 3; k++) eye[k] = imp->center[k] + 2.0f * r * back[k];
+			for (k = 0; k < 3; k++) {
+				view[k*4 + 0] = right[k];
+				view[k*4 + 1] = up[k];
+				view[k*4 + 2] = back[k];
+				view[k*4 + 3] = 0.0f;
+			}
+			view[12] = -(right[0]*eye[0] + right[1]*eye[1] + right[2]*eye[2]);
+			view[13] = -(up[0]*eye[0] + up[1]*eye[1] + up[2]*eye[2]);
+			view[14] = -(back[0]*eye[0] + back[1]*eye[1] + back[2]*eye[2]);
+			view[15] = 1.0f;
+			glLoadMatrixf(view);
+			glmSubmit(&list);
+		}
+	}
+	glmFreeCommands(&list);
+
+	glMatrixMode(GL_PROJECTION);
+	glPopMatrix();
+	glMatrixMode(GL_MODELVIEW);
+	glPopMatrix();
+	glPopAttrib();
+
+	glmextBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glmextDeleteRenderbuffers(1, &depth);
+	glmextDeleteFramebuffers(1, &fbo);
+
+	// Stop the mip chain at 4 pixel views, below that neighbouring views
+	// bleed into each other.
+	for (levels = 0; (tileSize >> levels) > 4; levels++);
+	glBindTexture(GL_TEXTURE_2D, imp->texture);
+	glmextGenerateMipmap(GL_TEXTURE_2D);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levels);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	imp->tileSize = tileSize;
+	ARLOGi("Impostor atlas %dx%d, %d views of %d pixels.\n", width, height, IMPOSTOR_ELEVATIONS * IMPOSTOR_AZIMUTHS, tileSize);
+	return (TRUE);
+}
+
+void impostorFree(Impostor *imp)
+{
+	if (imp->texture) glDeleteTextures(1, &imp->texture);
+	imp->texture = 0;
+}
+
+float impostorScreenSize(const Impostor *imp, const GLfloat view[16], const GLfloat transform[16],
+	const GLfloat projection[16], int viewportHeight)
+{
+	GLfloat mv[16], z, scale;
+	const GLfloat *c = imp->center;
+
+	impostorMultMatrix(view, transform, mv);
+	z = -(mv[2]*c[0] + mv[6]*c[1] + mv[10]*c[2] + mv[14]);
+	if (z <= imp->radius) return ((float)viewportHeight);   // Camera inside the sphere.
+	scale = sqrtf(mv[0]*mv[0] + mv[1]*mv[1] + mv[2]*mv[2]);
+	return (imp->radius * scale * projection[5] * (float)viewportHeight / z);
+}
+
+void impostorDraw(const Impostor *imp, const GLfloat view[16], const GLfloat transform[16], float alpha)
+{
+	GLfloat mv[16], eye[3], back[3], right[3], up[3], len, s2, el, az;
+	GLfloat vertices[4][3], texcoords[4][2], u0, v0, du, dv;
+	int i, j, k;
+
+	if (!imp->texture || alpha <= 0.0f) return;
+
+	// Eye in drawable coordinates, from the rigid (or uniformly scaled)
+	// modelview: eye = -R^T t / s^2.
+	impostorMultMatrix(view, transform, mv);
+	s2 = mv[0]*mv[0] + mv[1]*mv[1] + mv[2]*mv[2];
+	for (k = 0; k < 3; k++) {
+		eye[k] = -(mv[k*4]*mv[12] + mv[k*4 + 1]*mv[13] + mv[k*4 + 2]*mv[14]) / s2;
+		back[k] = eye[k] - imp->center[k];
+	}
+	len = sqrtf(back[0]*back[0] + back[1]*back[1] + back[2]*back[2]);
+	if (len <= 0.0f) return;
+	el = asinf(back[2] / len);
+	az = atan2f(back[1], back[0]);
+	if (az < 0.0f) az += (float)(2.0 * M_PI);
+
+	// Nearest view in the atlas, and a quad facing the eye.
+	i = (int)((el + M_PI / 2.0) * IMPOSTOR_ELEVATIONS / M_PI);
+	if (i < 0) i = 0;
+	if (i >= IMPOSTOR_ELEVATIONS) i = IMPOSTOR_ELEVATIONS - 1;
+	j = (int)floorf(az * IMPOSTOR_AZIMUTHS / (float)(2.0 * M_PI) + 0.5f) % IMPOSTOR_AZIMUTHS;
+	impostorBasis(el, az, back, right, up);
+	for (k = 0; k < 3; k++) {
+		vertices[0][k] = imp->center[k] - imp->radius * (right[k] + up[k]);
+		vertices[1][k] = imp->center[k] + imp->radius * (right[k] - up[k]);
+		vertices[2][k] = imp->center[k] + imp->radius * (right[k] + up[k]);
+		vertices[3][k] = imp->center[k] - imp->radius * (right[k] - up[k]);
+	}
+	du = 1.0f / IMPOSTOR_AZIMUTHS;
+	dv = 1.0f / IMPOSTOR_ELEVATIONS;
+	u0 = j * du;
+	v0 = i * dv;
+	texcoords[0][0] = u0;      texcoords[0][1] = v0;
+	texcoords[1][0] = u0 + du; texcoords[1][1] = v0;
+	texcoords[2][0] = u0 + du; texcoords[2][1] = v0 + dv;
+	texcoords[3][0] = u0;      texcoords[3][1] = v0 + dv;
+
+	// Premultiplied, so the fade scales all four channels. Depth is off so
+	// that during a fade the impostor lies over the mesh it replaces.
+	glPushAttrib(GL_ENABLE_BIT | GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_CURRENT_BIT | GL_TEXTURE_BIT);
+	glDisable(GL_LIGHTING);
+	glDisable(GL_DEPTH_TEST);
+	glDepthMask(GL_FALSE);
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+	glEnable(GL_TEXTURE_2D);
+	glBindTexture(GL_TEXTURE_2D, imp->texture);
+	glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
+	glColor4f(alpha, alpha, alpha, alpha);
+
+	glPushMatrix();
+	if (transform) glMultMatrixf(transform);
+	glVertexPointer(3, GL_FLOAT, 0, vertices);
+	glTexCoordPointer(2, GL_FLOAT, 0, texcoords);
+	glEnableClientState(GL_VERTEX_ARRAY);
+	glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+	glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
+	glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+	glDisableClientState(GL_VERTEX_ARRAY);
+	glPopMatrix();
+
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glPopAttrib();
+}
+
+void impostorLODInit(ImpostorLOD *lod, float threshold, double fade)
+{
+	memset(lod, 0, sizeof(ImpostorLOD));
+	lod->policy = IMPOSTOR_AUTO;
+	lod->threshold = threshold;
+	lod->fade = fade;
+}
+
+void impostorLODSetPolicy(ImpostorLOD *lod, IMPOSTOR_POLICY policy)
+{
+	lod->policy = policy;
+	lod->far = (policy == IMPOSTOR_ALWAYS);
+	lod->switched = 0.0;    // No fade into a manual choice.
+}
+
+const char *impostorPolicyName(IMPOSTOR_POLICY policy)
+{
+	return (policy >= 0 && policy < IMPOSTOR_POLICY_COUNT) ? impostorPolicyNames[policy] : "unknown";
+}
+
+float impostorLODWeight(ImpostorLOD *lod, float pixels, double now)
+{
+	int far;
+	float w;
+
+	lod->pixels = pixels;
+	if (lod->policy == IMPOSTOR_MESH_ONLY) return (lod->weight = 0.0f);
+	if (lod->policy == IMPOSTOR_ALWAYS) return (lod->weight = 1.0f);
+
+	far = lod->far ? pixels < lod->threshold * IMPOSTOR_HYSTERESIS : pixels < lod->threshold;
+	if (far != lod->far) {
+		// Reverse a fade still in progress from where it has got to.
+		w = lod->weight;
+		lod->switched = now - (far ? w : 1.0f - w) * lod->fade;
+		lod->far = far;
+	}
+	w = lod->fade > 0.0 ? (float)((now - lod->switched) / lod->fade) : 1.0f;
+	if (w > 1.0f) w = 1.0f;
+	if (w < 0.0f) w = 0.0f;
+	return (lod->weight = far ? w : 1.0f - w);
+}
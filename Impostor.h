@@ -0,0 +1,77 @@
+/*
+*  Impostor.h
+*
+*  Impostors for models too small on screen to be worth their triangles.
+*
+*  impostorBuild() renders a drawable from IMPOSTOR_ELEVATIONS x
+*  IMPOSTOR_AZIMUTHS directions around its bounding sphere into one
+*  mipmapped RGBA atlas, through a framebuffer object. impostorDraw()
+*  then stands in for the model with a single quad facing the camera,
+*  textured with the view nearest to the camera direction. Views are lit
+*  by the default GL_LIGHT0 (a directional light at the eye), which is
+*  what the sample uses, so lighting stays right as the camera moves.
+*
+*  ImpostorLOD picks between mesh and impostor by the projected diameter
+*  of the bounding sphere, with hysteresis so that a marker sitting at the
+*  threshold does not flicker, and cross-fades over a fixed time when it
+*  switches: the mesh is drawn until the impostor has faded in over it.
+*
+*/
+
+#ifndef IMPOSTOR_H
+#define IMPOSTOR_H
+
+#include "GLM.h"
+
+#define IMPOSTOR_ELEVATIONS     8       // Bands from below the model to above it.
+#define IMPOSTOR_AZIMUTHS       16      // Views around each band.
+#define IMPOSTOR_HYSTERESIS     1.25f   // Back to the mesh only above threshold times this.
+
+typedef struct {
+	GLuint      texture;                // Atlas, 0 if not built.
+	int         tileSize;               // Pixels per view.
+	GLfloat     center[3];              // Bounding sphere in drawable coordinates.
+	GLfloat     radius;
+} Impostor;
+
+typedef enum {
+	IMPOSTOR_AUTO = 0,                  // By projected size.
+	IMPOSTOR_MESH_ONLY,
+	IMPOSTOR_ALWAYS,
+	IMPOSTOR_POLICY_COUNT
+} IMPOSTOR_POLICY;
+
+typedef struct {
+	IMPOSTOR_POLICY policy;
+	float           threshold;          // Projected diameter in pixels below which the impostor is used.
+	double          fade;               // Seconds the cross-fade takes.
+	int             far;                // Impostor chosen.
+	double          switched;           // When the current fade started.
+	float           pixels;             // Last projected size and weight, for display.
+	float           weight;
+} ImpostorLOD;
+
+// With the GL context current. FALSE (and a warning) without framebuffer
+// objects. tileSize is reduced if the atlas would not fit in a texture.
+int         impostorBuild(Impostor *imp, GLMdrawable *drawable, int tileSize);
+void        impostorFree(Impostor *imp);
+
+// Projected diameter in pixels of the bounding sphere. view and
+// projection are the current matrices (column major), transform is
+// the one passed to glmPrepare() (or NULL).
+float       impostorScreenSize(const Impostor *imp, const GLfloat view[16], const GLfloat transform[16],
+	const GLfloat projection[16], int viewportHeight);
+
+// Draws the impostor with the given opacity. The modelview matrix must
+// be view; transform is applied as glmSubmit() would.
+void        impostorDraw(const Impostor *imp, const GLfloat view[16], const GLfloat transform[16], float alpha);
+
+void        impostorLODInit(ImpostorLOD *lod, float threshold, double fade);
+void        impostorLODSetPolicy(ImpostorLOD *lod, IMPOSTOR_POLICY policy);
+const char  *impostorPolicyName(IMPOSTOR_POLICY policy);
+
+// Weight of the impostor for a frame at time now (seconds): 0 draws only
+// the mesh, 1 only the impostor, anything between both.
+float       impostorLODWeight(ImpostorLOD *lod, float pixels, double now);
+
+#endif // !IMPOSTOR_H
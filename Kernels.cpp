@@ -0,0 +1,833 @@
+/*
+*  Kernels.cpp
+*
+*  Runtime selection of the vectorized inner loops. See Kernels.h.
+*
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <AR/ar.h>
+#include "Kernels.h"
+#include "Timing.h"
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#  define KERNEL_X86
+#  include <immintrin.h>
+#  if defined(_MSC_VER)
+#    include <intrin.h>
+#    define KERNEL_TARGET(isa)
+// MSVC compiles any intrinsic its headers have, so the variants are left
+// out where they don't: AVX2 came with VS2012, AVX-512BW with VS2017 15.3.
+#    if _MSC_VER >= 1700
+#      define KERNEL_AVX2
+#    endif
+#    if _MSC_VER >= 1911
+#      define KERNEL_AVX512
+#    endif
+#  else
+#    include <cpuid.h>
+// Compiles one function for a higher instruction set than the rest of the
+// file; it is only ever called once cpuid has said the CPU has it.
+#    define KERNEL_TARGET(isa)  __attribute__((target(isa)))
+#    define KERNEL_AVX2
+#    if defined(__clang__) || __GNUC__ >= 5
+#      define KERNEL_AVX512
+#    endif
+#  endif
+#endif
+
+// Table entries for variants that may not have been compiled; a kernel
+// without one falls back to the next set down.
+#ifdef KERNEL_AVX2
+#  define KERNEL_VARIANT_AVX2(fn)       (KernelFunc)fn
+#else
+#  define KERNEL_VARIANT_AVX2(fn)       NULL
+#endif
+#ifdef KERNEL_AVX512
+#  define KERNEL_VARIANT_AVX512(fn)     (KernelFunc)fn
+#else
+#  define KERNEL_VARIANT_AVX512(fn)     NULL
+#endif
+
+#define KERNEL_CHECK_ROUNDS     200
+#define KERNEL_BENCH_TRIALS     5
+
+typedef void (*KernelFunc)(void);
+
+typedef struct {
+	const char  *name;
+	const char  *env;                   // Per kernel override.
+	KernelFunc  variant[KERNEL_ISA_COUNT];  // NULL where there is none.
+	void        (*select)(KernelFunc fn);
+	double      (*bench)(KernelFunc fn);    // Seconds per call.
+	int         (*check)(KernelFunc fn, KernelFunc ref, uint32_t *seed);
+	KERNEL_ISA  selected;
+} Kernel;
+
+static struct {
+	int         detected;
+	int         supported[KERNEL_ISA_COUNT];
+} gKernel;
+
+static const char *kernelIsaNames[KERNEL_ISA_COUNT] = {
+	"scalar",
+	"sse2",
+	"avx2",
+	"avx512"
+};
+
+// ============================================================================
+//	CPU features
+// ============================================================================
+
+#ifdef KERNEL_X86
+static void kernelCpuid(unsigned int leaf, unsigned int sub, unsigned int r[4])
+{
+#if defined(_MSC_VER)
+	int i[4];
+
+	__cpuidex(i, (int)leaf, (int)sub);
+	r[0] = (unsigned int)i[0]; r[1] = (unsigned int)i[1]; r[2] = (unsigned int)i[2]; r[3] = (unsigned int)i[3];
+#else
+	__cpuid_count(leaf, sub, r[0], r[1], r[2], r[3]);
+#endif
+}
+
+// Register state the OS saves on a context switch (XCR0).
+static uint64_t kernelXgetbv(void)
+{
+#if defined(_MSC_VER)
+	return (uint64_t)_xgetbv(0);
+#else
+	unsigned int lo, hi;
+
+	__asm__ __volatile__ ("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+	return ((uint64_t)hi << 32) | lo;
+#endif
+}
+#endif
+
+static void kernelDetect(void)
+{
+#ifdef KERNEL_X86
+	unsigned int r[4], maxLeaf;
+	uint64_t xcr0 = 0;
+	int avx, avx2, avx512;
+#endif
+
+	if (gKernel.detected) return;
+	gKernel.detected = TRUE;
+	gKernel.supported[KERNEL_ISA_SCALAR] = TRUE;
+#ifdef KERNEL_X86
+	kernelCpuid(0, 0, r);
+	maxLeaf = r[0];
+	if (maxLeaf < 1) return;
+	kernelCpuid(1, 0, r);
+	gKernel.supported[KERNEL_ISA_SSE2] = (r[3] >> 26) & 1;
+	if ((r[2] >> 27) & 1) xcr0 = kernelXgetbv();                    // OSXSAVE.
+	avx = ((r[2] >> 28) & 1) && (xcr0 & 0x6) == 0x6;                // AVX, with XMM and YMM saved.
+	avx2 = avx512 = FALSE;
+	if (maxLeaf >= 7) {
+		kernelCpuid(7, 0, r);
+		avx2 = avx && ((r[1] >> 5) & 1);
+		avx512 = avx2 && ((r[1] >> 16) & 1) && ((r[1] >> 30) & 1)   // AVX-512F, BW,
+			&& (xcr0 & 0xE6) == 0xE6;                               // with the opmask and ZMM state saved.
+	}
+	gKernel.supported[KERNEL_ISA_AVX2] = avx2;
+	gKernel.supported[KERNEL_ISA_AVX512] = avx512;
+#endif
+}
+
+static int kernelParseIsa(const char *s, KERNEL_ISA *isa)
+{
+	int i;
+
+	if (!s || !*s) return (FALSE);
+	for (i = 0; i < KERNEL_ISA_COUNT; i++) {
+		if (strcmp(s, kernelIsaNames[i]) == 0) {
+			*isa = (KERNEL_ISA)i;
+			return (TRUE);
+		}
+	}
+	ARLOGw("Kernels: Unknown instruction set '%s' (scalar, sse2, avx2 or avx512).\n", s);
+	return (FALSE);
+}
+
+// Small deterministic generator for the check inputs.
+static uint32_t kernelRand(uint32_t *seed)
+{
+	*seed ^= *seed << 13;
+	*seed ^= *seed >> 17;
+	*seed ^= *seed << 5;
+	return *seed;
+}
+
+// ============================================================================
+//	Threshold
+// ============================================================================
+
+static void kernelThresholdScalar(const uint8_t *luma, int words, int thresh, uint64_t *out)
+{
+	uint64_t word;
+	int w, k;
+
+	for (w = 0; w < words; w++, luma += 64) {
+		word = 0;
+		for (k = 0; k < 64; k++) {
+			if (luma[k] <= thresh) word |= (uint64_t)1 << k;
+		}
+		out[w] = word;
+	}
+}
+
+#ifdef KERNEL_X86
+KERNEL_TARGET("sse2")
+static void kernelThresholdSSE2(const uint8_t *luma, int words, int thresh, uint64_t *out)
+{
+	__m128i l, t = _mm_set1_epi8((char)thresh);
+	uint64_t word;
+	int w, k;
+
+	for (w = 0; w < words; w++, luma += 64) {
+		word = 0;
+		for (k = 0; k < 4; k++) {
+			l = _mm_loadu_si128((const __m128i *)(luma + k * 16));
+			// l <= t  <=>  min(l, t) == l
+			word |= (uint64_t)(unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_min_epu8(l, t), l)) << (k * 16);
+		}
+		out[w] = word;
+	}
+}
+
+#ifdef KERNEL_AVX2
+KERNEL_TARGET("avx2")
+static void kernelThresholdAVX2(const uint8_t *luma, int words, int thresh, uint64_t *out)
+{
+	__m256i a, b, t = _mm256_set1_epi8((char)thresh);
+	int w;
+
+	for (w = 0; w < words; w++, luma += 64) {
+		a = _mm256_loadu_si256((const __m256i *)luma);
+		b = _mm256_loadu_si256((const __m256i *)(luma + 32));
+		out[w] = (uint64_t)(unsigned)_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_min_epu8(a, t), a))
+			| (uint64_t)(unsigned)_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_min_epu8(b, t), b)) << 32;
+	}
+}
+#endif
+
+#ifdef KERNEL_AVX512
+KERNEL_TARGET("avx512f,avx512bw")
+static void kernelThresholdAVX512(const uint8_t *luma, int words, int thresh, uint64_t *out)
+{
+	__m512i t = _mm512_set1_epi8((char)thresh);
+	int w;
+
+	for (w = 0; w < words; w++, luma += 64) {
+		out[w] = (uint64_t)_mm512_cmple_epu8_mask(_mm512_loadu_si512((const void *)luma), t);
+	}
+}
+#endif
+#endif
+
+KernelThresholdFunc kernelThreshold = kernelThresholdScalar;
+
+static void kernelThresholdSelect(KernelFunc fn)
+{
+	kernelThreshold = (KernelThresholdFunc)fn;
+}
+
+// One VGA luma plane.
+static double kernelThresholdBench(KernelFunc fn)
+{
+	KernelThresholdFunc f = (KernelThresholdFunc)fn;
+	const int words = 640 * 480 / 64, reps = 20;
+	uint8_t *luma;
+	uint64_t *out;
+	double t, best = 0.0;
+	int i, r;
+
+	luma = (uint8_t *)malloc((size_t)words * 64);
+	out = (uint64_t *)malloc((size_t)words * sizeof(uint64_t));
+	if (!luma || !out) {
+		free(luma);
+		free(out);
+		return 0.0;
+	}
+	for (i = 0; i < words * 64; i++) luma[i] = (uint8_t)((i * 7) ^ (i >> 6));
+	for (i = 0; i < KERNEL_BENCH_TRIALS; i++) {
+		t = timingNow();
+		for (r = 0; r < reps; r++) f(luma, words, 100, out);
+		t = (timingNow() - t) / reps;
+		if (i == 0 || t < best) best = t;
+	}
+	free(luma);
+	free(out);
+	return best;
+}
+
+// Random rows at odd offsets and lengths, and the thresholds at the ends
+// of the range.
+static int kernelThresholdCheck(KernelFunc fn, KernelFunc ref, uint32_t *seed)
+{
+	KernelThresholdFunc f = (KernelThresholdFunc)fn, g = (KernelThresholdFunc)ref;
+	uint8_t luma[17 * 64 + 64];
+	uint64_t out[17], want[17];
+	int i, round, words, offset, thresh;
+
+	for (round = 0; round < KERNEL_CHECK_ROUNDS; round++) {
+		for (i = 0; i < (int)sizeof(luma); i++) luma[i] = (uint8_t)kernelRand(seed);
+		words = 1 + (int)(kernelRand(seed) % 17);
+		offset = (int)(kernelRand(seed) % 64);
+		thresh = round % 3 == 0 ? 0 : round % 3 == 1 ? 255 : (int)(kernelRand(seed) & 0xFF);
+		f(luma + offset, words, thresh, out);
+		g(luma + offset, words, thresh, want);
+		if (memcmp(out, want, (size_t)words * sizeof(uint64_t)) != 0) return (FALSE);
+	}
+	return (TRUE);
+}
+
+// ============================================================================
+//	Bounds
+// ============================================================================
+
+static void kernelBoundsScalar(const float *xyz, unsigned int count, float min[3], float max[3])
+{
+	unsigned int i;
+	int k;
+
+	for (k = 0; k < 3; k++) min[k] = max[k] = xyz[k];
+	for (i = 1; i < count; i++) {
+		for (k = 0; k < 3; k++) {
+			if (xyz[3 * i + k] < min[k]) min[k] = xyz[3 * i + k];
+			if (xyz[3 * i + k] > max[k]) max[k] = xyz[3 * i + k];
+		}
+	}
+}
+
+#ifdef KERNEL_X86
+// The vector variants take the triples a register-width of vertices at a
+// time as three registers, without shuffling: lane j of the block is
+// always component j % 3, so each lane keeps the min and max of one
+// component and the lanes are folded together at the end. The last few
+// vertices go through the scalar loop.
+static void kernelBoundsFold(const float *lmin, const float *lmax, int lanes, const float *xyz, unsigned int i, unsigned int count, float min[3], float max[3])
+{
+	int j, k;
+
+	kernelBoundsScalar(xyz, 1, min, max);
+	for (j = 0; j < lanes; j++) {
+		k = j % 3;
+		if (lmin[j] < min[k]) min[k] = lmin[j];
+		if (lmax[j] > max[k]) max[k] = lmax[j];
+	}
+	for (; i < count; i++) {
+		for (k = 0; k < 3; k++) {
+			if (xyz[3 * i + k] < min[k]) min[k] = xyz[3 * i + k];
+			if (xyz[3 * i + k] > max[k]) max[k] = xyz[3 * i + k];
+		}
+	}
+}
+
+KERNEL_TARGET("sse2")
+static void kernelBoundsSSE2(const float *xyz, unsigned int count, float min[3], float max[3])
+{
+	float lmin[12], lmax[12];
+	__m128 v, mn[3], mx[3];
+	unsigned int i;
+	int j;
+
+	for (j = 0; j < 12; j++) lmin[j] = lmax[j] = xyz[j % 3];
+	for (j = 0; j < 3; j++) mn[j] = mx[j] = _mm_loadu_ps(lmin + j * 4);
+	for (i = 0; i + 4 <= count; i += 4) {
+		for (j = 0; j < 3; j++) {
+			v = _mm_loadu_ps(xyz + 3 * i + j * 4);
+			mn[j] = _mm_min_ps(mn[j], v);
+			mx[j] = _mm_max_ps(mx[j], v);
+		}
+	}
+	for (j = 0; j < 3; j++) {
+		_mm_storeu_ps(lmin + j * 4, mn[j]);
+		_mm_storeu_ps(lmax + j * 4, mx[j]);
+	}
+	kernelBoundsFold(lmin, lmax, 12, xyz, i, count, min, max);
+}
+
+// Only needs AVX; listed with the AVX2 kernels since every CPU with AVX2
+// has AVX.
+KERNEL_TARGET("avx")
+static void kernelBoundsAVX(const float *xyz, unsigned int count, float min[3], float max[3])
+{
+	float lmin[24], lmax[24];
+	__m256 v, mn[3], mx[3];
+	unsigned int i;
+	int j;
+
+	for (j = 0; j < 24; j++) lmin[j] = lmax[j] = xyz[j % 3];
+	for (j = 0; j < 3; j++) mn[j] = mx[j] = _mm256_loadu_ps(lmin + j * 8);
+	for (i = 0; i + 8 <= count; i += 8) {
+		for (j = 0; j < 3; j++) {
+			v = _mm256_loadu_ps(xyz + 3 * i + j * 8);
+			mn[j] = _mm256_min_ps(mn[j], v);
+			mx[j] = _mm256_max_ps(mx[j], v);
+		}
+	}
+	for (j = 0; j < 3; j++) {
+		_mm256_storeu_ps(lmin + j * 8, mn[j]);
+		_mm256_storeu_ps(lmax + j * 8, mx[j]);
+	}
+	_mm256_zeroupper();
+	kernelBoundsFold(lmin, lmax, 24, xyz, i, count, min, max);
+}
+#endif
+
+KernelBoundsFunc kernelBounds = kernelBoundsScalar;
+
+static void kernelBoundsSelect(KernelFunc fn)
+{
+	kernelBounds = (KernelBoundsFunc)fn;
+}
+
+// A 100k vertex model.
+static double kernelBoundsBench(KernelFunc fn)
+{
+	KernelBoundsFunc f = (KernelBoundsFunc)fn;
+	const unsigned int count = 100000;
+	const int reps = 20;
+	float *xyz, min[3], max[3];
+	double t, best = 0.0;
+	unsigned int i;
+	int r;
+
+	if (!(xyz = (float *)malloc((size_t)count * 3 * sizeof(float)))) return 0.0;
+	for (i = 0; i < count * 3; i++) xyz[i] = (float)((i * 37) % 1001) - 500.0f;
+	for (i = 0; i < KERNEL_BENCH_TRIALS; i++) {
+		t = timingNow();
+		for (r = 0; r < reps; r++) f(xyz, count, min, max);
+		t = (timingNow() - t) / reps;
+		if (i == 0 || t < best) best = t;
+	}
+	free(xyz);
+	return best;
+}
+
+// Every vertex count up to a few blocks, so each tail length is covered.
+static int kernelBoundsCheck(KernelFunc fn, KernelFunc ref, uint32_t *seed)
+{
+	KernelBoundsFunc f = (KernelBoundsFunc)fn, g = (KernelBoundsFunc)ref;
+	float xyz[3 * 64], min[3], max[3], wmin[3], wmax[3];
+	unsigned int i, count;
+	int round;
+
+	for (round = 0; round < KERNEL_CHECK_ROUNDS; round++) {
+		count = 1 + (unsigned int)round % 64;
+		for (i = 0; i < 3 * count; i++) xyz[i] = (float)((int)(kernelRand(seed) % 20001) - 10000) * 0.01f;
+		f(xyz, count, min, max);
+		g(xyz, count, wmin, wmax);
+		if (memcmp(min, wmin, sizeof(min)) != 0 || memcmp(max, wmax, sizeof(max)) != 0) return (FALSE);
+	}
+	return (TRUE);
+}
+
+// ============================================================================
+//	Unwarp
+// ============================================================================
+
+// One sample, with the operations in the order every variant uses, so
+// that all of them round alike.
+static inline int kernelUnwarpSample(const uint8_t *luma, int xsize, int ysize, float cx, float cy, float cw)
+{
+	float x = cx / cw + 0.5f, y = cy / cw + 0.5f;
+
+	if (x > -1.0f && x < (float)xsize && y > -1.0f && y < (float)ysize) return luma[(int)y * xsize + (int)x];
+	return 0;
+}
+
+// Adds a row of samples into the cells of the current row of cells, and
+// writes the cells out after their last row.
+static void kernelUnwarpFold(const int *v, int j, int cols, int rows, int cells, uint32_t *sums, uint8_t *out)
+{
+	const int sx = cols / cells, sy = rows / cells;
+	int i, c;
+
+	if (j % sy == 0) memset(sums, 0, (size_t)cells * sizeof(uint32_t));
+	for (c = 0; c < cells; c++) {
+		for (i = c * sx; i < (c + 1) * sx; i++) sums[c] += (uint32_t)v[i];
+	}
+	if (j % sy == sy - 1) {
+		for (c = 0; c < cells; c++) out[(j / sy) * cells + c] = (uint8_t)(sums[c] / (uint32_t)(sx * sy));
+	}
+}
+
+static void kernelUnwarpScalar(const uint8_t *luma, int xsize, int ysize, const float *col, int cols, const float *row, int rows, int cells, uint8_t *out)
+{
+	int v[KERNEL_UNWARP_MAX];
+	uint32_t sums[KERNEL_UNWARP_MAX];
+	int i, j;
+
+	for (j = 0; j < rows; j++) {
+		for (i = 0; i < cols; i++) {
+			v[i] = kernelUnwarpSample(luma, xsize, ysize, col[i] + row[j], col[cols + i] + row[rows + j], col[2 * cols + i] + row[2 * rows + j]);
+		}
+		kernelUnwarpFold(v, j, cols, rows, cells, sums, out);
+	}
+}
+
+#ifdef KERNEL_X86
+// Four samples at a time; SSE2 has no gather, so the loads are scalar.
+KERNEL_TARGET("sse2")
+static void kernelUnwarpSSE2(const uint8_t *luma, int xsize, int ysize, const float *col, int cols, const float *row, int rows, int cells, uint8_t *out)
+{
+	const __m128 half = _mm_set1_ps(0.5f), lo = _mm_set1_ps(-1.0f), xs = _mm_set1_ps((float)xsize), ys = _mm_set1_ps((float)ysize);
+	__m128 rx, ry, rw, w, x, y, m;
+	int v[KERNEL_UNWARP_MAX], xi[4], yi[4];
+	uint32_t sums[KERNEL_UNWARP_MAX];
+	int i, j, k, mask;
+
+	for (j = 0; j < rows; j++) {
+		rx = _mm_set1_ps(row[j]);
+		ry = _mm_set1_ps(row[rows + j]);
+		rw = _mm_set1_ps(row[2 * rows + j]);
+		for (i = 0; i + 4 <= cols; i += 4) {
+			w = _mm_add_ps(_mm_loadu_ps(col + 2 * cols + i), rw);
+			x = _mm_add_ps(_mm_div_ps(_mm_add_ps(_mm_loadu_ps(col + i), rx), w), half);
+			y = _mm_add_ps(_mm_div_ps(_mm_add_ps(_mm_loadu_ps(col + cols + i), ry), w), half);
+			m = _mm_and_ps(_mm_and_ps(_mm_cmpgt_ps(x, lo), _mm_cmplt_ps(x, xs)), _mm_and_ps(_mm_cmpgt_ps(y, lo), _mm_cmplt_ps(y, ys)));
+			mask = _mm_movemask_ps(m);
+			_mm_storeu_si128((__m128i *)xi, _mm_cvttps_epi32(x));
+			_mm_storeu_si128((__m128i *)yi, _mm_cvttps_epi32(y));
+			for (k = 0; k < 4; k++) v[i + k] = (mask >> k & 1) ? luma[yi[k] * xsize + xi[k]] : 0;
+		}
+		for (; i < cols; i++) {
+			v[i] = kernelUnwarpSample(luma, xsize, ysize, col[i] + row[j], col[cols + i] + row[rows + j], col[2 * cols + i] + row[2 * rows + j]);
+		}
+		kernelUnwarpFold(v, j, cols, rows, cells, sums, out);
+	}
+}
+
+#ifdef KERNEL_AVX2
+// Eight samples at a time, gathered as the aligned dwords holding them,
+// which cannot fault past either end of the plane.
+KERNEL_TARGET("avx2")
+static void kernelUnwarpAVX2(const uint8_t *luma, int xsize, int ysize, const float *col, int cols, const float *row, int rows, int cells, uint8_t *out)
+{
+	const __m256 half = _mm256_set1_ps(0.5f), lo = _mm256_set1_ps(-1.0f), xs = _mm256_set1_ps((float)xsize), ys = _mm256_set1_ps((float)ysize);
+	const __m256i stride = _mm256_set1_epi32(xsize), three = _mm256_set1_epi32(3), bytes = _mm256_set1_epi32(0xFF);
+	const __m256i skew = _mm256_set1_epi32((int)((uintptr_t)luma & 3));
+	const int *base = (const int *)((uintptr_t)luma & ~(uintptr_t)3);
+	__m256 rx, ry, rw, w, x, y, m;
+	__m256i at, g;
+	int v[KERNEL_UNWARP_MAX];
+	uint32_t sums[KERNEL_UNWARP_MAX];
+	int i, j;
+
+	for (j = 0; j < rows; j++) {
+		rx = _mm256_set1_ps(row[j]);
+		ry = _mm256_set1_ps(row[rows + j]);
+		rw = _mm256_set1_ps(row[2 * rows + j]);
+		for (i = 0; i + 8 <= cols; i += 8) {
+			w = _mm256_add_ps(_mm256_loadu_ps(col + 2 * cols + i), rw);
+			x = _mm256_add_ps(_mm256_div_ps(_mm256_add_ps(_mm256_loadu_ps(col + i), rx), w), half);
+			y = _mm256_add_ps(_mm256_div_ps(_mm256_add_ps(_mm256_loadu_ps(col + cols + i), ry), w), half);
+			m = _mm256_and_ps(_mm256_and_ps(_mm256_cmp_ps(x, lo, _CMP_GT_OQ), _mm256_cmp_ps(x, xs, _CMP_LT_OQ)),
+				_mm256_and_ps(_mm256_cmp_ps(y, lo, _CMP_GT_OQ), _mm256_cmp_ps(y, ys, _CMP_LT_OQ)));
+			at = _mm256_add_epi32(_mm256_add_epi32(_mm256_mullo_epi32(_mm256_cvttps_epi32(y), stride), _mm256_cvttps_epi32(x)), skew);
+			at = _mm256_and_si256(at, _mm256_castps_si256(m));
+			g = _mm256_mask_i32gather_epi32(_mm256_setzero_si256(), base, _mm256_andnot_si256(three, at), _mm256_castps_si256(m), 1);
+			g = _mm256_and_si256(_mm256_srlv_epi32(g, _mm256_slli_epi32(_mm256_and_si256(at, three), 3)), bytes);
+			_mm256_storeu_si256((__m256i *)(v + i), g);
+		}
+		for (; i < cols; i++) {
+			v[i] = kernelUnwarpSample(luma, xsize, ysize, col[i] + row[j], col[cols + i] + row[rows + j], col[2 * cols + i] + row[2 * rows + j]);
+		}
+		kernelUnwarpFold(v, j, cols, rows, cells, sums, out);
+	}
+}
+#endif
+
+#ifdef KERNEL_AVX512
+KERNEL_TARGET("avx512f,avx512bw")
+static void kernelUnwarpAVX512(const uint8_t *luma, int xsize, int ysize, const float *col, int cols, const float *row, int rows, int cells, uint8_t *out)
+{
+	const __m512 half = _mm512_set1_ps(0.5f), lo = _mm512_set1_ps(-1.0f), xs = _mm512_set1_ps((float)xsize), ys = _mm512_set1_ps((float)ysize);
+	const __m512i stride = _mm512_set1_epi32(xsize), three = _mm512_set1_epi32(3), dword = _mm512_set1_epi32(~3), bytes = _mm512_set1_epi32(0xFF);
+	const __m512i skew = _mm512_set1_epi32((int)((uintptr_t)luma & 3));
+	const int *base = (const int *)((uintptr_t)luma & ~(uintptr_t)3);
+	__m512 rx, ry, rw, w, x, y;
+	__m512i at, g;
+	__mmask16 m;
+	int v[KERNEL_UNWARP_MAX];
+	uint32_t sums[KERNEL_UNWARP_MAX];
+	int i, j;
+
+	for (j = 0; j < rows; j++) {
+		rx = _mm512_set1_ps(row[j]);
+		ry = _mm512_set1_ps(row[rows + j]);
+		rw = _mm512_set1_ps(row[2 * rows + j]);
+		for (i = 0; i + 16 <= cols; i += 16) {
+			w = _mm512_add_ps(_mm512_loadu_ps(col + 2 * cols + i), rw);
+			x = _mm512_add_ps(_mm512_div_ps(_mm512_add_ps(_mm512_loadu_ps(col + i), rx), w), half);
+			y = _mm512_add_ps(_mm512_div_ps(_mm512_add_ps(_mm512_loadu_ps(col + cols + i), ry), w), half);
+			m = _mm512_cmp_ps_mask(x, lo, _CMP_GT_OQ) & _mm512_cmp_ps_mask(x, xs, _CMP_LT_OQ) &
+				_mm512_cmp_ps_mask(y, lo, _CMP_GT_OQ) & _mm512_cmp_ps_mask(y, ys, _CMP_LT_OQ);
+			// The masked forms throughout; GCC's unmasked ones trip -Wmaybe-uninitialized.
+			at = _mm512_maskz_add_epi32(m, _mm512_add_epi32(_mm512_mullo_epi32(_mm512_maskz_cvttps_epi32(m, y), stride), _mm512_maskz_cvttps_epi32(m, x)), skew);
+			g = _mm512_mask_i32gather_epi32(_mm512_setzero_si512(), m, _mm512_and_si512(at, dword), base, 1);
+			g = _mm512_and_si512(_mm512_maskz_srlv_epi32(m, g, _mm512_maskz_slli_epi32(m, _mm512_and_si512(at, three), 3)), bytes);
+			_mm512_storeu_si512((void *)(v + i), g);
+		}
+		for (; i < cols; i++) {
+			v[i] = kernelUnwarpSample(luma, xsize, ysize, col[i] + row[j], col[cols + i] + row[rows + j], col[2 * cols + i] + row[2 * rows + j]);
+		}
+		kernelUnwarpFold(v, j, cols, rows, cells, sums, out);
+	}
+}
+#endif
+#endif
+
+KernelUnwarpFunc kernelUnwarp = kernelUnwarpScalar;
+
+static void kernelUnwarpSelect(KernelFunc fn)
+{
+	kernelUnwarp = (KernelUnwarpFunc)fn;
+}
+
+void kernelUnwarpTerms(const double quad[8], double ratio, float *col, int cols, float *row, int rows)
+{
+	const double *q = quad;
+	double dx1 = q[2] - q[4], dx2 = q[6] - q[4], dy1 = q[3] - q[5], dy2 = q[7] - q[5];
+	double sx = q[0] - q[2] + q[4] - q[6], sy = q[1] - q[3] + q[5] - q[7];
+	double det = dx1 * dy2 - dx2 * dy1, g, h, a, b, c, d, e, f, t;
+	int i;
+
+	// Square to quad (Heckbert); affine when sx and sy are 0.
+	g = (sx * dy2 - dx2 * sy) / det;
+	h = (dx1 * sy - sx * dy1) / det;
+	a = q[2] - q[0] + g * q[2]; b = q[6] - q[0] + h * q[6]; c = q[0];
+	d = q[3] - q[1] + g * q[3]; e = q[7] - q[1] + h * q[7]; f = q[1];
+	for (i = 0; i < cols; i++) {
+		t = (1.0 - ratio) * 0.5 + ratio * (i + 0.5) / cols;
+		col[i] = (float)(a * t); col[cols + i] = (float)(d * t); col[2 * cols + i] = (float)(g * t);
+	}
+	for (i = 0; i < rows; i++) {
+		t = (1.0 - ratio) * 0.5 + ratio * (i + 0.5) / rows;
+		row[i] = (float)(b * t + c); row[rows + i] = (float)(e * t + f); row[2 * rows + i] = (float)(h * t + 1.0);
+	}
+}
+
+// One 64 x 64 sample, 16 x 16 cell pattern, a candidate of about 120
+// pixels across in a VGA frame.
+static double kernelUnwarpBench(KernelFunc fn)
+{
+	KernelUnwarpFunc f = (KernelUnwarpFunc)fn;
+	const int xsize = 640, ysize = 480, n = 64, reps = 200;
+	const double q[8] = { 250.0, 180.0, 372.0, 196.0, 360.0, 310.0, 244.0, 300.0 };
+	float col[3 * 64], row[3 * 64];
+	uint8_t *luma, out[16 * 16];
+	double t, best = 0.0;
+	int i, r;
+
+	if (!(luma = (uint8_t *)malloc((size_t)xsize * ysize))) return 0.0;
+	for (i = 0; i < xsize * ysize; i++) luma[i] = (uint8_t)((i * 7) ^ (i >> 6));
+	kernelUnwarpTerms(q, 0.5, col, n, row, n);
+	for (i = 0; i < KERNEL_BENCH_TRIALS; i++) {
+		t = timingNow();
+		for (r = 0; r < reps; r++) f(luma, xsize, ysize, col, n, row, n, 16, out);
+		t = (timingNow() - t) / reps;
+		if (i == 0 || t < best) best = t;
+	}
+	free(luma);
+	return best;
+}
+
+// Random quads over an odd sized plane at an odd offset, some partly or
+// wholly off it and some folded, so that clipping and the tails are
+// covered.
+static int kernelUnwarpCheck(KernelFunc fn, KernelFunc ref, uint32_t *seed)
+{
+	KernelUnwarpFunc f = (KernelUnwarpFunc)fn, g = (KernelUnwarpFunc)ref;
+	const int xsize = 97, ysize = 83;
+	static uint8_t luma[97 * 83 + 3];
+	double q[8];
+	float col[3 * 96], row[3 * 96];
+	uint8_t out[16 * 16], want[16 * 16];
+	int i, round, cells, n, offset;
+
+	for (round = 0; round < KERNEL_CHECK_ROUNDS; round++) {
+		for (i = 0; i < (int)sizeof(luma); i++) luma[i] = (uint8_t)kernelRand(seed);
+		for (i = 0; i < 8; i++) q[i] = (double)((int)(kernelRand(seed) % 140) - 20);
+		cells = 4 + (int)(kernelRand(seed) % 13);
+		n = cells * (1 + (int)(kernelRand(seed) % (96 / cells)));
+		offset = (int)(kernelRand(seed) % 4);
+		kernelUnwarpTerms(q, 0.25 + 0.25 * (round % 4), col, n, row, n);
+		f(luma + offset, xsize, ysize, col, n, row, n, cells, out);
+		g(luma + offset, xsize, ysize, col, n, row, n, cells, want);
+		if (memcmp(out, want, (size_t)cells * cells) != 0) return (FALSE);
+	}
+	return (TRUE);
+}
+
+// ============================================================================
+//	Registry
+// ============================================================================
+
+static Kernel gKernels[] = {
+	{ "threshold", "KERNEL_THRESHOLD",
+#ifdef KERNEL_X86
+		{ (KernelFunc)kernelThresholdScalar, (KernelFunc)kernelThresholdSSE2, KERNEL_VARIANT_AVX2(kernelThresholdAVX2), KERNEL_VARIANT_AVX512(kernelThresholdAVX512) },
+#else
+		{ (KernelFunc)kernelThresholdScalar, NULL, NULL, NULL },
+#endif
+		kernelThresholdSelect, kernelThresholdBench, kernelThresholdCheck, KERNEL_ISA_SCALAR },
+	{ "bounds", "KERNEL_BOUNDS",
+#ifdef KERNEL_X86
+		{ (KernelFunc)kernelBoundsScalar, (KernelFunc)kernelBoundsSSE2, (KernelFunc)kernelBoundsAVX, NULL },
+#else
+		{ (KernelFunc)kernelBoundsScalar, NULL, NULL, NULL },
+#endif
+		kernelBoundsSelect, kernelBoundsBench, kernelBoundsCheck, KERNEL_ISA_SCALAR },
+	{ "unwarp", "KERNEL_UNWARP",
+#ifdef KERNEL_X86
+		{ (KernelFunc)kernelUnwarpScalar, (KernelFunc)kernelUnwarpSSE2, KERNEL_VARIANT_AVX2(kernelUnwarpAVX2), KERNEL_VARIANT_AVX512(kernelUnwarpAVX512) },
+#else
+		{ (KernelFunc)kernelUnwarpScalar, NULL, NULL, NULL },
+#endif
+		kernelUnwarpSelect, kernelUnwarpBench, kernelUnwarpCheck, KERNEL_ISA_SCALAR }
+};
+
+#define KERNEL_COUNT            ((int)(sizeof(gKernels) / sizeof(gKernels[0])))
+
+static int kernelRunnable(const Kernel *kn, int isa)
+{
+	return (kn->variant[isa] != NULL && gKernel.supported[isa]);
+}
+
+static void kernelUse(Kernel *kn, KERNEL_ISA isa)
+{
+	kn->selected = isa;
+	kn->select(kn->variant[isa]);
+}
+
+// Highest instruction set allowed by KERNEL_ISA.
+static KERNEL_ISA kernelCap(void)
+{
+	KERNEL_ISA cap;
+
+	if (!kernelParseIsa(getenv("KERNEL_ISA"), &cap)) cap = (KERNEL_ISA)(KERNEL_ISA_COUNT - 1);
+	return cap;
+}
+
+// The variant named by the kernel's own variable, if it can run.
+static int kernelOverride(const Kernel *kn, KERNEL_ISA *isa)
+{
+	if (!kernelParseIsa(getenv(kn->env), isa)) return (FALSE);
+	if (!kernelRunnable(kn, *isa)) {
+		ARLOGw("Kernels: %s has no %s variant this CPU can run.\n", kn->name, kernelIsaNames[*isa]);
+		return (FALSE);
+	}
+	return (TRUE);
+}
+
+void kernelInit(void)
+{
+	KERNEL_ISA cap, isa;
+	int i, j;
+
+	kernelDetect();
+	cap = kernelCap();
+	for (i = 0; i < KERNEL_COUNT; i++) {
+		if (!kernelOverride(&gKernels[i], &isa)) {
+			isa = KERNEL_ISA_SCALAR;
+			for (j = cap; j > KERNEL_ISA_SCALAR; j--) {
+				if (kernelRunnable(&gKernels[i], j)) {
+					isa = (KERNEL_ISA)j;
+					break;
+				}
+			}
+		}
+		kernelUse(&gKernels[i], isa);
+	}
+}
+
+void kernelBenchmark(void)
+{
+	KERNEL_ISA cap, isa;
+	double t, best;
+	int i, j;
+
+	kernelDetect();
+	cap = kernelCap();
+	for (i = 0; i < KERNEL_COUNT; i++) {
+		if (!kernelOverride(&gKernels[i], &isa)) {
+			isa = KERNEL_ISA_SCALAR;
+			best = gKernels[i].bench(gKernels[i].variant[KERNEL_ISA_SCALAR]);
+			for (j = KERNEL_ISA_SCALAR + 1; j <= cap; j++) {
+				if (!kernelRunnable(&gKernels[i], j)) continue;
+				t = gKernels[i].bench(gKernels[i].variant[j]);
+				if (t < best) {
+					best = t;
+					isa = (KERNEL_ISA)j;
+				}
+			}
+			ARLOGi("Kernels: %s fastest as %s, %.1f us.\n", gKernels[i].name, kernelIsaNames[isa], best * 1e6);
+		}
+		kernelUse(&gKernels[i], isa);
+	}
+}
+
+int kernelCheck(void)
+{
+	uint32_t seed;
+	int i, j, fail = 0;
+
+	kernelDetect();
+	for (i = 0; i < KERNEL_COUNT; i++) {
+		for (j = KERNEL_ISA_SCALAR + 1; j < KERNEL_ISA_COUNT; j++) {
+			if (!gKernels[i].variant[j]) continue;
+			if (!gKernel.supported[j]) {
+				ARLOGi("Kernels: %s %s skipped, not supported by this CPU.\n", gKernels[i].name, kernelIsaNames[j]);
+				continue;
+			}
+			seed = 0x9E3779B9u;
+			if (gKernels[i].check(gKernels[i].variant[j], gKernels[i].variant[KERNEL_ISA_SCALAR], &seed)) {
+				ARLOGi("Kernels: %s %s matches scalar.\n", gKernels[i].name, kernelIsaNames[j]);
+			}
+			else {
+				ARLOGe("Kernels: %s %s differs from scalar.\n", gKernels[i].name, kernelIsaNames[j]);
+				fail++;
+			}
+		}
+	}
+	return fail;
+}
+
+int kernelCount(void)
+{
+	return KERNEL_COUNT;
+}
+
+const char *kernelName(int kernel)
+{
+	if (kernel < 0 || kernel >= KERNEL_COUNT) return "unknown";
+	return gKernels[kernel].name;
+}
+
+KERNEL_ISA kernelSelected(int kernel)
+{
+	if (kernel < 0 || kernel >= KERNEL_COUNT) return KERNEL_ISA_SCALAR;
+	return gKernels[kernel].selected;
+}
+
+int kernelIsaSupported(KERNEL_ISA isa)
+{
+	if (isa < 0 || isa >= KERNEL_ISA_COUNT) return (FALSE);
+	kernelDetect();
+	return gKernel.supported[isa];
+}
+
+const char *kernelIsaName(KERNEL_ISA isa)
+{
+	if (isa < 0 || isa >= KERNEL_ISA_COUNT) return "unknown";
+	return kernelIsaNames[isa];
+}
@@ -0,0 +1,80 @@
+/*
+*  Kernels.h
+*
+*  Runtime selection of the vectorized inner loops.
+*
+*  Each kernel is compiled for several instruction sets in the one
+*  binary (scalar, SSE2, AVX/AVX2, AVX-512BW on x86; scalar elsewhere)
+*  and called through a function pointer. kernelInit() reads the CPU's
+*  features with cpuid, and the OS's register saving with xgetbv, and
+*  points each kernel at the best variant both support. Until then,
+*  the pointers are the scalar variants, so kernels may be called at
+*  any time.
+*
+*  Environment overrides, for testing each variant on one machine:
+*    KERNEL_ISA=scalar|sse2|avx2|avx512   highest set to use for all kernels
+*    KERNEL_<NAME>=<isa>                  variant of one kernel, e.g. KERNEL_THRESHOLD=sse2
+*  An override the CPU cannot run falls back to the best it can.
+*
+*  kernelBenchmark() times every runnable variant of each kernel on
+*  synthetic data and picks the fastest instead (overrides still win).
+*  kernelCheck() runs every runnable variant against the scalar one.
+*
+*/
+
+#ifndef KERNELS_H
+#define KERNELS_H
+
+// No ARToolKit types here, so GLM can use the kernels too.
+#include <stdint.h>
+
+typedef enum {
+	KERNEL_ISA_SCALAR = 0,
+	KERNEL_ISA_SSE2,
+	KERNEL_ISA_AVX2,                    // With AVX; the bounds kernel only needs AVX.
+	KERNEL_ISA_AVX512,                  // AVX-512F and BW.
+	KERNEL_ISA_COUNT
+} KERNEL_ISA;
+
+// Bit k of out[w] is set when luma[64 * w + k] <= thresh (0-255).
+typedef void (*KernelThresholdFunc)(const uint8_t *luma, int words, int thresh, uint64_t *out);
+
+// Bounding box of count (at least 1) xyz triples.
+typedef void (*KernelBoundsFunc)(const float *xyz, unsigned int count, float min[3], float max[3]);
+
+#define KERNEL_UNWARP_MAX       256     // Most samples across a pattern.
+
+// Samples a luma plane through a homography and averages the samples
+// into cells x cells bytes. The homography is split into the terms of
+// each sample column and row: sample (i, j) is at
+//   x = (col[i] + row[j]) / w + 0.5, y = (col[cols + i] + row[rows + j]) / w + 0.5,
+//   w = col[2 * cols + i] + row[2 * rows + j],
+// truncated, as ARToolKit rounds. Samples outside the plane count as 0.
+// cols and rows (at most KERNEL_UNWARP_MAX) are multiples of cells.
+typedef void (*KernelUnwarpFunc)(const uint8_t *luma, int xsize, int ysize, const float *col, int cols, const float *row, int rows, int cells, uint8_t *out);
+
+// Fills col (3 * cols) and row (3 * rows) for kernelUnwarp() from the
+// quad's corners (x0 y0 ... x3 y3, in order from the unit square's
+// (0, 0) to (0, 1)), sampling the middle ratio of it.
+void        kernelUnwarpTerms(const double quad[8], double ratio, float *col, int cols, float *row, int rows);
+
+extern KernelThresholdFunc kernelThreshold;
+extern KernelBoundsFunc    kernelBounds;
+extern KernelUnwarpFunc    kernelUnwarp;
+
+// Picks a variant of each kernel by CPU features and the environment.
+void        kernelInit(void);
+
+// Picks the fastest variant of each kernel instead.
+void        kernelBenchmark(void);
+
+// Returns the number of variants that disagree with the scalar one.
+int         kernelCheck(void);
+
+int         kernelCount(void);
+const char  *kernelName(int kernel);
+KERNEL_ISA  kernelSelected(int kernel);
+int         kernelIsaSupported(KERNEL_ISA isa);
+const char  *kernelIsaName(KERNEL_ISA isa);
+
+#endif // !KERNELS_H
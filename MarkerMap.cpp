@@ -0,0 +1,545 @@
+/*
+*  MarkerMap.cpp
+*
+*  Marker map and multi-marker pose. See MarkerMap.h.
+*
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <atomic>
+#ifdef _WIN32
+#  include <windows.h>
+#else
+#  include <pthread.h>
+#  include <unistd.h>
+#endif
+#include <AR/ar.h>
+#include <AR/arMulti.h>
+#include "MarkerMap.h"
+
+#define MARKER_MAP_EDGE_MAX     (MARKER_MAP_MAX * (MARKER_MAP_MAX - 1) / 2)
+#define MARKER_MAP_NAME_MAX     256
+#define MARKER_MAP_TOLERANCE    0.01    // mm. Sweeps stop once no marker moves further.
+#define MARKER_MAP_POLL         0.01    // Seconds between optimizer checks for work.
+
+enum {
+	MAP_IDLE = 0,                       // Work is the GLUT thread's.
+	MAP_SUBMITTED,                      // Work is the optimizer's.
+	MAP_DONE                            // Work holds a result for the GLUT thread.
+};
+
+typedef struct {
+	int         pattId;
+	char        pattName[MARKER_MAP_NAME_MAX];
+	ARdouble    width;
+	int         placed;
+	ARdouble    trans[3][4];            // Marker to map.
+} MapMarker;
+
+typedef struct {
+	int         a, b;                   // Marker indices, a < b.
+	long        count;
+	double      weight;                 // Weighted sums of b in a's frame.
+	ARdouble    quat[4];
+	ARdouble    pos[3];
+} MapEdge;
+
+// A copy of the map for the optimizer to work on.
+typedef struct {
+	int         markerNum;
+	int         placed[MARKER_MAP_MAX];
+	ARdouble    width[MARKER_MAP_MAX];
+	ARdouble    trans[MARKER_MAP_MAX][3][4];
+	int         edgeNum;
+	int         a[MARKER_MAP_EDGE_MAX], b[MARKER_MAP_EDGE_MAX];
+	double      weight[MARKER_MAP_EDGE_MAX];
+	ARdouble    rel[MARKER_MAP_EDGE_MAX][3][4];     // Mean b in a's frame.
+	ARdouble    relInv[MARKER_MAP_EDGE_MAX][3][4];
+	int         sweeps;
+	double      residual;
+} MapWork;
+
+static struct {
+	MapMarker               markers[MARKER_MAP_MAX];
+	int                     markerNum;
+	MapEdge                 edges[MARKER_MAP_EDGE_MAX];
+	int                     edgeNum;
+	int                     mapping;
+	int                     dirty;              // Edges changed since the last submission.
+	MarkerMapStats          stats;
+
+	ARMultiEachMarkerInfoT  multiMarkers[MARKER_MAP_MAX];
+	ARMultiMarkerInfoT      multi;              // The placed markers, for arGetTransMatMultiSquareRobust().
+
+	MapWork                 work;
+	std::atomic<int>        state;
+	std::atomic<int>        running;
+#ifdef _WIN32
+	HANDLE                  optimizer;
+#else
+	pthread_t               optimizer;
+#endif
+} gMap;
+
+// ============================================================================
+//	Optimizer thread
+// ============================================================================
+
+static void mapSetIdentity(ARdouble m[3][4])
+{
+	int i, j;
+
+	for (i = 0; i < 3; i++) for (j = 0; j < 4; j++) m[i][j] = (i == j) ? 1.0 : 0.0;
+}
+
+// Gauss-Seidel over the marker poses: each placed marker but the origin
+// moves in turn to the weighted mean of where its edges put it, until
+// no marker moves more than MARKER_MAP_TOLERANCE. Rotations are moved
+// by the angle times the marker width, so both are in mm.
+static void mapOptimize(MapWork *w)
+{
+	ARdouble pred[3][4], q[4], p[3], cur[4], curP[3], sumQ[4], sumP[3];
+	double weight, we, dot, len, move, change, err, errWeight;
+	int sweep, i, j, e, k;
+
+	for (sweep = 0; sweep < MARKER_MAP_SWEEPS; sweep++) {
+		change = 0.0;
+		for (i = 1; i < w->markerNum; i++) {
+			if (!w->placed[i]) continue;
+			arUtilMat2QuatPos(w->trans[i], cur, curP);
+			for (k = 0; k < 4; k++) sumQ[k] = 0.0;
+			for (k = 0; k < 3; k++) sumP[k] = 0.0;
+			weight = 0.0;
+			for (e = 0; e < w->edgeNum; e++) {
+				if (w->a[e] == i && w->placed[w->b[e]]) arUtilMatMul(w->trans[w->b[e]], w->relInv[e], pred);
+				else if (w->b[e] == i && w->placed[w->a[e]]) arUtilMatMul(w->trans[w->a[e]], w->rel[e], pred);
+				else continue;
+				arUtilMat2QuatPos(pred, q, p);
+				we = w->weight[e];
+				dot = q[0]*cur[0] + q[1]*cur[1] + q[2]*cur[2] + q[3]*cur[3];
+				if (dot < 0.0) we = -we;    // q and -q are the same rotation.
+				for (k = 0; k < 4; k++) sumQ[k] += (ARdouble)(we * q[k]);
+				for (k = 0; k < 3; k++) sumP[k] += (ARdouble)(w->weight[e] * p[k]);
+				weight += w->weight[e];
+			}
+			if (weight <= 0.0) continue;
+
+			len = sqrt(sumQ[0]*sumQ[0] + sumQ[1]*sumQ[1] + sumQ[2]*sumQ[2] + sumQ[3]*sumQ[3]);
+			if (len <= 0.0) continue;
+			for (k = 0; k < 4; k++) sumQ[k] = (ARdouble)(sumQ[k] / len);
+			for (k = 0; k < 3; k++) sumP[k] = (ARdouble)(sumP[k] / weight);
+			dot = fabs(sumQ[0]*cur[0] + sumQ[1]*cur[1] + sumQ[2]*cur[2] + sumQ[3]*cur[3]);
+			move = 2.0 * acos(dot > 1.0 ? 1.0 : dot) * w->width[i];
+			for (k = 0, len = 0.0; k < 3; k++) len += (sumP[k] - curP[k]) * (sumP[k] - curP[k]);
+			move += sqrt(len);
+			if (move > change) change = move;
+			arUtilQuatPos2Mat(sumQ, sumP, w->trans[i]);
+		}
+		if (change < MARKER_MAP_TOLERANCE) break;
+	}
+	w->sweeps = sweep < MARKER_MAP_SWEEPS ? sweep + 1 : MARKER_MAP_SWEEPS;
+
+	// How far, in the mean, each edge would put its second marker from
+	// where the map has it.
+	err = errWeight = 0.0;
+	for (e = 0; e < w->edgeNum; e++) {
+		if (!w->placed[w->a[e]] || !w->placed[w->b[e]]) continue;
+		arUtilMatMul(w->trans[w->a[e]], w->rel[e], pred);
+		for (j = 0, len = 0.0; j < 3; j++) len += (pred[j][3] - w->trans[w->b[e]][j][3]) * (pred[j][3] - w->trans[w->b[e]][j][3]);
+		err += w->weight[e] * len;
+		errWeight += w->weight[e];
+	}
+	w->residual = errWeight > 0.0 ? sqrt(err / errWeight) : 0.0;
+}
+
+#ifdef _WIN32
+static DWORD WINAPI mapThread(LPVOID arg)
+#else
+static void *mapThread(void *arg)
+#endif
+{
+	(void)arg;
+	while (gMap.running.load()) {
+		if (gMap.state.load(std::memory_order_acquire) == MAP_SUBMITTED) {
+			mapOptimize(&gMap.work);
+			gMap.state.store(MAP_DONE, std::memory_order_release);
+			continue;
+		}
+#ifdef _WIN32
+		Sleep((DWORD)(MARKER_MAP_POLL*1000.0));
+#else
+		usleep((useconds_t)(MARKER_MAP_POLL*1e6));
+#endif
+	}
+	return 0;
+}
+
+// ============================================================================
+//	GLUT thread side
+// ============================================================================
+
+// The placed markers as an ARToolKit multi-marker configuration.
+static void mapBuildMulti(void)
+{
+	ARMultiEachMarkerInfoT *m;
+	ARdouble corner[4][2];
+	int i, j, k, n;
+
+	n = 0;
+	for (i = 0; i < gMap.markerNum; i++) {
+		if (!gMap.markers[i].placed) continue;
+		m = &gMap.multiMarkers[n++];
+		memset(m, 0, sizeof(ARMultiEachMarkerInfoT));
+		m->patt_id = gMap.markers[i].pattId;
+		m->patt_type = AR_MULTI_PATTERN_TYPE_TEMPLATE;
+		m->width = gMap.markers[i].width;
+		memcpy(m->trans, gMap.markers[i].trans, sizeof(m->trans));
+		arUtilMatInv(m->trans, m->itrans);
+
+		// Corners as arMultiReadConfigFile() has them.
+		corner[0][0] = -m->width*0.5; corner[0][1] =  m->width*0.5;
+		corner[1][0] =  m->width*0.5; corner[1][1] =  m->width*0.5;
+		corner[2][0] =  m->width*0.5; corner[2][1] = -m->width*0.5;
+		corner[3][0] = -m->width*0.5; corner[3][1] = -m->width*0.5;
+		for (j = 0; j < 4; j++) {
+			for (k = 0; k < 3; k++) {
+				m->pos3d[j][k] = m->trans[k][0]*corner[j][0] + m->trans[k][1]*corner[j][1] + m->trans[k][3];
+			}
+		}
+	}
+	gMap.multi.marker = gMap.multiMarkers;
+	gMap.multi.marker_num = n;
+	gMap.multi.prevF = 0;
+	gMap.stats.placed = n;
+}
+
+// Take up a finished optimization, if there is one.
+static void mapCollect(void)
+{
+	int i;
+
+	if (gMap.state.load(std::memory_order_acquire) != MAP_DONE) return;
+	for (i = 0; i < gMap.work.markerNum; i++) {
+		if (gMap.work.placed[i]) memcpy(gMap.markers[i].trans, gMap.work.trans[i], sizeof(gMap.markers[i].trans));
+	}
+	gMap.stats.optimizations++;
+	gMap.stats.sweeps = gMap.work.sweeps;
+	gMap.stats.residual = gMap.work.residual;
+	gMap.state.store(MAP_IDLE, std::memory_order_release);
+	mapBuildMulti();
+}
+
+// Hand the map to the optimizer if it has changed and the optimizer is
+// free; otherwise it is handed over on a later frame.
+static void mapSubmit(void)
+{
+	MapWork *w = &gMap.work;
+	MapEdge *edge;
+	ARdouble q[4], p[3];
+	double len;
+	int i, k;
+
+	if (!gMap.dirty || gMap.state.load(std::memory_order_acquire) != MAP_IDLE) return;
+
+	w->markerNum = gMap.markerNum;
+	for (i = 0; i < gMap.markerNum; i++) {
+		w->placed[i] = gMap.markers[i].placed;
+		w->width[i] = gMap.markers[i].width;
+		memcpy(w->trans[i], gMap.markers[i].trans, sizeof(w->trans[i]));
+	}
+	w->edgeNum = gMap.edgeNum;
+	for (i = 0; i < gMap.edgeNum; i++) {
+		edge = &gMap.edges[i];
+		w->a[i] = edge->a;
+		w->b[i] = edge->b;
+		w->weight[i] = edge->weight;
+		len = sqrt(edge->quat[0]*edge->quat[0] + edge->quat[1]*edge->quat[1] + edge->quat[2]*edge->quat[2] + edge->quat[3]*edge->quat[3]);
+		for (k = 0; k < 4; k++) q[k] = (ARdouble)(edge->quat[k] / len);
+		for (k = 0; k < 3; k++) p[k] = (ARdouble)(edge->pos[k] / edge->weight);
+		arUtilQuatPos2Mat(q, p, w->rel[i]);
+		arUtilMatInv(w->rel[i], w->relInv[i]);
+	}
+	gMap.dirty = FALSE;
+	gMap.state.store(MAP_SUBMITTED, std::memory_order_release);
+}
+
+static int mapMarkerIndex(int pattId)
+{
+	int i;
+
+	for (i = 0; i < gMap.markerNum; i++) {
+		if (gMap.markers[i].pattId == pattId) return (i);
+	}
+	return (-1);
+}
+
+static MapEdge *mapEdge(int a, int b)
+{
+	MapEdge *edge;
+	int i;
+
+	for (i = 0; i < gMap.edgeNum; i++) {
+		if (gMap.edges[i].a == a && gMap.edges[i].b == b) return (&gMap.edges[i]);
+	}
+	if (gMap.edgeNum == MARKER_MAP_EDGE_MAX) return (NULL);
+	edge = &gMap.edges[gMap.edgeNum++];
+	memset(edge, 0, sizeof(MapEdge));
+	edge->a = a;
+	edge->b = b;
+	gMap.stats.edges = gMap.edgeNum;
+	return (edge);
+}
+
+// ============================================================================
+//	Public functions
+// ============================================================================
+
+int markerMapInit(void)
+{
+	gMap.markerNum = 0;
+	gMap.edgeNum = 0;
+	gMap.mapping = FALSE;
+	gMap.dirty = FALSE;
+	memset(&gMap.stats, 0, sizeof(gMap.stats));
+	memset(&gMap.multi, 0, sizeof(gMap.multi));
+	gMap.multi.patt_type = AR_MULTI_PATTERN_DETECTION_MODE_TEMPLATE;
+	gMap.multi.cfPattCutoff = AR_MULTI_CONFIDENCE_PATTERN_CUTOFF_DEFAULT;
+	gMap.multi.cfMatrixCutoff = AR_MULTI_CONFIDENCE_MATRIX_CUTOFF_DEFAULT;
+	gMap.state.store(MAP_IDLE);
+	gMap.running.store(1);
+
+#ifdef _WIN32
+	if ((gMap.optimizer = CreateThread(NULL, 0, mapThread, NULL, 0, NULL)) == NULL) {
+#else
+	if (pthread_create(&gMap.optimizer, NULL, mapThread, NULL) != 0) {
+#endif
+		ARLOGe("markerMapInit(): Unable to start optimizer thread.\n");
+		gMap.running.store(0);
+		return (FALSE);
+	}
+	return (TRUE);
+}
+
+void markerMapFinal(void)
+{
+	if (!gMap.running.load()) return;
+	gMap.running.store(0);
+#ifdef _WIN32
+	WaitForSingleObject(gMap.optimizer, INFINITE);
+	CloseHandle(gMap.optimizer);
+#else
+	pthread_join(gMap.optimizer, NULL);
+#endif
+}
+
+int markerMapAdd(int pattId, const char *pattName, ARdouble width)
+{
+	MapMarker *marker;
+
+	if (gMap.markerNum == MARKER_MAP_MAX) {
+		ARLOGe("markerMapAdd(): More than %d markers.\n", MARKER_MAP_MAX);
+		return (FALSE);
+	}
+	if (mapMarkerIndex(pattId) >= 0) {
+		ARLOGe("markerMapAdd(): Pattern %s is already on the map.\n", pattName);
+		return (FALSE);
+	}
+	marker = &gMap.markers[gMap.markerNum];
+	marker->pattId = pattId;
+	snprintf(marker->pattName, sizeof(marker->pattName), "%s", pattName);
+	marker->width = width;
+	marker->placed = (gMap.markerNum == 0);     // The origin.
+	mapSetIdentity(marker->trans);
+	gMap.markerNum++;
+	gMap.stats.markers = gMap.markerNum;
+	if (marker->placed) mapBuildMulti();
+	return (TRUE);
+}
+
+// Next line that is not blank or a comment, as arMultiReadConfigFile()
+// reads them.
+static int mapReadLine(FILE *fp, char *buf, int size)
+{
+	char *p;
+
+	while (fgets(buf, size, fp) != NULL) {
+		p = buf + strlen(buf);
+		while (p > buf && (p[-1] == '\n' || p[-1] == '\r' || p[-1] == ' ' || p[-1] == '\t')) *--p = '\0';
+		for (p = buf; *p == ' ' || *p == '\t'; p++);
+		if (*p == '\0' || *p == '#') continue;
+		if (p != buf) memmove(buf, p, strlen(p) + 1);
+		return (TRUE);
+	}
+	return (FALSE);
+}
+
+int markerMapLoad(const char *mapName, TrackerContext *tc)
+{
+	FILE *fp;
+	char buf[MARKER_MAP_NAME_MAX];
+	char names[MARKER_MAP_MAX][MARKER_MAP_NAME_MAX];
+	ARdouble widths[MARKER_MAP_MAX], trans[MARKER_MAP_MAX][3][4];
+	double w, c[2], r[4];
+	int num, i, j, id;
+
+	if ((fp = fopen(mapName, "r")) == NULL) return (FALSE);
+	num = 0;
+	if (!mapReadLine(fp, buf, sizeof(buf)) || sscanf(buf, "%d", &num) != 1 || num < 1 || num > MARKER_MAP_MAX - gMap.markerNum) {
+		ARLOGe("markerMapLoad(): %s does not start with a marker count up to %d.\n", mapName, MARKER_MAP_MAX - gMap.markerNum);
+		fclose(fp);
+		return (FALSE);
+	}
+	for (i = 0; i < num; i++) {
+		if (!mapReadLine(fp, names[i], sizeof(names[i]))) break;
+		if (!mapReadLine(fp, buf, sizeof(buf)) || sscanf(buf, "%lf", &w) != 1) break;
+		widths[i] = (ARdouble)w;
+		if (!mapReadLine(fp, buf, sizeof(buf)) || sscanf(buf, "%lf %lf", &c[0], &c[1]) != 2) break;
+		for (j = 0; j < 3; j++) {
+			if (!mapReadLine(fp, buf, sizeof(buf)) || sscanf(buf, "%lf %lf %lf %lf", &r[0], &r[1], &r[2], &r[3]) != 4) break;
+			trans[i][j][0] = (ARdouble)r[0];
+			trans[i][j][1] = (ARdouble)r[1];
+			trans[i][j][2] = (ARdouble)r[2];
+			trans[i][j][3] = (ARdouble)(r[3] + r[0]*c[0] + r[1]*c[1]);  // Centre offset folded in.
+		}
+		if (j < 3) break;
+	}
+	fclose(fp);
+	if (i < num) {
+		ARLOGe("markerMapLoad(): Marker %d of %s is incomplete.\n", i + 1, mapName);
+		return (FALSE);
+	}
+
+	for (i = 0; i < num; i++) {
+		if ((id = trackerAddPattern(tc, names[i], widths[i])) < 0) return (FALSE);
+		if (!markerMapAdd(id, names[i], widths[i])) return (FALSE);
+		gMap.markers[gMap.markerNum - 1].placed = TRUE;
+		memcpy(gMap.markers[gMap.markerNum - 1].trans, trans[i], sizeof(trans[i]));
+	}
+	mapBuildMulti();
+	ARLOGi("Loaded %d markers from map %s.\n", num, mapName);
+	return (TRUE);
+}
+
+int markerMapSave(const char *mapName)
+{
+	FILE *fp;
+	MapMarker *marker;
+	int i, j;
+
+	mapCollect();
+	if ((fp = fopen(mapName, "w")) == NULL) {
+		ARLOGe("markerMapSave(): Unable to open %s.\n", mapName);
+		return (FALSE);
+	}
+	fprintf(fp, "# Marker map written by simpleARDIY, in the multi-marker configuration format.\n");
+	fprintf(fp, "# Poses are of each marker in the frame of the first, in mm.\n\n");
+	fprintf(fp, "# Number of markers\n%d\n", gMap.stats.placed);
+	for (i = 0; i < gMap.markerNum; i++) {
+		marker = &gMap.markers[i];
+		if (!marker->placed) continue;
+		fprintf(fp, "\n# Marker %d\n%s\n%0.4f\n0.0 0.0\n", i + 1, marker->pattName, marker->width);
+		for (j = 0; j < 3; j++) {
+			fprintf(fp, "%10.7f %10.7f %10.7f %12.4f\n", marker->trans[j][0], marker->trans[j][1], marker->trans[j][2], marker->trans[j][3]);
+		}
+	}
+	if (fclose(fp) != 0) {
+		ARLOGe("markerMapSave(): Error writing %s.\n", mapName);
+		return (FALSE);
+	}
+	ARLOGi("Saved %d markers to map %s.\n", gMap.stats.placed, mapName);
+	return (TRUE);
+}
+
+void markerMapSetMapping(int mapping)
+{
+	gMap.mapping = mapping;
+}
+
+int markerMapMapping(void)
+{
+	return (gMap.mapping);
+}
+
+void markerMapObserve(const TrackerPose *poses, int num)
+{
+	ARdouble inv[3][4], rel[3][4], q[4], p[3];
+	MapEdge *edge;
+	int index[TRACKER_PATTERN_MAX];
+	int i, j, a, b, k, placed;
+	double w, dot;
+
+	mapCollect();
+	if (!gMap.mapping || num < 2) return;
+	if (num > TRACKER_PATTERN_MAX) num = TRACKER_PATTERN_MAX;
+	for (i = 0; i < num; i++) index[i] = mapMarkerIndex(poses[i].id);
+
+	// Every pair in view adds to the mean pose of one marker in the
+	// other's frame, weighted down by the fit errors.
+	for (i = 0; i < num; i++) {
+		for (j = i + 1; j < num; j++) {
+			if (index[i] < 0 || index[j] < 0) continue;
+			if (index[i] < index[j]) { a = i; b = j; }
+			else { a = j; b = i; }
+			if ((edge = mapEdge(index[a], index[b])) == NULL) continue;
+			arUtilMatInv(poses[a].trans, inv);
+			arUtilMatMul(inv, poses[b].trans, rel);
+			arUtilMat2QuatPos(rel, q, p);
+			w = 1.0 / (1.0 + poses[a].err + poses[b].err);
+			dot = q[0]*edge->quat[0] + q[1]*edge->quat[1] + q[2]*edge->quat[2] + q[3]*edge->quat[3];
+			for (k = 0; k < 4; k++) edge->quat[k] += (ARdouble)((dot < 0.0 ? -w : w) * q[k]);
+			for (k = 0; k < 3; k++) edge->pos[k] += (ARdouble)(w * p[k]);
+			edge->weight += w;
+			edge->count++;
+			gMap.stats.observations++;
+			gMap.dirty = TRUE;
+		}
+	}
+
+	// Markers seen with one already on the map are placed from this frame;
+	// repeat, so that one placed now can place others.
+	do {
+		placed = FALSE;
+		for (i = 0; i < num; i++) {
+			if (index[i] < 0 || !gMap.markers[index[i]].placed) continue;
+			for (j = 0; j < num; j++) {
+				if (index[j] < 0 || gMap.markers[index[j]].placed) continue;
+				arUtilMatInv(poses[i].trans, inv);
+				arUtilMatMul(inv, poses[j].trans, rel);
+				arUtilMatMul(gMap.markers[index[i]].trans, rel, gMap.markers[index[j]].trans);
+				gMap.markers[index[j]].placed = TRUE;
+				placed = TRUE;
+				ARLOGi("Placed marker %s on the map.\n", gMap.markers[index[j]].pattName);
+			}
+		}
+		if (placed) mapBuildMulti();
+	} while (placed);
+
+	mapSubmit();
+}
+
+int markerMapSolve(AR3DHandle *handle, ARMarkerInfo *markerInfo, int markerNum, ARdouble trans[3][4])
+{
+	ARdouble err;
+	int i, n;
+
+	mapCollect();
+	if (gMap.multi.marker_num == 0 || markerNum <= 0) return (FALSE);
+
+	err = arGetTransMatMultiSquareRobust(handle, markerInfo, markerNum, &gMap.multi);
+	n = 0;
+	for (i = 0; i < gMap.multi.marker_num; i++) {
+		if (gMap.multi.marker[i].visible >= 0) n++;
+	}
+	gMap.stats.solveMarkers = n;
+	if (err < 0.0 || n == 0) return (FALSE);
+	gMap.stats.solveErr = err;
+	memcpy(trans, gMap.multi.trans, sizeof(gMap.multi.trans));
+	return (TRUE);
+}
+
+const MarkerMapStats *markerMapStats(void)
+{
+	return (&gMap.stats);
+}
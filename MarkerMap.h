@@ -0,0 +1,77 @@
+/*
+*  MarkerMap.h
+*
+*  A map of markers scattered around a room, built while tracking, and
+*  the camera pose solved against all of it.
+*
+*  The first marker added is the origin. In mapping mode, every frame
+*  with more than one marker in view adds a measurement of where each
+*  marker sits relative to the others to an edge between them; an
+*  edge keeps only a weighted running mean, so the cost per frame does
+*  not grow with time. A marker seen together with one already on the
+*  map is placed straight away from that single frame.
+*
+*  A background thread refines the placements against all the edges
+*  (block Gauss-Seidel over the marker poses, each sweep touching only
+*  the edges that exist) and hands them back; the GLUT thread picks the
+*  result up on its next call without waiting.
+*
+*  The camera pose is solved each frame from the corners of every map
+*  marker in view at once with arGetTransMatMultiSquareRobust(), which
+*  runs a bounded number of iterations.
+*
+*  Maps are saved in ARToolKit's multi-marker configuration format, so
+*  a saved map also loads with arMultiReadConfigFile().
+*
+*/
+
+#ifndef MARKER_MAP_H
+#define MARKER_MAP_H
+
+#include <AR/ar.h>
+#include "Tracker.h"
+
+#define MARKER_MAP_MAX          TRACKER_PATTERN_MAX
+#define MARKER_MAP_SWEEPS       100     // Most Gauss-Seidel sweeps per optimization.
+
+typedef struct {
+	int      markers;                   // Added.
+	int      placed;                    // Of those, placed on the map.
+	int      edges;                     // Marker pairs seen together.
+	long     observations;              // Pair measurements taken.
+	long     optimizations;             // Optimizer results picked up.
+	int      sweeps;                    // Sweeps the last one took.
+	double   residual;                  // RMS disagreement of the edges with the map, mm.
+	int      solveMarkers;              // Markers the last camera pose was solved from.
+	double   solveErr;                  // Its error.
+} MarkerMapStats;
+
+// Starts the optimizer thread.
+int         markerMapInit(void);
+void        markerMapFinal(void);
+
+// Adds a pattern loaded with trackerAddPattern(). The first one added is
+// the origin of the map. Returns FALSE if the map is full.
+int         markerMapAdd(int pattId, const char *pattName, ARdouble width);
+
+// Loads the patterns of a saved map into the tracker and places them.
+// FALSE if the file cannot be read (nothing is added) or a pattern in
+// it cannot be loaded.
+int         markerMapLoad(const char *mapName, TrackerContext *tc);
+int         markerMapSave(const char *mapName);
+
+// Mapping on or off. Off, the map is only used, not changed.
+void        markerMapSetMapping(int mapping);
+int         markerMapMapping(void);
+
+// The poses from trackerProcess() for one frame. Only does anything
+// while mapping.
+void        markerMapObserve(const TrackerPose *poses, int num);
+
+// Camera pose (map to camera) from the markers arDetectMarker() found in
+// the frame. FALSE if no map marker is in view.
+int         markerMapSolve(AR3DHandle *handle, ARMarkerInfo *markerInfo, int markerNum, ARdouble trans[3][4]);
+
+const MarkerMapStats *markerMapStats(void);
+
+#endif // !MARKER_MAP_H
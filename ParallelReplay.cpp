@@ -0,0 +1,253 @@
+/*
+*  ParallelReplay.cpp
+*
+*  A recording detected on several threads, in order. See
+*  ParallelReplay.h.
+*
+*/
+
+#include <string.h>
+#include <atomic>
+#ifdef _WIN32
+#  include <windows.h>
+#else
+#  include <sys/types.h>
+#  include <pthread.h>
+#  include <unistd.h>
+#endif
+#include <AR/ar.h>
+#include "ParallelReplay.h"
+#include "Timing.h"
+
+#define PARALLEL_POLL           0.0002  // Seconds between checks while waiting for a frame or a result.
+
+typedef struct ParallelRun ParallelRun;
+
+typedef struct {
+	ParallelRun         *run;
+	TrackerContext      tc;
+	long                frames;
+	double              busy;
+#ifdef _WIN32
+	HANDLE              thread;
+#else
+	pthread_t           thread;
+#endif
+} ParallelWorker;
+
+struct ParallelRun {
+	const FrameReplay   *fr;
+	ParallelWorker      worker[PARALLEL_WORKERS_MAX];
+	int                 workerNum;
+	ParallelResult      result[PARALLEL_WINDOW];    // Frame f in result[f % PARALLEL_WINDOW].
+	std::atomic<int>    ready[PARALLEL_WINDOW];
+	std::atomic<long>   next;                       // Next frame to take.
+	std::atomic<long>   handed;                     // Frames handed on.
+	std::atomic<int>    running;
+};
+
+static void parallelSleep(double seconds)
+{
+#ifdef _WIN32
+	Sleep((DWORD)(seconds*1000.0));
+#else
+	usleep((useconds_t)(seconds*1e6));
+#endif
+}
+
+int parallelReplayDefaultWorkers(void)
+{
+	int n;
+#ifdef _WIN32
+	SYSTEM_INFO si;
+
+	GetSystemInfo(&si);
+	n = (int)si.dwNumberOfProcessors;
+#else
+	n = (int)sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+	if (n < 1) n = 1;
+	return n > PARALLEL_WORKERS_MAX ? PARALLEL_WORKERS_MAX : n;
+}
+
+// Detection modes as the model has them, without the ones that carry
+// state from one frame to the next.
+static void parallelCopyModes(TrackerContext *tc, const TrackerContext *model)
+{
+	AR_LABELING_THRESH_MODE threshMode;
+	int mode;
+
+	arGetImageProcMode(model->arHandle, &mode);
+	arSetImageProcMode(tc->arHandle, mode);
+	arGetLabelingMode(model->arHandle, &mode);
+	arSetLabelingMode(tc->arHandle, mode);
+	arGetPatternDetectionMode(model->arHandle, &mode);
+	arSetPatternDetectionMode(tc->arHandle, mode);
+	arGetLabelingThresh(model->arHandle, &mode);
+	arSetLabelingThresh(tc->arHandle, mode);
+	arGetLabelingThreshMode(model->arHandle, &threshMode);
+	if (threshMode == AR_LABELING_THRESH_MODE_AUTO_BRACKETING) threshMode = AR_LABELING_THRESH_MODE_AUTO_OTSU;
+	arSetLabelingThreshMode(tc->arHandle, threshMode);
+	arSetLabelingThreshModeAutoInterval(tc->arHandle, 1);
+}
+
+#ifdef _WIN32
+static DWORD WINAPI parallelWorkerThread(LPVOID arg)
+#else
+static void *parallelWorkerThread(void *arg)
+#endif
+{
+	ParallelWorker *pw = (ParallelWorker *)arg;
+	ParallelRun *run = pw->run;
+	ParallelResult *result;
+	TrackerFrame frame;
+	long f;
+	double t;
+
+	frame.stride = 0;
+	frame.pixFormat = run->fr->pixFormat;
+	while (run->running.load()) {
+		f = run->next.load();
+		if (f >= run->fr->frameCount) break;
+		// Not so far ahead that the frame's result slot is still in use.
+		if (f >= run->handed.load(std::memory_order_acquire) + PARALLEL_WINDOW) {
+			parallelSleep(PARALLEL_POLL);
+			continue;
+		}
+		if (!run->next.compare_exchange_weak(f, f + 1)) continue;
+
+		result = &run->result[f % PARALLEL_WINDOW];
+		result->frame = f;
+		frame.data = run->fr->frames + (size_t)f * run->fr->frameSize;
+		t = timingNow();
+		result->num = trackerProcess(&pw->tc, &frame, result->poses, TRACKER_PATTERN_MAX);
+		pw->busy += timingNow() - t;
+		pw->frames++;
+		run->ready[f % PARALLEL_WINDOW].store(TRUE, std::memory_order_release);
+	}
+	return 0;
+}
+
+static void parallelStop(ParallelRun *run, int started)
+{
+	int i;
+
+	run->running.store(FALSE);
+	for (i = 0; i < started; i++) {
+#ifdef _WIN32
+		WaitForSingleObject(run->worker[i].thread, INFINITE);
+		CloseHandle(run->worker[i].thread);
+#else
+		pthread_join(run->worker[i].thread, NULL);
+#endif
+	}
+	for (i = 0; i < run->workerNum; i++) trackerFinal(&run->worker[i].tc);
+}
+
+int parallelReplayRun(const FrameReplay *fr, const TrackerContext *model, const char *cparamName,
+	const char *const *pattNames, const ARdouble *pattWidths, int pattNum, int workers,
+	ParallelResultFunc func, void *arg, ParallelStats *stats)
+{
+	ParallelRun *run;
+	TrackerSettings settings;
+	PresenceSettings presence;
+	ParallelResult *result;
+	double start;
+	long f;
+	int i, j, started;
+
+	memset(stats, 0, sizeof(ParallelStats));
+	if (workers < 1) workers = 1;
+	if (workers > PARALLEL_WORKERS_MAX) workers = PARALLEL_WORKERS_MAX;
+
+	// Every frame is detected, whatever the ones before held.
+	presenceDefaultSettings(&presence);
+	presence.policy = PRESENCE_POLICY_FULL;
+	memset(&settings, 0, sizeof(settings));
+	settings.cparamName = cparamName;
+	settings.xsize = model->xsize;
+	settings.ysize = model->ysize;
+	settings.pixFormat = model->pixFormat;
+	settings.stride = model->stride;
+	settings.presence = &presence;
+	settings.bitLabelMode = model->bitLabelMode;
+	settings.stage = NULL;              // The stage hooks time the GLUT thread.
+
+	run = new ParallelRun;
+	run->fr = fr;
+	run->workerNum = 0;
+	run->next.store(0);
+	run->handed.store(0);
+	run->running.store(TRUE);
+	for (i = 0; i < PARALLEL_WINDOW; i++) run->ready[i].store(FALSE);
+
+	// Contexts are set up here, one at a time, before any thread runs.
+	for (i = 0; i < workers; i++) {
+		run->worker[i].run = run;
+		run->worker[i].frames = 0;
+		run->worker[i].busy = 0.0;
+		run->workerNum++;
+		if (!trackerInit(&run->worker[i].tc, &settings)) break;
+		for (j = 0; j < pattNum; j++) {
+			if (trackerAddPattern(&run->worker[i].tc, pattNames[j], pattWidths[j]) < 0) break;
+		}
+		if (j < pattNum) break;
+		parallelCopyModes(&run->worker[i].tc, model);
+	}
+	if (i < workers) {
+		ARLOGe("parallelReplayRun(): Unable to set up worker %d.\n", i);
+		parallelStop(run, 0);
+		delete run;
+		return (FALSE);
+	}
+
+	start = timingNow();
+	for (started = 0; started < workers; started++) {
+#ifdef _WIN32
+		if ((run->worker[started].thread = CreateThread(NULL, 0, parallelWorkerThread, &run->worker[started], 0, NULL)) == NULL) break;
+#else
+		if (pthread_create(&run->worker[started].thread, NULL, parallelWorkerThread, &run->worker[started]) != 0) break;
+#endif
+	}
+	if (started == 0) {
+		ARLOGe("parallelReplayRun(): Unable to start a worker thread.\n");
+		parallelStop(run, 0);
+		delete run;
+		return (FALSE);
+	}
+	if (started < workers) ARLOGw("parallelReplayRun(): Only %d of %d worker threads started.\n", started, workers);
+
+	// Results in frame order, on this thread.
+	for (f = 0; f < fr->frameCount; f++) {
+		while (!run->ready[f % PARALLEL_WINDOW].load(std::memory_order_acquire)) parallelSleep(PARALLEL_POLL);
+		result = &run->result[f % PARALLEL_WINDOW];
+		if (result->num < 0) stats->errors++;
+		if (func) func(result, arg);
+		run->ready[f % PARALLEL_WINDOW].store(FALSE, std::memory_order_relaxed);
+		run->handed.store(f + 1, std::memory_order_release);
+	}
+	stats->seconds = timingNow() - start;
+
+	parallelStop(run, started);
+	stats->workers = started;
+	stats->frames = fr->frameCount;
+	for (i = 0; i < started; i++) {
+		stats->workerFrames[i] = run->worker[i].frames;
+		stats->busy += run->worker[i].busy;
+	}
+	delete run;
+	return (TRUE);
+}
+
+void parallelReplayReport(const ParallelStats *stats)
+{
+	if (stats->seconds <= 0.0) return;
+	ARLOGi("Parallel: %ld frames on %d workers in %.2f s, %.1f frames/s.\n", stats->frames, stats->workers,
+		stats->seconds, stats->frames / stats->seconds);
+	// Detection time over elapsed time: the speedup over one worker, were
+	// detection all there was to it.
+	ARLOGi("Parallel: %.2f ms detection per frame, %.2f workers busy on average (%.0f%%).\n",
+		stats->frames ? stats->busy * 1e3 / stats->frames : 0.0, stats->busy / stats->seconds,
+		stats->workers ? stats->busy / stats->seconds * 100.0 / stats->workers : 0.0);
+	if (stats->errors) ARLOGw("Parallel: Detection failed on %ld frames.\n", stats->errors);
+}
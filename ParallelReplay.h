@@ -0,0 +1,68 @@
+/*
+*  ParallelReplay.h
+*
+*  One recording detected on several threads at once, with the results
+*  handed on in frame order.
+*
+*  Each worker has a TrackerContext of its own, and so its own ARHandle
+*  and AR3DHandle, set up like a template context. Workers take the next
+*  frame not yet taken and detect it. The calling thread waits for the
+*  results in frame order and passes each to a function, which is where
+*  anything that depends on the previous frames belongs: the pose
+*  predictor, the marker map, output.
+*
+*  No more than PARALLEL_WINDOW frames are in flight past the last one
+*  handed on, so a slow frame holds the others up by at most that much
+*  and the results need no more memory than that.
+*
+*  Detection in the workers must not depend on the frames before, as
+*  each sees only some of them. The presence scheduler is off, the auto
+*  threshold is worked out on every frame, and bracketing (which carries
+*  its threshold from frame to frame) is replaced by Otsu's method.
+*
+*/
+
+#ifndef PARALLEL_REPLAY_H
+#define PARALLEL_REPLAY_H
+
+#include <AR/ar.h>
+#include "FrameReplay.h"
+#include "Tracker.h"
+
+#define PARALLEL_WORKERS_MAX    64
+#define PARALLEL_WINDOW         256     // Frames taken by workers past the last result handed on.
+
+typedef struct {
+	long        frame;                  // Index in the recording.
+	int         num;                    // Poses, or -1 if detection failed.
+	TrackerPose poses[TRACKER_PATTERN_MAX];
+} ParallelResult;
+
+// Called on the calling thread, once per frame in frame order.
+typedef void (*ParallelResultFunc)(const ParallelResult *result, void *arg);
+
+typedef struct {
+	int         workers;
+	long        frames;
+	long        errors;                 // Frames detection failed on.
+	double      seconds;                // From the first frame taken to the last result handed on.
+	double      busy;                   // Seconds in trackerProcess(), summed over the workers.
+	long        workerFrames[PARALLEL_WORKERS_MAX];
+} ParallelStats;
+
+// Workers to use when none are asked for: one per CPU.
+int         parallelReplayDefaultWorkers(void);
+
+// Detects every frame of the recording once, on workers set up like
+// model (size, format, prefilter, detection modes) with the camera
+// parameters in cparamName and the given patterns; pattern ids are the
+// same as trackerAddPattern() gave model if it loaded the same patterns
+// in the same order. FALSE if the workers could not be set up.
+int         parallelReplayRun(const FrameReplay *fr, const TrackerContext *model, const char *cparamName,
+	const char *const *pattNames, const ARdouble *pattWidths, int pattNum, int workers,
+	ParallelResultFunc func, void *arg, ParallelStats *stats);
+
+// Logs the totals.
+void        parallelReplayReport(const ParallelStats *stats);
+
+#endif // !PARALLEL_REPLAY_H
@@ -0,0 +1,117 @@
+/*
+*  PosePredictor.cpp
+*
+*  Marker pose between detections. See PosePredictor.h.
+*
+*/
+
+#include <string.h>
+#include <math.h>
+#include <AR/ar.h>
+#include "PosePredictor.h"
+
+static const char *posePredictorModeNames[POSE_MODE_COUNT] = {
+	"hold",
+	"interpolate",
+	"extrapolate"
+};
+
+void posePredictorInit(PosePredictor *pp, POSE_MODE mode, double horizon)
+{
+	memset(pp, 0, sizeof(PosePredictor));
+	pp->mode = mode;
+	pp->horizon = horizon;
+}
+
+void posePredictorSetMode(PosePredictor *pp, POSE_MODE mode)
+{
+	if (mode < 0 || mode >= POSE_MODE_COUNT) return;
+	pp->mode = mode;
+}
+
+const char *posePredictorModeName(POSE_MODE mode)
+{
+	if (mode < 0 || mode >= POSE_MODE_COUNT) return "unknown";
+	return posePredictorModeNames[mode];
+}
+
+void posePredictorAdd(PosePredictor *pp, const ARdouble trans[3][4], double time)
+{
+	// A second pose for the same frame replaces the first.
+	if (pp->count == 0 || time > pp->time[1]) {
+		if (pp->count > 0) {
+			pp->time[0] = pp->time[1];
+			memcpy(pp->quat[0], pp->quat[1], sizeof(pp->quat[0]));
+			memcpy(pp->pos[0], pp->pos[1], sizeof(pp->pos[0]));
+		}
+		if (pp->count < 2) pp->count++;
+	}
+	pp->time[1] = time;
+	arUtilMat2QuatPos(trans, pp->quat[1], pp->pos[1]);
+}
+
+void posePredictorLost(PosePredictor *pp)
+{
+	pp->count = 0;
+}
+
+// Spherical interpolation from a (u = 0) to b (u = 1). u beyond 1 carries
+// on round the same great circle, which is constant angular velocity.
+static void posePredictorSlerp(const ARdouble a[4], const ARdouble b[4], double u, ARdouble q[4])
+{
+	double dot, theta, s, wa, wb, sign, len;
+	int i;
+
+	dot = a[0]*b[0] + a[1]*b[1] + a[2]*b[2] + a[3]*b[3];
+	sign = 1.0;
+	if (dot < 0.0) {    // q and -q are the same rotation; take the short way.
+		dot = -dot;
+		sign = -1.0;
+	}
+	if (dot > 0.9995) {
+		wa = 1.0 - u;
+		wb = u;
+	}
+	else {
+		theta = acos(dot);
+		s = sin(theta);
+		wa = sin((1.0 - u) * theta) / s;
+		wb = sin(u * theta) / s;
+	}
+	len = 0.0;
+	for (i = 0; i < 4; i++) {
+		q[i] = (ARdouble)(wa * a[i] + sign * wb * b[i]);
+		len += q[i] * q[i];
+	}
+	len = sqrt(len);
+	if (len > 0.0) for (i = 0; i < 4; i++) q[i] = (ARdouble)(q[i] / len);
+}
+
+int posePredictorGet(const PosePredictor *pp, double now, ARdouble trans[3][4])
+{
+	ARdouble q[4], p[3];
+	double interval, u;
+	int i;
+
+	if (pp->count == 0) return (FALSE);
+	interval = pp->count == 2 ? pp->time[1] - pp->time[0] : 0.0;
+	if (pp->mode == POSE_HOLD || interval <= 0.0 || interval > POSE_GAP_MAX) {
+		arUtilQuatPos2Mat(pp->quat[1], pp->pos[1], trans);
+		return (TRUE);
+	}
+
+	if (pp->mode == POSE_INTERPOLATE) {
+		u = (now - interval - pp->time[0]) / interval;
+		if (u < 0.0) u = 0.0;
+		if (u > 1.0) u = 1.0;
+	}
+	else {
+		if (now > pp->time[1] + pp->horizon) now = pp->time[1] + pp->horizon;
+		u = (now - pp->time[0]) / interval;
+		if (u < 1.0) u = 1.0;
+	}
+	posePredictorSlerp(pp->quat[0], pp->quat[1], u, q);
+	for (i = 0; i < 3; i++) p[i] = (ARdouble)(pp->pos[0][i] + u * (pp->pos[1][i] - pp->pos[0][i]));
+	arUtilQuatPos2Mat(q, p, trans);
+	return (TRUE);
+}
@@ -0,0 +1,54 @@
+/*
+*  PosePredictor.h
+*
+*  Marker pose at any moment between (or shortly after) detections, for
+*  drawing at the display's rate rather than the camera's.
+*
+*  The last two detected poses are kept with the times their frames were
+*  captured, as a rotation quaternion and a position. posePredictorGet()
+*  either holds the newest pose, interpolates between the two a camera
+*  interval behind the time asked for (smooth, one frame later than the
+*  newest detection), or extrapolates forwards from them at constant
+*  velocity (no added latency, but overshoots when the motion changes).
+*  Extrapolation stops a fixed time after the newest pose so that a
+*  marker that is lost does not drift off with its last velocity.
+*
+*/
+
+#ifndef POSE_PREDICTOR_H
+#define POSE_PREDICTOR_H
+
+#include <AR/ar.h>
+
+#define POSE_GAP_MAX            0.25    // Poses further apart than this (seconds) are not blended.
+
+typedef enum {
+	POSE_HOLD = 0,                      // Newest pose, as detected.
+	POSE_INTERPOLATE,                   // Between the last two, one interval behind.
+	POSE_EXTRAPOLATE,                   // Forwards from the last two.
+	POSE_MODE_COUNT
+} POSE_MODE;
+
+typedef struct {
+	POSE_MODE   mode;
+	double      horizon;                // Longest extrapolation past the newest pose, seconds.
+	int         count;                  // Poses held, 0 to 2; [1] is the newest.
+	double      time[2];
+	ARdouble    quat[2][4];
+	ARdouble    pos[2][3];
+} PosePredictor;
+
+void        posePredictorInit(PosePredictor *pp, POSE_MODE mode, double horizon);
+void        posePredictorSetMode(PosePredictor *pp, POSE_MODE mode);
+const char  *posePredictorModeName(POSE_MODE mode);
+
+// A pose detected in the frame captured at time (seconds, timingNow()).
+void        posePredictorAdd(PosePredictor *pp, const ARdouble trans[3][4], double time);
+
+// The marker was not found; nothing is predicted until it is again.
+void        posePredictorLost(PosePredictor *pp);
+
+// The pose to draw at time now. FALSE if there is none.
+int         posePredictorGet(const PosePredictor *pp, double now, ARdouble trans[3][4]);
+
+#endif // !POSE_PREDICTOR_H
@@ -0,0 +1,243 @@
+/*
+*  PresenceScheduler.cpp
+*
+*  Duty cycling of marker detection while no marker is in view.
+*  See PresenceScheduler.h.
+*
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include "PresenceScheduler.h"
+#include "Timing.h"
+
+void presenceDefaultSettings(PresenceSettings *settings)
+{
+	settings->policy = PRESENCE_POLICY_REDUCED_RATE;
+	settings->absentFrames = 30;        // About one second at camera rate.
+	settings->idleInterval = 6;         // Detect at 1/6 of camera rate while idle.
+	settings->motionStep = 8;           // 80x60 samples for a 640x480 frame.
+	settings->motionThresh = 6;
+}
+
+// Approximate luma of the pixel at x, y. Planar and packed YUV formats
+// give Y directly; RGB formats use (r + 2g + b) / 4. Only called for
+// formats accepted by presenceHasLuma().
+static int presenceLuma(const PresenceScheduler *ps, const ARUint8 *image, int x, int y)
+{
+	const ARUint8 *p;
+
+	switch (ps->pixFormat) {
+	case AR_PIXEL_FORMAT_MONO:
+	case AR_PIXEL_FORMAT_420v:
+	case AR_PIXEL_FORMAT_420f:
+	case AR_PIXEL_FORMAT_NV21:
+		return image[y*ps->xsize + x];
+	case AR_PIXEL_FORMAT_2vuy:
+		return image[(y*ps->xsize + x) * 2 + 1];
+	case AR_PIXEL_FORMAT_yuvs:
+		return image[(y*ps->xsize + x) * 2];
+	case AR_PIXEL_FORMAT_RGB:
+	case AR_PIXEL_FORMAT_BGR:
+	case AR_PIXEL_FORMAT_RGBA:
+	case AR_PIXEL_FORMAT_BGRA:
+		p = image + (y*ps->xsize + x) * ps->pixelSize;
+		return (p[0] + 2 * p[1] + p[2]) >> 2;
+	case AR_PIXEL_FORMAT_ARGB:
+	case AR_PIXEL_FORMAT_ABGR:
+		p = image + (y*ps->xsize + x) * 4;
+		return (p[1] + 2 * p[2] + p[3]) >> 2;
+	default:
+		return 0;
+	}
+}
+
+static int presenceHasLuma(AR_PIXEL_FORMAT pixFormat)
+{
+	switch (pixFormat) {
+	case AR_PIXEL_FORMAT_MONO:
+	case AR_PIXEL_FORMAT_420v:
+	case AR_PIXEL_FORMAT_420f:
+	case AR_PIXEL_FORMAT_NV21:
+	case AR_PIXEL_FORMAT_2vuy:
+	case AR_PIXEL_FORMAT_yuvs:
+	case AR_PIXEL_FORMAT_RGB:
+	case AR_PIXEL_FORMAT_BGR:
+	case AR_PIXEL_FORMAT_RGBA:
+	case AR_PIXEL_FORMAT_BGRA:
+	case AR_PIXEL_FORMAT_ARGB:
+	case AR_PIXEL_FORMAT_ABGR:
+		return (TRUE);
+	default:
+		return (FALSE);
+	}
+}
+
+int presenceInit(PresenceScheduler *ps, const PresenceSettings *settings, int xsize, int ysize, AR_PIXEL_FORMAT pixFormat)
+{
+	int step;
+
+	memset(ps, 0, sizeof(PresenceScheduler));
+	if (settings) ps->settings = *settings;
+	else presenceDefaultSettings(&ps->settings);
+	if (ps->settings.absentFrames < 1) ps->settings.absentFrames = 1;
+	if (ps->settings.idleInterval < 1) ps->settings.idleInterval = 1;
+	if (ps->settings.motionStep < 1) ps->settings.motionStep = 1;
+
+	ps->xsize = xsize;
+	ps->ysize = ysize;
+	ps->pixFormat = pixFormat;
+	ps->pixelSize = arUtilGetPixelSize(pixFormat);
+
+	// The low-res check is optional; without it the motion policy degrades
+	// to the reduced rate one.
+	step = ps->settings.motionStep;
+	ps->sampleCount = ((xsize + step - 1) / step) * ((ysize + step - 1) / step);
+	if (!presenceHasLuma(pixFormat)) {
+		ARLOGw("presenceInit(): No presence check for this pixel format, using reduced rate only.\n");
+		ps->sampleCount = 0;
+	}
+	if (ps->sampleCount) {
+		if ((ps->samples = (ARUint8 *)malloc(ps->sampleCount)) == NULL) {
+			ARLOGe("presenceInit(): Out of memory.\n");
+			return (FALSE);
+		}
+	}
+
+	ps->lastAbsentTime = timingNow();
+	return (TRUE);
+}
+
+void presenceFinal(PresenceScheduler *ps)
+{
+	free(ps->samples);
+	ps->samples = NULL;
+	ps->sampleCount = 0;
+}
+
+void presenceSetPolicy(PresenceScheduler *ps, PRESENCE_POLICY policy)
+{
+	ps->settings.policy = policy;
+	ps->idle = FALSE;
+	ps->absent = FALSE;
+	ps->misses = 0;
+	ps->samplesValid = FALSE;
+}
+
+const char *presencePolicyName(PRESENCE_POLICY policy)
+{
+	switch (policy) {
+	case PRESENCE_POLICY_FULL: return "full rate";
+	case PRESENCE_POLICY_REDUCED_RATE: return "reduced rate";
+	case PRESENCE_POLICY_MOTION_CHECK: return "motion check";
+	default: return "UNKNOWN";
+	}
+}
+
+// Sample the frame on a coarse grid and compare against the previous
+// sample set. Returns TRUE if the mean absolute difference exceeds the
+// threshold. The first call after going idle only records the samples.
+static int presenceChanged(PresenceScheduler *ps, const ARUint8 *image)
+{
+	int x, y, i, l, step;
+	long diff;
+
+	step = ps->settings.motionStep;
+	diff = 0;
+	i = 0;
+	for (y = 0; y < ps->ysize; y += step) {
+		for (x = 0; x < ps->xsize; x += step) {
+			l = presenceLuma(ps, image, x, y);
+			diff += abs(l - ps->samples[i]);
+			ps->samples[i++] = (ARUint8)l;
+		}
+	}
+	if (!ps->samplesValid) {
+		ps->samplesValid = TRUE;
+		return (FALSE);
+	}
+	return (diff > (long)ps->settings.motionThresh * ps->sampleCount);
+}
+
+int presenceShouldDetect(PresenceScheduler *ps, const ARUint8 *image)
+{
+	double t0;
+	int changed;
+
+	ps->stats.frames++;
+
+	if (!ps->idle || ps->settings.policy == PRESENCE_POLICY_FULL) goto detect;
+
+	// Periodic full detection catches anything the presence check misses
+	// (e.g. a marker slid in too slowly to register as a change).
+	if (++ps->sinceDetect >= ps->settings.idleInterval) goto detect;
+
+	if (ps->settings.policy == PRESENCE_POLICY_MOTION_CHECK && ps->sampleCount) {
+		t0 = timingNow();
+		changed = presenceChanged(ps, image);
+		ps->lastCheckTime = timingNow();
+		ps->stats.framesChecked++;
+		ps->stats.checkSeconds += ps->lastCheckTime - t0;
+		if (changed) {
+			// Something moved; back to full rate until it has been absent
+			// for absentFrames again.
+			ps->idle = FALSE;
+			ps->misses = 0;
+			ps->stats.wakeups++;
+			goto detect;
+		}
+		// An unchanged scene still has no marker in it.
+		ps->lastAbsentTime = ps->lastCheckTime;
+		return (FALSE);
+	}
+
+	ps->stats.framesSkipped++;
+	return (FALSE);
+
+detect:
+	ps->sinceDetect = 0;
+	ps->detectStart = timingNow();
+	return (TRUE);
+}
+
+void presenceDetected(PresenceScheduler *ps, int found)
+{
+	double now, latency;
+
+	now = timingNow();
+	ps->stats.framesDetected++;
+	ps->stats.detectSeconds += now - ps->detectStart;
+
+	if (!found) {
+		ps->lastAbsentTime = ps->detectStart;
+		if (++ps->misses >= ps->settings.absentFrames && !ps->idle) {
+			ps->idle = TRUE;
+			ps->absent = TRUE;
+			ps->samplesValid = FALSE;
+		}
+		return;
+	}
+
+	// Only count the ends of real absences, not single frame dropouts while
+	// tracking. The latency is measured from the last frame known not to
+	// contain the marker, so it bounds the delay added by the scheduler.
+	if (ps->absent) {
+		latency = now - ps->lastAbsentTime;
+		ps->stats.reacquisitions++;
+		ps->stats.reacquireLast = latency;
+		ps->stats.reacquireTotal += latency;
+		if (latency > ps->stats.reacquireMax) ps->stats.reacquireMax = latency;
+	}
+	ps->idle = FALSE;
+	ps->absent = FALSE;
+	ps->misses = 0;
+}
+
+double presenceSavedSeconds(const PresenceStats *stats)
+{
+	double perDetect;
+
+	if (!stats->framesDetected) return (0.0);
+	perDetect = stats->detectSeconds / stats->framesDetected;
+	return ((stats->framesSkipped + stats->framesChecked) * perDetect - stats->checkSeconds);
+}
@@ -0,0 +1,89 @@
+/*
+*  PresenceScheduler.h
+*
+*  Duty cycling of marker detection while no marker is in view.
+*
+*  After a run of frames without the marker the scheduler stops running
+*  arDetectMarker() on every camera frame. Depending on the policy it
+*  either runs full detection only on every Nth frame, or compares a
+*  small subsampled luma image against the previous one and wakes up
+*  as soon as the scene changes. Any frame in which a marker is found
+*  puts it straight back to full rate.
+*
+*/
+
+#ifndef PRESENCE_SCHEDULER_H
+#define PRESENCE_SCHEDULER_H
+
+#include <AR/ar.h>
+
+typedef enum {
+	PRESENCE_POLICY_FULL = 0,           // Always detect (scheduler disabled).
+	PRESENCE_POLICY_REDUCED_RATE,       // While idle, detect every idleInterval'th frame.
+	PRESENCE_POLICY_MOTION_CHECK,       // While idle, detect when the low-res image changes (and every idleInterval'th frame).
+	PRESENCE_POLICY_COUNT
+} PRESENCE_POLICY;
+
+typedef struct {
+	PRESENCE_POLICY policy;
+	int    absentFrames;                // Consecutive misses before going idle.
+	int    idleInterval;                // While idle, full detection at least every this many frames.
+	int    motionStep;                  // Sample spacing in pixels of the low-res presence check.
+	int    motionThresh;                // Mean absolute luma difference (0-255) that wakes the detector.
+} PresenceSettings;
+
+typedef struct {
+	long   frames;                      // Camera frames offered to the scheduler.
+	long   framesDetected;              // Frames that ran full detection.
+	long   framesSkipped;               // Frames that ran nothing.
+	long   framesChecked;               // Frames that only ran the low-res check.
+	double detectSeconds;               // Time spent in full detection.
+	double checkSeconds;                // Time spent in low-res checks.
+	long   wakeups;                     // Low-res checks that brought back full rate.
+	long   reacquisitions;              // Idle periods that ended with the marker found.
+	double reacquireLast;               // Latency bound of the last re-acquisition, seconds.
+	double reacquireMax;                // Worst re-acquisition latency bound, seconds.
+	double reacquireTotal;              // Sum, for the mean.
+} PresenceStats;
+
+typedef struct {
+	PresenceSettings settings;
+	PresenceStats    stats;
+	int     idle;                       // TRUE while backed off.
+	int     absent;                     // TRUE from going idle until the marker is found again.
+	int     misses;                     // Consecutive frames detected without the marker.
+	int     sinceDetect;                // Frames since the last full detection.
+	double  lastAbsentTime;             // Last time the frame was known not to contain the marker.
+	double  lastCheckTime;
+	double  detectStart;
+
+	// Low-res presence check.
+	int     xsize, ysize;
+	AR_PIXEL_FORMAT pixFormat;
+	int     pixelSize;
+	int     sampleCount;
+	ARUint8 *samples;                   // Previous low-res luma image.
+	int     samplesValid;
+} PresenceScheduler;
+
+// Fill in the default settings (reduced rate policy).
+void presenceDefaultSettings(PresenceSettings *settings);
+
+// Set up a scheduler for frames of the given size and format.
+int  presenceInit(PresenceScheduler *ps, const PresenceSettings *settings, int xsize, int ysize, AR_PIXEL_FORMAT pixFormat);
+void presenceFinal(PresenceScheduler *ps);
+
+// Change policy at runtime; always returns to full rate first.
+void presenceSetPolicy(PresenceScheduler *ps, PRESENCE_POLICY policy);
+const char *presencePolicyName(PRESENCE_POLICY policy);
+
+// Call for every new camera frame. Returns TRUE if full detection should
+// run on this frame; in that case call presenceDetected() once it is done.
+int  presenceShouldDetect(PresenceScheduler *ps, const ARUint8 *image);
+void presenceDetected(PresenceScheduler *ps, int found);
+
+// Estimated detection time saved, in seconds: skipped frames cost nothing,
+// checked frames cost the low-res check instead of a full detection.
+double presenceSavedSeconds(const PresenceStats *stats);
+
+#endif // !PRESENCE_SCHEDULER_H
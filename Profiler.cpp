@@ -0,0 +1,323 @@
+/*
+*  Profiler.cpp
+*
+*  In-process sampling profiler. See Profiler.h.
+*
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <atomic>
+#include <map>
+#include <string>
+#ifdef _WIN32
+#  include <windows.h>
+#else
+#  include <pthread.h>
+#  include <signal.h>
+#  include <sched.h>
+#  include <execinfo.h>
+#  include <sys/time.h>
+#  ifdef __linux__
+#    include <time.h>
+#    include <unistd.h>
+#    include <sys/syscall.h>
+#  endif
+#endif
+#include <AR/ar.h>
+#include "Profiler.h"
+#include "StackTrace.h"
+
+#ifdef _MSC_VER
+#  define PROFILER_TLS __declspec(thread)
+#else
+#  define PROFILER_TLS __thread
+#endif
+
+// Frames of the signal handler and the kernel's signal trampoline at the
+// inner end of a backtrace() taken in profilerSignal().
+#define PROFILER_SKIP   2
+
+typedef struct {
+	std::atomic<int>    ready;
+	int                 thread;
+	int                 depth;
+	void                *pc[PROFILER_DEPTH_MAX];    // Innermost first.
+} ProfilerSlot;
+
+static struct {
+	int                 hz;
+	ProfilerSlot        *slots;
+	int                 slotCount;
+	std::atomic<long>   writeIndex;                 // Samples taken since the last dump; slot writeIndex % slotCount is next.
+	std::atomic<int>    paused;                     // Set while dumping.
+	std::atomic<int>    active;                     // Samplers in flight.
+	std::atomic<long>   dropped;
+	int                 threadNum;
+	const char          *threadName[PROFILER_THREAD_MAX];
+#ifdef _WIN32
+	HANDLE              threads[PROFILER_THREAD_MAX];
+	ULONGLONG           threadTime[PROFILER_THREAD_MAX];
+	HANDLE              sampler;
+	std::atomic<int>    running;
+#else
+	struct sigaction    oldAction;
+#  ifdef __linux__
+	timer_t             timers[PROFILER_THREAD_MAX];
+#  endif
+#endif
+} gProfiler;
+
+static PROFILER_TLS int gProfilerThread = -1;
+
+static void profilerRecord(int thread, void **pcs, int depth)
+{
+	ProfilerSlot *slot;
+	long i;
+
+	// A ring: once it is full each sample replaces the oldest one.
+	i = gProfiler.writeIndex.fetch_add(1);
+	slot = &gProfiler.slots[i % gProfiler.slotCount];
+	if (i >= gProfiler.slotCount && slot->ready.exchange(0, std::memory_order_acquire)) gProfiler.dropped++;
+	slot->thread = thread;
+	slot->depth = depth < PROFILER_DEPTH_MAX ? depth : PROFILER_DEPTH_MAX;
+	memcpy(slot->pc, pcs, slot->depth * sizeof(void *));
+	slot->ready.store(1, std::memory_order_release);
+}
+
+#ifdef _WIN32
+static DWORD WINAPI profilerThread(LPVOID arg)
+{
+	void *pcs[PROFILER_DEPTH_MAX];
+	FILETIME created, exited, kernel, user;
+	ULONGLONG t;
+	DWORD interval;
+	int i, n;
+
+	(void)arg;
+	interval = 1000 / gProfiler.hz;
+	if (interval < 1) interval = 1;
+	while (gProfiler.running.load()) {
+		Sleep(interval);
+		for (i = 0; i < gProfiler.threadNum; i++) {
+			// Only sample threads that ran since last time, like a CPU
+			// time timer would.
+			if (!GetThreadTimes(gProfiler.threads[i], &created, &exited, &kernel, &user)) continue;
+			t = ((ULONGLONG)kernel.dwHighDateTime << 32 | kernel.dwLowDateTime) + ((ULONGLONG)user.dwHighDateTime << 32 | user.dwLowDateTime);
+			if (t == gProfiler.threadTime[i]) continue;
+			gProfiler.threadTime[i] = t;
+
+			gProfiler.active++;
+			if (!gProfiler.paused.load()) {
+				n = stackWalkThread(gProfiler.threads[i], pcs, PROFILER_DEPTH_MAX);
+				if (n > 0) profilerRecord(i, pcs, n);
+			}
+			gProfiler.active--;
+		}
+	}
+	return 0;
+}
+#else
+static void profilerSignal(int sig)
+{
+	void *pcs[PROFILER_DEPTH_MAX + PROFILER_SKIP];
+	int n, saved = errno;
+
+	(void)sig;
+	gProfiler.active++;
+	if (!gProfiler.paused.load()) {
+		n = backtrace(pcs, PROFILER_DEPTH_MAX + PROFILER_SKIP);
+		if (n > PROFILER_SKIP) profilerRecord(gProfilerThread, pcs + PROFILER_SKIP, n - PROFILER_SKIP);
+	}
+	gProfiler.active--;
+	errno = saved;
+}
+#endif
+
+int profilerInit(int hz, int slotCount)
+{
+#ifndef _WIN32
+	struct sigaction action;
+	void *warm[1];
+#  ifndef __linux__
+	struct itimerval it;
+#  endif
+#endif
+
+	gProfiler.hz = hz > 0 ? hz : 97;
+	gProfiler.slotCount = slotCount;
+	gProfiler.writeIndex.store(0);
+	gProfiler.paused.store(0);
+	gProfiler.active.store(0);
+	gProfiler.dropped.store(0);
+	gProfiler.threadNum = 0;
+	if ((gProfiler.slots = (ProfilerSlot *)calloc(slotCount, sizeof(ProfilerSlot))) == NULL) {
+		ARLOGe("profilerInit(): Out of memory.\n");
+		return (FALSE);
+	}
+	stackInit();
+
+#ifdef _WIN32
+	gProfiler.running.store(1);
+	if ((gProfiler.sampler = CreateThread(NULL, 0, profilerThread, NULL, 0, NULL)) == NULL) {
+		ARLOGe("profilerInit(): Unable to start sampler thread.\n");
+		profilerFinal();
+		return (FALSE);
+	}
+#else
+	backtrace(warm, 1);     // Load the unwinder now rather than in the handler.
+	memset(&action, 0, sizeof(action));
+	action.sa_handler = profilerSignal;
+	action.sa_flags = SA_RESTART;
+	sigemptyset(&action.sa_mask);
+	sigaction(SIGPROF, &action, &gProfiler.oldAction);
+#  ifndef __linux__
+	it.it_interval.tv_sec = 0;
+	it.it_interval.tv_usec = 1000000 / gProfiler.hz;
+	it.it_value = it.it_interval;
+	setitimer(ITIMER_PROF, &it, NULL);
+#  endif
+#endif
+	return (TRUE);
+}
+
+void profilerFinal(void)
+{
+	int i;
+
+	if (!gProfiler.slots) return;
+#ifdef _WIN32
+	if (gProfiler.sampler) {
+		gProfiler.running.store(0);
+		WaitForSingleObject(gProfiler.sampler, INFINITE);
+		CloseHandle(gProfiler.sampler);
+		gProfiler.sampler = NULL;
+	}
+	for (i = 0; i < gProfiler.threadNum; i++) CloseHandle(gProfiler.threads[i]);
+#else
+#  ifdef __linux__
+	for (i = 0; i < gProfiler.threadNum; i++) timer_delete(gProfiler.timers[i]);
+#  else
+	struct itimerval it;
+	memset(&it, 0, sizeof(it));
+	setitimer(ITIMER_PROF, &it, NULL);
+	(void)i;
+#  endif
+	gProfiler.paused.store(1);
+	while (gProfiler.active.load()) sched_yield();
+	sigaction(SIGPROF, &gProfiler.oldAction, NULL);
+#endif
+	gProfiler.threadNum = 0;
+	stackFinal();
+	free(gProfiler.slots);
+	gProfiler.slots = NULL;
+}
+
+int profilerAddThread(const char *name)
+{
+	int i;
+#ifdef __linux__
+	struct sigevent sev;
+	struct itimerspec its;
+#endif
+
+	if (!gProfiler.slots || gProfiler.threadNum == PROFILER_THREAD_MAX) return (FALSE);
+	i = gProfiler.threadNum;
+	gProfiler.threadName[i] = name;
+
+#ifdef _WIN32
+	if (!DuplicateHandle(GetCurrentProcess(), GetCurrentThread(), GetCurrentProcess(), &gProfiler.threads[i], 0, FALSE, DUPLICATE_SAME_ACCESS)) {
+		ARLOGe("profilerAddThread(): Unable to get thread handle.\n");
+		return (FALSE);
+	}
+	gProfiler.threadTime[i] = 0;
+#elif defined(__linux__)
+	// A CPU time clock of this thread alone, signalling this thread alone.
+	memset(&sev, 0, sizeof(sev));
+	sev.sigev_notify = SIGEV_THREAD_ID;
+	sev.sigev_signo = SIGPROF;
+#  ifdef sigev_notify_thread_id
+	sev.sigev_notify_thread_id = (pid_t)syscall(SYS_gettid);
+#  else
+	sev._sigev_un._tid = (pid_t)syscall(SYS_gettid);
+#  endif
+	if (timer_create(CLOCK_THREAD_CPUTIME_ID, &sev, &gProfiler.timers[i]) != 0) {
+		ARLOGe("profilerAddThread(): timer_create failed.\n");
+		return (FALSE);
+	}
+	its.it_interval.tv_sec = 0;
+	its.it_interval.tv_nsec = 1000000000L / gProfiler.hz;
+	its.it_value = its.it_interval;
+	timer_settime(gProfiler.timers[i], 0, &its, NULL);
+#endif
+
+	gProfilerThread = i;
+	gProfiler.threadNum++;
+	return (TRUE);
+}
+
+long profilerDump(const char *path)
+{
+	std::map<void *, std::string> names;
+	std::map<std::string, long> stacks;
+	std::map<void *, std::string>::iterator name;
+	std::map<std::string, long>::iterator it;
+	std::string stack;
+	ProfilerSlot *slot;
+	char buf[256], *p;
+	FILE *fp;
+	long total, first, i, n;
+	int d;
+
+	if (!gProfiler.slots) return (-1);
+	if ((fp = fopen(path, "w")) == NULL) {
+		ARLOGe("profilerDump(): Unable to open %s.\n", path);
+		return (-1);
+	}
+
+	// Stop new samples and wait for those in flight.
+	gProfiler.paused.store(1);
+	while (gProfiler.active.load()) {
+#ifdef _WIN32
+		Sleep(0);
+#else
+		sched_yield();
+#endif
+	}
+
+	// The last slotCount samples, oldest first.
+	n = gProfiler.writeIndex.load();
+	first = n > gProfiler.slotCount ? n - gProfiler.slotCount : 0;
+	total = 0;
+	for (i = first; i < n; i++) {
+		slot = &gProfiler.slots[i % gProfiler.slotCount];
+		if (!slot->ready.load(std::memory_order_acquire)) continue;
+		stack = (slot->thread >= 0 && slot->thread < gProfiler.threadNum) ? gProfiler.threadName[slot->thread] : "[thread]";
+		for (d = slot->depth - 1; d >= 0; d--) {
+			name = names.find(slot->pc[d]);
+			if (name == names.end()) {
+				stackSymbol(slot->pc[d], buf, sizeof(buf));
+				for (p = buf; *p; p++) if (*p == ';') *p = ':';   // ';' separates frames.
+				name = names.insert(std::make_pair(slot->pc[d], std::string(buf))).first;
+			}
+			stack += ';';
+			stack += name->second;
+		}
+		stacks[stack]++;
+		slot->ready.store(0, std::memory_order_relaxed);
+		total++;
+	}
+	gProfiler.writeIndex.store(0);
+	gProfiler.paused.store(0);
+
+	for (it = stacks.begin(); it != stacks.end(); ++it) fprintf(fp, "%s %ld\n", it->first.c_str(), it->second);
+	fclose(fp);
+	return total;
+}
+
+long profilerDropped(void)
+{
+	return gProfiler.dropped.load();
+}
@@ -0,0 +1,44 @@
+/*
+*  Profiler.h
+*
+*  In-process sampling profiler.
+*
+*  Registered threads are sampled at a fixed rate of their CPU time, so a
+*  blocked thread costs nothing. On Linux each thread gets its own
+*  timer_create() CPU clock timer delivering SIGPROF to that thread;
+*  other POSIX systems fall back to the process wide ITIMER_PROF. On
+*  Windows a sampler thread suspends each registered thread in turn and
+*  skips those that used no CPU time since the last sample.
+*
+*  Stacks go into a fixed ring of slots claimed with a single atomic
+*  increment; nothing is allocated or locked while sampling. Once the
+*  ring is full each sample replaces the oldest, so a dump holds the
+*  most recent samples however long the run. profilerDump() writes them
+*  out as collapsed stacks, one line per
+*  distinct stack ("thread;outer;...;inner count"), ready for
+*  flamegraph.pl, and empties the buffer.
+*
+*/
+
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#define PROFILER_DEPTH_MAX      32
+#define PROFILER_THREAD_MAX     8
+
+// hz samples per second of CPU time per thread; the latest slotCount
+// samples are kept between dumps.
+int  profilerInit(int hz, int slotCount);
+void profilerFinal(void);
+
+// Sample the calling thread. name must be a string literal.
+int  profilerAddThread(const char *name);
+
+// Write collapsed stacks to path and empty the buffer. Returns the number
+// of samples written, or -1.
+long profilerDump(const char *path);
+
+// Samples overwritten by newer ones before a dump wrote them out.
+long profilerDropped(void);
+
+#endif // !PROFILER_H
@@ -0,0 +1,462 @@
+/*
+*  Soak.cpp
+*
+*  Long running soak monitor. See Soak.h.
+*
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#ifdef _WIN32
+#  include <windows.h>
+#  include <psapi.h>
+#  include <malloc.h>
+#  pragma comment(lib, "psapi.lib")
+#  define snprintf _snprintf
+#elif defined(__APPLE__)
+#  include <mach/mach.h>
+#  include <malloc/malloc.h>
+#else
+#  include <fcntl.h>
+#  include <unistd.h>
+#  ifdef __GLIBC__
+#    include <malloc.h>
+#  endif
+#endif
+#include <AR/ar.h>
+#include "Soak.h"
+#include "AllocTrack.h"
+#include "Timing.h"
+
+#define SOAK_TREND_MIN      8       // Samples before a series is checked.
+#define SOAK_TAU            0.5     // Kendall's tau above which a series counts as rising.
+#define SOAK_MB             (1024.0 * 1024.0)
+
+typedef struct {
+	const char      *name;
+	int             gpu;
+	unsigned int    hist[SOAK_BUCKETS];
+	long            count;
+	double          max;
+} SoakStage;
+
+typedef struct {
+	char            name[48];
+	double          absFloor, relFloor;     // Growth over the run must exceed both to flag.
+	int             n, stride, skip;
+	double          t[SOAK_HISTORY];        // Seconds since start.
+	double          v[SOAK_HISTORY];
+	int             flagged;
+	double          tau, growth;
+} SoakSeries;
+
+static struct {
+	double          hours, interval, warmup;
+	FILE            *csv;
+	double          start, lastSample;
+	int             record;                 // Past the warm-up at this sample.
+
+	SoakStage       stages[SOAK_STAGE_MAX];
+	int             stageNum;
+	int             frame, stage;           // Indices into stages, -1 if none.
+	double          frameStart, stageStart;
+
+	long            delivered, dropped;     // Since the last sample.
+	long            allocLast;
+
+	SoakSeries      *series;
+	int             seriesNum;
+	int             flagged;
+} gSoak;
+
+// ============================================================================
+//	Process memory
+// ============================================================================
+
+// Resident set size in bytes, or -1.
+static double soakRss(void)
+{
+#if defined(_WIN32)
+	PROCESS_MEMORY_COUNTERS pmc;
+
+	if (!GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc))) return (-1.0);
+	return (double)pmc.WorkingSetSize;
+#elif defined(__APPLE__)
+	mach_task_basic_info_data_t info;
+	mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+
+	if (task_info(mach_task_self(), MACH_TASK_BASIC_INFO, (task_info_t)&info, &count) != KERN_SUCCESS) return (-1.0);
+	return (double)info.resident_size;
+#else
+	char buf[128];
+	long pages;
+	ssize_t len;
+	int fd;
+
+	// Read with plain read() so that sampling itself does not allocate.
+	if ((fd = open("/proc/self/statm", O_RDONLY)) < 0) return (-1.0);
+	len = read(fd, buf, sizeof(buf) - 1);
+	close(fd);
+	if (len <= 0) return (-1.0);
+	buf[len] = '\0';
+	if (sscanf(buf, "%*s %ld", &pages) != 1) return (-1.0);
+	return (double)pages * (double)sysconf(_SC_PAGESIZE);
+#endif
+}
+
+// Bytes the allocator has handed out, and bytes it holds from the system.
+static int soakHeap(double *inUse, double *held)
+{
+#if defined(_WIN32)
+	_HEAPINFO info;
+
+	*inUse = *held = 0.0;
+	info._pentry = NULL;
+	while (_heapwalk(&info) == _HEAPOK) {
+		*held += (double)info._size;
+		if (info._useflag == _USEDENTRY) *inUse += (double)info._size;
+	}
+	return (TRUE);
+#elif defined(__APPLE__)
+	malloc_statistics_t stats;
+
+	malloc_zone_statistics(NULL, &stats);
+	*inUse = (double)stats.size_in_use;
+	*held = (double)stats.size_allocated;
+	return (TRUE);
+#elif defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+	struct mallinfo2 mi = mallinfo2();
+
+	*inUse = (double)mi.uordblks + (double)mi.hblkhd;
+	*held = (double)mi.arena + (double)mi.hblkhd;
+	return (TRUE);
+#elif defined(__GLIBC__)
+	struct mallinfo mi = mallinfo();     // int fields, wraps past 2 GB.
+
+	*inUse = (double)(unsigned int)mi.uordblks + (double)(unsigned int)mi.hblkhd;
+	*held = (double)(unsigned int)mi.arena + (double)(unsigned int)mi.hblkhd;
+	return (TRUE);
+#else
+	(void)inUse; (void)held;
+	return (FALSE);
+#endif
+}
+
+// ============================================================================
+//	Stage histograms
+// ============================================================================
+
+static int soakStageIndex(const char *name, int gpu)
+{
+	int i;
+
+	for (i = 0; i < gSoak.stageNum; i++) if (gSoak.stages[i].name == name && gSoak.stages[i].gpu == gpu) return i;
+	for (i = 0; i < gSoak.stageNum; i++) if (gSoak.stages[i].gpu == gpu && strcmp(gSoak.stages[i].name, name) == 0) return i;
+	if (gSoak.stageNum == SOAK_STAGE_MAX) return (-1);
+	gSoak.stages[gSoak.stageNum].name = name;
+	gSoak.stages[gSoak.stageNum].gpu = gpu;
+	return gSoak.stageNum++;
+}
+
+static void soakStageAdd(int i, double seconds)
+{
+	SoakStage *st;
+	double us;
+	int b;
+
+	if (i < 0) return;
+	st = &gSoak.stages[i];
+	us = seconds * 1e6;
+	b = us > 1.0 ? (int)(log2(us) * 8.0) : 0;
+	if (b >= SOAK_BUCKETS) b = SOAK_BUCKETS - 1;
+	st->hist[b]++;
+	st->count++;
+	if (seconds > st->max) st->max = seconds;
+}
+
+// Upper edge of the bucket holding the given fraction of the samples, ms.
+static double soakPercentile(const SoakStage *st, double fraction)
+{
+	long want, seen;
+	int b;
+
+	want = (long)ceil(fraction * st->count);
+	if (want < 1) want = 1;
+	seen = 0;
+	for (b = 0; b < SOAK_BUCKETS - 1; b++) {
+		seen += st->hist[b];
+		if (seen >= want) break;
+	}
+	return pow(2.0, (b + 1) / 8.0) * 1e-3;
+}
+
+// ============================================================================
+//	Series and trends
+// ============================================================================
+
+static SoakSeries *soakSeriesFind(const char *name, double absFloor, double relFloor)
+{
+	SoakSeries *s;
+	int i;
+
+	for (i = 0; i < gSoak.seriesNum; i++) if (strcmp(gSoak.series[i].name, name) == 0) return &gSoak.series[i];
+	if (gSoak.seriesNum == SOAK_SERIES_MAX) return (NULL);
+	s = &gSoak.series[gSoak.seriesNum++];
+	snprintf(s->name, sizeof(s->name), "%s", name);
+	s->absFloor = absFloor;
+	s->relFloor = relFloor;
+	s->stride = 1;
+	return s;
+}
+
+static void soakTrend(SoakSeries *s)
+{
+	double tm, vm, cov, var, slope, base;
+	long S;
+	int i, j, q;
+
+	// Kendall's tau: +1 if every later sample is above every earlier one.
+	S = 0;
+	for (i = 0; i < s->n; i++) {
+		for (j = i + 1; j < s->n; j++) {
+			if (s->v[j] > s->v[i]) S++;
+			else if (s->v[j] < s->v[i]) S--;
+		}
+	}
+	s->tau = (double)S / (0.5 * s->n * (s->n - 1));
+
+	// Least squares growth from the first to the last sample.
+	tm = vm = 0.0;
+	for (i = 0; i < s->n; i++) {
+		tm += s->t[i];
+		vm += s->v[i];
+	}
+	tm /= s->n;
+	vm /= s->n;
+	cov = var = 0.0;
+	for (i = 0; i < s->n; i++) {
+		cov += (s->t[i] - tm) * (s->v[i] - vm);
+		var += (s->t[i] - tm) * (s->t[i] - tm);
+	}
+	slope = var > 0.0 ? cov / var : 0.0;
+	s->growth = slope * (s->t[s->n - 1] - s->t[0]);
+
+	// Relative to the level over the first quarter.
+	q = s->n / 4 > 0 ? s->n / 4 : 1;
+	base = 0.0;
+	for (i = 0; i < q; i++) base += s->v[i];
+	base /= q;
+
+	if (s->tau >= SOAK_TAU && s->growth > s->absFloor && s->growth > s->relFloor * fabs(base)) {
+		if (!s->flagged) {
+			s->flagged = TRUE;
+			gSoak.flagged++;
+			ARLOGw("Soak: %s is drifting, %+.3g over %.2f h (tau %.2f).\n", s->name, s->growth, (s->t[s->n - 1] - s->t[0]) / 3600.0, s->tau);
+		}
+	}
+	else if (s->flagged) {
+		s->flagged = FALSE;
+		gSoak.flagged--;
+		ARLOGi("Soak: %s no longer drifting.\n", s->name);
+	}
+}
+
+static void soakSeriesAdd(SoakSeries *s, double t, double v)
+{
+	int i;
+
+	if (++s->skip < s->stride) return;
+	s->skip = 0;
+	if (s->n == SOAK_HISTORY) {
+		// Keep every other sample and go on at half the rate.
+		for (i = 0; i < SOAK_HISTORY / 2; i++) {
+			s->t[i] = s->t[2 * i + 1];
+			s->v[i] = s->v[2 * i + 1];
+		}
+		s->n = SOAK_HISTORY / 2;
+		s->stride *= 2;
+	}
+	s->t[s->n] = t;
+	s->v[s->n] = v;
+	s->n++;
+	if (s->n >= SOAK_TREND_MIN) soakTrend(s);
+}
+
+// Log one value; absFloor < 0 logs it without following its trend.
+static void soakMetric(double elapsed, const char *name, double value, double absFloor, double relFloor)
+{
+	SoakSeries *s;
+
+	if (gSoak.csv) fprintf(gSoak.csv, "%.1f,%s,%.6g\n", elapsed, name, value);
+	if (!gSoak.record || absFloor < 0.0) return;
+	if ((s = soakSeriesFind(name, absFloor, relFloor)) != NULL) soakSeriesAdd(s, elapsed, value);
+}
+
+// ============================================================================
+//	Public
+// ============================================================================
+
+int soakInit(double hours, double interval, double warmup, const char *csvPath)
+{
+	memset(&gSoak, 0, sizeof(gSoak));
+	gSoak.hours = hours;
+	gSoak.interval = interval > 0.0 ? interval : 10.0;
+	gSoak.warmup = warmup;
+	gSoak.frame = gSoak.stage = -1;
+	if ((gSoak.series = (SoakSeries *)calloc(SOAK_SERIES_MAX, sizeof(SoakSeries))) == NULL) {
+		ARLOGe("soakInit(): Out of memory.\n");
+		return (FALSE);
+	}
+	if (csvPath) {
+		if ((gSoak.csv = fopen(csvPath, "w")) == NULL) {
+			ARLOGe("soakInit(): Unable to create %s.\n", csvPath);
+			soakFinal();
+			return (FALSE);
+		}
+		fprintf(gSoak.csv, "elapsed_s,metric,value\n");
+	}
+	gSoak.allocLast = allocTrackTotal();
+	gSoak.start = gSoak.lastSample = timingNow();
+	return (TRUE);
+}
+
+void soakFinal(void)
+{
+	if (gSoak.csv) fclose(gSoak.csv);
+	gSoak.csv = NULL;
+	free(gSoak.series);
+	gSoak.series = NULL;
+}
+
+void soakFrameBegin(const char *name)
+{
+	if (!gSoak.series) return;
+	gSoak.frame = soakStageIndex(name, FALSE);
+	gSoak.stage = -1;
+	gSoak.frameStart = gSoak.stageStart = timingNow();
+}
+
+void soakStage(const char *stage)
+{
+	double now;
+
+	if (!gSoak.series || gSoak.frame < 0) return;
+	now = timingNow();
+	soakStageAdd(gSoak.stage, now - gSoak.stageStart);
+	gSoak.stage = soakStageIndex(stage, FALSE);
+	gSoak.stageStart = now;
+}
+
+void soakFrameEnd(void)
+{
+	double now;
+
+	if (!gSoak.series || gSoak.frame < 0) return;
+	now = timingNow();
+	soakStageAdd(gSoak.stage, now - gSoak.stageStart);
+	soakStageAdd(gSoak.frame, now - gSoak.frameStart);
+	gSoak.frame = gSoak.stage = -1;
+}
+
+void soakGpuPass(const char *pass, double seconds)
+{
+	if (!gSoak.series) return;
+	soakStageAdd(soakStageIndex(pass, TRUE), seconds);
+}
+
+void soakSourceFrames(long delivered, long dropped)
+{
+	gSoak.delivered += delivered;
+	gSoak.dropped += dropped;
+}
+
+int soakUpdate(void)
+{
+	char name[64];
+	const char *kind;
+	double now, elapsed, span, inUse, held, rss;
+	long allocs;
+	SoakStage *st;
+	int i;
+
+	if (!gSoak.series) return (FALSE);
+	now = timingNow();
+	elapsed = now - gSoak.start;
+	if (now - gSoak.lastSample < gSoak.interval) return (gSoak.hours <= 0.0 || elapsed < gSoak.hours * 3600.0);
+	span = now - gSoak.lastSample;
+	gSoak.lastSample = now;
+	gSoak.record = (elapsed >= gSoak.warmup);
+
+	// Memory, in MB.
+	if ((rss = soakRss()) >= 0.0) soakMetric(elapsed, "rss_mb", rss / SOAK_MB, 4.0, 0.02);
+	if (soakHeap(&inUse, &held)) {
+		soakMetric(elapsed, "heap_in_use_mb", inUse / SOAK_MB, 1.0, 0.02);
+		soakMetric(elapsed, "heap_held_mb", held / SOAK_MB, 4.0, 0.02);
+	}
+	if (allocTrackAvailable()) {
+		allocs = allocTrackTotal();
+		soakMetric(elapsed, "allocs_per_s", (allocs - gSoak.allocLast) / span, 1.0, 0.25);
+		gSoak.allocLast = allocs;
+	}
+
+	// Source frames.
+	soakMetric(elapsed, "frames", (double)gSoak.delivered, -1.0, 0.0);
+	if (gSoak.delivered + gSoak.dropped > 0) {
+		soakMetric(elapsed, "drop_rate", (double)gSoak.dropped / (gSoak.delivered + gSoak.dropped), 0.02, 0.0);
+	}
+	gSoak.delivered = gSoak.dropped = 0;
+
+	// Stage latencies over the interval, in ms.
+	for (i = 0; i < gSoak.stageNum; i++) {
+		st = &gSoak.stages[i];
+		if (!st->count) continue;
+		kind = st->gpu ? "gpu_" : "";
+		snprintf(name, sizeof(name), "%s.%sp50_ms", st->name, kind);
+		soakMetric(elapsed, name, soakPercentile(st, 0.50), 0.5, 0.15);
+		snprintf(name, sizeof(name), "%s.%sp95_ms", st->name, kind);
+		soakMetric(elapsed, name, soakPercentile(st, 0.95), -1.0, 0.0);
+		snprintf(name, sizeof(name), "%s.%sp99_ms", st->name, kind);
+		soakMetric(elapsed, name, soakPercentile(st, 0.99), 1.0, 0.25);
+		snprintf(name, sizeof(name), "%s.%smax_ms", st->name, kind);
+		soakMetric(elapsed, name, st->max * 1000.0, -1.0, 0.0);
+		memset(st->hist, 0, sizeof(st->hist));
+		st->count = 0;
+		st->max = 0.0;
+	}
+	if (gSoak.csv) fflush(gSoak.csv);   // Keep what there is if the process dies.
+
+	return (gSoak.hours <= 0.0 || elapsed < gSoak.hours * 3600.0);
+}
+
+int soakReport(void)
+{
+	SoakSeries *s;
+	int i;
+
+	if (!gSoak.series) return (0);
+	ARLOGi("Soak: %.2f h, %d of %d series drifting.\n", soakElapsed() / 3600.0, gSoak.flagged, gSoak.seriesNum);
+	for (i = 0; i < gSoak.seriesNum; i++) {
+		s = &gSoak.series[i];
+		if (s->n < 2) continue;
+		ARLOGi("  %-32s %10.3f -> %10.3f, growth %+.3g, tau %+.2f%s\n", s->name, s->v[0], s->v[s->n - 1],
+			s->n >= SOAK_TREND_MIN ? s->growth : 0.0, s->n >= SOAK_TREND_MIN ? s->tau : 0.0, s->flagged ? "  DRIFTING" : "");
+	}
+	return gSoak.flagged;
+}
+
+int soakFlagged(void)
+{
+	return gSoak.flagged;
+}
+
+double soakElapsed(void)
+{
+	return gSoak.series ? timingNow() - gSoak.start : 0.0;
+}
+
+double soakHours(void)
+{
+	return gSoak.hours;
+}
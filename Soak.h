@@ -0,0 +1,64 @@
+/*
+*  Soak.h
+*
+*  Long running soak monitor: memory growth and latency drift.
+*
+*  Frames are bracketed the same way as for the stall watchdog
+*  (soakFrameBegin(), soakStage(), soakFrameEnd()); the stage times go
+*  into fixed log scale histograms, so the per-frame cost is a clock read
+*  and a counter increment, with no allocation.
+*
+*  Every interval soakUpdate() takes a sample: resident set size, the
+*  allocator's in-use and held bytes, allocations per second (with
+*  ALLOC_TRACKING, see AllocTrack.h), the source frame drop rate and the
+*  50th/95th/99th percentile and maximum of every stage. Samples are
+*  appended to a CSV file (elapsed_s,metric,value), and after the warm-up
+*  the memory, drop rate and latency percentiles are kept as series.
+*  Each series is checked for a trend: it is flagged as drifting when most
+*  pairs of samples increase (Kendall's tau) and the least squares growth
+*  over the run exceeds both an absolute and a relative floor.
+*
+*  The history is bounded: when full, every other sample is dropped and
+*  the series go on at half the rate, so weeks of running cost no more
+*  memory than minutes.
+*
+*/
+
+#ifndef SOAK_H
+#define SOAK_H
+
+#define SOAK_STAGE_MAX      32      // CPU stages and GPU passes.
+#define SOAK_SERIES_MAX     (5 + 2 * SOAK_STAGE_MAX)
+#define SOAK_HISTORY        512
+#define SOAK_BUCKETS        200     // 8 per octave from 1 us, up to 33 s.
+
+// Start a soak of the given length (hours <= 0 runs until stopped),
+// sampling every interval seconds and ignoring the first warmup seconds
+// for trends. csvPath may be NULL.
+int    soakInit(double hours, double interval, double warmup, const char *csvPath);
+void   soakFinal(void);
+
+// name and stage must be string literals (only the pointers are kept).
+void   soakFrameBegin(const char *name);
+void   soakStage(const char *stage);
+void   soakFrameEnd(void);
+
+// GPU time of a render pass, read back later (see GpuTimer.h). Logged as
+// <pass>.gpu_p50_ms and so on next to the CPU stage of the same name.
+void   soakGpuPass(const char *pass, double seconds);
+
+// Source frames handed to the pipeline, and those skipped because the
+// pipeline was still busy when they were due.
+void   soakSourceFrames(long delivered, long dropped);
+
+// Takes a sample when one is due. Returns FALSE once the soak is over.
+int    soakUpdate(void);
+
+// Logs the trend of every series. Returns the number flagged as drifting.
+int    soakReport(void);
+
+int    soakFlagged(void);
+double soakElapsed(void);
+double soakHours(void);
+
+#endif // !SOAK_H
@@ -0,0 +1,147 @@
+/*
+*  StackTrace.cpp
+*
+*  Stack capture and symbol lookup. See StackTrace.h.
+*
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#ifdef _WIN32
+#  include <windows.h>
+#  include <dbghelp.h>
+#  pragma comment(lib, "dbghelp.lib")
+#  define snprintf _snprintf
+#else
+#  ifndef _GNU_SOURCE
+#    define _GNU_SOURCE
+#  endif
+#  include <dlfcn.h>
+#  include <cxxabi.h>
+#endif
+#include <AR/ar.h>
+#include "StackTrace.h"
+
+static int gStackUsers = 0;
+#ifdef _WIN32
+// DbgHelp is single threaded, and the profiler, the stall watchdog and
+// the allocation checker call into it from threads of their own.
+static CRITICAL_SECTION gStackLock;
+#endif
+
+int stackInit(void)
+{
+	if (gStackUsers++) return (TRUE);
+#ifdef _WIN32
+	InitializeCriticalSection(&gStackLock);
+	SymSetOptions(SYMOPT_UNDNAME | SYMOPT_DEFERRED_LOADS);
+	if (!SymInitialize(GetCurrentProcess(), NULL, TRUE)) {
+		ARLOGe("stackInit(): SymInitialize failed.\n");
+		return (FALSE);
+	}
+#endif
+	return (TRUE);
+}
+
+void stackFinal(void)
+{
+	if (gStackUsers == 0 || --gStackUsers) return;
+#ifdef _WIN32
+	SymCleanup(GetCurrentProcess());
+	DeleteCriticalSection(&gStackLock);
+#endif
+}
+
+#ifdef _WIN32
+// DbgHelp may take locks the suspended thread holds. Callers only do this
+// from threads of their own, where a deadlock would stall the sampler and
+// not the application. gStackLock is taken before the thread is
+// suspended, so the thread is never stopped holding it.
+int stackWalkThread(HANDLE thread, void **pcs, int max)
+{
+	CONTEXT ctx;
+	STACKFRAME64 sf;
+	DWORD machine;
+	int n = 0;
+
+	EnterCriticalSection(&gStackLock);
+	if (SuspendThread(thread) == (DWORD)-1) {
+		LeaveCriticalSection(&gStackLock);
+		return 0;
+	}
+	memset(&ctx, 0, sizeof(ctx));
+	ctx.ContextFlags = CONTEXT_FULL;
+	if (GetThreadContext(thread, &ctx)) {
+		memset(&sf, 0, sizeof(sf));
+#ifdef _M_X64
+		machine = IMAGE_FILE_MACHINE_AMD64;
+		sf.AddrPC.Offset = ctx.Rip;
+		sf.AddrFrame.Offset = ctx.Rbp;
+		sf.AddrStack.Offset = ctx.Rsp;
+#else
+		machine = IMAGE_FILE_MACHINE_I386;
+		sf.AddrPC.Offset = ctx.Eip;
+		sf.AddrFrame.Offset = ctx.Ebp;
+		sf.AddrStack.Offset = ctx.Esp;
+#endif
+		sf.AddrPC.Mode = sf.AddrFrame.Mode = sf.AddrStack.Mode = AddrModeFlat;
+		while (n < max &&
+			StackWalk64(machine, GetCurrentProcess(), thread, &sf, &ctx, NULL, SymFunctionTableAccess64, SymGetModuleBase64, NULL)) {
+			if (!sf.AddrPC.Offset) break;
+			pcs[n++] = (void *)(uintptr_t)sf.AddrPC.Offset;
+		}
+	}
+	ResumeThread(thread);
+	LeaveCriticalSection(&gStackLock);
+	return n;
+}
+
+int stackSymbol(void *pc, char *buf, size_t size)
+{
+	char symbuf[sizeof(SYMBOL_INFO) + 256];
+	SYMBOL_INFO *sym = (SYMBOL_INFO *)symbuf;
+	IMAGEHLP_MODULE64 module;
+	DWORD64 displacement;
+	int found;
+
+	memset(symbuf, 0, sizeof(symbuf));
+	sym->SizeOfStruct = sizeof(SYMBOL_INFO);
+	sym->MaxNameLen = 255;
+	EnterCriticalSection(&gStackLock);
+	if ((found = SymFromAddr(GetCurrentProcess(), (DWORD64)(uintptr_t)pc, &displacement, sym)) != 0) {
+		snprintf(buf, size, "%s", sym->Name);
+	} else {
+		memset(&module, 0, sizeof(module));
+		module.SizeOfStruct = sizeof(module);
+		if (SymGetModuleInfo64(GetCurrentProcess(), (DWORD64)(uintptr_t)pc, &module)) snprintf(buf, size, "[%s]", module.ModuleName);
+		else snprintf(buf, size, "[unknown]");
+	}
+	LeaveCriticalSection(&gStackLock);
+	buf[size - 1] = '\0';
+	return (found ? TRUE : FALSE);
+}
+#else
+int stackSymbol(void *pc, char *buf, size_t size)
+{
+	Dl_info info;
+	const char *module;
+	char *demangled;
+	int status;
+
+	if (!dladdr(pc, &info)) {
+		snprintf(buf, size, "[unknown]");
+		return (FALSE);
+	}
+	if (info.dli_sname) {
+		demangled = abi::__cxa_demangle(info.dli_sname, NULL, NULL, &status);
+		snprintf(buf, size, "%s", status == 0 && demangled ? demangled : info.dli_sname);
+		free(demangled);
+		return (TRUE);
+	}
+	module = info.dli_fname ? strrchr(info.dli_fname, '/') : NULL;
+	snprintf(buf, size, "[%s]", module ? module + 1 : info.dli_fname ? info.dli_fname : "unknown");
+	return (FALSE);
+}
+#endif
@@ -0,0 +1,35 @@
+/*
+*  StackTrace.h
+*
+*  Stack capture and symbol lookup shared by the stall watchdog and the
+*  sampling profiler.
+*
+*  On POSIX systems symbols come from dladdr(), which only sees exported
+*  symbols: link with -rdynamic to get names for the functions of the
+*  executable itself. On Windows they come from DbgHelp and the .pdb.
+*
+*/
+
+#ifndef STACK_TRACE_H
+#define STACK_TRACE_H
+
+#include <stddef.h>
+#ifdef _WIN32
+#  include <windows.h>
+#endif
+
+// Reference counted; call once per user.
+int  stackInit(void);
+void stackFinal(void);
+
+#ifdef _WIN32
+// Suspend the thread, walk its stack into pcs (innermost first) and
+// resume it. Returns the number of frames.
+int  stackWalkThread(HANDLE thread, void **pcs, int max);
+#endif
+
+// Name of the function containing pc. Returns FALSE and "[module]" or
+// "[unknown]" if there is no symbol for it.
+int  stackSymbol(void *pc, char *buf, size_t size);
+
+#endif // !STACK_TRACE_H
@@ -0,0 +1,329 @@
+/*
+*  StallWatchdog.cpp
+*
+*  Frame budget watchdog for the GLUT callbacks. See StallWatchdog.h.
+*
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <stdint.h>
+#include <atomic>
+#ifdef _WIN32
+#  include <windows.h>
+#  define snprintf _snprintf
+#else
+#  include <pthread.h>
+#  include <signal.h>
+#  include <unistd.h>
+#  include <execinfo.h>
+#endif
+#include <AR/ar.h>
+#include "StallWatchdog.h"
+#include "StackTrace.h"
+#include "Timing.h"
+
+#ifndef _WIN32
+#  define WATCHDOG_SIGNAL       SIGUSR2
+#endif
+
+typedef struct {
+	const char    *name;
+	unsigned long seq;
+	double        start, end;
+	int           stageNum;
+	const char    *stageName[WATCHDOG_STAGE_MAX];
+	double        stageTime[WATCHDOG_STAGE_MAX];
+	char          settings[WATCHDOG_SETTINGS_MAX];
+} WatchdogFrame;
+
+static struct {
+	double                  budget;
+	char                    prefix[256];
+	int                     ringSize;
+	WatchdogSettingsFunc    settings;
+
+	WatchdogFrame           frame;          // In progress, only touched by the watched thread.
+	WatchdogFrame           incident;       // Owned by the watcher while pending is set.
+	std::atomic<int>        pending;
+	std::atomic<long long>  activeStart;    // Microseconds; 0 between frames.
+	std::atomic<unsigned long> activeSeq;
+	std::atomic<int>        running;
+
+	// Last stack sample of the watched thread.
+	void                    *stack[WATCHDOG_STACK_MAX];
+	int                     stackNum;
+	unsigned long           stackSeq;
+	double                  stackAt;        // Seconds into the frame.
+	std::atomic<int>        sampled;
+
+	std::atomic<long>       incidents;
+	std::atomic<long>       dropped;
+
+#ifdef _WIN32
+	HANDLE                  thread;         // The watched thread.
+	HANDLE                  watcher;
+#else
+	pthread_t               thread;
+	pthread_t               watcher;
+	struct sigaction        oldAction;
+#endif
+} gWatchdog;
+
+// ============================================================================
+//	Stack sampling
+// ============================================================================
+
+#ifdef _WIN32
+static void watchdogSample(void)
+{
+	gWatchdog.stackNum = stackWalkThread(gWatchdog.thread, gWatchdog.stack, WATCHDOG_STACK_MAX);
+	gWatchdog.stackSeq = gWatchdog.activeSeq.load();
+}
+#else
+// Runs on the watched thread. backtrace() was called once in
+// watchdogInit() so that it does not need to load anything here.
+static void watchdogSignal(int sig)
+{
+	(void)sig;
+	gWatchdog.stackNum = backtrace(gWatchdog.stack, WATCHDOG_STACK_MAX);
+	gWatchdog.stackSeq = gWatchdog.activeSeq.load();
+	gWatchdog.sampled.store(1);
+}
+
+static void watchdogSample(void)
+{
+	int i;
+
+	gWatchdog.sampled.store(0);
+	if (pthread_kill(gWatchdog.thread, WATCHDOG_SIGNAL) != 0) return;
+	for (i = 0; i < 100 && !gWatchdog.sampled.load(); i++) usleep(500);
+	if (!gWatchdog.sampled.load()) gWatchdog.stackNum = 0;
+}
+
+#endif
+
+static void watchdogWriteStack(FILE *fp)
+{
+	char name[256];
+	int i;
+
+	for (i = 0; i < gWatchdog.stackNum; i++) {
+		stackSymbol(gWatchdog.stack[i], name, sizeof(name));
+		fprintf(fp, "  %p %s\n", gWatchdog.stack[i], name);
+	}
+}
+
+// ============================================================================
+//	Incident files
+// ============================================================================
+
+static void watchdogWrite(void)
+{
+	const WatchdogFrame *f = &gWatchdog.incident;
+	char path[sizeof(gWatchdog.prefix) + 16];
+	FILE *fp;
+	time_t now;
+	double t;
+	const char *name;
+	int i;
+
+	snprintf(path, sizeof(path), "%s%02d.txt", gWatchdog.prefix, (int)(gWatchdog.incidents.load() % gWatchdog.ringSize));
+	if ((fp = fopen(path, "w")) == NULL) {
+		ARLOGe("watchdogWrite(): Unable to write stall incident %s.\n", path);
+		return;
+	}
+
+	now = time(NULL);
+	fprintf(fp, "Stall incident %ld, %s", gWatchdog.incidents.load() + 1, ctime(&now));
+	fprintf(fp, "Frame: %s #%lu took %0.1f ms (budget %0.1f ms)\n", f->name, f->seq, (f->end - f->start)*1000.0, gWatchdog.budget*1000.0);
+
+	fprintf(fp, "\nStages:\n");
+	t = f->start;
+	name = "(begin)";
+	for (i = 0; i < f->stageNum; i++) {
+		fprintf(fp, "  %-24s %8.2f ms\n", name, (f->stageTime[i] - t)*1000.0);
+		t = f->stageTime[i];
+		name = f->stageName[i];
+	}
+	fprintf(fp, "  %-24s %8.2f ms\n", name, (f->end - t)*1000.0);
+
+	fprintf(fp, "\nSettings:\n%s", f->settings);
+
+	if (gWatchdog.stackSeq == f->seq && gWatchdog.stackNum > 0) {
+		fprintf(fp, "\nStack of the stalled thread, %0.1f ms into the frame:\n", gWatchdog.stackAt*1000.0);
+		watchdogWriteStack(fp);
+	}
+	else {
+		fprintf(fp, "\nNo stack sample (the frame ended before the watcher saw it over budget).\n");
+	}
+	fclose(fp);
+	gWatchdog.incidents++;
+	ARLOGw("Frame %s took %0.1f ms, wrote %s.\n", f->name, (f->end - f->start)*1000.0, path);
+}
+
+// ============================================================================
+//	Watcher thread
+// ============================================================================
+
+#ifdef _WIN32
+static DWORD WINAPI watchdogThread(LPVOID arg)
+#else
+static void *watchdogThread(void *arg)
+#endif
+{
+	unsigned long sampledSeq = 0, seq;
+	long long start;
+	double now, poll;
+
+	(void)arg;
+	poll = gWatchdog.budget / 4.0;
+	if (poll < 0.001) poll = 0.001;
+
+	while (gWatchdog.running.load()) {
+#ifdef _WIN32
+		Sleep((DWORD)(poll*1000.0));
+#else
+		usleep((useconds_t)(poll*1e6));
+#endif
+		start = gWatchdog.activeStart.load();
+		seq = gWatchdog.activeSeq.load();
+		now = timingNow();
+		if (start && seq != sampledSeq && now - start*1e-6 > gWatchdog.budget) {
+			watchdogSample();
+			gWatchdog.stackAt = timingNow() - start*1e-6;
+			sampledSeq = seq;
+		}
+		if (gWatchdog.pending.load()) {
+			watchdogWrite();
+			gWatchdog.pending.store(0);
+		}
+	}
+	if (gWatchdog.pending.load()) watchdogWrite();
+	return 0;
+}
+
+// ============================================================================
+//	Public functions
+// ============================================================================
+
+int watchdogInit(double budget, const char *prefix, int ringSize, WatchdogSettingsFunc settings)
+{
+#ifndef _WIN32
+	struct sigaction action;
+	void *warm[1];
+#endif
+
+	gWatchdog.budget = budget;
+	snprintf(gWatchdog.prefix, sizeof(gWatchdog.prefix), "%s", prefix);
+	gWatchdog.ringSize = ringSize > 0 ? ringSize : 1;
+	gWatchdog.settings = settings;
+	gWatchdog.pending.store(0);
+	gWatchdog.activeStart.store(0);
+	gWatchdog.activeSeq.store(0);
+	gWatchdog.stackNum = 0;
+	gWatchdog.stackSeq = 0;
+	gWatchdog.incidents.store(0);
+	gWatchdog.dropped.store(0);
+	gWatchdog.frame.seq = 0;
+	gWatchdog.running.store(1);
+	stackInit();
+
+#ifdef _WIN32
+	if (!DuplicateHandle(GetCurrentProcess(), GetCurrentThread(), GetCurrentProcess(), &gWatchdog.thread, 0, FALSE, DUPLICATE_SAME_ACCESS)) {
+		ARLOGe("watchdogInit(): Unable to get handle of the watched thread.\n");
+		stackFinal();
+		gWatchdog.running.store(0);
+		return (FALSE);
+	}
+	if ((gWatchdog.watcher = CreateThread(NULL, 0, watchdogThread, NULL, 0, NULL)) == NULL) {
+		ARLOGe("watchdogInit(): Unable to start watcher thread.\n");
+		CloseHandle(gWatchdog.thread);
+		stackFinal();
+		gWatchdog.running.store(0);
+		return (FALSE);
+	}
+#else
+	backtrace(warm, 1);
+	gWatchdog.thread = pthread_self();
+	memset(&action, 0, sizeof(action));
+	action.sa_handler = watchdogSignal;
+	action.sa_flags = SA_RESTART;
+	sigemptyset(&action.sa_mask);
+	sigaction(WATCHDOG_SIGNAL, &action, &gWatchdog.oldAction);
+	if (pthread_create(&gWatchdog.watcher, NULL, watchdogThread, NULL) != 0) {
+		ARLOGe("watchdogInit(): Unable to start watcher thread.\n");
+		sigaction(WATCHDOG_SIGNAL, &gWatchdog.oldAction, NULL);
+		stackFinal();
+		gWatchdog.running.store(0);
+		return (FALSE);
+	}
+#endif
+	return (TRUE);
+}
+
+void watchdogFinal(void)
+{
+	if (!gWatchdog.running.load()) return;
+	gWatchdog.running.store(0);
+#ifdef _WIN32
+	WaitForSingleObject(gWatchdog.watcher, INFINITE);
+	CloseHandle(gWatchdog.watcher);
+	CloseHandle(gWatchdog.thread);
+#else
+	pthread_join(gWatchdog.watcher, NULL);
+	sigaction(WATCHDOG_SIGNAL, &gWatchdog.oldAction, NULL);
+#endif
+	stackFinal();
+}
+
+void watchdogFrameBegin(const char *name)
+{
+	WatchdogFrame *f = &gWatchdog.frame;
+
+	f->name = name;
+	f->stageNum = 0;
+	f->start = timingNow();
+	f->seq++;
+	gWatchdog.activeSeq.store(f->seq, std::memory_order_relaxed);
+	gWatchdog.activeStart.store((long long)(f->start*1e6) + 1, std::memory_order_release);
+}
+
+void watchdogStage(const char *stage)
+{
+	WatchdogFrame *f = &gWatchdog.frame;
+
+	if (f->stageNum == WATCHDOG_STAGE_MAX) return;
+	f->stageName[f->stageNum] = stage;
+	f->stageTime[f->stageNum++] = timingNow();
+}
+
+void watchdogFrameEnd(void)
+{
+	WatchdogFrame *f = &gWatchdog.frame;
+
+	f->end = timingNow();
+	gWatchdog.activeStart.store(0, std::memory_order_relaxed);
+	if (f->end - f->start <= gWatchdog.budget || !gWatchdog.running.load(std::memory_order_relaxed)) return;
+
+	// Over budget: from here on the frame is already late.
+	if (gWatchdog.pending.load()) {
+		gWatchdog.dropped++;
+		return;
+	}
+	memcpy(&gWatchdog.incident, f, offsetof(WatchdogFrame, settings));
+	gWatchdog.incident.settings[0] = '\0';
+	if (gWatchdog.settings) gWatchdog.settings(gWatchdog.incident.settings, sizeof(gWatchdog.incident.settings));
+	gWatchdog.pending.store(1);
+}
+
+long watchdogIncidents(void)
+{
+	return gWatchdog.incidents.load();
+}
+
+long watchdogDropped(void)
+{
+	return gWatchdog.dropped.load();
+}
@@ -0,0 +1,47 @@
+/*
+*  StallWatchdog.h
+*
+*  Frame budget watchdog for the GLUT callbacks.
+*
+*  Each mainLoop()/Display() iteration is bracketed by watchdogFrameBegin()
+*  and watchdogFrameEnd(), with watchdogStage() marking the stages in
+*  between. On the calling thread that is a clock read and a store per
+*  call: no locks, system calls, allocation or I/O.
+*
+*  A watcher thread polls the start time of the frame in progress. Once a
+*  frame runs past the budget it samples the stack of the stalled thread
+*  while it is still stuck. When the frame ends over budget, its stage
+*  timings and a settings snapshot are handed to the watcher, which writes
+*  them with the stack sample to the next file in a ring of incident files
+*  (<prefix>00.txt, <prefix>01.txt, ...).
+*
+*/
+
+#ifndef STALL_WATCHDOG_H
+#define STALL_WATCHDOG_H
+
+#include <stddef.h>
+
+#define WATCHDOG_STAGE_MAX      16
+#define WATCHDOG_STACK_MAX      64
+#define WATCHDOG_SETTINGS_MAX   1024
+
+// Called on the stalled thread at the end of an over budget frame to
+// describe the current settings, one per line.
+typedef void (*WatchdogSettingsFunc)(char *buf, size_t size);
+
+// Start watching frames run on the calling thread. budget is in seconds.
+int  watchdogInit(double budget, const char *prefix, int ringSize, WatchdogSettingsFunc settings);
+void watchdogFinal(void);
+
+// name and stage must be string literals (only the pointers are kept).
+void watchdogFrameBegin(const char *name);
+void watchdogStage(const char *stage);
+void watchdogFrameEnd(void);
+
+// Incidents written so far, and those dropped because the previous one
+// was still being written.
+long watchdogIncidents(void);
+long watchdogDropped(void);
+
+#endif // !STALL_WATCHDOG_H
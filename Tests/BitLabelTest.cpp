@@ -0,0 +1,98 @@
+/*
+*  BitLabelTest.cpp
+*
+*  Runs the bit-packed candidate search (bitLabelDetect()) and the byte
+*  per pixel one (bitLabelReference()) on every frame of recordings and
+*  fails on any frame where their candidate lists differ. Each frame is
+*  tried with several thresholds, black and white regions, and every
+*  threshold kernel this CPU can run.
+*
+*  The recordings are those named on the command line, or else
+*  Data/replay-synthetic.arfr; the synthetic source at VGA size is always
+*  added. Exits non-zero on a mismatch, or if no frame had a candidate
+*  at all, as the check would then prove nothing.
+*
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <AR/ar.h>
+#include "../BitLabel.h"
+#include "../FrameReplay.h"
+#include "../Kernels.h"
+
+#define BIT_TEST_SYNTHETIC_FRAMES   48
+
+static const int bitTestThresholds[] = { 60, 100, 150 };
+
+typedef struct {
+	long    frames;
+	long    candidates;
+	long    mismatches;
+} BitTestTotals;
+
+static void bitTestRecording(FrameReplay *fr, const char *name, BitTestTotals *totals)
+{
+	BitLabel bl;
+	BitCandidate reference[BIT_CANDIDATE_MAX];
+	ARUint8 *image;
+	int f, t, black, num;
+
+	if (!bitLabelInit(&bl, fr->xsize, fr->ysize)) {
+		totals->mismatches++;
+		return;
+	}
+	for (f = 0; f < fr->frameCount; f++) {
+		image = frameReplayNext(fr);
+		for (t = 0; t < (int)(sizeof(bitTestThresholds) / sizeof(bitTestThresholds[0])); t++) {
+			for (black = 0; black < 2; black++) {
+				bl.black = black;
+				bitLabelDetect(&bl, image, fr->pixFormat, bitTestThresholds[t]);
+				num = bitLabelReference(&bl, image, fr->pixFormat, bitTestThresholds[t], reference);
+				totals->frames++;
+				totals->candidates += bl.candidateNum;
+				if (num < 0 || !bitLabelCompare(bl.candidates, bl.candidateNum, reference, num)) {
+					ARLOGe("BitLabelTest: %s frame %d, threshold %d, %s regions: %d bit-packed candidates, %d reference.\n",
+						name, f, bitTestThresholds[t], black ? "black" : "white", bl.candidateNum, num);
+					totals->mismatches++;
+				}
+			}
+		}
+	}
+	bitLabelFinal(&bl);
+}
+
+int main(int argc, char *argv[])
+{
+	static char env[32];
+	FrameReplay fr;
+	BitTestTotals totals = { 0, 0, 0 };
+	const char *defaultName = "Data/replay-synthetic.arfr";
+	const char *const *names;
+	int nameNum, isa, i;
+
+	names = argc > 1 ? (const char *const *)argv + 1 : &defaultName;
+	nameNum = argc > 1 ? argc - 1 : 1;
+
+	for (isa = KERNEL_ISA_SCALAR; isa < KERNEL_ISA_COUNT; isa++) {
+		if (!kernelIsaSupported((KERNEL_ISA)isa)) continue;
+		sprintf(env, "KERNEL_ISA=%s", kernelIsaName((KERNEL_ISA)isa));
+		putenv(env);
+		kernelInit();
+		for (i = 0; i < nameNum; i++) {
+			if (!frameReplayOpen(&fr, names[i])) return (1);
+			bitTestRecording(&fr, names[i], &totals);
+			frameReplayClose(&fr);
+		}
+		if (!frameReplaySynthetic(&fr, 640, 480, BIT_TEST_SYNTHETIC_FRAMES, "Data/patt.irc")) return (1);
+		bitTestRecording(&fr, "synthetic", &totals);
+		frameReplayClose(&fr);
+	}
+
+	ARLOGi("BitLabelTest: %ld frames checked, %ld candidates, %ld mismatches.\n", totals.frames, totals.candidates, totals.mismatches);
+	if (totals.candidates == 0) {
+		ARLOGe("BitLabelTest: No candidates in any frame.\n");
+		return (1);
+	}
+	return (totals.mismatches ? 1 : 0);
+}
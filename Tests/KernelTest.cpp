@@ -0,0 +1,69 @@
+/*
+*  KernelTest.cpp
+*
+*  Runs every compiled variant of every kernel that this CPU can run
+*  against the scalar one with kernelCheck(), then checks that each
+*  KERNEL_ISA cap selects a variant at or below it. Links Kernels.cpp
+*  alone. Exits non-zero on any mismatch.
+*
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <ctype.h>
+#include <AR/ar.h>
+#include "../Kernels.h"
+
+#define KERNEL_TEST_KERNELS     16
+
+// putenv() keeps the string, so it is static.
+static int capCheck(KERNEL_ISA cap)
+{
+	static char value[32];
+	int i, fail = 0;
+
+	sprintf(value, "KERNEL_ISA=%s", kernelIsaName(cap));
+	putenv(value);
+	kernelInit();
+	for (i = 0; i < kernelCount(); i++) {
+		if (kernelSelected(i) > cap || !kernelIsaSupported(kernelSelected(i))) {
+			ARLOGe("KernelTest: %s selected %s under KERNEL_ISA=%s.\n", kernelName(i), kernelIsaName(kernelSelected(i)), kernelIsaName(cap));
+			fail++;
+		}
+	}
+	return fail;
+}
+
+// Clears the per-kernel overrides (KERNEL_<NAME>), which win over the cap.
+static void clearOverrides(void)
+{
+	static char value[KERNEL_TEST_KERNELS][32];
+	const char *name;
+	int i, j;
+
+	for (i = 0; i < kernelCount() && i < KERNEL_TEST_KERNELS; i++) {
+		name = kernelName(i);
+		j = sprintf(value[i], "KERNEL_");
+		while (*name && j < 30) value[i][j++] = (char)toupper((unsigned char)*name++);
+		value[i][j++] = '=';
+		value[i][j] = '\0';
+		putenv(value[i]);
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	int isa, fail;
+
+	(void)argc; (void)argv;
+	for (isa = KERNEL_ISA_SCALAR; isa < KERNEL_ISA_COUNT; isa++) {
+		ARLOGi("KernelTest: %s %s.\n", kernelIsaName((KERNEL_ISA)isa), kernelIsaSupported((KERNEL_ISA)isa) ? "supported" : "not supported");
+	}
+	clearOverrides();
+	fail = kernelCheck();
+	for (isa = KERNEL_ISA_SCALAR; isa < KERNEL_ISA_COUNT; isa++) fail += capCheck((KERNEL_ISA)isa);
+
+	if (fail) ARLOGe("KernelTest: %d failures.\n", fail);
+	else ARLOGi("KernelTest: passed.\n");
+	return (fail ? 1 : 0);
+}
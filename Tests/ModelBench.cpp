@@ -0,0 +1,275 @@
+/*
+*  ModelBench.cpp
+*
+*  Times the model loading and preparation passes of the GLM library.
+*
+*  Loaders: a model (Data/bunny.obj by default) is read with glmReadOBJ()
+*  and written out as binary PLY and STL, which are then read back with
+*  glmReadPLY() and glmReadSTL(). Each reader's best of five runs is
+*  reported.
+*
+*  Reordering: a sphere of about the given number of vertices (1000000
+*  by default, two triangles per vertex) with its vertices and triangles
+*  shuffled, as an exported scan or a welded mesh tends to be, is read
+*  from a PLY file. glmFacetNormals() and glmVertexNormals() are timed
+*  on it before and after glmReorder().
+*
+*    ModelBench [model.obj [vertices]]
+*
+*  Not part of the tests: it takes a while, and the numbers depend on
+*  the machine. Run by Tests/run_tests.sh with BENCH set.
+*
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <AR/ar.h>
+#include "../GLM.h"
+#include "../Timing.h"
+
+#define BENCH_RUNS          5
+#define BENCH_PLY           "Tests/build/bench.ply"
+#define BENCH_STL           "Tests/build/bench.stl"
+#define BENCH_SPHERE        "Tests/build/bench-sphere.ply"
+
+static void benchPut32(FILE *fp, unsigned int v)
+{
+	unsigned char b[4];
+
+	b[0] = (unsigned char)v;
+	b[1] = (unsigned char)(v >> 8);
+	b[2] = (unsigned char)(v >> 16);
+	b[3] = (unsigned char)(v >> 24);
+	fwrite(b, 1, 4, fp);
+}
+
+static void benchPutFloat(FILE *fp, float f)
+{
+	unsigned int v;
+
+	memcpy(&v, &f, 4);
+	benchPut32(fp, v);
+}
+
+// Little endian binary PLY of vertices (x y z, numvertices of them) and
+// triangles (three 0 based indices each).
+static int benchWritePLY(const char *name, const GLfloat *vertices, GLuint numvertices, const GLuint *triangles, GLuint numtriangles)
+{
+	FILE *fp;
+	GLuint i;
+
+	if ((fp = fopen(name, "wb")) == NULL) {
+		ARLOGe("ModelBench: Unable to create %s.\n", name);
+		return (FALSE);
+	}
+	fprintf(fp, "ply\nformat binary_little_endian 1.0\nelement vertex %u\nproperty float x\nproperty float y\nproperty float z\n"
+		"element face %u\nproperty list uchar int vertex_indices\nend_header\n", numvertices, numtriangles);
+	for (i = 0; i < 3 * numvertices; i++) benchPutFloat(fp, vertices[i]);
+	for (i = 0; i < numtriangles; i++) {
+		fputc(3, fp);
+		benchPut32(fp, triangles[3 * i]);
+		benchPut32(fp, triangles[3 * i + 1]);
+		benchPut32(fp, triangles[3 * i + 2]);
+	}
+	if (fclose(fp) != 0) {
+		ARLOGe("ModelBench: Unable to write %s.\n", name);
+		return (FALSE);
+	}
+	return (TRUE);
+}
+
+static int benchWriteSTL(const char *name, const GLMmodel *model)
+{
+	char header[80];
+	const GLfloat *v;
+	FILE *fp;
+	GLuint i, k;
+
+	if ((fp = fopen(name, "wb")) == NULL) {
+		ARLOGe("ModelBench: Unable to create %s.\n", name);
+		return (FALSE);
+	}
+	memset(header, 0, sizeof(header));
+	fwrite(header, 1, sizeof(header), fp);
+	benchPut32(fp, model->numtriangles);
+	for (i = 0; i < model->numtriangles; i++) {
+		for (k = 0; k < 3; k++) benchPutFloat(fp, model->facetnorms[3 * model->triangles[i].findex + k]);
+		for (k = 0; k < 9; k++) {
+			v = &model->vertices[3 * model->triangles[i].vindices[k / 3]];
+			benchPutFloat(fp, v[k % 3]);
+		}
+		fputc(0, fp);
+		fputc(0, fp);
+	}
+	if (fclose(fp) != 0) {
+		ARLOGe("ModelBench: Unable to write %s.\n", name);
+		return (FALSE);
+	}
+	return (TRUE);
+}
+
+// Best of BENCH_RUNS reads, in milliseconds. -1 if the file can't be read.
+static double benchRead(GLMmodel *(*reader)(char *), const char *name)
+{
+	GLMmodel *model;
+	double start, t, best = -1.0;
+	int run;
+
+	for (run = 0; run < BENCH_RUNS; run++) {
+		start = timingNow();
+		model = reader((char *)name);
+		t = (timingNow() - start) * 1000.0;
+		if (!model) return (-1.0);
+		glmDelete(model);
+		if (best < 0.0 || t < best) best = t;
+	}
+	return (best);
+}
+
+static int benchLoaders(const char *objName)
+{
+	GLMmodel *model;
+	GLuint *triangles, i, k;
+	double obj, ply, stl;
+	int ok;
+
+	if ((model = glmReadOBJ((char *)objName)) == NULL) return (FALSE);
+	glmFacetNormals(model);
+	if ((triangles = (GLuint *)malloc(3 * model->numtriangles * sizeof(GLuint))) == NULL) {
+		glmDelete(model);
+		return (FALSE);
+	}
+	for (i = 0; i < model->numtriangles; i++) {
+		for (k = 0; k < 3; k++) triangles[3 * i + k] = model->triangles[i].vindices[k] - 1;
+	}
+	ok = benchWritePLY(BENCH_PLY, model->vertices + 3, model->numvertices, triangles, model->numtriangles) &&
+		benchWriteSTL(BENCH_STL, model);
+	ARLOGi("ModelBench: %s, %u vertices, %u triangles.\n", objName, model->numvertices, model->numtriangles);
+	free(triangles);
+	glmDelete(model);
+	if (!ok) return (FALSE);
+
+	obj = benchRead(glmReadOBJ, objName);
+	ply = benchRead(glmReadPLY, BENCH_PLY);
+	stl = benchRead(glmReadSTL, BENCH_STL);
+	if (obj < 0.0 || ply < 0.0 || stl < 0.0) return (FALSE);
+	ARLOGi("  glmReadOBJ %8.2f ms\n", obj);
+	ARLOGi("  glmReadPLY %8.2f ms\n", ply);
+	ARLOGi("  glmReadSTL %8.2f ms\n", stl);
+	return (TRUE);
+}
+
+// Fisher-Yates shuffle of n records of size GLuints, with a fixed seed.
+static void benchShuffle(GLuint *a, GLuint n, int size, unsigned int *seed)
+{
+	GLuint i, j, t;
+	int k;
+
+	for (i = n - 1; i > 0; i--) {
+		*seed = *seed * 1103515245u + 12345u;
+		j = (GLuint)(((unsigned long long)(*seed >> 8) * (i + 1)) >> 24);
+		for (k = 0; k < size; k++) {
+			t = a[i * size + k];
+			a[i * size + k] = a[j * size + k];
+			a[j * size + k] = t;
+		}
+	}
+}
+
+static int benchSphere(GLuint target)
+{
+	GLfloat *vertices, *shuffled, a, b;
+	GLuint *triangles, *order, *where, rows, cols, numvertices, numtriangles, r, c, i, n;
+	GLMmodel *model;
+	double start, facet[2], vertex[2], reorder;
+	unsigned int seed = 1;
+	int pass, ok;
+
+	// A UV sphere without the poles: rows x cols vertices, wrapping
+	// around in longitude.
+	rows = (GLuint)sqrt(target / 2.0);
+	if (rows < 2) rows = 2;
+	cols = 2 * rows;
+	numvertices = rows * cols;
+	numtriangles = 2 * (rows - 1) * cols;
+	vertices = (GLfloat *)malloc(3 * numvertices * sizeof(GLfloat));
+	shuffled = (GLfloat *)malloc(3 * numvertices * sizeof(GLfloat));
+	triangles = (GLuint *)malloc(3 * numtriangles * sizeof(GLuint));
+	order = (GLuint *)malloc(numvertices * sizeof(GLuint));
+	where = (GLuint *)malloc(numvertices * sizeof(GLuint));
+	if (!vertices || !shuffled || !triangles || !order || !where) {
+		ARLOGe("ModelBench: Out of memory for the sphere.\n");
+		free(vertices); free(shuffled); free(triangles); free(order); free(where);
+		return (FALSE);
+	}
+	for (r = 0; r < rows; r++) {
+		a = (GLfloat)M_PI * (r + 1) / (rows + 1);
+		for (c = 0; c < cols; c++) {
+			b = 2.0f * (GLfloat)M_PI * c / cols;
+			vertices[3 * (r * cols + c)] = sinf(a) * cosf(b);
+			vertices[3 * (r * cols + c) + 1] = cosf(a);
+			vertices[3 * (r * cols + c) + 2] = sinf(a) * sinf(b);
+		}
+	}
+	for (i = 0; i < numvertices; i++) order[i] = i;
+	benchShuffle(order, numvertices, 1, &seed);
+	for (i = 0; i < numvertices; i++) {
+		where[order[i]] = i;
+		memcpy(&shuffled[3 * i], &vertices[3 * order[i]], 3 * sizeof(GLfloat));
+	}
+	n = 0;
+	for (r = 0; r + 1 < rows; r++) {
+		for (c = 0; c < cols; c++) {
+			triangles[n++] = where[r * cols + c];
+			triangles[n++] = where[(r + 1) * cols + c];
+			triangles[n++] = where[(r + 1) * cols + (c + 1) % cols];
+			triangles[n++] = where[r * cols + c];
+			triangles[n++] = where[(r + 1) * cols + (c + 1) % cols];
+			triangles[n++] = where[r * cols + (c + 1) % cols];
+		}
+	}
+	benchShuffle(triangles, numtriangles, 3, &seed);
+	ok = benchWritePLY(BENCH_SPHERE, shuffled, numvertices, triangles, numtriangles);
+	free(vertices); free(shuffled); free(triangles); free(order); free(where);
+	if (!ok || (model = glmReadPLY((char *)BENCH_SPHERE)) == NULL) return (FALSE);
+	ARLOGi("ModelBench: Shuffled sphere, %u vertices, %u triangles.\n", model->numvertices, model->numtriangles);
+
+	reorder = 0.0;
+	for (pass = 0; pass < 2; pass++) {
+		if (pass == 1) {
+			start = timingNow();
+			glmReorder(model);
+			reorder = (timingNow() - start) * 1000.0;
+		}
+		start = timingNow();
+		glmFacetNormals(model);
+		facet[pass] = (timingNow() - start) * 1000.0;
+		start = timingNow();
+		glmVertexNormals(model, 90.0f);
+		vertex[pass] = (timingNow() - start) * 1000.0;
+	}
+	glmDelete(model);
+	ARLOGi("                     shuffled  reordered\n");
+	ARLOGi("  glmFacetNormals  %8.0f ms %8.0f ms\n", facet[0], facet[1]);
+	ARLOGi("  glmVertexNormals %8.0f ms %8.0f ms\n", vertex[0], vertex[1]);
+	ARLOGi("  glmReorder itself %.0f ms.\n", reorder);
+	return (TRUE);
+}
+
+int main(int argc, char *argv[])
+{
+	const char *objName = argc > 1 ? argv[1] : "Data/bunny.obj";
+	GLuint vertices = argc > 2 ? (GLuint)atoi(argv[2]) : 1000000;
+
+	if (!benchLoaders(objName)) {
+		ARLOGe("ModelBench: Loader benchmark failed.\n");
+		return (1);
+	}
+	if (!benchSphere(vertices)) {
+		ARLOGe("ModelBench: Reorder benchmark failed.\n");
+		return (1);
+	}
+	return (0);
+}
@@ -0,0 +1,37 @@
+/*
+*  SyntheticRecording.cpp
+*
+*  Writes the synthetic source (see frameReplaySynthetic()) as a frame
+*  recording, for tests that need a small one with Data/patt.irc in
+*  view: Data/replay-synthetic.arfr was made with
+*
+*    SyntheticRecording Data/replay-synthetic.arfr 320 240 8
+*
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <AR/ar.h>
+#include "../FrameReplay.h"
+
+int main(int argc, char *argv[])
+{
+	FrameReplay fr;
+	FrameRecorder rec;
+	int i, ok;
+
+	if (argc != 5) {
+		fprintf(stderr, "usage: %s out.arfr xsize ysize frames\n", argv[0]);
+		return (1);
+	}
+	if (!frameReplaySynthetic(&fr, atoi(argv[2]), atoi(argv[3]), atoi(argv[4]), "Data/patt.irc")) return (1);
+	if (!frameRecordOpen(&rec, argv[1], fr.xsize, fr.ysize, fr.pixFormat)) {
+		frameReplayClose(&fr);
+		return (1);
+	}
+	ok = TRUE;
+	for (i = 0; i < fr.frameCount && ok; i++) ok = frameRecordWrite(&rec, frameReplayNext(&fr));
+	frameRecordClose(&rec);
+	frameReplayClose(&fr);
+	return (ok ? 0 : 1);
+}
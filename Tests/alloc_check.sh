@@ -0,0 +1,33 @@
+#!/bin/sh
+#
+#  alloc_check.sh
+#
+#  Replays Data/replay-synthetic.arfr twice under --alloc-check and fails
+#  if any frame of the second pass allocated. The sample must be built
+#  with ALLOC_TRACKING defined (glibc, or a Windows debug build) and
+#  needs a display; without one, xvfb-run is used if there is one.
+#
+#    Tests/alloc_check.sh path/to/simpleARDIY
+#
+
+cd "$(dirname "$0")/.." || exit 1
+app=${1:?usage: $0 path/to/simpleARDIY}
+case $app in
+/*) ;;
+*) app=$OLDPWD/$app ;;
+esac
+
+run=
+if [ -z "$DISPLAY" ] && command -v xvfb-run >/dev/null 2>&1; then
+	run="xvfb-run -a"
+fi
+
+$run "$app" --replay Data/replay-synthetic.arfr --alloc-check
+status=$?
+case $status in
+0) echo "alloc_check: no allocations in steady state." ;;
+1) echo "alloc_check: frames allocated in steady state." ;;
+2) echo "alloc_check: $app was built without ALLOC_TRACKING." ;;
+*) echo "alloc_check: $app failed with status $status." ;;
+esac
+exit $status
@@ -0,0 +1,66 @@
+#!/bin/sh
+#
+#  run_tests.sh
+#
+#  Builds and runs the offline tests, none of which need a camera or a
+#  display. ARToolKit 5 is found through ARTOOLKIT5_ROOT. With
+#  SIMPLEARDIY set to a build of the sample, its own checks on the
+#  recording in Data/ are run too. With BENCH set, the benchmarks are
+#  built and run as well, linked with GL_LIBS. Exits non-zero if any test
+#  fails to build or fails.
+#
+#    ARTOOLKIT5_ROOT=/path/to/ARToolKit5 [SIMPLEARDIY=path/to/simpleARDIY] [BENCH=1] Tests/run_tests.sh
+#
+
+cd "$(dirname "$0")/.." || exit 1
+: "${CXX:=c++}"
+: "${ARTOOLKIT5_ROOT:?set ARTOOLKIT5_ROOT to the ARToolKit 5 directory}"
+OUT=Tests/build
+CXXFLAGS="-O2 -I$ARTOOLKIT5_ROOT/include"
+LIBS="-L$ARTOOLKIT5_ROOT/lib -lAR -lARUtil -lpthread -lm"
+: "${GL_LIBS:=-lglut -lGLU -lGL}"
+
+mkdir -p "$OUT"
+failed=0
+
+# test <name> <sources...>: builds Tests/<name>.cpp with the sources and runs it.
+test_program() {
+	name=$1
+	shift
+	echo "== $name"
+	if ! $CXX $CXXFLAGS -o "$OUT/$name" "Tests/$name.cpp" "$@" $LIBS; then
+		echo "== $name: build FAILED"
+		failed=$((failed + 1))
+	elif ! "$OUT/$name"; then
+		echo "== $name FAILED"
+		failed=$((failed + 1))
+	else
+		echo "== $name passed"
+	fi
+}
+
+test_program KernelTest Kernels.cpp
+test_program BitLabelTest BitLabel.cpp Kernels.cpp FrameReplay.cpp
+
+if [ -n "$SIMPLEARDIY" ]; then
+	echo "== alloc_check"
+	if Tests/alloc_check.sh "$SIMPLEARDIY"; then
+		echo "== alloc_check passed"
+	else
+		echo "== alloc_check FAILED"
+		failed=$((failed + 1))
+	fi
+else
+	echo "== alloc_check skipped, SIMPLEARDIY not set"
+fi
+
+if [ -n "$BENCH" ]; then
+	LIBS="$LIBS $GL_LIBS"
+	test_program ModelBench GLM.cpp GLMExt.cpp Kernels.cpp
+fi
+
+if [ $failed -ne 0 ]; then
+	echo "$failed tests failed."
+	exit 1
+fi
+echo "All tests passed."
@@ -0,0 +1,875 @@
+/*
+*  TileTexture.cpp
+*
+*  Tiled texture files and their streaming. See TileTexture.h.
+*
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <math.h>
+#include <atomic>
+#ifdef _WIN32
+#  include <windows.h>
+#else
+#  include <sys/types.h>
+#  include <pthread.h>
+#  include <unistd.h>
+#endif
+#include <AR/ar.h>
+#include "TileTexture.h"
+#include "GLMExt.h"
+
+#define TILE_VERSION            1
+#define TILE_HEADER             24      // Magic and five 32 bit integers.
+#define TILE_BUILD_CACHE        16      // Tiles of the level below kept while building a level.
+#define TILE_WANT_MAX           64      // Missing tiles considered for loading per update.
+#define TILE_POLL               0.002   // Seconds between loader checks for work.
+
+enum {
+	STAGE_FREE = 0,                     // The GLUT thread's.
+	STAGE_REQUESTED,                    // The loader's.
+	STAGE_LOADED,                       // Pixels for the GLUT thread.
+	STAGE_FAILED
+};
+
+typedef struct {
+	std::atomic<int>    state;
+	int                 tile;
+	unsigned char       *pixels;
+} TileStage;
+
+struct TileLoader {
+	FILE                *fp;
+	size_t              tileBytes;
+	TileStage           stage[TILE_STAGING];
+	std::atomic<int>    running;
+#ifdef _WIN32
+	HANDLE              thread;
+#else
+	pthread_t           thread;
+#endif
+};
+
+// Tiles are fixed size and stored level by level, so a tile's place in
+// the file follows from its index.
+static int tileSeek(FILE *fp, size_t tileBytes, int tile)
+{
+	unsigned long long offset = TILE_HEADER + (unsigned long long)tileBytes * (unsigned long long)tile;
+
+#ifdef _WIN32
+	return (_fseeki64(fp, (__int64)offset, SEEK_SET) == 0);
+#else
+	return (fseeko(fp, (off_t)offset, SEEK_SET) == 0);
+#endif
+}
+
+static int tileLevelSize(int size, int level)
+{
+	size >>= level;
+	return size > 0 ? size : 1;
+}
+
+static int tileClamp(int v, int lo, int hi)
+{
+	return v < lo ? lo : v > hi ? hi : v;
+}
+
+// Levels down to the first that fits in one tile. 0 if there would be too
+// many.
+static int tileLayout(TileTexture *tt)
+{
+	int level, w, h;
+
+	tt->tileNum = 0;
+	for (level = 0; level < TILE_LEVELS_MAX; level++) {
+		w = tileLevelSize(tt->width, level);
+		h = tileLevelSize(tt->height, level);
+		tt->tilesX[level] = (w + tt->tileSize - 1) / tt->tileSize;
+		tt->tilesY[level] = (h + tt->tileSize - 1) / tt->tileSize;
+		tt->firstTile[level] = tt->tileNum;
+		tt->tileNum += tt->tilesX[level] * tt->tilesY[level];
+		if (w <= tt->tileSize && h <= tt->tileSize) return (tt->levels = level + 1);
+	}
+	return (tt->levels = 0);
+}
+
+static void tilePut32(unsigned char *p, int v)
+{
+	p[0] = (unsigned char)v;
+	p[1] = (unsigned char)(v >> 8);
+	p[2] = (unsigned char)(v >> 16);
+	p[3] = (unsigned char)(v >> 24);
+}
+
+static int tileGet32(const unsigned char *p)
+{
+	return (int)((unsigned)p[0] | (unsigned)p[1] << 8 | (unsigned)p[2] << 16 | (unsigned)p[3] << 24);
+}
+
+// ============================================================================
+//	Building
+// ============================================================================
+
+// Next decimal in a PPM header, past whitespace and comments. Consumes
+// the one character after it.
+static int tilePPMInt(FILE *fp, int *v)
+{
+	int c;
+
+	while ((c = fgetc(fp)) != EOF) {
+		if (c == '#') {
+			while ((c = fgetc(fp)) != EOF && c != '\n');
+		}
+		else if (!isspace(c)) break;
+	}
+	if (c == EOF || !isdigit(c)) return (FALSE);
+	*v = 0;
+	do {
+		*v = *v * 10 + (c - '0');
+	} while ((c = fgetc(fp)) != EOF && isdigit(c));
+	return (TRUE);
+}
+
+typedef struct {
+	FILE            *fp;
+	size_t          tileBytes;
+	int             tile[TILE_BUILD_CACHE];
+	unsigned char   *pixels[TILE_BUILD_CACHE];
+	int             next;
+	int             last;               // Entry of the last lookup.
+} TileBuildCache;
+
+// Stored tile from the file being written.
+static const unsigned char *tileBuildFetch(TileBuildCache *bc, int tile)
+{
+	int i;
+
+	if (bc->tile[bc->last] == tile) return bc->pixels[bc->last];
+	for (i = 0; i < TILE_BUILD_CACHE; i++) {
+		if (bc->tile[i] == tile) return bc->pixels[bc->last = i];
+	}
+	i = bc->next;
+	bc->next = (bc->next + 1) % TILE_BUILD_CACHE;
+	if (!tileSeek(bc->fp, bc->tileBytes, tile) || fread(bc->pixels[i], bc->tileBytes, 1, bc->fp) != 1) return NULL;
+	bc->tile[i] = tile;
+	return bc->pixels[bc->last = i];
+}
+
+// Level 0, a band of tileSize + 2 rows of the source at a time. Row y
+// lives at y % (tileSize + 2) in the band; the two rows the next band
+// shares with this one are not overwritten until it has used them.
+static int tileBuildBase(TileTexture *tt, FILE *in, FILE *out, unsigned char *tile)
+{
+	const int P = tt->pageSize, C = tt->tileSize, W = tt->width, H = tt->height;
+	unsigned char *band, *d;
+	const unsigned char *row;
+	int tx, ty, i, j, y, next = 0;
+
+	if (!(band = (unsigned char *)malloc((size_t)(C + 2) * W * 3))) {
+		ARLOGe("tileTextureBuild(): Out of memory.\n");
+		return (FALSE);
+	}
+	for (ty = 0; ty < tt->tilesY[0]; ty++) {
+		for (j = 0; j < P; j++) {
+			y = tileClamp(ty * C - 1 + j, 0, H - 1);
+			for (; next <= y; next++) {
+				if (fread(band + (size_t)(next % (C + 2)) * W * 3, (size_t)W * 3, 1, in) != 1) {
+					ARLOGe("tileTextureBuild(): Source ends at row %d of %d.\n", next, H);
+					free(band);
+					return (FALSE);
+				}
+			}
+		}
+		for (tx = 0; tx < tt->tilesX[0]; tx++) {
+			d = tile;
+			for (j = 0; j < P; j++) {
+				row = band + (size_t)(tileClamp(ty * C - 1 + j, 0, H - 1) % (C + 2)) * W * 3;
+				for (i = 0; i < P; i++, d += 3) memcpy(d, row + tileClamp(tx * C - 1 + i, 0, W - 1) * 3, 3);
+			}
+			if (fwrite(tile, tt->pageSize * tt->pageSize * 3, 1, out) != 1) {
+				free(band);
+				return (FALSE);
+			}
+		}
+	}
+	free(band);
+	return (TRUE);
+}
+
+// A level from the one below, 2x2 box filtered. Border pixels past the
+// edge of the level repeat its edge, as they do at level 0.
+static int tileBuildLevel(TileTexture *tt, int level, TileBuildCache *bc, unsigned char *tile)
+{
+	const int P = tt->pageSize, C = tt->tileSize;
+	int w, h, pw, ph, tx, ty, i, j, k, x, y, xs[2], ys[2], a, b, sum[3];
+	unsigned char *d;
+	const unsigned char *s;
+
+	w = tileLevelSize(tt->width, level);
+	h = tileLevelSize(tt->height, level);
+	pw = tileLevelSize(tt->width, level - 1);
+	ph = tileLevelSize(tt->height, level - 1);
+	for (ty = 0; ty < tt->tilesY[level]; ty++) {
+		for (tx = 0; tx < tt->tilesX[level]; tx++) {
+			d = tile;
+			for (j = 0; j < P; j++) {
+				y = tileClamp(ty * C - 1 + j, 0, h - 1);
+				ys[0] = tileClamp(2 * y, 0, ph - 1);
+				ys[1] = tileClamp(2 * y + 1, 0, ph - 1);
+				for (i = 0; i < P; i++, d += 3) {
+					x = tileClamp(tx * C - 1 + i, 0, w - 1);
+					xs[0] = tileClamp(2 * x, 0, pw - 1);
+					xs[1] = tileClamp(2 * x + 1, 0, pw - 1);
+					sum[0] = sum[1] = sum[2] = 2;
+					for (b = 0; b < 2; b++) {
+						for (a = 0; a < 2; a++) {
+							s = tileBuildFetch(bc, tt->firstTile[level - 1] + (ys[b] / C) * tt->tilesX[level - 1] + xs[a] / C);
+							if (!s) return (FALSE);
+							s += ((ys[b] % C + 1) * P + xs[a] % C + 1) * 3;
+							for (k = 0; k < 3; k++) sum[k] += s[k];
+						}
+					}
+					for (k = 0; k < 3; k++) d[k] = (unsigned char)(sum[k] / 4);
+				}
+			}
+			if (!tileSeek(bc->fp, bc->tileBytes, tt->firstTile[level] + ty * tt->tilesX[level] + tx) ||
+				fwrite(tile, bc->tileBytes, 1, bc->fp) != 1) return (FALSE);
+		}
+	}
+	return (TRUE);
+}
+
+int tileTextureBuild(const char *ppmName, const char *tileName)
+{
+	TileTexture tt;
+	TileBuildCache bc;
+	FILE *in, *out;
+	unsigned char header[TILE_HEADER], *tile = NULL;
+	int maxval, level, i, ok = FALSE;
+
+	memset(&tt, 0, sizeof(tt));
+	memset(&bc, 0, sizeof(bc));
+	if (!(in = fopen(ppmName, "rb"))) {
+		ARLOGe("tileTextureBuild(): Unable to open %s.\n", ppmName);
+		return (FALSE);
+	}
+	if (fgetc(in) != 'P' || fgetc(in) != '6' || !tilePPMInt(in, &tt.width) || !tilePPMInt(in, &tt.height) || !tilePPMInt(in, &maxval) ||
+		tt.width <= 0 || tt.height <= 0 || maxval <= 0 || maxval > 255) {
+		ARLOGe("tileTextureBuild(): %s is not a binary PPM with 8 bit samples.\n", ppmName);
+		fclose(in);
+		return (FALSE);
+	}
+	tt.pageSize = TILE_PAGE_SIZE;
+	tt.tileSize = TILE_PAGE_SIZE - 2;
+	if (!tileLayout(&tt)) {
+		ARLOGe("tileTextureBuild(): %s is too large.\n", ppmName);
+		fclose(in);
+		return (FALSE);
+	}
+	if (!(out = fopen(tileName, "w+b"))) {
+		ARLOGe("tileTextureBuild(): Unable to create %s.\n", tileName);
+		fclose(in);
+		return (FALSE);
+	}
+
+	memcpy(header, "GTIL", 4);
+	tilePut32(header + 4, TILE_VERSION);
+	tilePut32(header + 8, tt.width);
+	tilePut32(header + 12, tt.height);
+	tilePut32(header + 16, tt.pageSize);
+	tilePut32(header + 20, tt.levels);
+	bc.fp = out;
+	bc.tileBytes = (size_t)tt.pageSize * tt.pageSize * 3;
+	for (i = 0; i < TILE_BUILD_CACHE; i++) {
+		bc.tile[i] = -1;
+		if (!(bc.pixels[i] = (unsigned char *)malloc(bc.tileBytes))) goto done;
+	}
+	if (!(tile = (unsigned char *)malloc(bc.tileBytes))) goto done;
+	if (fwrite(header, sizeof(header), 1, out) != 1 || !tileBuildBase(&tt, in, out, tile)) goto done;
+	for (level = 1; level < tt.levels; level++) {
+		if (!tileBuildLevel(&tt, level, &bc, tile)) goto done;
+	}
+	ok = TRUE;
+	ARLOGi("tileTextureBuild(): %s, %dx%d in %d levels, %d tiles.\n", tileName, tt.width, tt.height, tt.levels, tt.tileNum);
+
+done:
+	if (!ok) ARLOGe("tileTextureBuild(): Unable to write %s.\n", tileName);
+	for (i = 0; i < TILE_BUILD_CACHE; i++) free(bc.pixels[i]);
+	free(tile);
+	fclose(in);
+	if (fclose(out) != 0) ok = FALSE;
+	return ok;
+}
+
+// ============================================================================
+//	Loader thread
+// ============================================================================
+
+#ifdef _WIN32
+static DWORD WINAPI tileLoaderThread(LPVOID arg)
+#else
+static void *tileLoaderThread(void *arg)
+#endif
+{
+	TileLoader *tl = (TileLoader *)arg;
+	int i, busy;
+
+	while (tl->running.load()) {
+		busy = FALSE;
+		for (i = 0; i < TILE_STAGING; i++) {
+			if (tl->stage[i].state.load(std::memory_order_acquire) != STAGE_REQUESTED) continue;
+			if (tileSeek(tl->fp, tl->tileBytes, tl->stage[i].tile) && fread(tl->stage[i].pixels, tl->tileBytes, 1, tl->fp) == 1) {
+				tl->stage[i].state.store(STAGE_LOADED, std::memory_order_release);
+			}
+			else tl->stage[i].state.store(STAGE_FAILED, std::memory_order_release);
+			busy = TRUE;
+		}
+		if (busy) continue;
+#ifdef _WIN32
+		Sleep((DWORD)(TILE_POLL*1000.0));
+#else
+		usleep((useconds_t)(TILE_POLL*1e6));
+#endif
+	}
+	return 0;
+}
+
+static void tileLoaderFree(TileLoader *tl)
+{
+	int i;
+
+	if (!tl) return;
+	if (tl->running.load()) {
+		tl->running.store(0);
+#ifdef _WIN32
+		WaitForSingleObject(tl->thread, INFINITE);
+		CloseHandle(tl->thread);
+#else
+		pthread_join(tl->thread, NULL);
+#endif
+	}
+	for (i = 0; i < TILE_STAGING; i++) free(tl->stage[i].pixels);
+	if (tl->fp) fclose(tl->fp);
+	delete tl;
+}
+
+static TileLoader *tileLoaderStart(const char *tileName, size_t tileBytes)
+{
+	TileLoader *tl = new TileLoader;
+	int i;
+
+	tl->tileBytes = tileBytes;
+	tl->running.store(0);
+	for (i = 0; i < TILE_STAGING; i++) {
+		tl->stage[i].state.store(STAGE_FREE);
+		tl->stage[i].pixels = (unsigned char *)malloc(tileBytes);
+	}
+	tl->fp = NULL;
+	for (i = 0; i < TILE_STAGING; i++) if (!tl->stage[i].pixels) break;
+	if (i == TILE_STAGING) tl->fp = fopen(tileName, "rb");
+	if (!tl->fp) {
+		tileLoaderFree(tl);
+		return NULL;
+	}
+	tl->running.store(1);
+#ifdef _WIN32
+	if ((tl->thread = CreateThread(NULL, 0, tileLoaderThread, tl, 0, NULL)) == NULL) {
+#else
+	if (pthread_create(&tl->thread, NULL, tileLoaderThread, tl) != 0) {
+#endif
+		tl->running.store(0);
+		tileLoaderFree(tl);
+		return NULL;
+	}
+	return tl;
+}
+
+// ============================================================================
+//	Page table shader
+// ============================================================================
+
+// The level comes from the derivatives of the level 0 pixel position.
+// The page table entry of the tile at that level holds the atlas slot
+// and level of the tile actually resident there (itself or an
+// ancestor), whose pixels are then addressed relative to that tile.
+static const char *tileFragment =
+	"uniform sampler2D atlas;\n"
+	"uniform sampler2D pageTable;\n"
+	"uniform vec2 size;\n"
+	"uniform float levels;\n"
+	"uniform float tileSize;\n"
+	"uniform float pageSize;\n"
+	"uniform float atlasSize;\n"
+	"uniform vec2 tableSize;\n"
+	"uniform float tableRow[16];\n"
+	"void main()\n"
+	"{\n"
+	"	vec2 tc = clamp(vec2(gl_TexCoord[0].s, 1.0 - gl_TexCoord[0].t), 0.0, 1.0);\n"
+	"	vec2 px = tc * size;\n"
+	"	float rho = max(length(dFdx(px)), length(dFdy(px)));\n"
+	"	float level = clamp(floor(log2(max(rho, 1.0))), 0.0, levels - 1.0);\n"
+	"	vec2 lsize = max(floor(size / exp2(level)), 1.0);\n"
+	"	vec2 tile = floor(min(tc * lsize, lsize - 0.5) / tileSize);\n"
+	"	vec4 e = texture2D(pageTable, (vec2(tile.x, tile.y + tableRow[int(level)]) + 0.5) / tableSize);\n"
+	"	float mlevel = floor(e.b * 255.0 + 0.5);\n"
+	"	vec2 msize = max(floor(size / exp2(mlevel)), 1.0);\n"
+	"	vec2 mtile = floor(tile / exp2(mlevel - level));\n"
+	"	vec2 within = clamp(tc * msize - mtile * tileSize, -0.5, tileSize + 0.5);\n"
+	"	vec2 apx = floor(e.rg * 255.0 + 0.5) * pageSize + 1.0 + within;\n"
+	"	gl_FragColor = texture2D(atlas, apx / atlasSize) * gl_Color;\n"
+	"}\n";
+
+static GLuint tileProgram(void)
+{
+	const GLMchar *source = tileFragment;
+	GLuint shader, program;
+	GLint ok;
+	char log[1024];
+
+	shader = glmextCreateShader(GL_FRAGMENT_SHADER);
+	glmextShaderSource(shader, 1, &source, NULL);
+	glmextCompileShader(shader);
+	glmextGetShaderiv(shader, GL_COMPILE_STATUS, &ok);
+	if (!ok) {
+		glmextGetShaderInfoLog(shader, sizeof(log), NULL, log);
+		ARLOGe("tileTextureOpen(): Shader did not compile: %s\n", log);
+		glmextDeleteShader(shader);
+		return 0;
+	}
+	// Vertices stay fixed function.
+	program = glmextCreateProgram();
+	glmextAttachShader(program, shader);
+	glmextLinkProgram(program);
+	glmextDeleteShader(shader);
+	glmextGetProgramiv(program, GL_LINK_STATUS, &ok);
+	if (!ok) {
+		glmextGetProgramInfoLog(program, sizeof(log), NULL, log);
+		ARLOGe("tileTextureOpen(): Shader did not link: %s\n", log);
+		glmextDeleteProgram(program);
+		return 0;
+	}
+	return program;
+}
+
+// ============================================================================
+//	Cache
+// ============================================================================
+
+// One patch per run of TILE_PATCH_TRIANGLES triangles; glmReorder() keeps
+// such runs compact.
+static int tilePatches(TileTexture *tt, const GLMmodel *model)
+{
+	const GLMtriangle *t;
+	const GLfloat *v[3], *uv[3];
+	TilePatch *p;
+	float lo[3], hi[3], e1[3], e2[3], n[3], worldArea, texArea;
+	GLuint i, first;
+	int j, k;
+
+	tt->patchNum = (int)((model->numtriangles + TILE_PATCH_TRIANGLES - 1) / TILE_PATCH_TRIANGLES);
+	if (!(tt->patches = (TilePatch *)calloc(tt->patchNum ? tt->patchNum : 1, sizeof(TilePatch)))) return (FALSE);
+	for (j = 0; j < tt->patchNum; j++) {
+		p = &tt->patches[j];
+		first = (GLuint)j * TILE_PATCH_TRIANGLES;
+		worldArea = texArea = 0.0f;
+		p->uv[0] = p->uv[1] = 1.0f;
+		p->uv[2] = p->uv[3] = 0.0f;
+		for (i = first; i < model->numtriangles && i < first + TILE_PATCH_TRIANGLES; i++) {
+			t = &model->triangles[i];
+			for (k = 0; k < 3; k++) {
+				v[k] = &model->vertices[3 * t->vindices[k]];
+				uv[k] = &model->texcoords[2 * t->tindices[k]];
+				if (i == first && k == 0) {
+					memcpy(lo, v[0], sizeof(lo));
+					memcpy(hi, v[0], sizeof(hi));
+				}
+				lo[0] = fminf(lo[0], v[k][0]); lo[1] = fminf(lo[1], v[k][1]); lo[2] = fminf(lo[2], v[k][2]);
+				hi[0] = fmaxf(hi[0], v[k][0]); hi[1] = fmaxf(hi[1], v[k][1]); hi[2] = fmaxf(hi[2], v[k][2]);
+				p->uv[0] = fminf(p->uv[0], uv[k][0]); p->uv[1] = fminf(p->uv[1], uv[k][1]);
+				p->uv[2] = fmaxf(p->uv[2], uv[k][0]); p->uv[3] = fmaxf(p->uv[3], uv[k][1]);
+			}
+			for (k = 0; k < 3; k++) {
+				e1[k] = v[1][k] - v[0][k];
+				e2[k] = v[2][k] - v[0][k];
+			}
+			n[0] = e1[1] * e2[2] - e1[2] * e2[1];
+			n[1] = e1[2] * e2[0] - e1[0] * e2[2];
+			n[2] = e1[0] * e2[1] - e1[1] * e2[0];
+			worldArea += 0.5f * sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+			texArea += 0.5f * fabsf((uv[1][0] - uv[0][0]) * (uv[2][1] - uv[0][1]) - (uv[2][0] - uv[0][0]) * (uv[1][1] - uv[0][1]));
+		}
+		for (k = 0; k < 3; k++) p->center[k] = (lo[k] + hi[k]) * 0.5f;
+		p->radius = 0.5f * sqrtf((hi[0] - lo[0]) * (hi[0] - lo[0]) + (hi[1] - lo[1]) * (hi[1] - lo[1]) + (hi[2] - lo[2]) * (hi[2] - lo[2]));
+		p->density = worldArea > 0.0f ? sqrtf(texArea * (float)tt->width * (float)tt->height / worldArea) : 0.0f;
+	}
+	return (TRUE);
+}
+
+static void tileUpload(TileTexture *tt, int slot, const unsigned char *pixels)
+{
+	const int perRow = TILE_ATLAS_SIZE / tt->pageSize;
+
+	glBindTexture(GL_TEXTURE_2D, tt->atlas);
+	glPushClientAttrib(GL_CLIENT_PIXEL_STORE_BIT);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glTexSubImage2D(GL_TEXTURE_2D, 0, (slot % perRow) * tt->pageSize, (slot / perRow) * tt->pageSize, tt->pageSize, tt->pageSize,
+		GL_RGB, GL_UNSIGNED_BYTE, pixels);
+	glPopClientAttrib();
+	glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+// A slot for a newly loaded tile: a free one, or the one least recently
+// needed, but never one needed this frame or the coarsest tile. -1 if
+// the cache is full of tiles in use.
+static int tileSlotFor(TileTexture *tt)
+{
+	int i, best = -1;
+
+	for (i = 0; i < tt->slotNum; i++) {
+		if (tt->slotTile[i] < 0) return i;
+		if (tt->slotTile[i] == tt->tileNum - 1 || tt->slotUsed[i] == tt->frame) continue;
+		if (best < 0 || tt->slotUsed[i] < tt->slotUsed[best]) best = i;
+	}
+	if (best >= 0) {
+		tt->tileSlot[tt->slotTile[best]] = -1;
+		tt->slotTile[best] = -1;
+		tt->stats.evicted++;
+		tt->stats.resident--;
+	}
+	return best;
+}
+
+static void tilePlace(TileTexture *tt, int tile, const unsigned char *pixels)
+{
+	int slot;
+
+	if ((slot = tileSlotFor(tt)) < 0) return;
+	tileUpload(tt, slot, pixels);
+	tt->slotTile[slot] = tile;
+	tt->slotUsed[slot] = tt->tileNeeded[tile];
+	tt->tileSlot[tile] = slot;
+	tt->stats.resident++;
+	tt->tableDirty = TRUE;
+}
+
+// Coarsest level first, each tile pointing at itself if resident and
+// otherwise inheriting its parent's entry.
+static void tileTableUpdate(TileTexture *tt)
+{
+	const int perRow = TILE_ATLAS_SIZE / tt->pageSize;
+	unsigned char *e;
+	const unsigned char *parent;
+	int level, tx, ty, tile, slot;
+
+	for (level = tt->levels - 1; level >= 0; level--) {
+		for (ty = 0; ty < tt->tilesY[level]; ty++) {
+			for (tx = 0; tx < tt->tilesX[level]; tx++) {
+				tile = tt->firstTile[level] + ty * tt->tilesX[level] + tx;
+				e = tt->table + 4 * ((size_t)(tt->tableRow[level] + ty) * tt->tableWidth + tx);
+				if ((slot = tt->tileSlot[tile]) >= 0) {
+					e[0] = (unsigned char)(slot % perRow);
+					e[1] = (unsigned char)(slot / perRow);
+					e[2] = (unsigned char)level;
+					e[3] = 255;
+				}
+				else {
+					parent = tt->table + 4 * ((size_t)(tt->tableRow[level + 1] + tileClamp(ty / 2, 0, tt->tilesY[level + 1] - 1)) * tt->tableWidth +
+						tileClamp(tx / 2, 0, tt->tilesX[level + 1] - 1));
+					memcpy(e, parent, 4);
+				}
+			}
+		}
+	}
+	glBindTexture(GL_TEXTURE_2D, tt->pageTable);
+	glPushClientAttrib(GL_CLIENT_PIXEL_STORE_BIT);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, tt->tableWidth, tt->tableHeight, GL_RGBA, GL_UNSIGNED_BYTE, tt->table);
+	glPopClientAttrib();
+	glBindTexture(GL_TEXTURE_2D, 0);
+	tt->tableDirty = FALSE;
+}
+
+int tileTextureOpen(TileTexture *tt, const char *tileName, const GLMmodel *model)
+{
+	FILE *fp;
+	unsigned char header[TILE_HEADER], *pixels;
+	size_t tileBytes;
+	GLfloat rows[TILE_LEVELS_MAX];
+	GLint maxSize;
+	int level, i;
+
+	memset(tt, 0, sizeof(TileTexture));
+	if (!model->texcoords) {
+		ARLOGe("tileTextureOpen(): The model has no texture coordinates.\n");
+		return (FALSE);
+	}
+	glmExtInit();
+	if (!glmExtHasShaders()) {
+		ARLOGe("tileTextureOpen(): Shaders not available.\n");
+		return (FALSE);
+	}
+	if (!(fp = fopen(tileName, "rb"))) {
+		ARLOGe("tileTextureOpen(): Unable to open %s.\n", tileName);
+		return (FALSE);
+	}
+	if (fread(header, sizeof(header), 1, fp) != 1 || memcmp(header, "GTIL", 4) != 0 || tileGet32(header + 4) != TILE_VERSION) {
+		ARLOGe("tileTextureOpen(): %s is not a tiled texture.\n", tileName);
+		fclose(fp);
+		return (FALSE);
+	}
+	tt->width = tileGet32(header + 8);
+	tt->height = tileGet32(header + 12);
+	tt->pageSize = tileGet32(header + 16);
+	tt->tileSize = tt->pageSize - 2;
+	if (tt->width <= 0 || tt->height <= 0 || tt->pageSize < 4 || tt->pageSize > TILE_ATLAS_SIZE ||
+		!tileLayout(tt) || tt->levels != tileGet32(header + 20)) {
+		ARLOGe("tileTextureOpen(): %s has a bad header.\n", tileName);
+		fclose(fp);
+		return (FALSE);
+	}
+
+	// Every level's page table entries, one level under another.
+	tt->tableWidth = tt->tilesX[0];
+	for (level = 0; level < tt->levels; level++) {
+		tt->tableRow[level] = tt->tableHeight;
+		tt->tableHeight += tt->tilesY[level];
+		rows[level] = (GLfloat)tt->tableRow[level];
+	}
+	glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxSize);
+	if (tt->tableWidth > maxSize || tt->tableHeight > maxSize) {
+		ARLOGe("tileTextureOpen(): %s has too many tiles.\n", tileName);
+		fclose(fp);
+		return (FALSE);
+	}
+	tt->slotNum = (TILE_ATLAS_SIZE / tt->pageSize) * (TILE_ATLAS_SIZE / tt->pageSize);
+	tileBytes = (size_t)tt->pageSize * tt->pageSize * 3;
+	tt->tileSlot = (int *)malloc(tt->tileNum * sizeof(int));
+	tt->tileNeeded = (unsigned *)calloc(tt->tileNum, sizeof(unsigned));
+	tt->tileLoading = (char *)calloc(tt->tileNum, 1);
+	tt->slotTile = (int *)malloc(tt->slotNum * sizeof(int));
+	tt->slotUsed = (unsigned *)calloc(tt->slotNum, sizeof(unsigned));
+	tt->table = (unsigned char *)malloc((size_t)tt->tableWidth * tt->tableHeight * 4);
+	pixels = (unsigned char *)malloc(tileBytes);
+	if (!tt->tileSlot || !tt->tileNeeded || !tt->tileLoading || !tt->slotTile || !tt->slotUsed || !tt->table || !pixels ||
+		!tilePatches(tt, model)) {
+		ARLOGe("tileTextureOpen(): Out of memory.\n");
+		free(pixels);
+		fclose(fp);
+		tileTextureClose(tt);
+		return (FALSE);
+	}
+	for (i = 0; i < tt->tileNum; i++) tt->tileSlot[i] = -1;
+	for (i = 0; i < tt->slotNum; i++) tt->slotTile[i] = -1;
+	memset(tt->table, 0, (size_t)tt->tableWidth * tt->tableHeight * 4);
+
+	if (!(tt->program = tileProgram())) {
+		free(pixels);
+		fclose(fp);
+		tileTextureClose(tt);
+		return (FALSE);
+	}
+	glmextUseProgram(tt->program);
+	glmextUniform1i(glmextGetUniformLocation(tt->program, "atlas"), 0);
+	glmextUniform1i(glmextGetUniformLocation(tt->program, "pageTable"), 1);
+	glmextUniform2f(glmextGetUniformLocation(tt->program, "size"), (GLfloat)tt->width, (GLfloat)tt->height);
+	glmextUniform1f(glmextGetUniformLocation(tt->program, "levels"), (GLfloat)tt->levels);
+	glmextUniform1f(glmextGetUniformLocation(tt->program, "tileSize"), (GLfloat)tt->tileSize);
+	glmextUniform1f(glmextGetUniformLocation(tt->program, "pageSize"), (GLfloat)tt->pageSize);
+	glmextUniform1f(glmextGetUniformLocation(tt->program, "atlasSize"), (GLfloat)TILE_ATLAS_SIZE);
+	glmextUniform2f(glmextGetUniformLocation(tt->program, "tableSize"), (GLfloat)tt->tableWidth, (GLfloat)tt->tableHeight);
+	glmextUniform1fv(glmextGetUniformLocation(tt->program, "tableRow"), tt->levels, rows);
+	glmextUseProgram(0);
+
+	glGenTextures(1, &tt->atlas);
+	glBindTexture(GL_TEXTURE_2D, tt->atlas);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB8, TILE_ATLAS_SIZE, TILE_ATLAS_SIZE, 0, GL_RGB, GL_UNSIGNED_BYTE, NULL);
+	glGenTextures(1, &tt->pageTable);
+	glBindTexture(GL_TEXTURE_2D, tt->pageTable);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, tt->tableWidth, tt->tableHeight, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	tt->stats.gpuBytes = (size_t)TILE_ATLAS_SIZE * TILE_ATLAS_SIZE * 4 + (size_t)tt->tableWidth * tt->tableHeight * 4;
+
+	// The coarsest tile, which everything falls back to, before the first
+	// frame.
+	if (!tileSeek(fp, tileBytes, tt->tileNum - 1) || fread(pixels, tileBytes, 1, fp) != 1) {
+		ARLOGe("tileTextureOpen(): %s is truncated.\n", tileName);
+		free(pixels);
+		fclose(fp);
+		tileTextureClose(tt);
+		return (FALSE);
+	}
+	tilePlace(tt, tt->tileNum - 1, pixels);
+	tileTableUpdate(tt);
+	free(pixels);
+	fclose(fp);
+
+	if (!(tt->loader = tileLoaderStart(tileName, tileBytes))) {
+		ARLOGe("tileTextureOpen(): Unable to start the loader.\n");
+		tileTextureClose(tt);
+		return (FALSE);
+	}
+	ARLOGi("tileTextureOpen(): %s, %dx%d in %d levels, %d tiles, %d in the cache.\n", tileName, tt->width, tt->height, tt->levels, tt->tileNum, tt->slotNum);
+	return (TRUE);
+}
+
+void tileTextureClose(TileTexture *tt)
+{
+	tileLoaderFree(tt->loader);
+	if (tt->program) glmextDeleteProgram(tt->program);
+	if (tt->atlas) glDeleteTextures(1, &tt->atlas);
+	if (tt->pageTable) glDeleteTextures(1, &tt->pageTable);
+	free(tt->patches);
+	free(tt->tileSlot);
+	free(tt->tileNeeded);
+	free(tt->tileLoading);
+	free(tt->slotTile);
+	free(tt->slotUsed);
+	free(tt->table);
+	memset(tt, 0, sizeof(TileTexture));
+}
+
+// Adds a missing tile to the list to load, coarser levels first; when the
+// list is full a finer tile makes way.
+static void tileWant(TileTexture *tt, int *want, int *wantNum, int tile, int level)
+{
+	int i;
+
+	if (tt->tileSlot[tile] >= 0 || tt->tileLoading[tile]) return;
+	if (*wantNum == TILE_WANT_MAX) {
+		if (want[TILE_WANT_MAX - 1] >> 24 >= level) return;
+		(*wantNum)--;
+	}
+	for (i = *wantNum; i > 0 && want[i - 1] >> 24 < level; i--) want[i] = want[i - 1];
+	want[i] = level << 24 | tile;
+	(*wantNum)++;
+}
+
+void tileTextureUpdate(TileTexture *tt, const GLfloat view[16], const GLfloat transform[16], const GLfloat projection[16], int viewportHeight)
+{
+	TileLoader *tl = tt->loader;
+	TilePatch *p;
+	GLfloat mv[16], e[3], scale;
+	float cx, cy, cw, r, pixelsPerUnit, rho;
+	int want[TILE_WANT_MAX], wantNum = 0;
+	int i, j, k, level, w, h, x0, x1, y0, y1, tx, ty, tile, state, uploads;
+
+	if (!tt->program) return;
+	tt->frame++;
+
+	// Tiles each patch in view needs, from the level its texel density on
+	// screen calls for up.
+	for (i = 0; i < 4; i++) {
+		for (j = 0; j < 4; j++) {
+			mv[j * 4 + i] = 0.0f;
+			for (k = 0; k < 4; k++) mv[j * 4 + i] += view[k * 4 + i] * transform[j * 4 + k];
+		}
+	}
+	scale = sqrtf(mv[0] * mv[0] + mv[1] * mv[1] + mv[2] * mv[2]);
+	tt->stats.needed = tt->stats.missing = 0;
+	for (i = 0; i < tt->patchNum; i++) {
+		p = &tt->patches[i];
+		for (k = 0; k < 3; k++) e[k] = mv[k] * p->center[0] + mv[4 + k] * p->center[1] + mv[8 + k] * p->center[2] + mv[12 + k];
+		r = p->radius * scale;
+		cx = projection[0] * e[0] + projection[4] * e[1] + projection[8] * e[2] + projection[12];
+		cy = projection[1] * e[0] + projection[5] * e[1] + projection[9] * e[2] + projection[13];
+		cw = projection[3] * e[0] + projection[7] * e[1] + projection[11] * e[2] + projection[15];
+		if (cw + r <= 0.0f) continue;
+		if (fabsf(cx) > cw + r * (fabsf(projection[0]) + 1.0f) || fabsf(cy) > cw + r * (fabsf(projection[5]) + 1.0f)) continue;
+		pixelsPerUnit = scale * projection[5] * (float)viewportHeight * 0.5f / (cw > r ? cw - r : 1e-3f);
+		rho = pixelsPerUnit > 0.0f ? p->density / pixelsPerUnit : 0.0f;
+		// The estimate is for the nearest point of the patch, facing the
+		// camera, so the shader may pick any coarser level for the rest of
+		// it: those are wanted too, and cost a third more tiles at most.
+		level = rho > 1.0f ? (int)floorf(log2f(rho)) : 0;
+		if (level > tt->levels - 1) level = tt->levels - 1;
+		for (; level < tt->levels; level++) {
+			w = tileLevelSize(tt->width, level);
+			h = tileLevelSize(tt->height, level);
+			x0 = tileClamp((int)floorf(p->uv[0] * w) / tt->tileSize, 0, tt->tilesX[level] - 1);
+			x1 = tileClamp((int)floorf(p->uv[2] * w) / tt->tileSize, 0, tt->tilesX[level] - 1);
+			y0 = tileClamp((int)floorf((1.0f - p->uv[3]) * h) / tt->tileSize, 0, tt->tilesY[level] - 1);
+			y1 = tileClamp((int)floorf((1.0f - p->uv[1]) * h) / tt->tileSize, 0, tt->tilesY[level] - 1);
+			for (ty = y0; ty <= y1; ty++) {
+				for (tx = x0; tx <= x1; tx++) {
+					tile = tt->firstTile[level] + ty * tt->tilesX[level] + tx;
+					if (tt->tileNeeded[tile] == tt->frame) continue;
+					tt->tileNeeded[tile] = tt->frame;
+					tt->stats.needed++;
+					if (tt->tileSlot[tile] >= 0) tt->slotUsed[tt->tileSlot[tile]] = tt->frame;
+					else {
+						tt->stats.missing++;
+						tileWant(tt, want, &wantNum, tile, level);
+					}
+				}
+			}
+		}
+	}
+
+	// Loaded tiles into the atlas, a few per frame.
+	uploads = 0;
+	for (i = 0; i < TILE_STAGING; i++) {
+		state = tl->stage[i].state.load(std::memory_order_acquire);
+		if (state == STAGE_LOADED && uploads < TILE_UPLOADS_PER_FRAME) {
+			tilePlace(tt, tl->stage[i].tile, tl->stage[i].pixels);
+			tt->stats.loaded++;
+			uploads++;
+		}
+		else if (state == STAGE_FAILED) {
+			ARLOGe("tileTextureUpdate(): Unable to read tile %d.\n", tl->stage[i].tile);
+		}
+		else continue;
+		tt->tileLoading[tl->stage[i].tile] = FALSE;
+		tl->stage[i].state.store(STAGE_FREE, std::memory_order_release);
+	}
+	if (tt->tableDirty) tileTableUpdate(tt);
+
+	// The most wanted missing tiles to the loader.
+	tt->stats.loading = 0;
+	for (i = 0, j = 0; i < TILE_STAGING; i++) {
+		if (tl->stage[i].state.load(std::memory_order_acquire) != STAGE_FREE) {
+			tt->stats.loading++;
+			continue;
+		}
+		for (; j < wantNum; j++) {
+			tile = want[j] & 0xFFFFFF;
+			if (tt->tileSlot[tile] < 0 && !tt->tileLoading[tile]) break;
+		}
+		if (j == wantNum) continue;
+		tile = want[j++] & 0xFFFFFF;
+		tt->tileLoading[tile] = TRUE;
+		tl->stage[i].tile = tile;
+		tl->stage[i].state.store(STAGE_REQUESTED, std::memory_order_release);
+		tt->stats.loading++;
+	}
+}
+
+void tileTextureBind(const TileTexture *tt)
+{
+	if (!tt->program) return;
+	glmextActiveTexture(GL_TEXTURE1);
+	glBindTexture(GL_TEXTURE_2D, tt->pageTable);
+	glmextActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, tt->atlas);
+	glmextUseProgram(tt->program);
+}
+
+void tileTextureUnbind(const TileTexture *tt)
+{
+	if (!tt->program) return;
+	glmextUseProgram(0);
+	glmextActiveTexture(GL_TEXTURE1);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glmextActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, 0);
+}
@@ -0,0 +1,113 @@
+/*
+*  TileTexture.h
+*
+*  Textures too large for GPU memory, streamed in tiles.
+*
+*  tileTextureBuild() converts a PPM into a tiled file: every mip level
+*  cut into square tiles, each stored with a one pixel border copied
+*  from its neighbours so that filtering does not show the seams. The
+*  source is read a band of rows at a time and each level is built
+*  from tiles of the level below, so building never holds the image.
+*
+*  At run time the GPU holds a fixed size atlas of tiles, the tile cache,
+*  and a page table with one entry per tile of every level. A fragment
+*  shader picks the level from the texture coordinate derivatives and
+*  samples the atlas through the page table. A tile that is not in the
+*  cache has the entry of its nearest resident ancestor, so the surface
+*  is drawn from coarser levels until it arrives. The one tile of the
+*  coarsest level is loaded up front and never evicted.
+*
+*  tileTextureUpdate() works out from the model and the marker view which
+*  tiles each part of the model needs, from the level its projected
+*  texel density calls for up. A loader thread reads them from the file,
+*  and each update uploads a few into the atlas, evicting those used
+*  least recently. GPU memory is the atlas plus 4 bytes per tile of page
+*  table, however large the texture.
+*
+*  Needs OpenGL 2.0. Drawing is otherwise fixed function: the texture is
+*  modulated by the lit colour.
+*
+*/
+
+#ifndef TILE_TEXTURE_H
+#define TILE_TEXTURE_H
+
+#include "GLM.h"
+
+#define TILE_LEVELS_MAX         16
+#define TILE_PAGE_SIZE          128     // Pixels across a stored tile, border included.
+#define TILE_ATLAS_SIZE         2048    // Pixels across the tile cache. Fixes its GPU memory.
+#define TILE_STAGING            16      // Tiles being read at once.
+#define TILE_UPLOADS_PER_FRAME  8       // Most tiles copied into the atlas per update.
+#define TILE_PATCH_TRIANGLES    256     // Triangles per patch of the model when choosing tiles.
+
+typedef struct {
+	int         resident;               // Tiles in the cache.
+	int         needed;                 // Tiles the last view asked for.
+	int         missing;                // Of those, drawn from a coarser level.
+	int         loading;
+	long        loaded;                 // Tiles read since opening.
+	long        evicted;
+	size_t      gpuBytes;               // Atlas and page table.
+} TileTextureStats;
+
+typedef struct {
+	float       center[3];              // Bounding sphere, model coordinates.
+	float       radius;
+	float       uv[4];                  // Texture coordinate bounds: s0, t0, s1, t1.
+	float       density;                // Level 0 texels per model unit.
+} TilePatch;
+
+typedef struct TileLoader TileLoader;
+
+typedef struct {
+	int         width, height;          // Level 0 pixels.
+	int         pageSize;               // Stored tile, pixels across.
+	int         tileSize;               // Of which content, without the border.
+	int         levels;
+	int         tilesX[TILE_LEVELS_MAX], tilesY[TILE_LEVELS_MAX];
+	int         firstTile[TILE_LEVELS_MAX]; // Index of each level's first tile.
+	int         tileNum;
+
+	TilePatch   *patches;
+	int         patchNum;
+
+	int         *tileSlot;              // Atlas slot of each tile, -1 if not resident.
+	unsigned    *tileNeeded;            // Frame each tile was last needed.
+	char        *tileLoading;
+	int         *slotTile;              // Tile in each atlas slot, -1 if free.
+	unsigned    *slotUsed;              // Frame the slot's tile was last needed.
+	int         slotNum;
+	unsigned    frame;
+
+	unsigned char *table;               // Page table: atlas slot x, y and level of each tile.
+	int         tableWidth, tableHeight;
+	int         tableRow[TILE_LEVELS_MAX]; // Each level's first row.
+	int         tableDirty;
+
+	GLuint      atlas;
+	GLuint      pageTable;
+	GLuint      program;                // 0 if not open.
+	TileLoader  *loader;
+	TileTextureStats stats;
+} TileTexture;
+
+// Converts a binary (P6) PPM into a tiled file. FALSE on error.
+int         tileTextureBuild(const char *ppmName, const char *tileName);
+
+// Opens a tiled file for a model, with the GL context current; the model
+// must have texture coordinates and be in its final (drawable)
+// coordinates. FALSE (and nothing to free) on error.
+int         tileTextureOpen(TileTexture *tt, const char *tileName, const GLMmodel *model);
+void        tileTextureClose(TileTexture *tt);
+
+// Once per drawing, before tileTextureBind(): chooses tiles for the
+// view (column major view and projection; transform places the model),
+// queues the missing ones and uploads those that have loaded.
+void        tileTextureUpdate(TileTexture *tt, const GLfloat view[16], const GLfloat transform[16], const GLfloat projection[16], int viewportHeight);
+
+// Around drawing the model with GLM_TEXTURE.
+void        tileTextureBind(const TileTexture *tt);
+void        tileTextureUnbind(const TileTexture *tt);
+
+#endif // !TILE_TEXTURE_H
@@ -0,0 +1,38 @@
+/*
+*  Timing.h
+*
+*  Monotonic high resolution clock shared by the frame instrumentation.
+*  glutGet(GLUT_ELAPSED_TIME) only has millisecond resolution and
+*  arUtilTimer() is a single global stopwatch reset by the 'c' key, so
+*  neither is usable for per-stage timings.
+*
+*/
+
+#ifndef TIMING_H
+#define TIMING_H
+
+#ifdef _WIN32
+#  include <windows.h>
+#else
+#  include <time.h>
+#endif
+
+// Seconds since an arbitrary fixed point.
+static inline double timingNow(void)
+{
+#ifdef _WIN32
+	static LARGE_INTEGER freq = { 0 };
+	LARGE_INTEGER count;
+
+	if (!freq.QuadPart) QueryPerformanceFrequency(&freq);
+	QueryPerformanceCounter(&count);
+	return (double)count.QuadPart / (double)freq.QuadPart;
+#else
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+#endif
+}
+
+#endif // !TIMING_H
@@ -0,0 +1,227 @@
+/*
+*  Tracker.cpp
+*
+*  Marker detection and pose estimation as a library. See Tracker.h.
+*
+*/
+
+#include <string.h>
+#include <AR/ar.h>
+#include <AR/param.h>
+#include "Tracker.h"
+
+static void trackerStage(TrackerContext *tc, const char *stage)
+{
+	if (tc->stage) tc->stage(stage);
+}
+
+int trackerInit(TrackerContext *tc, const TrackerSettings *settings)
+{
+	ARParam cparam;
+	int pixelSize, width;
+
+	memset(tc, 0, sizeof(TrackerContext));
+	tc->xsize = settings->xsize;
+	tc->ysize = settings->ysize;
+	tc->pixFormat = settings->pixFormat;
+	tc->stage = settings->stage;
+	tc->bitLabelMode = settings->bitLabelMode;
+
+	pixelSize = arUtilGetPixelSize(settings->pixFormat);
+	if (pixelSize <= 0) {
+		ARLOGe("trackerInit(): Unsupported pixel format.\n");
+		return (FALSE);
+	}
+	tc->stride = settings->stride ? settings->stride : settings->xsize * pixelSize;
+	if (tc->stride < settings->xsize * pixelSize || tc->stride % pixelSize) {
+		ARLOGe("trackerInit(): Stride %d does not fit %d pixels of %d bytes.\n", tc->stride, settings->xsize, pixelSize);
+		return (FALSE);
+	}
+	width = tc->stride / pixelSize;
+
+	// Load the camera parameters and resize them for the frames.
+	if (arParamLoad(settings->cparamName, 1, &cparam) < 0) {
+		ARLOGe("trackerInit(): Error loading parameter file %s for camera.\n", settings->cparamName);
+		return (FALSE);
+	}
+	if (cparam.xsize != settings->xsize || cparam.ysize != settings->ysize) {
+		ARLOGw("*** Camera Parameter resized from %d, %d. ***\n", cparam.xsize, cparam.ysize);
+		arParamChangeSize(&cparam, settings->xsize, settings->ysize, &cparam);
+	}
+#ifdef DEBUG
+	ARLOG("*** Camera Parameter ***\n");
+	arParamDisp(&cparam);
+#endif
+	// Padding is more columns at the same intrinsics, not a wider view.
+	cparam.xsize = width;
+
+	if ((tc->paramLT = arParamLTCreate(&cparam, AR_PARAM_LT_DEFAULT_OFFSET)) == NULL) {
+		ARLOGe("trackerInit(): Error: arParamLTCreate.\n");
+		return (FALSE);
+	}
+	if ((tc->arHandle = arCreateHandle(tc->paramLT)) == NULL) {
+		ARLOGe("trackerInit(): Error: arCreateHandle.\n");
+		return (FALSE);
+	}
+	if (arSetPixelFormat(tc->arHandle, settings->pixFormat) < 0) {
+		ARLOGe("trackerInit(): Error: arSetPixelFormat.\n");
+		return (FALSE);
+	}
+	if (arSetDebugMode(tc->arHandle, AR_DEBUG_DISABLE) < 0) {
+		ARLOGe("trackerInit(): Error: arSetDebugMode.\n");
+		return (FALSE);
+	}
+	if ((tc->ar3DHandle = ar3DCreateHandle(&cparam)) == NULL) {
+		ARLOGe("trackerInit(): Error: ar3DCreateHandle.\n");
+		return (FALSE);
+	}
+	if ((tc->pattHandle = arPattCreateHandle()) == NULL) {
+		ARLOGe("trackerInit(): Error: arPattCreateHandle.\n");
+		return (FALSE);
+	}
+	arPattAttach(tc->arHandle, tc->pattHandle);
+
+	if (!presenceInit(&tc->presence, settings->presence, width, settings->ysize, settings->pixFormat)) {
+		ARLOGe("trackerInit(): Unable to set up presence scheduler.\n");
+		return (FALSE);
+	}
+	if (!bitLabelInit(&tc->bitLabel, width, settings->ysize)) {
+		ARLOGe("trackerInit(): Unable to set up bit-packed labeling.\n");
+		return (FALSE);
+	}
+	return (TRUE);
+}
+
+void trackerFinal(TrackerContext *tc)
+{
+	if (tc->arHandle) {
+		arPattDetach(tc->arHandle);
+		arDeleteHandle(tc->arHandle);
+		tc->arHandle = NULL;
+	}
+	if (tc->pattHandle) {
+		arPattDeleteHandle(tc->pattHandle);
+		tc->pattHandle = NULL;
+	}
+	if (tc->ar3DHandle) ar3DDeleteHandle(&tc->ar3DHandle);
+	if (tc->paramLT) arParamLTFree(&tc->paramLT);
+	presenceFinal(&tc->presence);
+	bitLabelFinal(&tc->bitLabel);
+	tc->pattNum = 0;
+}
+
+int trackerAddPattern(TrackerContext *tc, const char *pattName, ARdouble width)
+{
+	int id;
+
+	if (tc->pattNum == TRACKER_PATTERN_MAX) {
+		ARLOGe("trackerAddPattern(): More than %d patterns.\n", TRACKER_PATTERN_MAX);
+		return (-1);
+	}
+	if ((id = arPattLoad(tc->pattHandle, pattName)) < 0) {
+		ARLOGe("trackerAddPattern(): Error loading pattern file %s.\n", pattName);
+		return (-1);
+	}
+	tc->pattId[tc->pattNum] = id;
+	tc->pattWidth[tc->pattNum] = width;
+	tc->pattNum++;
+	return (id);
+}
+
+// Run the bit-packed candidate search. Returns FALSE if it is certain that
+// arDetectMarker() would find nothing in this frame. Only manual threshold
+// mode is certain, as the auto modes pick a new threshold inside
+// arDetectMarker(); field mode and adaptive thresholding are not mirrored.
+static int trackerPrefilter(TrackerContext *tc, const ARUint8 *image)
+{
+	int mode, thresh;
+	AR_LABELING_THRESH_MODE threshMode;
+
+	if (tc->bitLabelMode != 1) return (TRUE);
+	arGetImageProcMode(tc->arHandle, &mode);
+	arGetLabelingThreshMode(tc->arHandle, &threshMode);
+	if (mode != AR_IMAGE_PROC_FRAME_IMAGE || threshMode != AR_LABELING_THRESH_MODE_MANUAL) return (TRUE);
+	arGetLabelingMode(tc->arHandle, &mode);
+	tc->bitLabel.black = (mode == AR_LABELING_BLACK_REGION);
+	arGetLabelingThresh(tc->arHandle, &thresh);
+	return (bitLabelDetect(&tc->bitLabel, image, tc->pixFormat, thresh) > 0);
+}
+
+// Check the bit-packed path against arDetectMarker()'s candidates and the
+// byte per pixel reference on the frame just detected.
+static void trackerVerify(TrackerContext *tc, const ARUint8 *image)
+{
+	BitCandidate reference[BIT_CANDIDATE_MAX];
+	int mode, thresh, num;
+	AR_LABELING_THRESH_MODE threshMode;
+
+	arGetImageProcMode(tc->arHandle, &mode);
+	arGetLabelingThreshMode(tc->arHandle, &threshMode);
+	if (mode != AR_IMAGE_PROC_FRAME_IMAGE || threshMode == AR_LABELING_THRESH_MODE_AUTO_ADAPTIVE) return;
+	arGetLabelingMode(tc->arHandle, &mode);
+	tc->bitLabel.black = (mode == AR_LABELING_BLACK_REGION);
+	arGetLabelingThresh(tc->arHandle, &thresh);    // As used by this frame's detection.
+
+	bitLabelDetect(&tc->bitLabel, image, tc->pixFormat, thresh);
+	num = bitLabelReference(&tc->bitLabel, image, tc->pixFormat, thresh, reference);
+	tc->bitLabelChecks++;
+	if (!bitLabelCompareAR(&tc->bitLabel, tc->arHandle) || !bitLabelCompare(tc->bitLabel.candidates, tc->bitLabel.candidateNum, reference, num)) {
+		tc->bitLabelMismatches++;
+		ARLOGe("Bit-packed labeling mismatch: %d candidates, arDetectMarker %d, reference %d.\n", tc->bitLabel.candidateNum, tc->arHandle->marker2_num, num);
+	}
+}
+
+int trackerProcess(TrackerContext *tc, const TrackerFrame *frame, TrackerPose *poses, int maxPoses)
+{
+	ARMarkerInfo *info;
+	TrackerPose *pose;
+	int i, j, k, num;
+
+	if (!tc->arHandle || !frame->data) return (-1);
+	if (frame->pixFormat != tc->pixFormat || (frame->stride && frame->stride != tc->stride)) {
+		ARLOGe("trackerProcess(): Frame format or stride differs from the context.\n");
+		return (-1);
+	}
+	tc->frames++;
+
+	// While the marker has been absent for a while, only detect on the
+	// frames the scheduler picks.
+	trackerStage(tc, "presenceShouldDetect");
+	if (!presenceShouldDetect(&tc->presence, frame->data)) return (0);
+
+	// Without a single square candidate there is nothing to detect.
+	trackerStage(tc, "bitLabelPrefilter");
+	if (!trackerPrefilter(tc, frame->data)) {
+		presenceDetected(&tc->presence, FALSE);
+		return (0);
+	}
+
+	// Detect the markers in the frame. ARToolKit only reads the image,
+	// whatever its prototype says. Debug mode, when asked for, only for
+	// a frame that is detected, as switching it allocates the image.
+	trackerStage(tc, "arDetectMarker");
+	if (tc->debugImage) arSetDebugMode(tc->arHandle, AR_DEBUG_ENABLE);
+	if (arDetectMarker(tc->arHandle, (ARUint8 *)frame->data) < 0) return (-1);
+	tc->framesDetected++;
+	if (tc->bitLabelMode == 2) trackerVerify(tc, frame->data);
+
+	// The highest confidence marker of each pattern.
+	trackerStage(tc, "arGetTransMatSquare");
+	num = 0;
+	for (i = 0; i < tc->pattNum && num < maxPoses; i++) {
+		k = -1;
+		for (j = 0; j < tc->arHandle->marker_num; j++) {
+			if (tc->arHandle->markerInfo[j].id != tc->pattId[i]) continue;
+			if (k == -1 || tc->arHandle->markerInfo[j].cf > tc->arHandle->markerInfo[k].cf) k = j;
+		}
+		if (k == -1) continue;
+		info = &tc->arHandle->markerInfo[k];
+		pose = &poses[num++];
+		pose->id = tc->pattId[i];
+		pose->cf = info->cf;
+		pose->err = arGetTransMatSquare(tc->ar3DHandle, info, tc->pattWidth[i], pose->trans);
+		memcpy(pose->vertex, info->vertex, sizeof(pose->vertex));
+	}
+	presenceDetected(&tc->presence, num > 0);
+	return (num);
+}
@@ -0,0 +1,99 @@
+/*
+*  Tracker.h
+*
+*  Marker detection and pose estimation as a library: everything
+*  simpleARDIY does between getting a camera frame and drawing, with no
+*  globals, no GLUT and no video input.
+*
+*  A TrackerContext holds the camera parameters, the ARToolKit handles,
+*  the loaded patterns, a presence scheduler and the bit-packed candidate
+*  search for one camera. Contexts share nothing, so several can run at
+*  once on different threads (one thread per context at a time).
+*
+*  Frames stay the caller's. trackerProcess() reads the frame in place
+*  and keeps no pointer to it once it returns, so the caller may reuse
+*  the buffer straight away. Rows may be padded: the stride given at
+*  trackerInit() is used as the image width that ARToolKit sees, with
+*  the camera intrinsics left as they are, so pixel coordinates are
+*  unchanged and the padding is simply extra columns on the right.
+*  Planar formats are detected on the luma plane alone.
+*
+*/
+
+#ifndef TRACKER_H
+#define TRACKER_H
+
+#include <AR/ar.h>
+#include "PresenceScheduler.h"
+#include "BitLabel.h"
+
+#define TRACKER_PATTERN_MAX     16
+
+typedef void (*TrackerStageFunc)(const char *stage);
+
+typedef struct {
+	const char          *cparamName;    // Camera parameter file.
+	int                 xsize, ysize;   // Frame size; the parameters are resized to it.
+	AR_PIXEL_FORMAT     pixFormat;
+	int                 stride;         // Bytes per row, 0 for rows without padding.
+	const PresenceSettings *presence;   // NULL for presenceDefaultSettings().
+	int                 bitLabelMode;   // 0 = off, 1 = skip arDetectMarker() without candidates, 2 = also verify.
+	TrackerStageFunc    stage;          // Called as each step starts, or NULL.
+} TrackerSettings;
+
+typedef struct {
+	const ARUint8       *data;          // Caller-owned, only read.
+	int                 stride;         // Must match the context.
+	AR_PIXEL_FORMAT     pixFormat;      // Must match the context.
+} TrackerFrame;
+
+typedef struct {
+	int                 id;             // From trackerAddPattern().
+	ARdouble            cf;             // Match confidence.
+	ARdouble            err;            // Fit error of the pose.
+	ARdouble            trans[3][4];    // Marker to camera.
+	ARdouble            vertex[4][2];   // Corners in the image.
+} TrackerPose;
+
+typedef struct {
+	int                 xsize, ysize;
+	AR_PIXEL_FORMAT     pixFormat;
+	int                 stride;
+	TrackerStageFunc    stage;
+
+	ARParamLT           *paramLT;
+	ARHandle            *arHandle;
+	AR3DHandle          *ar3DHandle;
+	ARPattHandle        *pattHandle;
+	int                 pattId[TRACKER_PATTERN_MAX];
+	ARdouble            pattWidth[TRACKER_PATTERN_MAX];
+	int                 pattNum;
+
+	PresenceScheduler   presence;
+	BitLabel            bitLabel;
+	int                 bitLabelMode;
+	long                bitLabelChecks;
+	long                bitLabelMismatches;
+	int                 debugImage;     // Run arDetectMarker() in ARToolKit's debug mode; the caller switches it off.
+
+	long                frames;         // Frames given to trackerProcess().
+	long                framesDetected; // Frames arDetectMarker() ran on.
+} TrackerContext;
+
+// FALSE (and the context left safe to pass to trackerFinal()) if the
+// camera parameters cannot be loaded or the stride does not fit the
+// format. A zeroed context may be passed to trackerFinal() too.
+int         trackerInit(TrackerContext *tc, const TrackerSettings *settings);
+void        trackerFinal(TrackerContext *tc);
+
+// Loads a pattern file for markers of the given width (mm). Returns the
+// id poses will carry, or -1.
+int         trackerAddPattern(TrackerContext *tc, const char *pattName, ARdouble width);
+
+// Detects markers in a frame and writes the best pose of each pattern
+// found, up to maxPoses, into poses. Returns the number written, 0 if the
+// presence scheduler or the prefilter skipped detection, or -1 on error.
+// Does not allocate, except for ARToolKit's image when debugImage is set.
+int         trackerProcess(TrackerContext *tc, const TrackerFrame *frame, TrackerPose *poses, int maxPoses);
+
+#endif // !TRACKER_H
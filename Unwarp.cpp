@@ -0,0 +1,134 @@
+/*
+*  Unwarp.cpp
+*
+*  Marker interiors sampled through one homography per candidate. See
+*  Unwarp.h.
+*
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <AR/ar.h>
+#include "Unwarp.h"
+#include "Kernels.h"
+#include "Timing.h"
+
+const ARUint8 *unwarpLuma(const ARUint8 *image, AR_PIXEL_FORMAT pixFormat, int xsize, int ysize, ARUint8 *buffer)
+{
+	const ARUint8 *p = image;
+	int i, n = xsize * ysize;
+
+	switch (pixFormat) {
+	case AR_PIXEL_FORMAT_RGB:
+	case AR_PIXEL_FORMAT_BGR:
+		for (i = 0; i < n; i++, p += 3) buffer[i] = (ARUint8)((p[0] + p[1] + p[2]) / 3);
+		return buffer;
+	case AR_PIXEL_FORMAT_RGBA:
+	case AR_PIXEL_FORMAT_BGRA:
+		for (i = 0; i < n; i++, p += 4) buffer[i] = (ARUint8)((p[0] + p[1] + p[2]) / 3);
+		return buffer;
+	case AR_PIXEL_FORMAT_ARGB:
+	case AR_PIXEL_FORMAT_ABGR:
+		for (i = 0; i < n; i++, p += 4) buffer[i] = (ARUint8)((p[1] + p[2] + p[3]) / 3);
+		return buffer;
+	case AR_PIXEL_FORMAT_2vuy:
+		for (i = 0; i < n; i++) buffer[i] = image[i * 2 + 1];
+		return buffer;
+	case AR_PIXEL_FORMAT_yuvs:
+		for (i = 0; i < n; i++) buffer[i] = image[i * 2];
+		return buffer;
+	default:                            // MONO and the planar YUV formats.
+		return image;
+	}
+}
+
+// Samples across one direction: the pattern size doubled until there is
+// a sample per pixel along the longer of the two sides, as
+// arPattGetImage2() does.
+static int unwarpDivisions(const ARdouble a[2], const ARdouble b[2], const ARdouble c[2], const ARdouble d[2], ARdouble pattRatio, int pattSize, int sampleSize)
+{
+	ARdouble l1 = (a[0] - b[0]) * (a[0] - b[0]) + (a[1] - b[1]) * (a[1] - b[1]);
+	ARdouble l2 = (c[0] - d[0]) * (c[0] - d[0]) + (c[1] - d[1]) * (c[1] - d[1]);
+	int n = pattSize;
+
+	if (l2 > l1) l1 = l2;
+	while (n * n < l1 * pattRatio * pattRatio && n * 2 <= sampleSize) n *= 2;
+	return n;
+}
+
+void unwarpPattern(const ARUint8 *luma, int xsize, int ysize, ARParamLT *paramLT, const ARdouble vertex[4][2], ARdouble pattRatio,
+	int pattSize, int sampleSize, ARUint8 *out)
+{
+	float col[3 * KERNEL_UNWARP_MAX], row[3 * KERNEL_UNWARP_MAX];
+	double quad[8];
+	float ox, oy;
+	int i, cols, rows;
+
+	if (sampleSize > KERNEL_UNWARP_MAX) sampleSize = KERNEL_UNWARP_MAX;
+	cols = unwarpDivisions(vertex[0], vertex[1], vertex[2], vertex[3], pattRatio, pattSize, sampleSize);
+	rows = unwarpDivisions(vertex[1], vertex[2], vertex[3], vertex[0], pattRatio, pattSize, sampleSize);
+	for (i = 0; i < 4; i++) {
+		if (paramLT) {
+			arParamIdeal2ObservLTf(&paramLT->paramLTf, (float)vertex[i][0], (float)vertex[i][1], &ox, &oy);
+			quad[i * 2] = ox;
+			quad[i * 2 + 1] = oy;
+		}
+		else {
+			quad[i * 2] = vertex[i][0];
+			quad[i * 2 + 1] = vertex[i][1];
+		}
+	}
+	kernelUnwarpTerms(quad, pattRatio, col, cols, row, rows);
+	kernelUnwarp(luma, xsize, ysize, col, cols, row, rows, pattSize, out);
+}
+
+void unwarpBenchFrame(UnwarpBench *ub, ARHandle *arHandle, ARUint8 *image, ARUint8 *lumaBuffer)
+{
+	const int pattSize = arHandle->pattHandle ? arHandle->pattHandle->pattSize : AR_PATT_SIZE1;
+	ARUint8 ours[AR_PATT_SIZE1_MAX * AR_PATT_SIZE1_MAX], library[AR_PATT_SIZE1_MAX * AR_PATT_SIZE1_MAX];
+	const ARUint8 *luma;
+	double t, diff;
+	int i, k;
+
+	if (pattSize > AR_PATT_SIZE1_MAX) return;
+	luma = unwarpLuma(image, arHandle->arPixelFormat, arHandle->xsize, arHandle->ysize, lumaBuffer);
+	for (i = 0; i < arHandle->marker_num; i++) {
+		t = timingNow();
+		if (arPattGetImage2(AR_IMAGE_PROC_FRAME_IMAGE, AR_TEMPLATE_MATCHING_MONO, pattSize, AR_PATT_SAMPLE_NUM, image,
+			arHandle->xsize, arHandle->ysize, arHandle->arPixelFormat, &arHandle->arParamLT->paramLTf,
+			arHandle->markerInfo[i].vertex, arHandle->pattRatio, library) < 0) continue;
+		ub->library += timingNow() - t;
+		t = timingNow();
+		unwarpPattern(luma, arHandle->xsize, arHandle->ysize, arHandle->arParamLT, arHandle->markerInfo[i].vertex, arHandle->pattRatio,
+			pattSize, AR_PATT_SAMPLE_NUM, ours);
+		ub->ours += timingNow() - t;
+
+		diff = 0.0;
+		for (k = 0; k < pattSize * pattSize; k++) diff += abs((int)ours[k] - (int)library[k]);
+		diff /= pattSize * pattSize;
+		ub->diff += diff;
+		if (diff > ub->diffMax) ub->diffMax = diff;
+		if (diff > UNWARP_TOLERANCE) ub->mismatches++;
+		ub->candidates++;
+	}
+}
+
+int unwarpBenchReport(const UnwarpBench *ub)
+{
+	KERNEL_ISA isa = KERNEL_ISA_SCALAR;
+	int i;
+
+	for (i = 0; i < kernelCount(); i++) {
+		if (strcmp(kernelName(i), "unwarp") == 0) isa = kernelSelected(i);
+	}
+	if (!ub->candidates) {
+		ARLOGw("Unwarp: No candidates to compare.\n");
+		return (TRUE);
+	}
+	ARLOGi("Unwarp: %ld candidates, %.1f us each (arPattGetImage2 %.1f us, %.1fx) with the %s kernel.\n", ub->candidates,
+		ub->ours * 1e6 / ub->candidates, ub->library * 1e6 / ub->candidates, ub->ours > 0.0 ? ub->library / ub->ours : 0.0,
+		kernelIsaName(isa));
+	ARLOGi("Unwarp: Mean difference per cell %.2f (worst candidate %.2f), %ld over the tolerance of %d.\n",
+		ub->diff / ub->candidates, ub->diffMax, ub->mismatches, UNWARP_TOLERANCE);
+	return (ub->mismatches == 0);
+}
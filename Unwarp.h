@@ -0,0 +1,55 @@
+/*
+*  Unwarp.h
+*
+*  Marker interiors sampled into the pattern grid through one homography
+*  per candidate.
+*
+*  arPattGetImage2() works out the position of each sample separately,
+*  through the perspective transform and then the lens distortion.
+*  unwarpPattern() takes only the four corners through the distortion.
+*  It computes the homography between them once, and kernelUnwarp()
+*  steps every sample through it with SIMD and gathers. The sample count
+*  grows with the candidate's size as it does in arPattGetImage2(), up to
+*  sampleSize across.
+*
+*  Distortion inside the square is left out, so the result is close to
+*  ARToolKit's rather than equal to it. unwarpBenchFrame() measures how
+*  close, and how much faster, on the candidates of real frames.
+*
+*  Monochrome patterns only, in frame (not field) mode.
+*
+*/
+
+#ifndef UNWARP_H
+#define UNWARP_H
+
+#include <AR/ar.h>
+
+#define UNWARP_TOLERANCE        8       // Mean difference per cell from arPattGetImage2() that still counts as a match.
+
+// The luma plane of an image as ARToolKit's monochrome matching sees it:
+// the image itself for the planar formats, otherwise converted into
+// buffer (xsize * ysize bytes).
+const ARUint8 *unwarpLuma(const ARUint8 *image, AR_PIXEL_FORMAT pixFormat, int xsize, int ysize, ARUint8 *buffer);
+
+// vertex is in ideal coordinates, as in ARMarkerInfo; paramLT may be NULL
+// for an undistorted camera. out is pattSize * pattSize bytes.
+void        unwarpPattern(const ARUint8 *luma, int xsize, int ysize, ARParamLT *paramLT, const ARdouble vertex[4][2], ARdouble pattRatio,
+	int pattSize, int sampleSize, ARUint8 *out);
+
+typedef struct {
+	long        candidates;
+	double      ours, library;          // Seconds in total.
+	double      diff;                   // Sum over candidates of the mean difference per cell.
+	double      diffMax;
+	long        mismatches;             // Candidates over UNWARP_TOLERANCE.
+} UnwarpBench;
+
+// Times unwarpPattern() against arPattGetImage2() on each candidate of
+// the last arDetectMarker(arHandle, image), and compares the two.
+void        unwarpBenchFrame(UnwarpBench *ub, ARHandle *arHandle, ARUint8 *image, ARUint8 *lumaBuffer);
+
+// Logs the totals. FALSE if any candidate was out of tolerance.
+int         unwarpBenchReport(const UnwarpBench *ub);
+
+#endif // !UNWARP_H
@@ -0,0 +1,246 @@
+/*
+*  YuvBackground.cpp
+*
+*  Video background converted from YUV on the GPU. See YuvBackground.h.
+*
+*/
+
+#include <stdio.h>
+#include <string.h>
+#ifdef _WIN32
+#  define snprintf _snprintf
+#endif
+#include <AR/ar.h>
+#include "YuvBackground.h"
+
+// How the frame is laid out in the textures, for the shader.
+#define YUV_LAYOUT_CBCR         0       // Luma plane, then Cb Cr pairs (420v, 420f).
+#define YUV_LAYOUT_CRCB         1       // Luma plane, then Cr Cb pairs (NV21).
+#define YUV_LAYOUT_YUYV         2       // Y0 Cb Y1 Cr (yuvs).
+#define YUV_LAYOUT_UYVY         3       // Cb Y0 Cr Y1 (2vuy).
+
+static const char *yuvBackgroundVertex =
+	"void main()\n"
+	"{\n"
+	"	gl_TexCoord[0] = gl_MultiTexCoord0;\n"
+	"	gl_Position = ftransform();\n"
+	"}\n";
+
+// Preceded by the LAYOUT and VIDEO_RANGE defines.
+static const char *yuvBackgroundFragment =
+	"uniform sampler2D texY;\n"
+	"uniform sampler2D texC;\n"
+	"uniform float width;\n"    // Pixels across, for Y0 or Y1 of a packed pair.
+	"void main()\n"
+	"{\n"
+	"	vec2 tc = gl_TexCoord[0].st;\n"
+	"	float y;\n"
+	"	vec2 c;\n"
+	"#if LAYOUT < 2\n"
+	"	vec4 t = texture2D(texC, tc);\n"
+	"	y = texture2D(texY, tc).r;\n"
+	"#  if LAYOUT == 0\n"
+	"	c = vec2(t.r, t.a);\n"
+	"#  else\n"
+	"	c = vec2(t.a, t.r);\n"
+	"#  endif\n"
+	"#else\n"
+	"	vec4 t = texture2D(texY, tc);\n"
+	"	float odd = mod(floor(tc.s * width), 2.0);\n"
+	"#  if LAYOUT == 2\n"
+	"	y = mix(t.r, t.b, odd);\n"
+	"	c = vec2(t.g, t.a);\n"
+	"#  else\n"
+	"	y = mix(t.g, t.a, odd);\n"
+	"	c = vec2(t.r, t.b);\n"
+	"#  endif\n"
+	"#endif\n"
+	"	c -= 128.0 / 255.0;\n"
+	"#if VIDEO_RANGE\n"
+	"	y = (y - 16.0 / 255.0) * (255.0 / 219.0);\n"
+	"	c *= 255.0 / 224.0;\n"
+	"#endif\n"
+	"	gl_FragColor = vec4(y + 1.402 * c.y, y - 0.344136 * c.x - 0.714136 * c.y, y + 1.772 * c.x, 1.0);\n"
+	"}\n";
+
+static int yuvBackgroundLayout(AR_PIXEL_FORMAT pixFormat, int *videoRange)
+{
+	switch (pixFormat) {
+	case AR_PIXEL_FORMAT_420v: *videoRange = TRUE;  return YUV_LAYOUT_CBCR;
+	case AR_PIXEL_FORMAT_420f: *videoRange = FALSE; return YUV_LAYOUT_CBCR;
+	case AR_PIXEL_FORMAT_NV21: *videoRange = FALSE; return YUV_LAYOUT_CRCB;
+	case AR_PIXEL_FORMAT_yuvs: *videoRange = TRUE;  return YUV_LAYOUT_YUYV;
+	case AR_PIXEL_FORMAT_2vuy: *videoRange = TRUE;  return YUV_LAYOUT_UYVY;
+	default: return -1;
+	}
+}
+
+int yuvBackgroundFormatSupported(AR_PIXEL_FORMAT pixFormat)
+{
+	int videoRange;
+
+	return (yuvBackgroundLayout(pixFormat, &videoRange) >= 0);
+}
+
+static GLuint yuvBackgroundCompile(GLenum type, const char *defines, const char *source)
+{
+	const GLMchar *sources[2] = { defines, source };
+	GLuint shader;
+	GLint ok;
+	char log[1024];
+
+	shader = glmextCreateShader(type);
+	glmextShaderSource(shader, 2, sources, NULL);
+	glmextCompileShader(shader);
+	glmextGetShaderiv(shader, GL_COMPILE_STATUS, &ok);
+	if (!ok) {
+		glmextGetShaderInfoLog(shader, sizeof(log), NULL, log);
+		ARLOGe("yuvBackgroundInit(): %s shader did not compile: %s\n", type == GL_VERTEX_SHADER ? "Vertex" : "Fragment", log);
+		glmextDeleteShader(shader);
+		return 0;
+	}
+	return shader;
+}
+
+// Storage is allocated once; frames are copied into it.
+static void yuvBackgroundTexture(GLuint texture, GLenum format, int width, int height, GLenum filter)
+{
+	glBindTexture(GL_TEXTURE_2D, texture);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, NULL);
+}
+
+int yuvBackgroundInit(YuvBackground *yb, int xsize, int ysize, AR_PIXEL_FORMAT pixFormat)
+{
+	char defines[64];
+	GLuint vs, fs;
+	GLint ok;
+	int layout, videoRange;
+	char log[1024];
+
+	memset(yb, 0, sizeof(YuvBackground));
+	if ((layout = yuvBackgroundLayout(pixFormat, &videoRange)) < 0) {
+		ARLOGw("yuvBackgroundInit(): Not a YUV format with a shader (%s).\n", arUtilGetPixelFormatName(pixFormat));
+		return (FALSE);
+	}
+	glmExtInit();
+	if (!glmExtHasShaders()) {
+		ARLOGw("yuvBackgroundInit(): Shaders not available.\n");
+		return (FALSE);
+	}
+	yb->xsize = xsize;
+	yb->ysize = ysize;
+	yb->pixFormat = pixFormat;
+
+	snprintf(defines, sizeof(defines), "#define LAYOUT %d\n#define VIDEO_RANGE %d\n", layout, videoRange);
+	if (!(vs = yuvBackgroundCompile(GL_VERTEX_SHADER, "", yuvBackgroundVertex))) return (FALSE);
+	if (!(fs = yuvBackgroundCompile(GL_FRAGMENT_SHADER, defines, yuvBackgroundFragment))) {
+		glmextDeleteShader(vs);
+		return (FALSE);
+	}
+	yb->program = glmextCreateProgram();
+	glmextAttachShader(yb->program, vs);
+	glmextAttachShader(yb->program, fs);
+	glmextLinkProgram(yb->program);
+	glmextDeleteShader(vs);     // Freed with the program.
+	glmextDeleteShader(fs);
+	glmextGetProgramiv(yb->program, GL_LINK_STATUS, &ok);
+	if (!ok) {
+		glmextGetProgramInfoLog(yb->program, sizeof(log), NULL, log);
+		ARLOGe("yuvBackgroundInit(): Shaders did not link: %s\n", log);
+		yuvBackgroundFinal(yb);
+		return (FALSE);
+	}
+	glmextUseProgram(yb->program);
+	glmextUniform1i(glmextGetUniformLocation(yb->program, "texY"), 0);
+	glmextUniform1i(glmextGetUniformLocation(yb->program, "texC"), 1);
+	glmextUniform1f(glmextGetUniformLocation(yb->program, "width"), (GLfloat)xsize);
+	glmextUseProgram(0);
+
+	// Packed pairs must not be filtered across, or Y0 and Y1 and the two
+	// chroma samples would blend with their neighbours'.
+	glGenTextures(2, yb->texture);
+	if (layout < YUV_LAYOUT_YUYV) {
+		yuvBackgroundTexture(yb->texture[0], GL_LUMINANCE, xsize, ysize, GL_LINEAR);
+		yuvBackgroundTexture(yb->texture[1], GL_LUMINANCE_ALPHA, xsize / 2, ysize / 2, GL_LINEAR);
+	}
+	else yuvBackgroundTexture(yb->texture[0], GL_RGBA, xsize / 2, ysize, GL_NEAREST);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	return (TRUE);
+}
+
+void yuvBackgroundFinal(YuvBackground *yb)
+{
+	if (yb->program) glmextDeleteProgram(yb->program);
+	if (yb->texture[0]) glDeleteTextures(2, yb->texture);
+	memset(yb, 0, sizeof(YuvBackground));
+}
+
+void yuvBackgroundUpload(YuvBackground *yb, const ARUint8 *image)
+{
+	int videoRange;
+
+	if (!yb->program || !image) return;
+	glPushClientAttrib(GL_CLIENT_PIXEL_STORE_BIT);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	if (yuvBackgroundLayout(yb->pixFormat, &videoRange) < YUV_LAYOUT_YUYV) {
+		glBindTexture(GL_TEXTURE_2D, yb->texture[0]);
+		glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, yb->xsize, yb->ysize, GL_LUMINANCE, GL_UNSIGNED_BYTE, image);
+		glBindTexture(GL_TEXTURE_2D, yb->texture[1]);
+		glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, yb->xsize / 2, yb->ysize / 2, GL_LUMINANCE_ALPHA, GL_UNSIGNED_BYTE,
+			image + (size_t)yb->xsize * yb->ysize);
+	}
+	else {
+		glBindTexture(GL_TEXTURE_2D, yb->texture[0]);
+		glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, yb->xsize / 2, yb->ysize, GL_RGBA, GL_UNSIGNED_BYTE, image);
+	}
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glPopClientAttrib();
+	yb->uploaded = TRUE;
+}
+
+void yuvBackgroundDraw(const YuvBackground *yb)
+{
+	if (!yb->program || !yb->uploaded) return;
+
+	glPushAttrib(GL_ENABLE_BIT | GL_TEXTURE_BIT | GL_DEPTH_BUFFER_BIT | GL_TRANSFORM_BIT);
+	glDisable(GL_DEPTH_TEST);
+	glDisable(GL_LIGHTING);
+	glDisable(GL_BLEND);
+	glDepthMask(GL_FALSE);
+	glMatrixMode(GL_PROJECTION);
+	glPushMatrix();
+	glLoadIdentity();
+	glOrtho(0.0, 1.0, 0.0, 1.0, -1.0, 1.0);
+	glMatrixMode(GL_MODELVIEW);
+	glPushMatrix();
+	glLoadIdentity();
+
+	glmextActiveTexture(GL_TEXTURE1);
+	glBindTexture(GL_TEXTURE_2D, yb->texture[1]);
+	glmextActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, yb->texture[0]);
+	glmextUseProgram(yb->program);
+
+	// Row 0 of the frame is the top of the screen.
+	glBegin(GL_QUADS);
+	glTexCoord2f(0.0f, 1.0f); glVertex2f(0.0f, 0.0f);
+	glTexCoord2f(1.0f, 1.0f); glVertex2f(1.0f, 0.0f);
+	glTexCoord2f(1.0f, 0.0f); glVertex2f(1.0f, 1.0f);
+	glTexCoord2f(0.0f, 0.0f); glVertex2f(0.0f, 1.0f);
+	glEnd();
+
+	glmextUseProgram(0);
+	glmextActiveTexture(GL_TEXTURE1);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glmextActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glMatrixMode(GL_PROJECTION);
+	glPopMatrix();
+	glMatrixMode(GL_MODELVIEW);
+	glPopMatrix();
+	glPopAttrib();
+}
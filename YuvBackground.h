@@ -0,0 +1,50 @@
+/*
+*  YuvBackground.h
+*
+*  The video background drawn straight from the camera's YUV frames.
+*
+*  For YUV formats argl converts each frame to RGB on the CPU before it
+*  can be uploaded. Here the frame is uploaded as it is and converted in
+*  a fragment shader (BT.601, video or full range by format): the luma
+*  plane and the interleaved chroma plane of 420v, 420f and NV21 as two
+*  textures, and the packed pairs of yuvs (YUYV) and 2vuy (UYVY) as one
+*  RGBA texture of half the width, each texel holding two pixels.
+*
+*  The frame fills the viewport, as arglDispImage() draws it with zoom 1,
+*  but without argl's lens distortion correction.
+*
+*  Needs OpenGL 2.0. Detection is unaffected: ARToolKit and the tracker
+*  read the luma of these formats in place.
+*
+*/
+
+#ifndef YUV_BACKGROUND_H
+#define YUV_BACKGROUND_H
+
+#include <AR/ar.h>
+#include "GLMExt.h"
+
+typedef struct {
+	int             xsize, ysize;
+	AR_PIXEL_FORMAT pixFormat;
+	GLuint          program;            // 0 if not set up.
+	GLuint          texture[2];         // Luma or packed pairs, and chroma.
+	int             uploaded;           // A frame is in the textures.
+} YuvBackground;
+
+// Whether there is a shader for the format.
+int         yuvBackgroundFormatSupported(AR_PIXEL_FORMAT pixFormat);
+
+// With the GL context current. FALSE (and a warning) if the format is
+// not YUV or shaders are not available.
+int         yuvBackgroundInit(YuvBackground *yb, int xsize, int ysize, AR_PIXEL_FORMAT pixFormat);
+void        yuvBackgroundFinal(YuvBackground *yb);
+
+// A new frame, in the format and size given to yuvBackgroundInit().
+void        yuvBackgroundUpload(YuvBackground *yb, const ARUint8 *image);
+
+// The last frame uploaded, filling the viewport. GL state is left as it
+// was found.
+void        yuvBackgroundDraw(const YuvBackground *yb);
+
+#endif // !YUV_BACKGROUND_H
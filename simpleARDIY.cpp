@@ -22,6 +22,7 @@
 #  define snprintf _snprintf
 #endif
 #include <stdlib.h>					// malloc(), free()
+#include <math.h>
 #ifdef __APPLE__
 #  include <GLUT/glut.h>
 #else
@@ -33,7 +34,26 @@
 #include <AR/ar.h>
 #include <AR/gsub_lite.h>
 
-#include "GLM.h"           // load and draw obj model file
+#include "GLM.h"           // load and draw obj/ply/stl model file
+#include "Tracker.h"       // detection and pose, with duty cycling and the bit-packed prefilter
+#include "StallWatchdog.h" // writes stall-NN.txt when a frame runs over budget
+#include "Profiler.h"      // sampling profiler, 'f' writes profile-NN.folded
+#include "StackTrace.h"
+#include "AllocTrack.h"    // allocation counting for --alloc-check
+#include "FrameReplay.h"   // 'r' records frames-NN.arfr, --replay plays one back
+#include "Soak.h"          // --soak <hours> logs memory and latency trends to soak.csv
+#include "GpuTimer.h"      // GPU time per Display() pass
+#include "FramePacing.h"   // --pacing off|vsync|adaptive|wait, 'v' cycles
+#include "Impostor.h"      // textured quad in place of the model when it is small on screen
+#include "PosePredictor.h" // marker pose between detections, for drawing at the display's rate
+#include "MarkerMap.h"     // --map <file>: many markers mapped and solved as one, 'g' maps, 'w' saves
+#include "Kernels.h"       // SIMD variants picked for the CPU, --kernel-bench, --kernel-check
+#include "YuvBackground.h" // YUV video converted in a shader, --background argl|shader, 'y' switches
+#include "TileTexture.h"   // --tiles <file>: a texture too large for the GPU, streamed in tiles
+#include "DebugOverlay.h"  // 'd': labels, candidates and markers drawn over the video
+#include "Unwarp.h"        // --unwarp-bench: SIMD pattern unwarping timed against ARToolKit's
+#include "ParallelReplay.h" // --parallel <n>: a recording detected on n threads, poses to poses.csv
+#include "Timing.h"
 
 // ============================================================================
 //	Constants
@@ -43,6 +63,37 @@
 #define VIEW_DISTANCE_MIN		40.0        // Objects closer to the camera than this will not be displayed. OpenGL units.
 #define VIEW_DISTANCE_MAX		10000.0     // Objects further away from the camera than this will not be displayed. OpenGL units.
 
+#define STALL_BUDGET			0.050       // mainLoop()/Display() iterations longer than this (seconds) are written up as stalls.
+#define STALL_INCIDENTS			8           // Size of the ring of stall incident files.
+
+#define PROFILER_HZ				97          // Profiler samples per second of CPU time. 0 disables the profiler.
+#define PROFILER_SLOTS			16384       // Latest samples kept for a dump (nearly 3 minutes of one busy thread).
+
+#define SOAK_INTERVAL			10.0        // Seconds between soak samples.
+#define SOAK_WARMUP				120.0       // Seconds of soak left out of the trends.
+#define SOAK_SOURCE_FPS			30.0        // Rate the replayed or synthetic source delivers frames at during a soak.
+#define SOAK_SYNTHETIC_FRAMES	240         // Length of the synthetic loop when soaking without --replay.
+
+#define IMPOSTOR_TILE			64          // Pixels per impostor view.
+#define IMPOSTOR_THRESHOLD		96.0f       // Projected model diameter (pixels) below which the impostor is drawn.
+#define IMPOSTOR_FADE			0.3         // Seconds to cross-fade between mesh and impostor.
+#define IMPOSTOR_BENCH_FRAMES	60          // Frames timed per distance by --impostor-bench.
+
+#define SPLAT_DENSITY			1.0f        // Triangles per covered pixel above which the model is drawn as points.
+#define SPLAT_HYSTERESIS		0.7f        // Back to triangles only below SPLAT_DENSITY times this.
+#define SPLAT_POINTS_PER_PIXEL	2.0f        // Points drawn per covered pixel; the rest are subsampled away.
+
+#define RENDER_RATE_MAX			240.0       // Hz. Display-rate drawing is held to this when the swap does not wait for the vblank.
+#define POSE_HORIZON			0.05        // Seconds a pose is extrapolated past the frame it was detected in.
+
+#define BACKGROUND_CPU_SMOOTHING 0.05       // Weight of each frame in the mean CPU time of the video background.
+
+#define DEBUG_IMAGE_INTERVAL	30          // Detections between binarized images in the second debug mode.
+
+#define PARALLEL_SOURCE_FPS		30.0        // Rate a recording is taken to have been captured at by --parallel.
+
+#define GROUPS_MAX				64          // Names given to --groups.
+
 // ============================================================================
 //	Global variables
 // ============================================================================
@@ -56,23 +107,35 @@ static int windowRefresh = 0;					// Fullscreen mode refresh rate. Set to 0 to u
 
 // Image acquisition.
 static ARUint8		*gARTImage = NULL;
+static ARUint8		*gARTImageShown = NULL;	// Last frame drawn as the background.
 static int          gARTImageSavePlease = FALSE;
 
 // Marker detection.
-static ARHandle		*gARHandle = NULL;
-static ARPattHandle	*gARPattHandle = NULL;
+static TrackerContext gTracker;				// Camera parameters, ARToolKit handles, presence scheduler, prefilter.
 static long			gCallCountMarkerDetect = 0;
+static FrameReplay	gReplay;				// --replay: frames come from a recording, not the camera.
+static int			gReplaying = FALSE;
+static FrameRecorder gRecorder;				// 'r': camera frames are written out.
+static int			gAllocCheck = FALSE;	// --alloc-check: the second replay pass must not allocate.
+static long			gAllocViolations = 0;
+static const char	*gFrameName = NULL;
+static int			gSoaking = FALSE;		// --soak: replay paced like a camera, trends sampled.
+static double		gSourceStart = 0.0;
+static long			gSourceDelivered = 0;
 
 // Transformation matrix retrieval.
-static AR3DHandle	*gAR3DHandle = NULL;
 static ARdouble		gPatt_width = 80.0;	// Per-marker, but we are using only 1 marker.
 static ARdouble		gPatt_trans[3][4];		// Per-marker, but we are using only 1 marker.
 static int			gPatt_found = FALSE;	// Per-marker, but we are using only 1 marker.
 static int			gPatt_id;				// Per-marker, but we are using only 1 marker.
+static const char	*gMapName = NULL;		// --map: the pose is of the map of all markers, kept in this file.
+static DebugOverlay	gDebugOverlay;			// 'd': what detection saw, over the video.
 
 // Drawing.
-static ARParamLT *gCparamLT = NULL;
 static ARGL_CONTEXT_SETTINGS_REF gArglSettings = NULL;
+static YuvBackground gYuvBackground;			// Set up for YUV camera formats.
+static int gBackgroundShader = FALSE;			// Draw YUV video with gYuvBackground (--background shader) or argl.
+static double gBackgroundCpu[2] = { 0.0, 0.0 };	// Mean CPU seconds per frame drawing the video, argl and shader.
 static int gShowHelp = 1;
 static int gShowMode = 1;
 static int gDrawRotate = TRUE;
@@ -80,16 +143,46 @@ static float gDrawRotateAngle = 0;			// For use in drawing.
 
 // Model files.
 static GLMmodel *gObj = NULL;
+static GLMdrawable *gObjDrawable = NULL;		// gObj flattened for glmPrepare()/glmSubmit().
+static GLMcommandlist gObjCommands;				// Recorded by mainLoop(), executed by Display().
+static GLfloat gObjTransform[16];				// The transform recorded with them.
+static TileTexture gTiles;						// --tiles: the model's texture, streamed as the view needs it.
+static GLMsplats *gObjSplats = NULL;			// gObj as points, for when its triangles are smaller than pixels.
+static int gSplatMode = 0;						// 0 = by triangle density, 1 = triangles only, 2 = points only.
+static int gSplatting = FALSE;
+static float gSplatDensity = 0.0f;
+static GLuint gSplatCount = 0;
+static Impostor gImpostor;
+static ImpostorLOD gImpostorLOD;
+static int gImpostorBench = FALSE;				// --impostor-bench: time mesh and impostor by distance and exit.
+static int gRenderDecoupled = TRUE;				// Draw at the display's rate (TRUE) or once per camera frame.
+static PosePredictor gPose;						// Detected poses, for the pose at each drawing.
+static double gRenderLast = 0.0;
+static double gRateStart = 0.0;				// Drawing and camera rates, for printMode().
+static long gRateRenders = 0;
+static long gRateFrames = 0;
+static float gRenderFps = 0.0f;
+static float gCameraFps = 0.0f;
 static const float markerSize = 40.0f;
 
 // ============================================================================
 //	Function prototypes.
 // ============================================================================
 static void DrawObj(void);
+static void DrawObjPrepare(void);
 static void DrawObjUpdate(float timeDelta);
-static int setupCamera(const char *cparam_name, char *vconf, ARParamLT **cparamLT_p, ARHandle **arhandle, AR3DHandle **ar3dhandle);
-static int setupMarker(const char *patt_name, int *patt_id, ARHandle *arhandle, ARPattHandle **pattHandle_p);
+static void DrawSplats(const GLfloat projection[16], float distance);
+static float objScreenSize(const GLfloat view[16], const GLfloat projection[16], float *distance);
+static int setupCamera(const char *cparam_name, const char *vconf, TrackerContext *tc);
 static void Keyboard(unsigned char key, int x, int y);
+static void describeSettings(char *buf, size_t size);
+static void frameBegin(const char *name);
+static void frameStage(const char *stage);
+static void frameEnd(void);
+static ARUint8 *replayGetImage(void);
+static void gpuTimerResult(const char *pass, double seconds);
+static void impostorBenchmark(const char *csv_name);
+static int parallelPoses(const char *cparam_name, const char *patt_name, int workers, const char *csv_name);
 static void mainLoop(void);
 static void Reshape(int w, int h);
 static void Display(void);
@@ -113,41 +206,273 @@ int main(int argc, char** argv)
 	//
 	char glutGamemode[32];
 	char cparam_name[] = "Data/camera_para.dat";
-	char vconf[] = "";
+	const char *vconf = "";
 	char patt_name[] = "Data/patt.irc";
 	char obj_name[] = "Data/bunny.obj";
+	char *objName = obj_name;
+	const char *tilesName = NULL;
+	char *groupNames[GROUPS_MAX], *groupList = NULL, *groupName, *indexName;
+	GLuint groupNum = 0;
+	int i;
+	const char *pattNames[TRACKER_PATTERN_MAX];
+	ARdouble pattWidths[TRACKER_PATTERN_MAX];
+	int pattNum = 0, pattId;
+	FILE *fp;
+	double soakHours = 0.0;
+	PACING_MODE pacing = PACING_DRIVER;
+	int framesAhead = 0;
+	int benchKernels = FALSE, checkKernels = FALSE;
+	int benchUnwarp = FALSE;
+	int parallelWorkers = -1;
+	UnwarpBench unwarpBench;
+	ARUint8 *image, *lumaBuffer;
+
+	kernelInit();       // Before anything runs a kernel; KERNEL_ISA etc. override.
+
+	//
+	// Library inits.
+	//
+
+	glutInit(&argc, argv);
+
+	// Options left over by glutInit().
+	for (i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+			if (!frameReplayOpen(&gReplay, argv[++i])) exit(-1);
+			gReplaying = TRUE;
+		}
+		else if (strcmp(argv[i], "--alloc-check") == 0) {
+			gAllocCheck = TRUE;
+		}
+		else if (strcmp(argv[i], "--soak") == 0 && i + 1 < argc) {
+			soakHours = atof(argv[++i]);
+			gSoaking = TRUE;
+		}
+		else if (strcmp(argv[i], "--pacing") == 0 && i + 1 < argc) {
+			if (!pacingModeFromName(argv[++i], &pacing)) {
+				ARLOGe("main(): --pacing takes driver, off, vsync, adaptive or wait.\n");
+				exit(-1);
+			}
+		}
+		else if (strcmp(argv[i], "--frames-ahead") == 0 && i + 1 < argc) {
+			framesAhead = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--impostor-bench") == 0) {
+			gImpostorBench = TRUE;
+		}
+		else if (strcmp(argv[i], "--map") == 0 && i + 1 < argc) {
+			gMapName = argv[++i];
+		}
+		else if (strcmp(argv[i], "--patt") == 0 && i + 2 < argc) {
+			if (pattNum == TRACKER_PATTERN_MAX) {
+				ARLOGe("main(): More than %d --patt options.\n", TRACKER_PATTERN_MAX);
+				exit(-1);
+			}
+			pattNames[pattNum] = argv[++i];
+			pattWidths[pattNum++] = (ARdouble)atof(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--vconf") == 0 && i + 1 < argc) {
+			vconf = argv[++i];
+		}
+		else if (strcmp(argv[i], "--background") == 0 && i + 1 < argc) {
+			i++;
+			if (strcmp(argv[i], "argl") == 0) gBackgroundShader = FALSE;
+			else if (strcmp(argv[i], "shader") == 0) gBackgroundShader = TRUE;
+			else {
+				ARLOGe("main(): --background takes argl or shader.\n");
+				exit(-1);
+			}
+		}
+		else if (strcmp(argv[i], "--kernel-bench") == 0) {
+			benchKernels = TRUE;
+		}
+		else if (strcmp(argv[i], "--kernel-check") == 0) {
+			checkKernels = TRUE;
+		}
+		else if (strcmp(argv[i], "--unwarp-bench") == 0) {
+			benchUnwarp = TRUE;
+		}
+		else if (strcmp(argv[i], "--parallel") == 0 && i + 1 < argc) {
+			parallelWorkers = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--model") == 0 && i + 1 < argc) {
+			objName = argv[++i];
+		}
+		else if (strcmp(argv[i], "--groups") == 0 && i + 1 < argc) {
+			groupList = argv[++i];
+		}
+		else if (strcmp(argv[i], "--tiles") == 0 && i + 1 < argc) {
+			tilesName = argv[++i];
+		}
+		else if (strcmp(argv[i], "--tiles-build") == 0 && i + 2 < argc) {
+			// A PPM into a tiled file for --tiles, then exit.
+			exit(tileTextureBuild(argv[i + 1], argv[i + 2]) ? 0 : 1);
+		}
+		else if (strcmp(argv[i], "--render-rate") == 0 && i + 1 < argc) {
+			i++;
+			if (strcmp(argv[i], "camera") == 0) gRenderDecoupled = FALSE;
+			else if (strcmp(argv[i], "display") == 0) gRenderDecoupled = TRUE;
+			else {
+				ARLOGe("main(): --render-rate takes camera or display.\n");
+				exit(-1);
+			}
+		}
+		else {
+			ARLOGw("main(): Ignoring unknown option %s.\n", argv[i]);
+		}
+	}
+	if (checkKernels) {
+		// Every SIMD variant the CPU can run against the scalar one, then exit.
+		exit(kernelCheck() ? 1 : 0);
+	}
+	if (benchKernels) kernelBenchmark();
+	if (benchUnwarp && !gReplaying) {
+		ARLOGe("main(): --unwarp-bench needs --replay <file>.\n");
+		exit(-1);
+	}
+	if (parallelWorkers >= 0 && (!gReplaying || gMapName)) {
+		ARLOGe("main(): --parallel needs --replay <file>, and does not map.\n");
+		exit(-1);
+	}
 
-	gObj = glmReadOBJ(obj_name);
+	if (groupList) {
+		// Only these groups of an OBJ, through its index (built here the
+		// first time, and again if the OBJ has changed since).
+		for (groupName = strtok(groupList, ","); groupName; groupName = strtok(NULL, ",")) {
+			if (groupNum == GROUPS_MAX) {
+				ARLOGe("main(): --groups takes at most %d names.\n", GROUPS_MAX);
+				exit(-1);
+			}
+			groupNames[groupNum++] = groupName;
+		}
+		indexName = (char *)malloc(strlen(objName) + 6);
+		sprintf(indexName, "%s.gidx", objName);
+		if ((fp = fopen(indexName, "rb")) != NULL) {
+			fclose(fp);
+			gObj = glmReadOBJGroups(objName, indexName, groupNames, groupNum);
+		}
+		else gObj = NULL;
+		if (gObj == NULL && glmWriteOBJIndex(objName, indexName)) {
+			gObj = glmReadOBJGroups(objName, indexName, groupNames, groupNum);
+		}
+		free(indexName);
+	}
+	else gObj = glmReadModel(objName);
 	if (gObj == NULL)
 	{
 		ARLOGe("main(): Unable to load obj model file.\n");
 		exit(-1);
 	}
+	glmReorder(gObj);   // Lay out vertices/triangles for cache locality.
 	glmUnitize(gObj);
 	glmScale(gObj, 1.5*markerSize);
-
-	//
-	// Library inits.
-	//
-
-	glutInit(&argc, argv);
+	gObjDrawable = glmBuildDrawable(gObj, GLM_SMOOTH | GLM_MATERIAL | (tilesName ? GLM_TEXTURE : 0));
+	gObjSplats = glmBuildSplats(gObj);
+	glmInitCommands(&gObjCommands);
+	glmReserveCommands(&gObjCommands, glmCountCommands(gObjDrawable), 1); // Not on the first frame with a marker.
+	posePredictorInit(&gPose, POSE_EXTRAPOLATE, POSE_HORIZON);
+	if (gAllocCheck) {
+		if (!gReplaying) {
+			ARLOGe("main(): --alloc-check needs --replay <file>.\n");
+			exit(-1);
+		}
+		if (!allocTrackAvailable()) {
+			ARLOGe("main(): --alloc-check needs a build with ALLOC_TRACKING defined.\n");
+			exit(2);
+		}
+		stackInit();
+	}
+	if (gSoaking) {
+		// Without a recording, soak on a generated sequence.
+		if (!gReplaying) {
+			if (!frameReplaySynthetic(&gReplay, 640, 480, SOAK_SYNTHETIC_FRAMES, patt_name)) exit(-1);
+			gReplaying = TRUE;
+		}
+		if (!soakInit(soakHours, SOAK_INTERVAL, SOAK_WARMUP, "soak.csv")) exit(-1);
+	}
 
 	//
 	// Video setup.
 	//
 
-	if (!setupCamera(cparam_name, vconf, &gCparamLT, &gARHandle, &gAR3DHandle)) {
+	if (!setupCamera(cparam_name, vconf, &gTracker)) {
 		ARLOGe("main(): Unable to set up AR camera.\n");
 		exit(-1);
 	}
 
-	// Load marker(s).
-	if (!setupMarker(patt_name, &gPatt_id, gARHandle, &gARPattHandle)) {
-		ARLOGe("main(): Unable to set up AR marker.\n");
+	if (!debugOverlayInit(&gDebugOverlay, gTracker.xsize, gTracker.ysize, DEBUG_IMAGE_INTERVAL)) {
 		cleanup();
 		exit(-1);
 	}
 
+	// Load marker(s). Only 1 pattern in this example, unless mapping.
+	if (!gMapName) {
+		if ((gPatt_id = trackerAddPattern(&gTracker, patt_name, gPatt_width)) < 0) {
+			ARLOGe("main(): Unable to set up AR marker.\n");
+			cleanup();
+			exit(-1);
+		}
+	}
+	else {
+		// A saved map brings its markers; a new one starts from ours as the
+		// origin and maps the --patt markers as they are seen with it.
+		if (!markerMapInit()) {
+			cleanup();
+			exit(-1);
+		}
+		if ((fp = fopen(gMapName, "r")) != NULL) {
+			fclose(fp);
+			if (!markerMapLoad(gMapName, &gTracker)) {
+				ARLOGe("main(): Unable to load marker map %s.\n", gMapName);
+				cleanup();
+				exit(-1);
+			}
+		}
+		else {
+			if ((gPatt_id = trackerAddPattern(&gTracker, patt_name, gPatt_width)) < 0 || !markerMapAdd(gPatt_id, patt_name, gPatt_width)) {
+				ARLOGe("main(): Unable to set up AR marker.\n");
+				cleanup();
+				exit(-1);
+			}
+			markerMapSetMapping(TRUE);
+		}
+		for (i = 0; i < pattNum; i++) {
+			if ((pattId = trackerAddPattern(&gTracker, pattNames[i], pattWidths[i])) < 0 || !markerMapAdd(pattId, pattNames[i], pattWidths[i])) {
+				ARLOGe("main(): Unable to add marker %s to the map.\n", pattNames[i]);
+				cleanup();
+				exit(-1);
+			}
+			markerMapSetMapping(TRUE);
+		}
+	}
+
+	if (benchUnwarp) {
+		// Every candidate of one pass through the recording unwarped both
+		// ways, then exit.
+		if ((lumaBuffer = (ARUint8 *)malloc(gTracker.xsize * gTracker.ysize)) == NULL) {
+			ARLOGe("main(): Out of memory!!\n");
+			cleanup();
+			exit(-1);
+		}
+		memset(&unwarpBench, 0, sizeof(unwarpBench));
+		for (i = 0; i < gReplay.frameCount; i++) {
+			if ((image = frameReplayNext(&gReplay)) == NULL) break;
+			if (arDetectMarker(gTracker.arHandle, image) < 0) continue;
+			unwarpBenchFrame(&unwarpBench, gTracker.arHandle, image, lumaBuffer);
+		}
+		free(lumaBuffer);
+		i = unwarpBenchReport(&unwarpBench);
+		cleanup();
+		exit(i ? 0 : 1);
+	}
+	if (parallelWorkers >= 0) {
+		// Every frame of the recording once, then exit.
+		if (parallelWorkers == 0) parallelWorkers = parallelReplayDefaultWorkers();
+		i = parallelPoses(cparam_name, patt_name, parallelWorkers, "poses.csv");
+		cleanup();
+		exit(i ? 0 : 1);
+	}
+
 	//
 	// Graphics setup.
 	//
@@ -166,13 +491,50 @@ int main(int argc, char** argv)
 	}
 
 	// Setup ARgsub_lite library for current OpenGL context.
-	if ((gArglSettings = arglSetupForCurrentContext(&(gCparamLT->param), arVideoGetPixelFormat())) == NULL) {
+	if ((gArglSettings = arglSetupForCurrentContext(&(gTracker.paramLT->param), gTracker.pixFormat)) == NULL) {
 		ARLOGe("main(): arglSetupForCurrentContext() returned error.\n");
 		cleanup();
 		exit(-1);
 	}
-	arglSetupDebugMode(gArglSettings, gARHandle);
+	arglSetupDebugMode(gArglSettings, gTracker.arHandle);
+	// YUV video is converted in a shader if asked for and the GL has
+	// them; argl, the default, stays set up for comparison and for the
+	// other formats.
+	if (!yuvBackgroundFormatSupported(gTracker.pixFormat) ||
+		!yuvBackgroundInit(&gYuvBackground, gTracker.xsize, gTracker.ysize, gTracker.pixFormat)) {
+		gBackgroundShader = FALSE;
+	}
 	arUtilTimerReset();
+	glmUploadDrawable(gObjDrawable);
+	glmUploadSplats(gObjSplats);
+	if (tilesName && !tileTextureOpen(&gTiles, tilesName, gObj)) {
+		ARLOGw("main(): Drawing the model untextured.\n");
+	}
+	if (!gpuTimerInit(gpuTimerResult)) {
+		ARLOGw("main(): GPU timer queries not available.\n");
+	}
+	pacingInit(pacing, framesAhead);
+	impostorLODInit(&gImpostorLOD, IMPOSTOR_THRESHOLD, IMPOSTOR_FADE);
+	if (!impostorBuild(&gImpostor, gObjDrawable, IMPOSTOR_TILE)) {
+		if (gImpostorBench) {
+			ARLOGe("main(): --impostor-bench needs framebuffer objects.\n");
+			cleanup();
+			exit(-1);
+		}
+		impostorLODSetPolicy(&gImpostorLOD, IMPOSTOR_MESH_ONLY);
+	}
+
+	// Profile the GLUT thread.
+	if (PROFILER_HZ > 0) {
+		if (!profilerInit(PROFILER_HZ, PROFILER_SLOTS) || !profilerAddThread("main")) {
+			ARLOGw("main(): Sampling profiler not available.\n");
+		}
+	}
+
+	// Watch the GLUT callbacks, which all run on this thread.
+	if (!watchdogInit(STALL_BUDGET, "stall-", STALL_INCIDENTS, describeSettings)) {
+		ARLOGw("main(): Stall watchdog not available.\n");
+	}
 
 
 	// Register GLUT event-handling callbacks.
@@ -188,14 +550,52 @@ int main(int argc, char** argv)
 }
 
 // Something to look at, draw a rotating object loaded from file.
+// The commands were recorded by DrawObjPrepare(); this only executes them.
 static void DrawObj(void)
 {
-	glPushMatrix(); // Save world coordinate system.
-	glRotatef(gDrawRotateAngle, 0.0f, 0.0f, 1.0f); // Rotate about z axis.	
-	glTranslatef(0.0f, 0.0f, markerSize / 2.0); // Place base of object on marker surface.
+	glmSubmit(&gObjCommands);
+}
+
+// Record the draw commands for the object. Makes no GL calls, so it can run
+// off the GL thread (one command list per thread).
+static void DrawObjPrepare(void)
+{
+	GLfloat m[16];
+	float a = gDrawRotateAngle * (float)M_PI / 180.0f;
+
+	// Rotate about z axis, then place base of object on marker surface.
+	m[0] = cosf(a);  m[4] = -sinf(a); m[8]  = 0.0f; m[12] = 0.0f;
+	m[1] = sinf(a);  m[5] = cosf(a);  m[9]  = 0.0f; m[13] = 0.0f;
+	m[2] = 0.0f;     m[6] = 0.0f;     m[10] = 1.0f; m[14] = markerSize / 2.0f;
+	m[3] = 0.0f;     m[7] = 0.0f;     m[11] = 0.0f; m[15] = 1.0f;
+
+	glmResetCommands(&gObjCommands);
+	glmPrepare(gObjDrawable, m, &gObjCommands);
+	memcpy(gObjTransform, m, sizeof(gObjTransform));
+}
 
-	glmDraw(gObj, GLM_SMOOTH | GLM_MATERIAL);
-	glPopMatrix();    // Restore world coordinate system.
+// The object as points, gSplatCount of them, sized for the distance.
+static void DrawSplats(const GLfloat projection[16], float distance)
+{
+	glPushMatrix();
+	glMultMatrixf(gObjTransform);
+	glmDrawSplats(gObjSplats, gSplatCount, projection[5] * (float)windowHeight / 2.0f, distance);
+	glPopMatrix();
+}
+
+// Projected diameter in pixels of the object's bounding sphere, and its
+// eye distance.
+static float objScreenSize(const GLfloat view[16], const GLfloat projection[16], float *distance)
+{
+	const GLfloat *c = gObjSplats->center, *t = gObjTransform;
+	GLfloat x, y, z;
+
+	x = t[0]*c[0] + t[4]*c[1] + t[8]*c[2] + t[12];
+	y = t[1]*c[0] + t[5]*c[1] + t[9]*c[2] + t[13];
+	z = t[2]*c[0] + t[6]*c[1] + t[10]*c[2] + t[14];
+	*distance = -(view[2]*x + view[6]*y + view[10]*z + view[14]);
+	if (*distance <= gObjSplats->radius) return ((float)windowHeight);
+	return (gObjSplats->radius * projection[5] * (float)windowHeight / *distance);
 }
 
 static void DrawObjUpdate(float timeDelta)
@@ -206,71 +606,57 @@ static void DrawObjUpdate(float timeDelta)
 	}
 }
 
-static int setupCamera(const char *cparam_name, char *vconf, ARParamLT **cparamLT_p, ARHandle **arhandle, AR3DHandle **ar3dhandle)
+static int setupCamera(const char *cparam_name, const char *vconf, TrackerContext *tc)
 {
-	ARParam			cparam;
+	TrackerSettings	settings;
 	int				xsize, ysize;
 	AR_PIXEL_FORMAT pixFormat;
 
-	// Open the video path.
-	if (arVideoOpen(vconf) < 0) {
-		ARLOGe("setupCamera(): Unable to open connection to camera.\n");
-		return (FALSE);
-	}
-
-	// Find the size of the window.
-	if (arVideoGetSize(&xsize, &ysize) < 0) {
-		ARLOGe("setupCamera(): Unable to determine camera frame size.\n");
-		arVideoClose();
-		return (FALSE);
-	}
-	ARLOGi("Camera image size (x,y) = (%d,%d)\n", xsize, ysize);
-
-	// Get the format in which the camera is returning pixels.
-	pixFormat = arVideoGetPixelFormat();
-	if (pixFormat == AR_PIXEL_FORMAT_INVALID) {
-		ARLOGe("setupCamera(): Camera is using unsupported pixel format.\n");
-		arVideoClose();
-		return (FALSE);
+	if (gReplaying) {
+		// The recording stands in for the camera.
+		xsize = gReplay.xsize;
+		ysize = gReplay.ysize;
+		pixFormat = gReplay.pixFormat;
+		ARLOGi("Replaying %d frames of (x,y) = (%d,%d)\n", gReplay.frameCount, xsize, ysize);
 	}
+	else {
+		// Open the video path.
+		if (arVideoOpen(vconf) < 0) {
+			ARLOGe("setupCamera(): Unable to open connection to camera.\n");
+			return (FALSE);
+		}
 
-	// Load the camera parameters, resize for the window and init.
-	if (arParamLoad(cparam_name, 1, &cparam) < 0) {
-		ARLOGe("setupCamera(): Error loading parameter file %s for camera.\n", cparam_name);
-		arVideoClose();
-		return (FALSE);
-	}
-	if (cparam.xsize != xsize || cparam.ysize != ysize) {
-		ARLOGw("*** Camera Parameter resized from %d, %d. ***\n", cparam.xsize, cparam.ysize);
-		arParamChangeSize(&cparam, xsize, ysize, &cparam);
-	}
-#ifdef DEBUG
-	ARLOG("*** Camera Parameter ***\n");
-	arParamDisp(&cparam);
-#endif
-	if ((*cparamLT_p = arParamLTCreate(&cparam, AR_PARAM_LT_DEFAULT_OFFSET)) == NULL) {
-		ARLOGe("setupCamera(): Error: arParamLTCreate.\n");
-		return (FALSE);
+		// Find the size of the window.
+		if (arVideoGetSize(&xsize, &ysize) < 0) {
+			ARLOGe("setupCamera(): Unable to determine camera frame size.\n");
+			arVideoClose();
+			return (FALSE);
+		}
+		ARLOGi("Camera image size (x,y) = (%d,%d)\n", xsize, ysize);
+
+		// Get the format in which the camera is returning pixels.
+		pixFormat = arVideoGetPixelFormat();
+		if (pixFormat == AR_PIXEL_FORMAT_INVALID) {
+			ARLOGe("setupCamera(): Camera is using unsupported pixel format.\n");
+			arVideoClose();
+			return (FALSE);
+		}
 	}
 
-	if ((*arhandle = arCreateHandle(*cparamLT_p)) == NULL) {
-		ARLOGe("setupCamera(): Error: arCreateHandle.\n");
-		return (FALSE);
-	}
-	if (arSetPixelFormat(*arhandle, pixFormat) < 0) {
-		ARLOGe("setupCamera(): Error: arSetPixelFormat.\n");
-		return (FALSE);
-	}
-	if (arSetDebugMode(*arhandle, AR_DEBUG_DISABLE) < 0) {
-		ARLOGe("setupCamera(): Error: arSetDebugMode.\n");
-		return (FALSE);
-	}
-	if ((*ar3dhandle = ar3DCreateHandle(&cparam)) == NULL) {
-		ARLOGe("setupCamera(): Error: ar3DCreateHandle.\n");
+	// The camera parameters, ARToolKit handles and detection helpers.
+	memset(&settings, 0, sizeof(settings));
+	settings.cparamName = cparam_name;
+	settings.xsize = xsize;
+	settings.ysize = ysize;
+	settings.pixFormat = pixFormat;
+	settings.bitLabelMode = 1;
+	settings.stage = frameStage;
+	if (!trackerInit(tc, &settings)) {
+		if (!gReplaying) arVideoClose();
 		return (FALSE);
 	}
 
-	if (arVideoCapStart() != 0) {
+	if (!gReplaying && arVideoCapStart() != 0) {
 		ARLOGe("setupCamera(): Unable to begin camera data capture.\n");
 		return (FALSE);
 	}
@@ -278,25 +664,6 @@ static int setupCamera(const char *cparam_name, char *vconf, ARParamLT **cparamL
 	return (TRUE);
 }
 
-static int setupMarker(const char *patt_name, int *patt_id, ARHandle *arhandle, ARPattHandle **pattHandle_p)
-{
-	if ((*pattHandle_p = arPattCreateHandle()) == NULL) {
-		ARLOGe("setupMarker(): Error: arPattCreateHandle.\n");
-		return (FALSE);
-	}
-
-	// Loading only 1 pattern in this example.
-	if ((*patt_id = arPattLoad(*pattHandle_p, patt_name)) < 0) {
-		ARLOGe("setupMarker(): Error loading pattern file %s.\n", patt_name);
-		arPattDeleteHandle(*pattHandle_p);
-		return (FALSE);
-	}
-
-	arPattAttach(arhandle, *pattHandle_p);
-
-	return (TRUE);
-}
-
 static void Keyboard(unsigned char key, int x, int y)
 {
 	int mode, threshChange = 0;
@@ -314,13 +681,13 @@ static void Keyboard(unsigned char key, int x, int y)
 		break;
 	case 'X':
 	case 'x':
-		arGetImageProcMode(gARHandle, &mode);
+		arGetImageProcMode(gTracker.arHandle, &mode);
 		switch (mode) {
 		case AR_IMAGE_PROC_FRAME_IMAGE:  mode = AR_IMAGE_PROC_FIELD_IMAGE; break;
 		case AR_IMAGE_PROC_FIELD_IMAGE:
 		default: mode = AR_IMAGE_PROC_FRAME_IMAGE; break;
 		}
-		arSetImageProcMode(gARHandle, mode);
+		arSetImageProcMode(gTracker.arHandle, mode);
 		break;
 	case 'C':
 	case 'c':
@@ -340,7 +707,7 @@ static void Keyboard(unsigned char key, int x, int y)
 		break;
 	case 'a':
 	case 'A':
-		arGetLabelingThreshMode(gARHandle, &modea);
+		arGetLabelingThreshMode(gTracker.arHandle, &modea);
 		switch (modea) {
 		case AR_LABELING_THRESH_MODE_MANUAL:        modea = AR_LABELING_THRESH_MODE_AUTO_MEDIAN; break;
 		case AR_LABELING_THRESH_MODE_AUTO_MEDIAN:   modea = AR_LABELING_THRESH_MODE_AUTO_OTSU; break;
@@ -348,7 +715,7 @@ static void Keyboard(unsigned char key, int x, int y)
 		case AR_LABELING_THRESH_MODE_AUTO_ADAPTIVE:
 		default: modea = AR_LABELING_THRESH_MODE_MANUAL; break;
 		}
-		arSetLabelingThreshMode(gARHandle, modea);
+		arSetLabelingThreshMode(gTracker.arHandle, modea);
 		break;
 	case '-':
 		threshChange = -5;
@@ -359,8 +726,7 @@ static void Keyboard(unsigned char key, int x, int y)
 		break;
 	case 'D':
 	case 'd':
-		arGetDebugMode(gARHandle, &mode);
-		arSetDebugMode(gARHandle, !mode);
+		debugOverlaySetMode(&gDebugOverlay, (DEBUG_OVERLAY_MODE)((gDebugOverlay.mode + 1) % DEBUG_OVERLAY_MODE_COUNT));
 		break;
 	case 's':
 	case 'S':
@@ -375,16 +741,86 @@ static void Keyboard(unsigned char key, int x, int y)
 	case 'M':
 		gShowMode = !gShowMode;
 		break;
+	case 'b':
+	case 'B':
+		gTracker.bitLabelMode = (gTracker.bitLabelMode + 1) % 3;
+		gTracker.bitLabelChecks = gTracker.bitLabelMismatches = 0;
+		break;
+	case 'f':
+	case 'F':
+		{
+			static int profileNumber = 0;
+			char profileName[32];
+			long samples;
+			sprintf(profileName, "profile-%02d.folded", profileNumber++);
+			if ((samples = profilerDump(profileName)) >= 0) {
+				ARLOGi("Wrote %ld profiler samples to %s (%ld overwritten).\n", samples, profileName, profilerDropped());
+			}
+		}
+		break;
+	case 'r':
+	case 'R':
+		if (gRecorder.fp) {
+			ARLOGi("Recorded %d frames.\n", gRecorder.frameCount);
+			frameRecordClose(&gRecorder);
+		}
+		else if (!gReplaying) {
+			static int recordNumber = 0;
+			char recordName[32];
+			sprintf(recordName, "frames-%02d.arfr", recordNumber++);
+			if (frameRecordOpen(&gRecorder, recordName, gTracker.xsize, gTracker.ysize, gTracker.pixFormat)) {
+				ARLOGi("Recording frames to %s.\n", recordName);
+			}
+		}
+		break;
+	case 'v':
+	case 'V':
+		pacingSetMode((PACING_MODE)((pacingMode() + 1) % PACING_MODE_COUNT));
+		break;
+	case 'o':
+	case 'O':
+		gSplatMode = (gSplatMode + 1) % 3;
+		break;
+	case 'i':
+	case 'I':
+		if (gImpostor.texture) impostorLODSetPolicy(&gImpostorLOD, (IMPOSTOR_POLICY)((gImpostorLOD.policy + 1) % IMPOSTOR_POLICY_COUNT));
+		break;
+	case 'e':
+	case 'E':
+		// Camera rate, then display rate holding, interpolating and extrapolating the pose.
+		if (!gRenderDecoupled) {
+			gRenderDecoupled = TRUE;
+			posePredictorSetMode(&gPose, POSE_HOLD);
+		}
+		else if (gPose.mode + 1 < POSE_MODE_COUNT) posePredictorSetMode(&gPose, (POSE_MODE)(gPose.mode + 1));
+		else gRenderDecoupled = FALSE;
+		break;
+	case 'g':
+	case 'G':
+		if (gMapName) markerMapSetMapping(!markerMapMapping());
+		break;
+	case 'w':
+	case 'W':
+		if (gMapName) markerMapSave(gMapName);
+		break;
+	case 'y':
+	case 'Y':
+		if (gYuvBackground.program) gBackgroundShader = !gBackgroundShader;
+		break;
+	case 'p':
+	case 'P':
+		presenceSetPolicy(&gTracker.presence, (PRESENCE_POLICY)((gTracker.presence.settings.policy + 1) % PRESENCE_POLICY_COUNT));
+		break;
 	default:
 		break;
 	}
 	if (threshChange) {
 		int threshhold;
-		arGetLabelingThresh(gARHandle, &threshhold);
+		arGetLabelingThresh(gTracker.arHandle, &threshhold);
 		threshhold += threshChange;
 		if (threshhold < 0) threshhold = 0;
 		if (threshhold > 255) threshhold = 255;
-		arSetLabelingThresh(gARHandle, threshhold);
+		arSetLabelingThresh(gTracker.arHandle, threshhold);
 	}
 
 }
@@ -396,9 +832,15 @@ static void mainLoop(void)
 	int ms;
 	float s_elapsed;
 	ARUint8 *image;
-	ARdouble err;
+	TrackerFrame frame;
+	TrackerPose poses[TRACKER_PATTERN_MAX];
+	int             j, num, flagged;
+	long            detected;
+	double captured;
 
-	int             j, k;
+	// At the display's rate, draw on every pass; with vsync the swap holds
+	// Display() to the refresh rate, and without it RENDER_RATE_MAX does.
+	if (gRenderDecoupled && timingNow() - gRenderLast >= 1.0 / RENDER_RATE_MAX) glutPostRedisplay();
 
 	// Find out how long since mainLoop() last ran.
 	ms = glutGet(GLUT_ELAPSED_TIME);
@@ -406,17 +848,29 @@ static void mainLoop(void)
 	if (s_elapsed < 0.01f) return; // Don't update more often than 100 Hz.
 	ms_prev = ms;
 
-	// Update drawing.
-	DrawObjUpdate(s_elapsed);
+	// In wait mode, hold off until just before the next vblank.
+	pacingWaitForStart();
+
+	frameBegin("mainLoop");
+
+	// Update drawing. At the display's rate, Display() does this.
+	if (!gRenderDecoupled) DrawObjUpdate(s_elapsed);
 
 	// Grab a video frame.
-	if ((image = arVideoGetImage()) != NULL) {
+	frameStage("arVideoGetImage");
+	if (gReplaying) image = replayGetImage();
+	else image = arVideoGetImage();
+	if (image != NULL) {
 		gARTImage = image;	// Save the fetched image.
+		captured = timingNow();
+		gRateFrames++;
+		pacingCaptured();
+		if (gRecorder.fp) frameRecordWrite(&gRecorder, gARTImage);
 
 		if (gARTImageSavePlease) {
 			char imageNumberText[15];
 			sprintf(imageNumberText, "image-%04d.jpg", imageNumber++);
-			if (arVideoSaveImageJPEG(gARHandle->xsize, gARHandle->ysize, gARHandle->arPixelFormat, gARTImage, imageNumberText, 75, 0) < 0) {
+			if (arVideoSaveImageJPEG(gTracker.xsize, gTracker.ysize, gTracker.pixFormat, gARTImage, imageNumberText, 75, 0) < 0) {
 				ARLOGe("Error saving video image.\n");
 			}
 			gARTImageSavePlease = FALSE;
@@ -424,33 +878,262 @@ static void mainLoop(void)
 
 		gCallCountMarkerDetect++; // Increment ARToolKit FPS counter.
 
-		// Detect the markers in the video frame.
-		if (arDetectMarker(gARHandle, gARTImage) < 0) {
+		// Detect the markers in the video frame, and get the transformation
+		// between our marker and the real camera into gPatt_trans. While the
+		// marker has been absent for a while the tracker skips frames; the
+		// video is still redrawn.
+		frame.data = gARTImage;
+		frame.stride = 0;
+		frame.pixFormat = gTracker.pixFormat;
+		detected = gTracker.framesDetected;
+		gTracker.debugImage = debugOverlayWantsImage(&gDebugOverlay);
+		if ((num = trackerProcess(&gTracker, &frame, poses, TRACKER_PATTERN_MAX)) < 0) {
 			exit(-1);
 		}
-
-		// Check through the marker_info array for highest confidence
-		// visible marker matching our preferred pattern.
-		k = -1;
-		for (j = 0; j < gARHandle->marker_num; j++) {
-			if (gARHandle->markerInfo[j].id == gPatt_id) {
-				if (k == -1) k = j; // First marker detected.
-				else if (gARHandle->markerInfo[j].cf > gARHandle->markerInfo[k].cf) k = j; // Higher confidence marker detected.
+		debugOverlayAfterDetect(&gDebugOverlay, gTracker.arHandle, gTracker.framesDetected != detected);
+		gPatt_found = FALSE;
+		if (gMapName) {
+			// The pose of the whole map, from every marker on it in view.
+			if (num > 0) {
+				frameStage("markerMap");
+				markerMapObserve(poses, num);
+				gPatt_found = markerMapSolve(gTracker.ar3DHandle, gTracker.arHandle->markerInfo, gTracker.arHandle->marker_num, gPatt_trans);
 			}
 		}
-
-		if (k != -1) {
-			// Get the transformation between the marker and the real camera into gPatt_trans.
-			err = arGetTransMatSquare(gAR3DHandle, &(gARHandle->markerInfo[k]), gPatt_width, gPatt_trans);
-			gPatt_found = TRUE;
-		}
 		else {
-			gPatt_found = FALSE;
+			for (j = 0; j < num; j++) {
+				if (poses[j].id == gPatt_id) {
+					memcpy(gPatt_trans, poses[j].trans, sizeof(gPatt_trans));
+					gPatt_found = TRUE;
+				}
+			}
+		}
+		if (gPatt_found) posePredictorAdd(&gPose, gPatt_trans, captured);
+		else posePredictorLost(&gPose);
+		if (gPatt_found && !gRenderDecoupled) {
+			frameStage("DrawObjPrepare");
+			DrawObjPrepare();
 		}
 
 		// Tell GLUT the display has changed.
 		glutPostRedisplay();
 	}
+	frameEnd();
+
+	if (gSoaking && !soakUpdate()) {
+		flagged = soakReport();
+		cleanup();
+		exit(flagged ? 1 : 0);
+	}
+}
+
+// The next replayed frame. While soaking the source is paced like a
+// camera: NULL until the next frame is due, and frames that came due
+// while the pipeline was busy are skipped and counted as dropped.
+static ARUint8 *replayGetImage(void)
+{
+	long due, dropped;
+
+	if (!gSoaking) return frameReplayNext(&gReplay);
+	if (gSourceStart == 0.0) gSourceStart = timingNow();
+	due = (long)((timingNow() - gSourceStart) * SOAK_SOURCE_FPS) + 1;
+	if (due <= gSourceDelivered) return (NULL);
+	for (dropped = 0; gSourceDelivered < due - 1; dropped++, gSourceDelivered++) frameReplayNext(&gReplay);
+	gSourceDelivered++;
+	soakSourceFrames(1, dropped);
+	return frameReplayNext(&gReplay);
+}
+
+// Begin, mark a stage of and end one iteration of mainLoop() or
+// Display(): the stall watchdog's frame, the soak stage timings, and
+// under --alloc-check an allocation count.
+static void frameBegin(const char *name)
+{
+	gFrameName = name;
+	watchdogFrameBegin(name);
+	soakFrameBegin(name);
+	if (gAllocCheck) allocTrackBegin();
+}
+
+static void frameStage(const char *stage)
+{
+	watchdogStage(stage);
+	soakStage(stage);
+	gpuTimerPass(stage);    // Only between gpuTimerFrameBegin() and gpuTimerFrameEnd().
+}
+
+// GPU pass times arrive a few frames late; they go to the soak next to
+// the CPU stages of the same name.
+static void gpuTimerResult(const char *pass, double seconds)
+{
+	soakGpuPass(pass ? pass : "Display", seconds);
+}
+
+static void frameEnd(void)
+{
+	void *pcs[ALLOC_STACK_MAX];
+	char symbol[256];
+	long count;
+	int i, n;
+
+	count = gAllocCheck ? allocTrackEnd() : 0;
+	watchdogFrameEnd();
+	soakFrameEnd();
+	if (!gAllocCheck) return;
+
+	// The first pass over the recording warms up; verify mode allocates
+	// its reference buffers by design.
+	if (gReplay.served <= gReplay.frameCount || gTracker.bitLabelMode == 2 || count == 0) return;
+	gAllocViolations++;
+	ARLOGe("%s() allocated %ld times in steady state (frame %ld), first at:\n", gFrameName, count, gReplay.served);
+	n = allocTrackFirstStack(pcs, ALLOC_STACK_MAX);
+	for (i = 0; i < n; i++) {
+		stackSymbol(pcs[i], symbol, sizeof(symbol));
+		ARLOGe("    %s\n", symbol);
+	}
+}
+
+// Frame time of the mesh and of its impostor against marker distance,
+// written to csv_name. The marker faces the camera tilted back 45 degrees,
+// as it usually is; each frame is finished before the next so the times
+// are what a frame of each costs.
+static void impostorBenchmark(const char *csv_name)
+{
+	ARdouble p[16];
+	GLfloat pf[16], view[16];
+	FILE *fp;
+	double distance, t0, meshMs, impostorMs;
+	float pixels;
+	int i, pass;
+	const float c = cosf((float)M_PI / 4.0f), s = sinf((float)M_PI / 4.0f);
+
+	if ((fp = fopen(csv_name, "w")) == NULL) {
+		ARLOGe("impostorBenchmark(): Unable to open %s.\n", csv_name);
+		return;
+	}
+	fprintf(fp, "distance_mm,pixels,mesh_ms,impostor_ms\n");
+
+	arglCameraFrustumRH(&(gTracker.paramLT->param), VIEW_DISTANCE_MIN, VIEW_DISTANCE_MAX, p);
+	for (i = 0; i < 16; i++) pf[i] = (GLfloat)p[i];
+	glMatrixMode(GL_PROJECTION);
+	glLoadMatrixf(pf);
+	glMatrixMode(GL_MODELVIEW);
+	glEnable(GL_LIGHTING);
+	glEnable(GL_LIGHT0);
+	glEnable(GL_DEPTH_TEST);
+	gDrawRotateAngle = 0.0f;
+	DrawObjPrepare();
+
+	// Rotated about x, then pushed away down -z.
+	memset(view, 0, sizeof(view));
+	view[0] = 1.0f;
+	view[5] = c;  view[6] = s;
+	view[9] = -s; view[10] = c;
+	view[15] = 1.0f;
+
+	for (distance = 100.0; distance <= 5000.0; distance *= 1.1) {
+		view[14] = (GLfloat)-distance;
+		pixels = impostorScreenSize(&gImpostor, view, gObjTransform, pf, windowHeight);
+		meshMs = impostorMs = 0.0;
+		for (pass = 0; pass < 2; pass++) {
+			t0 = timingNow();
+			for (i = 0; i < IMPOSTOR_BENCH_FRAMES; i++) {
+				glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+				glLoadMatrixf(view);
+				if (pass == 0) DrawObj();
+				else impostorDraw(&gImpostor, view, gObjTransform, 1.0f);
+				glFinish();
+			}
+			if (pass == 0) meshMs = (timingNow() - t0) * 1000.0 / IMPOSTOR_BENCH_FRAMES;
+			else impostorMs = (timingNow() - t0) * 1000.0 / IMPOSTOR_BENCH_FRAMES;
+		}
+		fprintf(fp, "%0.0f,%0.1f,%0.4f,%0.4f\n", distance, pixels, meshMs, impostorMs);
+		ARLOGi("%6.0f mm %6.1f px: mesh %0.3f ms, impostor %0.3f ms.\n", distance, pixels, meshMs, impostorMs);
+	}
+	fclose(fp);
+	ARLOGi("Wrote impostor benchmark to %s.\n", csv_name);
+}
+
+// --parallel: the sequential pass over the workers' results. Poses go
+// through the pose predictor in frame order, as they would live: a
+// frame without the marker is lost, and the predictor starts over.
+typedef struct {
+	FILE            *fp;
+	PosePredictor   pose;
+	long            detected;
+} ParallelPass;
+
+static void parallelResult(const ParallelResult *result, void *arg)
+{
+	ParallelPass *pass = (ParallelPass *)arg;
+	ARdouble trans[3][4];
+	double time = result->frame / PARALLEL_SOURCE_FPS;
+	const char *state = "lost";
+	int j, k, found = FALSE;
+
+	for (j = 0; j < result->num; j++) {
+		if (result->poses[j].id == gPatt_id) {
+			posePredictorAdd(&pass->pose, result->poses[j].trans, time);
+			found = TRUE;
+		}
+	}
+	if (found && posePredictorGet(&pass->pose, time, trans)) {
+		state = "detected";
+		pass->detected++;
+	}
+	else posePredictorLost(&pass->pose);
+
+	fprintf(pass->fp, "%ld,%s", result->frame, state);
+	for (j = 0; j < 3; j++) for (k = 0; k < 4; k++) {
+		if (strcmp(state, "lost") == 0) fprintf(pass->fp, ",");
+		else fprintf(pass->fp, ",%0.4f", (double)trans[j][k]);
+	}
+	fprintf(pass->fp, "\n");
+}
+
+// The marker pose in every frame of the recording, detected on workers
+// threads and written to csv_name in frame order. FALSE on error.
+static int parallelPoses(const char *cparam_name, const char *patt_name, int workers, const char *csv_name)
+{
+	ParallelPass pass;
+	ParallelStats stats;
+	const char *pattNames[1] = { patt_name };
+	ARdouble pattWidths[1] = { gPatt_width };
+	int ok;
+
+	if ((pass.fp = fopen(csv_name, "w")) == NULL) {
+		ARLOGe("parallelPoses(): Unable to open %s.\n", csv_name);
+		return (FALSE);
+	}
+	fprintf(pass.fp, "frame,state,m00,m01,m02,m03,m10,m11,m12,m13,m20,m21,m22,m23\n");
+	posePredictorInit(&pass.pose, POSE_EXTRAPOLATE, POSE_HORIZON);
+	pass.detected = 0;
+
+	ok = parallelReplayRun(&gReplay, &gTracker, cparam_name, pattNames, pattWidths, 1, workers, parallelResult, &pass, &stats);
+	fclose(pass.fp);
+	if (!ok) return (FALSE);
+	parallelReplayReport(&stats);
+	ARLOGi("Wrote poses of %ld frames (%ld detected) to %s.\n", stats.frames, pass.detected, csv_name);
+	return (stats.errors == 0);
+}
+
+// Snapshot of the settings for stall incident files.
+static void describeSettings(char *buf, size_t size)
+{
+	int mode, thresh, len;
+	AR_LABELING_THRESH_MODE threshMode;
+
+	arGetImageProcMode(gTracker.arHandle, &mode);
+	arGetLabelingThreshMode(gTracker.arHandle, &threshMode);
+	arGetLabelingThresh(gTracker.arHandle, &thresh);
+	len = snprintf(buf, size, "imageProcMode=%d\nthreshMode=%d\nthresh=%d\n", mode, (int)threshMode, thresh);
+	if (len < 0 || (size_t)len >= size) return;
+	len += snprintf(buf + len, size - len, "drawMode=%d\ntexmapMode=%d\nwindow=%dx%d\n",
+		arglDrawModeGet(gArglSettings), arglTexmapModeGet(gArglSettings), windowWidth, windowHeight);
+	if (len < 0 || (size_t)len >= size) return;
+	snprintf(buf + len, size - len, "presencePolicy=%s%s\nbitLabelMode=%d\npacing=%s\nmarkerFound=%d\n",
+		presencePolicyName(gTracker.presence.settings.policy), gTracker.presence.idle ? " (idle)" : "", gTracker.bitLabelMode,
+		pacingModeName(pacingMode()), gPatt_found);
 }
 
 //
@@ -475,16 +1158,58 @@ static void Display(void)
 {
 	ARdouble p[16];
 	ARdouble m[16];
+	ARdouble trans[3][4];
+	GLfloat pf[16], mf[16];
+	float w, pixels, area, distance;
+	double now, backgroundStart;
+	int i, found;
+
+	if (gImpostorBench) {
+		impostorBenchmark("impostor-bench.csv");
+		cleanup();
+		exit(0);
+	}
+
+	frameBegin("Display");
+	gpuTimerFrameBegin();
+
+	// At the display's rate the model turns and moves per drawing, not per
+	// camera frame.
+	now = timingNow();
+	if (gRenderDecoupled && gRenderLast > 0.0) DrawObjUpdate((float)(now - gRenderLast));
+	gRenderLast = now;
+	gRateRenders++;
+	if (now - gRateStart >= 1.0) {
+		if (gRateStart > 0.0) {
+			gRenderFps = (float)(gRateRenders / (now - gRateStart));
+			gCameraFps = (float)(gRateFrames / (now - gRateStart));
+		}
+		gRateStart = now;
+		gRateRenders = gRateFrames = 0;
+	}
 
 	// Select correct buffer for this context.
 	glDrawBuffer(GL_BACK);
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT); // Clear the buffers for new frame.
 
-	arglDispImage(gARTImage, &(gCparamLT->param), 1.0, gArglSettings);	// zoom = 1.0.
-	gARTImage = NULL; // Invalidate image data.
+	// The video is uploaded only when a new frame has come in; otherwise
+	// the texture from last time is drawn again. glDrawPixels() keeps
+	// nothing, so it is given the last frame every time.
+	frameStage(gBackgroundShader ? "yuvBackground" : "arglDispImage");
+	backgroundStart = timingNow();
+	if (gARTImage) {
+		if (gBackgroundShader) yuvBackgroundUpload(&gYuvBackground, gARTImage);
+		else if (arglDrawModeGet(gArglSettings) != AR_DRAW_BY_GL_DRAW_PIXELS) arglPixelBufferDataUpload(gArglSettings, gARTImage);
+		gARTImageShown = gARTImage;
+		gARTImage = NULL; // Invalidate image data.
+	}
+	if (gBackgroundShader) yuvBackgroundDraw(&gYuvBackground);
+	else arglDispImage(arglDrawModeGet(gArglSettings) == AR_DRAW_BY_GL_DRAW_PIXELS ? gARTImageShown : NULL,
+		&(gTracker.paramLT->param), 1.0, gArglSettings);	// zoom = 1.0.
+	gBackgroundCpu[gBackgroundShader] += (timingNow() - backgroundStart - gBackgroundCpu[gBackgroundShader]) * BACKGROUND_CPU_SMOOTHING;
 
 	// Projection transformation.
-	arglCameraFrustumRH(&(gCparamLT->param), VIEW_DISTANCE_MIN, VIEW_DISTANCE_MAX, p);
+	arglCameraFrustumRH(&(gTracker.paramLT->param), VIEW_DISTANCE_MIN, VIEW_DISTANCE_MAX, p);
 	glMatrixMode(GL_PROJECTION);
 #ifdef ARDOUBLE_IS_FLOAT
 	glLoadMatrixf(p);
@@ -503,11 +1228,25 @@ static void Display(void)
 	glEnable(GL_LIGHT0);
 	glEnable(GL_DEPTH_TEST);
 
-	if (gPatt_found) {
+	// The marker pose for this drawing: as detected at the camera's rate,
+	// or predicted for now from the last detections at the display's.
+	if (gRenderDecoupled) {
+		found = posePredictorGet(&gPose, now, trans);
+		if (found) {
+			frameStage("DrawObjPrepare");
+			DrawObjPrepare();
+		}
+	}
+	else {
+		found = gPatt_found;
+		memcpy(trans, gPatt_trans, sizeof(trans));
+	}
+
+	if (found) {
 
 		// Calculate the camera position relative to the marker.
 		// Replace VIEW_SCALEFACTOR with 1.0 to make one drawing unit equal to 1.0 ARToolKit units (usually millimeters).
-		arglCameraViewRH(gPatt_trans, m, VIEW_SCALEFACTOR);
+		arglCameraViewRH(trans, m, VIEW_SCALEFACTOR);
 #ifdef ARDOUBLE_IS_FLOAT
 		glLoadMatrixf(m);
 #else
@@ -515,11 +1254,48 @@ static void Display(void)
 #endif
 
 		// All lighting and geometry to be drawn relative to the marker goes here.
-		DrawObj();
+		// Small on screen, the model is drawn as an impostor, cross-fading
+		// from the mesh. With more triangles than pixels to cover, the
+		// mesh is drawn as points, as many as there are pixels to fill.
+		for (i = 0; i < 16; i++) {
+			pf[i] = (GLfloat)p[i];
+			mf[i] = (GLfloat)m[i];
+		}
+		w = 0.0f;
+		if (gImpostor.texture) {
+			w = impostorLODWeight(&gImpostorLOD, impostorScreenSize(&gImpostor, mf, gObjTransform, pf, windowHeight), timingNow());
+		}
+		pixels = objScreenSize(mf, pf, &distance);
+		area = (float)M_PI * pixels * pixels / 4.0f;
+		gSplatDensity = area > 0.0f ? (float)gObj->numtriangles / area : 0.0f;
+		if (gSplatMode == 1) gSplatting = FALSE;
+		else if (gSplatMode == 2) gSplatting = TRUE;
+		else if (gSplatDensity > SPLAT_DENSITY) gSplatting = TRUE;
+		else if (gSplatDensity < SPLAT_DENSITY * SPLAT_HYSTERESIS) gSplatting = FALSE;
+		gSplatCount = gObjSplats->numpoints;
+		if (SPLAT_POINTS_PER_PIXEL * area < gSplatCount) gSplatCount = (GLuint)(SPLAT_POINTS_PER_PIXEL * area) + 1;
+		if (w < 1.0f) {
+			if (gSplatting) {
+				frameStage("DrawSplats");
+				DrawSplats(pf, distance);
+			}
+			else {
+				frameStage("DrawObj");
+				tileTextureUpdate(&gTiles, mf, gObjTransform, pf, windowHeight);
+				tileTextureBind(&gTiles);
+				DrawObj();
+				tileTextureUnbind(&gTiles);
+			}
+		}
+		if (w > 0.0f) {
+			frameStage("impostorDraw");
+			impostorDraw(&gImpostor, mf, gObjTransform, w);
+		}
 
-	} // gPatt_found
+	} // found
 
 	// Any 2D overlays go here.
+	frameStage("overlays");
 	glMatrixMode(GL_PROJECTION);
 	glLoadIdentity();
 	glOrtho(0, (GLdouble)windowWidth, 0, (GLdouble)windowHeight, -1.0, 1.0);
@@ -527,6 +1303,7 @@ static void Display(void)
 	glLoadIdentity();
 	glDisable(GL_LIGHTING);
 	glDisable(GL_DEPTH_TEST);
+	debugOverlayDraw(&gDebugOverlay, windowWidth, windowHeight);
 
 	//
 	// Draw help text and mode.
@@ -540,7 +1317,17 @@ static void Display(void)
 		}
 	}
 
-	glutSwapBuffers();
+	gpuTimerFrameEnd();
+	frameStage("glutSwapBuffers");
+	pacingSwap();
+	frameEnd();
+
+	// Two passes over the recording make one allocation check.
+	if (gAllocCheck && gReplay.served >= 2 * gReplay.frameCount) {
+		ARLOGi("Allocation check: %ld allocating frames in %d steady state frames.\n", gAllocViolations, gReplay.frameCount);
+		cleanup();
+		exit(gAllocViolations ? 1 : 0);
+	}
 }
 
 //
@@ -559,16 +1346,39 @@ static void Visibility(int visible)
 
 static void cleanup(void)
 {
+	watchdogFinal();
+	profilerFinal();
+	gpuTimerFinal();
+	pacingFinal();
+	if (gMapName) {
+		if (markerMapStats()->observations) markerMapSave(gMapName);
+		markerMapFinal();
+	}
+	impostorFree(&gImpostor);
+	yuvBackgroundFinal(&gYuvBackground);
+	tileTextureClose(&gTiles);
+	debugOverlayFinal(&gDebugOverlay);
 	arglCleanup(gArglSettings);
 	gArglSettings = NULL;
-	arPattDetach(gARHandle);
-	arPattDeleteHandle(gARPattHandle);
-	arVideoCapStop();
-	ar3DDeleteHandle(&gAR3DHandle);
-	arDeleteHandle(gARHandle);
-	arParamLTFree(&gCparamLT);
-	arVideoClose();
-
+	if (!gReplaying) arVideoCapStop();
+	trackerFinal(&gTracker);
+	if (!gReplaying) arVideoClose();
+	frameReplayClose(&gReplay);
+	frameRecordClose(&gRecorder);
+	soakFinal();
+	if (gAllocCheck) stackFinal();
+
+	if (gObjSplats != NULL)
+	{
+		glmDeleteSplats(gObjSplats);
+		gObjSplats = NULL;
+	}
+	if (gObjDrawable != NULL)
+	{
+		glmDeleteDrawable(gObjDrawable);
+		gObjDrawable = NULL;
+	}
+	glmFreeCommands(&gObjCommands);
 	if (gObj != NULL)
 	{
 		glmDelete(gObj);
@@ -635,12 +1445,23 @@ static void printHelpKeys()
 		"Keys:\n",
 		" ? or /        Show/hide this help.",
 		" q or [esc]    Quit program.",
-		" d             Activate / deactivate debug mode.",
+		" d             Debug overlay: off / on / also the binarized image every so often.",
 		" m             Toggle display of mode info.",
 		" a             Toggle between available threshold modes.",
 		" - and +       Switch to manual threshold mode, and adjust threshhold up/down by 5.",
 		" x             Change image processing mode.",
 		" c             Change arglDrawMode and arglTexmapMode.",
+		" p             Change detection policy while no marker is visible.",
+		" b             Bit-packed candidate prefilter off / on / verify.",
+		" f             Write profiler samples as collapsed stacks for flame graphs.",
+		" r             Start / stop recording camera frames for --replay.",
+		" v             Change frame pacing (driver / off / vsync / adaptive / wait).",
+		" o             Draw model as points when triangles are below pixel size / never / always.",
+		" i             Impostor for the model when small: auto / mesh only / impostor only.",
+		" e             Draw at camera rate / display rate holding, interpolating, extrapolating pose.",
+		" y             Convert YUV video in a shader / with argl (YUV camera formats, e.g. --vconf \"-format=420f\").",
+		" g             Map markers seen together on / off (with --map).",
+		" w             Write the marker map (with --map); it is also written on exit after mapping.",
 	};
 #define helpTextLineCount (sizeof(helpText)/sizeof(char *))
 
@@ -657,17 +1478,21 @@ static void printHelpKeys()
 
 static void printMode()
 {
-	int len, thresh, line, mode, xsize, ysize;
+	int len, thresh, line, mode, xsize, ysize, i;
 	AR_LABELING_THRESH_MODE threshMode;
 	ARdouble tempF;
 	char text[256], *text_p;
+	const PresenceStats *ps;
+	const PacingStats *pst;
+	const MarkerMapStats *ms;
 
 	glColor3ub(255, 255, 255);
 	line = 1;
 
 	// Image size and processing mode.
-	arVideoGetSize(&xsize, &ysize);
-	arGetImageProcMode(gARHandle, &mode);
+	xsize = gTracker.xsize;
+	ysize = gTracker.ysize;
+	arGetImageProcMode(gTracker.arHandle, &mode);
 	if (mode == AR_IMAGE_PROC_FRAME_IMAGE) text_p = "full frame";
 	else text_p = "even field only";
 	snprintf(text, sizeof(text), "Processing %dx%d video frames %s", xsize, ysize, text_p);
@@ -675,7 +1500,7 @@ static void printMode()
 	line++;
 
 	// Threshold mode, and threshold, if applicable.
-	arGetLabelingThreshMode(gARHandle, &threshMode);
+	arGetLabelingThreshMode(gTracker.arHandle, &threshMode);
 	switch (threshMode) {
 	case AR_LABELING_THRESH_MODE_MANUAL: text_p = "MANUAL"; break;
 	case AR_LABELING_THRESH_MODE_AUTO_MEDIAN: text_p = "AUTO_MEDIAN, thresh="; break;
@@ -685,7 +1510,7 @@ static void printMode()
 	}
 	snprintf(text, sizeof(text), "Threshold mode: %s", text_p);
 	if (threshMode != AR_LABELING_THRESH_MODE_AUTO_ADAPTIVE) {
-		arGetLabelingThresh(gARHandle, &thresh);
+		arGetLabelingThresh(gTracker.arHandle, &thresh);
 		len = (int)strlen(text);
 		snprintf(text + len, sizeof(text) - len, ", thresh=%d", thresh);
 	}
@@ -693,9 +1518,9 @@ static void printMode()
 	line++;
 
 	// Border size, image processing mode, pattern detection mode.
-	arGetBorderSize(gARHandle, &tempF);
+	arGetBorderSize(gTracker.arHandle, &tempF);
 	snprintf(text, sizeof(text), "Border: %0.1f%%", tempF*100.0);
-	arGetPatternDetectionMode(gARHandle, &mode);
+	arGetPatternDetectionMode(gTracker.arHandle, &mode);
 	switch (mode) {
 	case AR_TEMPLATE_MATCHING_COLOR: text_p = "Colour template (pattern)"; break;
 	case AR_TEMPLATE_MATCHING_MONO: text_p = "Mono template (pattern)"; break;
@@ -710,7 +1535,8 @@ static void printMode()
 	line++;
 
 	// Draw mode.
-	if (arglDrawModeGet(gArglSettings) == AR_DRAW_BY_GL_DRAW_PIXELS) text_p = "GL_DRAW_PIXELS";
+	if (gBackgroundShader) text_p = "YUV shader";
+	else if (arglDrawModeGet(gArglSettings) == AR_DRAW_BY_GL_DRAW_PIXELS) text_p = "GL_DRAW_PIXELS";
 	else {
 		if (arglTexmapModeGet(gArglSettings) == AR_DRAW_TEXTURE_FULL_IMAGE) text_p = "texture mapping";
 		else text_p = "texture mapping (even field only)";
@@ -719,4 +1545,149 @@ static void printMode()
 	print(text, 2.0f, (line - 1)*12.0f + 2.0f, 0, 1);
 	line++;
 
+	// CPU cost of the video background, for both paths once each has run.
+	snprintf(text, sizeof(text), "Background: %s video, CPU %0.3f ms per frame by %s", arUtilGetPixelFormatName(gTracker.pixFormat),
+		gBackgroundCpu[gBackgroundShader]*1000.0, gBackgroundShader ? "shader" : "argl");
+	if (gYuvBackground.program && gBackgroundCpu[!gBackgroundShader] > 0.0) {
+		len = (int)strlen(text);
+		snprintf(text + len, sizeof(text) - len, " (%0.3f ms by %s)", gBackgroundCpu[!gBackgroundShader]*1000.0, gBackgroundShader ? "argl" : "shader");
+	}
+	print(text, 2.0f, (line - 1)*12.0f + 2.0f, 0, 1);
+	line++;
+
+	// Debug overlay and what it costs.
+	if (gDebugOverlay.mode != DEBUG_OVERLAY_OFF) {
+		snprintf(text, sizeof(text), "Debug: %s, CPU %0.3f ms per frame", debugOverlayModeName(gDebugOverlay.mode), gDebugOverlay.cpu*1000.0);
+		if (gDebugOverlay.mode == DEBUG_OVERLAY_IMAGE) {
+			len = (int)strlen(text);
+			snprintf(text + len, sizeof(text) - len, ", image every %d detections", gDebugOverlay.imageInterval);
+		}
+		print(text, 2.0f, (line - 1)*12.0f + 2.0f, 0, 1);
+		line++;
+	}
+
+	// Tile cache, when streaming the model's texture.
+	if (gTiles.program) {
+		snprintf(text, sizeof(text), "Tiles: %d/%d resident (%0.1f MB GPU), %d needed, %d coarser, %d loading, %ld loaded, %ld evicted",
+			gTiles.stats.resident, gTiles.slotNum, (double)gTiles.stats.gpuBytes / (1024.0*1024.0), gTiles.stats.needed,
+			gTiles.stats.missing, gTiles.stats.loading, gTiles.stats.loaded, gTiles.stats.evicted);
+		print(text, 2.0f, (line - 1)*12.0f + 2.0f, 0, 1);
+		line++;
+	}
+
+	// Detection scheduling.
+	ps = &gTracker.presence.stats;
+	snprintf(text, sizeof(text), "Detection: %s%s, detected %ld/%ld frames, saved %0.2f s",
+		presencePolicyName(gTracker.presence.settings.policy), gTracker.presence.idle ? " (idle)" : "",
+		ps->framesDetected, ps->frames, presenceSavedSeconds(ps));
+	if (ps->reacquisitions) {
+		len = (int)strlen(text);
+		snprintf(text + len, sizeof(text) - len, ", reacquire %0.0f ms (mean %0.0f, max %0.0f)",
+			ps->reacquireLast*1000.0, ps->reacquireTotal*1000.0 / ps->reacquisitions, ps->reacquireMax*1000.0);
+	}
+	print(text, 2.0f, (line - 1)*12.0f + 2.0f, 0, 1);
+	line++;
+
+	// Bit-packed labeling.
+	if (gTracker.bitLabelMode == 0) text_p = "off";
+	else if (gTracker.bitLabelMode == 1) text_p = "prefilter";
+	else text_p = "verify";
+	snprintf(text, sizeof(text), "Bit-packed labeling: %s", text_p);
+	if (gTracker.bitLabelMode == 2) {
+		len = (int)strlen(text);
+		snprintf(text + len, sizeof(text) - len, ", %ld mismatches in %ld frames", gTracker.bitLabelMismatches, gTracker.bitLabelChecks);
+	}
+	print(text, 2.0f, (line - 1)*12.0f + 2.0f, 0, 1);
+	line++;
+
+	// SIMD variant of each kernel.
+	snprintf(text, sizeof(text), "Kernels:");
+	for (i = 0; i < kernelCount(); i++) {
+		len = (int)strlen(text);
+		snprintf(text + len, sizeof(text) - len, "%s %s %s", i ? "," : "", kernelName(i), kernelIsaName(kernelSelected(i)));
+	}
+	print(text, 2.0f, (line - 1)*12.0f + 2.0f, 0, 1);
+	line++;
+
+	// Frame pacing, and what it costs in latency and jitter.
+	pst = pacingStats();
+	snprintf(text, sizeof(text), "Pacing: %s", pacingModeName(pst->mode));
+	if (pst->frames) {
+		len = (int)strlen(text);
+		snprintf(text + len, sizeof(text) - len, ", latency to %s %0.1f ms (sd %0.1f), interval %0.2f ms (jitter %0.2f)",
+			pst->measure == PACING_MEASURE_SWAP_RETURN ? "swap return" : "present", pst->latencyMean*1000.0, pst->latencyStd*1000.0,
+			pst->intervalMean*1000.0, pst->intervalStd*1000.0);
+	}
+	print(text, 2.0f, (line - 1)*12.0f + 2.0f, 0, 1);
+	line++;
+
+	// Marker map.
+	if (gMapName) {
+		ms = markerMapStats();
+		snprintf(text, sizeof(text), "Map: %s, %d of %d markers placed, %d pairs from %ld views",
+			markerMapMapping() ? "mapping" : "fixed", ms->placed, ms->markers, ms->edges, ms->observations);
+		if (ms->optimizations) {
+			len = (int)strlen(text);
+			snprintf(text + len, sizeof(text) - len, ", %ld optimizations (%d sweeps, residual %0.2f mm)", ms->optimizations, ms->sweeps, ms->residual);
+		}
+		len = (int)strlen(text);
+		snprintf(text + len, sizeof(text) - len, ", pose from %d markers", ms->solveMarkers);
+		print(text, 2.0f, (line - 1)*12.0f + 2.0f, 0, 1);
+		line++;
+	}
+
+	// Drawing rate against the camera's.
+	if (gRenderDecoupled) snprintf(text, sizeof(text), "Render: display rate, %s pose", posePredictorModeName(gPose.mode));
+	else snprintf(text, sizeof(text), "Render: camera rate");
+	len = (int)strlen(text);
+	snprintf(text + len, sizeof(text) - len, ", drawing %0.1f fps from %0.1f camera fps", gRenderFps, gCameraFps);
+	print(text, 2.0f, (line - 1)*12.0f + 2.0f, 0, 1);
+	line++;
+
+	// Points in place of sub-pixel triangles.
+	if (gSplatMode == 0) text_p = "auto";
+	else if (gSplatMode == 1) text_p = "triangles only";
+	else text_p = "points only";
+	snprintf(text, sizeof(text), "Splats: %s, %0.2f triangles per pixel, drawing ", text_p, gSplatDensity);
+	len = (int)strlen(text);
+	if (gSplatting) snprintf(text + len, sizeof(text) - len, "%u of %u points", gSplatCount, gObjSplats->numpoints);
+	else snprintf(text + len, sizeof(text) - len, "%u triangles", gObj->numtriangles);
+	print(text, 2.0f, (line - 1)*12.0f + 2.0f, 0, 1);
+	line++;
+
+	// Impostor level of detail.
+	if (gImpostor.texture) {
+		snprintf(text, sizeof(text), "Impostor: %s, model %0.0f px (threshold %0.0f), drawing %s",
+			impostorPolicyName(gImpostorLOD.policy), gImpostorLOD.pixels, gImpostorLOD.threshold,
+			gImpostorLOD.weight <= 0.0f ? "mesh" : (gImpostorLOD.weight >= 1.0f ? "impostor" : "both (fading)"));
+		print(text, 2.0f, (line - 1)*12.0f + 2.0f, 0, 1);
+		line++;
+	}
+
+	// GPU time per pass, against the CPU time spent issuing them.
+	if (gpuTimerAvailable()) {
+		snprintf(text, sizeof(text), "GPU %0.2f ms per frame (", gpuTimerFrameMs());
+		for (i = 0; i < gpuTimerPassCount(); i++) {
+			len = (int)strlen(text);
+			snprintf(text + len, sizeof(text) - len, "%s%s %0.2f", i ? ", " : "", gpuTimerPassName(i), gpuTimerPassMs(i));
+		}
+		len = (int)strlen(text);
+		snprintf(text + len, sizeof(text) - len, "), CPU %0.2f ms in Display()", gpuTimerCpuMs());
+		print(text, 2.0f, (line - 1)*12.0f + 2.0f, 0, 1);
+		line++;
+	}
+
+	// Soak progress.
+	if (gSoaking) {
+		snprintf(text, sizeof(text), "Soak: %0.2f h", soakElapsed() / 3600.0);
+		if (soakHours() > 0.0) {
+			len = (int)strlen(text);
+			snprintf(text + len, sizeof(text) - len, " of %0.2f h", soakHours());
+		}
+		len = (int)strlen(text);
+		snprintf(text + len, sizeof(text) - len, ", %d series drifting", soakFlagged());
+		print(text, 2.0f, (line - 1)*12.0f + 2.0f, 0, 1);
+		line++;
+	}
+
 }